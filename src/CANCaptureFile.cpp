@@ -0,0 +1,60 @@
+#include "CANCaptureFile.h"
+
+//----------------------------------------------------------------------------------------
+
+static const char CAPTURE_IDENTIFIER [8] = {'<', 'S', 'A', 'L', 'E', 'A', 'E', '>'} ;
+
+//----------------------------------------------------------------------------------------
+
+CANCaptureFile::CANCaptureFile (void) :
+mFile (),
+mInitialLevelHigh (false),
+mBeginSeconds (0.0),
+mEndSeconds (0.0),
+mTransitionCount (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANCaptureFile::open (const std::string & inPath, std::string & outError) {
+  close () ;
+  bool ok = mFile.open (inPath, outError) ;
+  if (ok) {
+    const uint8_t * header = mFile.data () ;
+    int32_t version = 0 ;
+    int32_t type = 0 ;
+    uint32_t initialState = 0 ;
+    ok = (mFile.size () >= CAPTURE_HEADER_SIZE) && (memcmp (header, CAPTURE_IDENTIFIER, 8) == 0) ;
+    if (ok) {
+      memcpy (&version, header + 8, 4) ;
+      memcpy (&type, header + 12, 4) ;
+      memcpy (&initialState, header + 16, 4) ;
+      memcpy (&mBeginSeconds, header + 20, 8) ;
+      memcpy (&mEndSeconds, header + 28, 8) ;
+      memcpy (&mTransitionCount, header + 36, 8) ;
+      mInitialLevelHigh = initialState != 0 ;
+      ok = ((version == 0) || (version == 1))
+        && (type == 0)
+        && (mEndSeconds >= mBeginSeconds)
+        && (mTransitionCount <= ((mFile.size () - CAPTURE_HEADER_SIZE) / sizeof (double)))
+      ;
+    }
+    if (!ok) {
+      outError = inPath + ": not a Logic 2 digital binary export, or incomplete" ;
+      close () ;
+    }
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANCaptureFile::close (void) {
+  mFile.close () ;
+  mInitialLevelHigh = false ;
+  mBeginSeconds = 0.0 ;
+  mEndSeconds = 0.0 ;
+  mTransitionCount = 0 ;
+}
+
+//----------------------------------------------------------------------------------------
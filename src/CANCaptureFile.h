@@ -0,0 +1,53 @@
+#ifndef CAN_CAPTURE_FILE
+#define CAN_CAPTURE_FILE
+
+//----------------------------------------------------------------------------------------
+// Capture file, as exported by Logic 2 for one digital channel (binary raw data export),
+// mapped in memory (see CANMappedFile.h); transition times are read in place. Does not
+// depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include "CANMappedFile.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------------------------
+// File layout, little endian, without padding:
+//   - "<SALEAE>", int32 version (0 or 1), int32 type (0: digital);
+//   - uint32 initial state (0: low), double begin time, double end time (seconds);
+//   - uint64 transition count, then a double time (seconds) per transition.
+
+static const size_t CAPTURE_HEADER_SIZE = 8 + 4 + 4 + 4 + 8 + 8 + 8 ;
+
+//----------------------------------------------------------------------------------------
+
+class CANCaptureFile {
+
+  public: CANCaptureFile (void) ;
+
+//--- Maps the file and checks its header and size; on failure, outError is set
+  public: bool open (const std::string & inPath, std::string & outError) ;
+
+  public: void close (void) ;
+
+  public: inline bool initialLevelHigh (void) const { return mInitialLevelHigh ; }
+  public: inline double beginSeconds (void) const { return mBeginSeconds ; }
+  public: inline double endSeconds (void) const { return mEndSeconds ; }
+  public: inline uint64_t transitionCount (void) const { return mTransitionCount ; }
+
+  public: inline double transitionSeconds (const uint64_t inIndex) const {
+    double result ; // Not aligned
+    memcpy (&result, mFile.data () + CAPTURE_HEADER_SIZE + inIndex * sizeof (double), sizeof (double)) ;
+    return result ;
+  }
+
+  private: CANMappedFile mFile ;
+  private: bool mInitialLevelHigh ;
+  private: double mBeginSeconds ;
+  private: double mEndSeconds ;
+  private: uint64_t mTransitionCount ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_CAPTURE_FILE
@@ -0,0 +1,341 @@
+#include "CANColumnarFile.h"
+
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------
+
+static_assert (sizeof (ColumnarFileHeader) == 64, "ColumnarFileHeader layout") ;
+static_assert (sizeof (ColumnarBlockIndex) == 48, "ColumnarBlockIndex layout") ;
+
+//----------------------------------------------------------------------------------------
+
+static inline uint8_t payloadLength (const uint8_t inFlags, const uint8_t inDataCodeLength) {
+  return ((inFlags & COLUMNAR_REMOTE_FLAG) != 0)
+    ? 0
+    : canDataLengthForCode (inDataCodeLength, (inFlags & COLUMNAR_FD_FLAG) != 0)
+  ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANColumnarWriter
+//----------------------------------------------------------------------------------------
+
+CANColumnarWriter::CANColumnarWriter (void) :
+mFile (NULL),
+mFileSize (0),
+mHeader (),
+mIndex (),
+mBlock (),
+mTimeOffsets (),
+mIdentifierKeys (),
+mFlags (),
+mDataCodeLengths (),
+mPayloads () {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANColumnarWriter::~ CANColumnarWriter (void) {
+  if (mFile != NULL) {
+    fclose (mFile) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANColumnarWriter::write (const void * inData, const size_t inSize, std::string & outError) {
+  const bool ok = (inSize == 0) || (fwrite (inData, 1, inSize, mFile) == inSize) ;
+  if (ok) {
+    mFileSize += inSize ;
+  }else{
+    outError = std::string ("write: ") + strerror (errno) ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANColumnarWriter::open (const std::string & inPath,
+                              const uint32_t inSampleRateHz,
+                              const uint64_t inTriggerSampleNumber,
+                              std::string & outError) {
+  mFile = fopen (inPath.c_str (), "wb") ;
+  if (mFile == NULL) {
+    outError = inPath + ": " + strerror (errno) ;
+    return false ;
+  }
+  memset (&mHeader, 0, sizeof (mHeader)) ;
+  mHeader.mMagic = COLUMNAR_MAGIC ;
+  mHeader.mVersion = COLUMNAR_VERSION ;
+  mHeader.mHeaderSize = uint16_t (sizeof (ColumnarFileHeader)) ;
+  mHeader.mSampleRateHz = inSampleRateHz ;
+  mHeader.mTriggerSampleNumber = inTriggerSampleNumber ;
+  mFileSize = 0 ;
+  mIndex.clear () ;
+  mBlock.mMessageCount = 0 ;
+  return write (&mHeader, sizeof (mHeader), outError) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANColumnarWriter::append (const CANDecodedMessage & inMessage, std::string & outError) {
+  bool ok = true ;
+  if ((mBlock.mMessageCount > 0)
+   && ((inMessage.mStartSampleNumber - mBlock.mFirstSampleNumber) > UINT32_MAX)) {
+    ok = flushBlock (outError) ;
+  }
+  const uint32_t key = CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended) ;
+  if (mBlock.mMessageCount == 0) {
+    mBlock.mFirstSampleNumber = inMessage.mStartSampleNumber ;
+    mBlock.mPayloadByteCount = 0 ;
+    mBlock.mMinimumIdentifierKey = key ;
+    mBlock.mMaximumIdentifierKey = key ;
+    mBlock.mIdentifierBloom = 0 ;
+  }
+  const uint8_t flags = uint8_t (
+      (inMessage.mExtended ? COLUMNAR_EXTENDED_FLAG : 0)
+    | (inMessage.mRemote ? COLUMNAR_REMOTE_FLAG : 0)
+    | (inMessage.mFD ? COLUMNAR_FD_FLAG : 0)
+    | (inMessage.mBRS ? COLUMNAR_BRS_FLAG : 0)
+    | (inMessage.mESI ? COLUMNAR_ESI_FLAG : 0)
+    | (inMessage.mAcked ? COLUMNAR_ACKED_FLAG : 0)
+  ) ;
+  const uint8_t dataCodeLength = inMessage.mDataCodeLength & 0xF ;
+  const uint8_t length = payloadLength (flags, dataCodeLength) ;
+  mTimeOffsets.push_back (uint32_t (inMessage.mStartSampleNumber - mBlock.mFirstSampleNumber)) ;
+  mIdentifierKeys.push_back (key) ;
+  mFlags.push_back (flags) ;
+  mDataCodeLengths.push_back (dataCodeLength) ;
+  mPayloads.insert (mPayloads.end (), inMessage.mData, inMessage.mData + length) ;
+  mBlock.mLastSampleNumber = inMessage.mStartSampleNumber ;
+  mBlock.mMessageCount += 1 ;
+  mBlock.mPayloadByteCount += length ;
+  mBlock.mMinimumIdentifierKey = std::min (mBlock.mMinimumIdentifierKey, key) ;
+  mBlock.mMaximumIdentifierKey = std::max (mBlock.mMaximumIdentifierKey, key) ;
+  mBlock.mIdentifierBloom |= uint64_t (1) << columnarBloomBit (key) ;
+  if (ok && (mBlock.mMessageCount == COLUMNAR_BLOCK_MESSAGE_COUNT)) {
+    ok = flushBlock (outError) ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANColumnarWriter::flushBlock (std::string & outError) {
+  bool ok = true ;
+  if (mBlock.mMessageCount > 0) {
+    static const uint8_t padding [8] = {0, 0, 0, 0, 0, 0, 0, 0} ;
+    ok = write (padding, size_t ((8 - (mFileSize & 7)) & 7), outError) ;
+    mBlock.mOffset = mFileSize ;
+    ok = ok && write (mTimeOffsets.data (), mTimeOffsets.size () * sizeof (uint32_t), outError) ;
+    ok = ok && write (mIdentifierKeys.data (), mIdentifierKeys.size () * sizeof (uint32_t), outError) ;
+    ok = ok && write (mFlags.data (), mFlags.size (), outError) ;
+    ok = ok && write (mDataCodeLengths.data (), mDataCodeLengths.size (), outError) ;
+    ok = ok && write (mPayloads.data (), mPayloads.size (), outError) ;
+    mIndex.push_back (mBlock) ;
+    mHeader.mMessageCount += mBlock.mMessageCount ;
+    mBlock.mMessageCount = 0 ;
+    mTimeOffsets.clear () ;
+    mIdentifierKeys.clear () ;
+    mFlags.clear () ;
+    mDataCodeLengths.clear () ;
+    mPayloads.clear () ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANColumnarWriter::close (std::string & outError) {
+  bool ok = mFile != NULL ;
+  if (ok) {
+    ok = flushBlock (outError) ;
+    static const uint8_t padding [8] = {0, 0, 0, 0, 0, 0, 0, 0} ;
+    ok = ok && write (padding, size_t ((8 - (mFileSize & 7)) & 7), outError) ;
+    mHeader.mIndexOffset = mFileSize ;
+    mHeader.mBlockCount = uint32_t (mIndex.size ()) ;
+    ok = ok && write (mIndex.data (), mIndex.size () * sizeof (ColumnarBlockIndex), outError) ;
+  //--- The header is completed last: a truncated file has no index
+    if (ok && (fseek (mFile, 0, SEEK_SET) != 0)) {
+      outError = std::string ("seek: ") + strerror (errno) ;
+      ok = false ;
+    }
+    ok = ok && write (&mHeader, sizeof (mHeader), outError) ;
+    if ((fclose (mFile) != 0) && ok) {
+      outError = std::string ("close: ") + strerror (errno) ;
+      ok = false ;
+    }
+    mFile = NULL ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANColumnarReader
+//----------------------------------------------------------------------------------------
+
+CANColumnarReader::CANColumnarReader (void) :
+mFile (),
+mHeader (NULL),
+mIndex (NULL) {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANColumnarReader::~ CANColumnarReader (void) {
+  close () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANColumnarReader::open (const std::string & inPath, std::string & outError) {
+  close () ;
+  if (!mFile.open (inPath, outError)) {
+    return false ;
+  }
+  const size_t size = mFile.size () ;
+  if (size < sizeof (ColumnarFileHeader)) {
+    outError = inPath + ": not a columnar message file" ;
+    mFile.close () ;
+    return false ;
+  }
+  mHeader = reinterpret_cast <const ColumnarFileHeader *> (mFile.data ()) ;
+//--- Check header and index, so that accesses stay within the mapping
+  bool ok = (mHeader->mMagic == COLUMNAR_MAGIC)
+    && (mHeader->mVersion == COLUMNAR_VERSION)
+    && (mHeader->mHeaderSize == sizeof (ColumnarFileHeader))
+    && (mHeader->mIndexOffset >= sizeof (ColumnarFileHeader))
+    && ((mHeader->mIndexOffset & 7) == 0)
+    && (mHeader->mIndexOffset <= size)
+    && (uint64_t (mHeader->mBlockCount) <= ((size - mHeader->mIndexOffset) / sizeof (ColumnarBlockIndex)))
+  ;
+  if (ok) {
+    mIndex = reinterpret_cast <const ColumnarBlockIndex *> (mFile.data () + mHeader->mIndexOffset) ;
+  }
+  uint64_t messageCount = 0 ;
+  for (uint32_t i=0 ; ok && (i<mHeader->mBlockCount) ; i++) {
+    const ColumnarBlockIndex & block = mIndex [i] ;
+    const uint64_t blockSize = uint64_t (block.mMessageCount) * 10 + block.mPayloadByteCount ;
+    ok = ((block.mOffset & 7) == 0)
+      && (block.mOffset >= sizeof (ColumnarFileHeader))
+      && (block.mMessageCount > 0)
+      && (block.mMessageCount <= COLUMNAR_BLOCK_MESSAGE_COUNT)
+      && (blockSize <= (mHeader->mIndexOffset - std::min (mHeader->mIndexOffset, block.mOffset)))
+      && ((i == 0) || (mIndex [i-1].mLastSampleNumber <= block.mFirstSampleNumber))
+    ;
+//--- Row payloads: message and scan walk them from the block start
+    if (ok) {
+      const uint32_t n = block.mMessageCount ;
+      const uint8_t * flags = mFile.data () + block.mOffset + size_t (n) * 8 ;
+      const uint8_t * dataCodeLengths = flags + n ;
+      uint64_t payloadByteCount = 0 ;
+      for (uint32_t r=0 ; r<n ; r++) {
+        payloadByteCount += payloadLength (flags [r], dataCodeLengths [r]) ;
+      }
+      ok = payloadByteCount == block.mPayloadByteCount ;
+    }
+    messageCount += block.mMessageCount ;
+  }
+  ok = ok && (messageCount == mHeader->mMessageCount) ;
+  if (!ok) {
+    outError = inPath + ": not a columnar message file, or incomplete" ;
+    close () ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANColumnarReader::close (void) {
+  mFile.close () ;
+  mHeader = NULL ;
+  mIndex = NULL ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANColumnarReader::message (const uint32_t inBlock,
+                                 const uint32_t inRow,
+                                 CANColumnarMessage & outMessage) const {
+  const ColumnarBlockIndex & block = mIndex [inBlock] ;
+  const uint32_t n = block.mMessageCount ;
+  const uint8_t * base = mFile.data () + block.mOffset ;
+  const uint32_t * timeOffsets = reinterpret_cast <const uint32_t *> (base) ;
+  const uint32_t * identifierKeys = timeOffsets + n ;
+  const uint8_t * flags = base + size_t (n) * 8 ;
+  const uint8_t * dataCodeLengths = flags + n ;
+  const uint8_t * payload = dataCodeLengths + n ;
+  for (uint32_t i=0 ; i<inRow ; i++) {
+    payload += payloadLength (flags [i], dataCodeLengths [i]) ;
+  }
+  outMessage.mSampleNumber = block.mFirstSampleNumber + timeOffsets [inRow] ;
+  outMessage.mIdentifierKey = identifierKeys [inRow] ;
+  outMessage.mFlags = flags [inRow] ;
+  outMessage.mDataCodeLength = dataCodeLengths [inRow] ;
+  outMessage.mDataLength = payloadLength (flags [inRow], dataCodeLengths [inRow]) ;
+  outMessage.mData = payload ;
+}
+
+//----------------------------------------------------------------------------------------
+
+uint64_t CANColumnarReader::scan (const uint64_t inFirstSampleNumber,
+                                  const uint64_t inEndSampleNumber,
+                                  const uint32_t inIdentifierKey,
+                                  const uint32_t inIdentifierMask,
+                                  CANColumnarVisitor & inVisitor) const {
+  uint64_t visitCount = 0 ;
+//--- First block whose last message is not before the range
+  uint32_t low = 0 ;
+  uint32_t high = mHeader->mBlockCount ;
+  while (low < high) {
+    const uint32_t middle = low + (high - low) / 2 ;
+    if (mIndex [middle].mLastSampleNumber < inFirstSampleNumber) {
+      low = middle + 1 ;
+    }else{
+      high = middle ;
+    }
+  }
+  const bool exactKey = inIdentifierMask == UINT32_MAX ;
+  const uint64_t bloomBit = uint64_t (1) << columnarBloomBit (inIdentifierKey) ;
+  bool goOn = true ;
+  for (uint32_t b=low ; goOn && (b<mHeader->mBlockCount) && (mIndex [b].mFirstSampleNumber < inEndSampleNumber) ; b++) {
+    const ColumnarBlockIndex & block = mIndex [b] ;
+    const bool skip = exactKey
+      && ((inIdentifierKey < block.mMinimumIdentifierKey)
+       || (inIdentifierKey > block.mMaximumIdentifierKey)
+       || ((block.mIdentifierBloom & bloomBit) == 0))
+    ;
+    if (!skip) {
+      const uint32_t n = block.mMessageCount ;
+      const uint8_t * base = mFile.data () + block.mOffset ;
+      const uint32_t * timeOffsets = reinterpret_cast <const uint32_t *> (base) ;
+      const uint32_t * identifierKeys = timeOffsets + n ;
+      const uint8_t * flags = base + size_t (n) * 8 ;
+      const uint8_t * dataCodeLengths = flags + n ;
+      const uint8_t * payload = dataCodeLengths + n ;
+      for (uint32_t i=0 ; goOn && (i<n) ; i++) {
+        const uint8_t length = payloadLength (flags [i], dataCodeLengths [i]) ;
+        const uint64_t sampleNumber = block.mFirstSampleNumber + timeOffsets [i] ;
+        if ((sampleNumber >= inFirstSampleNumber)
+         && (sampleNumber < inEndSampleNumber)
+         && ((identifierKeys [i] & inIdentifierMask) == inIdentifierKey)) {
+          CANColumnarMessage message ;
+          message.mSampleNumber = sampleNumber ;
+          message.mIdentifierKey = identifierKeys [i] ;
+          message.mFlags = flags [i] ;
+          message.mDataCodeLength = dataCodeLengths [i] ;
+          message.mDataLength = length ;
+          message.mData = payload ;
+          visitCount += 1 ;
+          goOn = inVisitor.visit (message) ;
+        }
+        payload += length ;
+      }
+    }
+  }
+  return visitCount ;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,190 @@
+#ifndef CAN_COLUMNAR_FILE
+#define CAN_COLUMNAR_FILE
+
+//----------------------------------------------------------------------------------------
+// Columnar binary message file: decoded messages are written in blocks of at most
+// COLUMNAR_BLOCK_MESSAGE_COUNT messages, each block stores its columns one after the
+// other, and an index of blocks (time range, identifier range and identifier Bloom
+// filter) ends the file. The reader maps the whole file (see CANMappedFile.h): opening
+// reads the header and the index only, a range scan by time or by identifier skips the
+// blocks that cannot match. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+#include "CANMappedFile.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t COLUMNAR_MAGIC = 0x4C4F4343 ; // "CCOL", little endian
+static const uint16_t COLUMNAR_VERSION = 1 ;
+static const uint32_t COLUMNAR_BLOCK_MESSAGE_COUNT = 4096 ;
+
+//----------------------------------------------------------------------------------------
+
+static const uint8_t COLUMNAR_EXTENDED_FLAG = 0x01 ;
+static const uint8_t COLUMNAR_REMOTE_FLAG = 0x02 ;
+static const uint8_t COLUMNAR_FD_FLAG = 0x04 ;
+static const uint8_t COLUMNAR_BRS_FLAG = 0x08 ;
+static const uint8_t COLUMNAR_ESI_FLAG = 0x10 ;
+static const uint8_t COLUMNAR_ACKED_FLAG = 0x20 ;
+
+//----------------------------------------------------------------------------------------
+// File layout, little endian: a 64-byte header, the blocks, then mBlockCount block index
+// entries at mIndexOffset. A block of N messages, at its mOffset (8-byte aligned):
+//   - N uint32_t: SOF sample number minus the block mFirstSampleNumber;
+//   - N uint32_t: identifier key (see CANErrorCounters::identifierKey);
+//   - N uint8_t: COLUMNAR_xxx_FLAG;
+//   - N uint8_t: DLC as transmitted;
+//   - payloads, concatenated: canDataLengthForCode (DLC, FD) bytes per message, none for
+//     a remote frame.
+// A block ends before a time offset would not fit in 32 bits.
+
+class ColumnarFileHeader {
+  public: uint32_t mMagic ;
+  public: uint16_t mVersion ;
+  public: uint16_t mHeaderSize ;
+  public: uint32_t mSampleRateHz ; // Sample numbers are in this unit
+  public: uint32_t mBlockCount ;
+  public: uint64_t mTriggerSampleNumber ; // Time origin
+  public: uint64_t mMessageCount ;
+  public: uint64_t mIndexOffset ; // 0 while the file is being written
+  public: uint8_t mReserved [24] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class ColumnarBlockIndex {
+  public: uint64_t mOffset ;
+  public: uint64_t mFirstSampleNumber ;
+  public: uint64_t mLastSampleNumber ;
+  public: uint32_t mMessageCount ;
+  public: uint32_t mPayloadByteCount ;
+  public: uint32_t mMinimumIdentifierKey ;
+  public: uint32_t mMaximumIdentifierKey ;
+  public: uint64_t mIdentifierBloom ; // Bit columnarBloomBit (key) set for each key
+} ;
+
+//----------------------------------------------------------------------------------------
+
+static inline uint32_t columnarBloomBit (const uint32_t inIdentifierKey) {
+  return uint32_t ((uint64_t (inIdentifierKey) * 0x9E3779B97F4A7C15ULL) >> 58) ;
+}
+
+//----------------------------------------------------------------------------------------
+//   Writer
+//----------------------------------------------------------------------------------------
+
+class CANColumnarWriter {
+
+  public: CANColumnarWriter (void) ;
+
+  public: ~ CANColumnarWriter (void) ;
+
+//--- On failure, outError is set
+  public: bool open (const std::string & inPath,
+                     const uint32_t inSampleRateHz,
+                     const uint64_t inTriggerSampleNumber,
+                     std::string & outError) ;
+
+//--- Messages are entered in increasing mStartSampleNumber order
+  public: bool append (const CANDecodedMessage & inMessage, std::string & outError) ;
+
+//--- Writes the last block, the index, and the final header
+  public: bool close (std::string & outError) ;
+
+  private: bool flushBlock (std::string & outError) ;
+  private: bool write (const void * inData, const size_t inSize, std::string & outError) ;
+
+  private: FILE * mFile ;
+  private: uint64_t mFileSize ;
+  private: ColumnarFileHeader mHeader ;
+  private: std::vector <ColumnarBlockIndex> mIndex ;
+  private: ColumnarBlockIndex mBlock ; // Being filled
+  private: std::vector <uint32_t> mTimeOffsets ;
+  private: std::vector <uint32_t> mIdentifierKeys ;
+  private: std::vector <uint8_t> mFlags ;
+  private: std::vector <uint8_t> mDataCodeLengths ;
+  private: std::vector <uint8_t> mPayloads ;
+
+//--- No copy
+  private: CANColumnarWriter (const CANColumnarWriter &) ;
+  private: CANColumnarWriter & operator = (const CANColumnarWriter &) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+//   Reader
+//----------------------------------------------------------------------------------------
+
+class CANColumnarMessage {
+  public: uint64_t mSampleNumber ; // SOF
+  public: uint32_t mIdentifierKey ;
+  public: uint8_t mFlags ; // COLUMNAR_xxx_FLAG
+  public: uint8_t mDataCodeLength ;
+  public: uint8_t mDataLength ;
+  public: const uint8_t * mData ; // In the mapping
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANColumnarVisitor {
+  public: virtual ~CANColumnarVisitor (void) {}
+
+//--- Returns false to stop the scan
+  public: virtual bool visit (const CANColumnarMessage & inMessage) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANColumnarReader {
+
+  public: CANColumnarReader (void) ;
+
+  public: ~ CANColumnarReader (void) ;
+
+//--- Maps the file and checks its header, its index, and the payload byte count of each
+//    block against its rows; on failure, outError is set
+  public: bool open (const std::string & inPath, std::string & outError) ;
+
+  public: void close (void) ;
+
+  public: inline bool isOpen (void) const { return mHeader != NULL ; }
+
+  public: inline uint32_t sampleRateHz (void) const { return mHeader->mSampleRateHz ; }
+  public: inline uint64_t triggerSampleNumber (void) const { return mHeader->mTriggerSampleNumber ; }
+  public: inline uint64_t messageCount (void) const { return mHeader->mMessageCount ; }
+  public: inline uint32_t blockCount (void) const { return mHeader->mBlockCount ; }
+  public: inline const ColumnarBlockIndex & blockIndex (const uint32_t inBlock) const { return mIndex [inBlock] ; }
+
+//--- Row inRow of block inBlock; payloads are located by summing the lengths of the
+//    previous rows, a sequential scan should use scan
+  public: void message (const uint32_t inBlock,
+                        const uint32_t inRow,
+                        CANColumnarMessage & outMessage) const ;
+
+//--- Messages with inFirstSampleNumber <= SOF < inEndSampleNumber and
+//    (key & inIdentifierMask) == inIdentifierKey, in file order; blocks out of the time
+//    range are skipped by binary search, blocks without the key (full mask) by identifier
+//    range and Bloom filter. Returns the count of visited messages.
+  public: uint64_t scan (const uint64_t inFirstSampleNumber,
+                         const uint64_t inEndSampleNumber,
+                         const uint32_t inIdentifierKey,
+                         const uint32_t inIdentifierMask,
+                         CANColumnarVisitor & inVisitor) const ;
+
+  private: CANMappedFile mFile ;
+  private: const ColumnarFileHeader * mHeader ;
+  private: const ColumnarBlockIndex * mIndex ;
+
+//--- No copy
+  private: CANColumnarReader (const CANColumnarReader &) ;
+  private: CANColumnarReader & operator = (const CANColumnarReader &) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_COLUMNAR_FILE
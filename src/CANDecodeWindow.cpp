@@ -0,0 +1,102 @@
+#include "CANDecodeWindow.h"
+
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------------
+
+static bool parseBound (const std::string & inText, bool & outPresent, double & outValue) {
+  size_t first = 0 ;
+  while ((first < inText.size ()) && (inText [first] == ' ')) {
+    first += 1 ;
+  }
+  size_t last = inText.size () ;
+  while ((last > first) && (inText [last - 1] == ' ')) {
+    last -= 1 ;
+  }
+  outPresent = last > first ;
+  outValue = 0.0 ;
+  bool ok = true ;
+  if (outPresent) {
+    const std::string text = inText.substr (first, last - first) ;
+    char * end = NULL ;
+    outValue = strtod (text.c_str (), &end) ;
+    ok = (end == (text.c_str () + text.size ()))
+      && (outValue > -1.0e15) && (outValue < 1.0e15) // Also rejects NaN and infinities
+    ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+CANDecodeWindow::CANDecodeWindow (void) :
+mReference (WINDOW_WHOLE_CAPTURE),
+mHasStart (false),
+mHasEnd (false),
+mStart (0.0),
+mEnd (0.0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANDecodeWindow::set (const CANDecodeWindowReference inReference,
+                           const std::string & inStartText,
+                           const std::string & inEndText) {
+  bool hasStart ;
+  double start ;
+  bool hasEnd ;
+  double end ;
+  bool ok = parseBound (inStartText, hasStart, start) && parseBound (inEndText, hasEnd, end) ;
+  if (ok && (inReference != WINDOW_SECONDS_FROM_TRIGGER)) {
+    ok = (start >= 0.0) && (end >= 0.0) ;
+  }
+  if (ok && hasStart && hasEnd) {
+    ok = end > start ;
+  }
+  if (ok) {
+    mReference = inReference ;
+    mHasStart = hasStart ;
+    mHasEnd = hasEnd ;
+    mStart = start ;
+    mEnd = end ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANDecodeWindow::resolve (const uint32_t inSampleRateHz,
+                               const uint64_t inFirstSampleNumber,
+                               const uint64_t inTriggerSampleNumber,
+                               uint64_t & outStartSampleNumber,
+                               uint64_t & outEndSampleNumber) const {
+  double origin = 0.0 ;
+  double scale = 1.0 ;
+  switch (mReference) {
+  case WINDOW_WHOLE_CAPTURE :
+  case WINDOW_SAMPLES :
+    break ;
+  case WINDOW_SECONDS :
+    origin = double (inFirstSampleNumber) ;
+    scale = double (inSampleRateHz) ;
+    break ;
+  case WINDOW_SECONDS_FROM_TRIGGER :
+    origin = double (inTriggerSampleNumber) ;
+    scale = double (inSampleRateHz) ;
+    break ;
+  }
+  outStartSampleNumber = inFirstSampleNumber ;
+  outEndSampleNumber = UINT64_MAX ;
+  if (mReference != WINDOW_WHOLE_CAPTURE) {
+    const double start = mHasStart ? (origin + mStart * scale) : origin ;
+    if (start > double (inFirstSampleNumber)) {
+      outStartSampleNumber = uint64_t (start + 0.5) ;
+    }
+    if (mHasEnd) {
+      const double end = origin + mEnd * scale ;
+      outEndSampleNumber = (end > double (outStartSampleNumber)) ? uint64_t (end + 0.5) : outStartSampleNumber ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
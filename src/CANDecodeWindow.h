@@ -0,0 +1,54 @@
+#ifndef CAN_DECODE_WINDOW
+#define CAN_DECODE_WINDOW
+
+//----------------------------------------------------------------------------------------
+// Decode window: the part of the capture that is decoded, given in absolute samples, in
+// seconds from the capture start, or in seconds relative to the trigger. Does not depend
+// on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  WINDOW_WHOLE_CAPTURE, // Window disabled
+  WINDOW_SAMPLES,
+  WINDOW_SECONDS,
+  WINDOW_SECONDS_FROM_TRIGGER
+} CANDecodeWindowReference ;
+
+//----------------------------------------------------------------------------------------
+
+class CANDecodeWindow {
+
+  public: CANDecodeWindow (void) ;
+
+//--- Bounds are decimal numbers, negative only relative to the trigger; an empty start is
+// the capture start (or the trigger), an empty end is the capture end. Returns false on
+// syntax error, or if the end is not after the start; the window is then unchanged.
+  public: bool set (const CANDecodeWindowReference inReference,
+                    const std::string & inStartText,
+                    const std::string & inEndText) ;
+
+  public: inline bool wholeCapture (void) const { return mReference == WINDOW_WHOLE_CAPTURE ; }
+
+//--- Window in samples: from outStartSampleNumber to (excluding) outEndSampleNumber,
+// UINT64_MAX if no end is given
+  public: void resolve (const uint32_t inSampleRateHz,
+                        const uint64_t inFirstSampleNumber,
+                        const uint64_t inTriggerSampleNumber,
+                        uint64_t & outStartSampleNumber,
+                        uint64_t & outEndSampleNumber) const ;
+
+  private: CANDecodeWindowReference mReference ;
+  private: bool mHasStart ;
+  private: bool mHasEnd ;
+  private: double mStart ;
+  private: double mEnd ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_DECODE_WINDOW
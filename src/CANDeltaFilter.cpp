@@ -0,0 +1,131 @@
+#include "CANDeltaFilter.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t INITIAL_ENTRY_COUNT = 256 ;
+
+static const uint8_t REMOTE_FLAG = 1 ;
+static const uint8_t FD_FLAG = 2 ;
+
+//----------------------------------------------------------------------------------------
+
+static inline uint8_t messageFlags (const CANDecodedMessage & inMessage) {
+  return uint8_t ((inMessage.mRemote ? REMOTE_FLAG : 0) | (inMessage.mFD ? FD_FLAG : 0)) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+CANDeltaFilter::Entry::Entry (void) :
+mUsed (false),
+mFlags (0),
+mDataCodeLength (0),
+mDataLength (0),
+mIdentifierKey (0),
+mRepeatCount (0),
+mLastSeenSampleNumber (0),
+mData () {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANDeltaFilter::CANDeltaFilter (CANDeltaFilterDelegate * inDelegate) :
+mDelegate (inDelegate),
+mEntries (),
+mUsedCount (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANDeltaFilter::clear (void) {
+  mEntries.assign (INITIAL_ENTRY_COUNT, Entry ()) ;
+  mUsedCount = 0 ;
+}
+
+//----------------------------------------------------------------------------------------
+// Linear probing from a multiplicative hash of the key; the table is at most half full
+
+CANDeltaFilter::Entry & CANDeltaFilter::entry (const uint32_t inIdentifierKey, bool & outFound) {
+  if (mEntries.empty ()) {
+    clear () ;
+  }
+  const uint32_t mask = uint32_t (mEntries.size () - 1) ;
+  uint32_t idx = (inIdentifierKey * 0x9E3779B1U) & mask ;
+  while (mEntries [idx].mUsed && (mEntries [idx].mIdentifierKey != inIdentifierKey)) {
+    idx = (idx + 1) & mask ;
+  }
+  outFound = mEntries [idx].mUsed ;
+  return mEntries [idx] ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANDeltaFilter::grow (void) {
+  std::vector <Entry> entries (mEntries.size () * 2) ;
+  entries.swap (mEntries) ;
+  for (size_t i=0 ; i<entries.size () ; i++) {
+    if (entries [i].mUsed) {
+      bool found ;
+      entry (entries [i].mIdentifierKey, found) = entries [i] ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANDeltaFilter::record (Entry & ioEntry, const CANDecodedMessage & inMessage) {
+  ioEntry.mFlags = messageFlags (inMessage) ;
+  ioEntry.mDataCodeLength = inMessage.mDataCodeLength ;
+  ioEntry.mDataLength = inMessage.mDataLength ;
+  ioEntry.mLastSeenSampleNumber = inMessage.mStartSampleNumber ;
+  memcpy (ioEntry.mData, inMessage.mData, inMessage.mDataLength) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANDeltaFilter::enter (const CANDecodedMessage & inMessage,
+                            const bool inForced,
+                            uint64_t & outFoldedCount) {
+  const uint32_t key = CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended) ;
+  bool found ;
+  Entry & e = entry (key, found) ;
+  const bool changed = inForced
+    || !found
+    || (e.mFlags != messageFlags (inMessage))
+    || (e.mDataCodeLength != inMessage.mDataCodeLength)
+    || (memcmp (e.mData, inMessage.mData, inMessage.mDataLength) != 0)
+  ;
+  outFoldedCount = 0 ;
+  if (changed) {
+    outFoldedCount = e.mRepeatCount ;
+    e.mRepeatCount = 0 ;
+    if (!found) {
+      e.mUsed = true ;
+      e.mIdentifierKey = key ;
+      mUsedCount += 1 ;
+    }
+    record (e, inMessage) ;
+    if ((2 * mUsedCount) > mEntries.size ()) {
+      grow () ;
+    }
+  }else{
+    e.mRepeatCount += 1 ;
+    e.mLastSeenSampleNumber = inMessage.mStartSampleNumber ;
+  }
+  return changed ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANDeltaFilter::flushRepeats (const uint64_t inSampleNumber) {
+  for (size_t i=0 ; i<mEntries.size () ; i++) {
+    Entry & e = mEntries [i] ;
+    if (e.mUsed && (e.mRepeatCount > 0)) {
+      mDelegate->addRepeats (e.mIdentifierKey, e.mRepeatCount, e.mLastSeenSampleNumber, inSampleNumber) ;
+      e.mRepeatCount = 0 ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
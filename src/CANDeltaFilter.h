@@ -0,0 +1,67 @@
+#ifndef CAN_DELTA_FILTER
+#define CAN_DELTA_FILTER
+
+//----------------------------------------------------------------------------------------
+// Changed messages only: last frame format and payload per identifier, in an open
+// addressing hash table. A message identical to the previous one of its identifier is
+// folded into a repeat count. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+class CANDeltaFilterDelegate {
+  public: virtual ~CANDeltaFilterDelegate (void) {}
+
+//--- Sent by flushRepeats for each identifier with folded messages since the last flush
+  public: virtual void addRepeats (const uint32_t inIdentifierKey,
+                                   const uint64_t inRepeatCount,
+                                   const uint64_t inLastSeenSampleNumber,
+                                   const uint64_t inSampleNumber) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANDeltaFilter {
+
+  public: CANDeltaFilter (CANDeltaFilterDelegate * inDelegate) ;
+
+  public: void clear (void) ;
+
+//--- Returns true if the message differs from the previous one of its identifier, is the
+// first one, or if inForced (error, no ACK); outFoldedCount is then the count of repeats
+// folded since the last flush, no longer reported by flushRepeats. Otherwise, the message
+// is folded into the repeat count of its identifier.
+  public: bool enter (const CANDecodedMessage & inMessage,
+                      const bool inForced,
+                      uint64_t & outFoldedCount) ;
+
+  public: void flushRepeats (const uint64_t inSampleNumber) ;
+
+  private: class Entry {
+    public: Entry (void) ;
+    public: bool mUsed ;
+    public: uint8_t mFlags ; // Remote, FD
+    public: uint8_t mDataCodeLength ;
+    public: uint8_t mDataLength ;
+    public: uint32_t mIdentifierKey ;
+    public: uint64_t mRepeatCount ;
+    public: uint64_t mLastSeenSampleNumber ;
+    public: uint8_t mData [64] ;
+  } ;
+
+  private: Entry & entry (const uint32_t inIdentifierKey, bool & outFound) ;
+  private: void grow (void) ;
+  private: static void record (Entry & ioEntry, const CANDecodedMessage & inMessage) ;
+
+  private: CANDeltaFilterDelegate * mDelegate ;
+  private: std::vector <Entry> mEntries ; // Size is a power of 2
+  private: uint32_t mUsedCount ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_DELTA_FILTER
@@ -0,0 +1,73 @@
+#include "CANDestuffTable.h"
+
+//----------------------------------------------------------------------------------------
+//  TABLE: 2 previous bit values x 5 counts x 256 bytes, 4 bytes per entry (10 KiB)
+//----------------------------------------------------------------------------------------
+
+class CANDestuffTableBuilder {
+  public: CANDestuffTableBuilder (void) {
+    for (uint32_t previous = 0 ; previous < 2 ; previous++) {
+      for (uint32_t count = 1 ; count <= 5 ; count++) {
+        for (uint32_t byte = 0 ; byte < 256 ; byte++) {
+          CANDestuffEntry & entry = mEntries [previous][count - 1][byte] ;
+          entry.mOutputBits = 0 ;
+          entry.mOutputCount = 0 ;
+          entry.mStuffMask = 0 ;
+          entry.mErrorIndex = 8 ;
+          bool previousBit = previous != 0 ;
+          uint32_t sameBitCount = count ;
+          for (uint32_t i=0 ; (i<8) && (entry.mErrorIndex == 8) ; i++) {
+            const bool bit = ((byte << i) & 0x80) != 0 ;
+            if ((sameBitCount == 5) && (bit != previousBit)) { // Stuff bit
+              entry.mStuffMask |= uint8_t (0x80 >> i) ;
+              sameBitCount = 1 ;
+              previousBit = bit ;
+            }else if (sameBitCount == 5) { // Stuff error
+              entry.mErrorIndex = uint8_t (i) ;
+            }else{
+              sameBitCount = (bit == previousBit) ? (sameBitCount + 1) : 1 ;
+              previousBit = bit ;
+              if (bit) {
+                entry.mOutputBits |= uint8_t (0x80 >> entry.mOutputCount) ;
+              }
+              entry.mOutputCount += 1 ;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  public: CANDestuffEntry mEntries [2][5][256] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+const CANDestuffEntry & destuffEntry (const bool inPreviousBit,
+                                      const uint32_t inSameBitCount,
+                                      const uint8_t inRawBits) {
+  static const CANDestuffTableBuilder table ;
+  return table.mEntries [inPreviousBit][inSameBitCount - 1][inRawBits] ;
+}
+
+//----------------------------------------------------------------------------------------
+// Runs include stuff bits, so the state only depends on the trailing run of raw bits
+
+void advanceDestuffState (bool & ioPreviousBit,
+                          int & ioSameBitCount,
+                          const uint8_t inRawBits,
+                          const uint32_t inCount) {
+  const bool lastBit = ((inRawBits << (inCount - 1)) & 0x80) != 0 ;
+  uint32_t trailingCount = 1 ;
+  while ((trailingCount < inCount) && ((((inRawBits << (inCount - 1 - trailingCount)) & 0x80) != 0) == lastBit)) {
+    trailingCount += 1 ;
+  }
+  if ((trailingCount == inCount) && (lastBit == ioPreviousBit)) {
+    ioSameBitCount += int (inCount) ;
+  }else{
+    ioSameBitCount = int (trailingCount) ;
+  }
+  ioPreviousBit = lastBit ;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,40 @@
+#ifndef CAN_DESTUFF_TABLE
+#define CAN_DESTUFF_TABLE
+
+//----------------------------------------------------------------------------------------
+// Table driven destuffing: one lookup handles 8 raw bits, given the run state before
+// them. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------------
+// Raw bit i is bit (7 - i) of the byte. Positions after a stuff error are not examined.
+
+class CANDestuffEntry {
+  public: uint8_t mOutputBits ; // Destuffed bits, the first one in bit 7
+  public: uint8_t mOutputCount ;
+  public: uint8_t mStuffMask ; // Raw positions of stuff bits
+  public: uint8_t mErrorIndex ; // Raw index of the stuff error (sixth identical bit), 8 if none
+} ;
+
+//----------------------------------------------------------------------------------------
+// inPreviousBit is the last raw bit, inSameBitCount (1 ... 5) the count of identical raw
+// bits that end with it, stuff bits included.
+
+const CANDestuffEntry & destuffEntry (const bool inPreviousBit,
+                                      const uint32_t inSameBitCount,
+                                      const uint8_t inRawBits) ;
+
+//----------------------------------------------------------------------------------------
+// Run state after the first inCount (1 ... 8) raw bits; ioSameBitCount may reach 6 if
+// these bits end with a stuff error.
+
+void advanceDestuffState (bool & ioPreviousBit,
+                          int & ioSameBitCount,
+                          const uint8_t inRawBits,
+                          const uint32_t inCount) ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_DESTUFF_TABLE
@@ -0,0 +1,70 @@
+#include "CANDetailPolicy.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------
+//   Identifier list
+//----------------------------------------------------------------------------------------
+
+bool parseIdentifierList (const std::string & inText, std::vector <uint32_t> & outKeys) {
+  outKeys.clear () ;
+  bool ok = true ;
+  size_t idx = 0 ;
+  while (ok && (idx < inText.size ())) {
+    const char c = inText [idx] ;
+    if ((c == ' ') || (c == ',') || (c == ';') || (c == '\t')) {
+      idx += 1 ;
+    }else{
+      uint32_t key = 0 ;
+      ok = CANErrorCounters::parseIdentifierKey (inText, idx, key) ;
+      if (ok) {
+        outKeys.push_back (key) ;
+      }
+    }
+  }
+  std::sort (outKeys.begin (), outKeys.end ()) ;
+  outKeys.erase (std::unique (outKeys.begin (), outKeys.end ()), outKeys.end ()) ;
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANDetailPolicy
+//----------------------------------------------------------------------------------------
+
+CANDetailPolicy::CANDetailPolicy (void) :
+mLevel (DETAIL_FULL),
+mErrorWindowSampleCount (0),
+mFullDetailEndSampleNumber (0),
+mIdentifierKeys () {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANDetailPolicy::configure (const CANDetailLevel inLevel,
+                                 const uint32_t inSampleRateHz,
+                                 const uint64_t inStartSampleNumber,
+                                 const uint32_t inFullDetailSeconds,
+                                 const uint32_t inErrorWindowMilliSeconds,
+                                 const std::vector <uint32_t> & inIdentifierKeys) {
+  mLevel = inLevel ;
+  mErrorWindowSampleCount = uint64_t (inSampleRateHz) * inErrorWindowMilliSeconds / 1000 ;
+  mFullDetailEndSampleNumber = inStartSampleNumber + uint64_t (inSampleRateHz) * inFullDetailSeconds ;
+  mIdentifierKeys = inIdentifierKeys ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANDetailPolicy::fullDetailIdentifier (const uint32_t inIdentifierKey) const {
+  return std::binary_search (mIdentifierKeys.begin (), mIdentifierKeys.end (), inIdentifierKey) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANDetailPolicy::enterError (const uint64_t inSampleNumber) {
+  const uint64_t end = inSampleNumber + mErrorWindowSampleCount ;
+  if (mFullDetailEndSampleNumber < end) {
+    mFullDetailEndSampleNumber = end ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
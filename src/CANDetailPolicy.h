@@ -0,0 +1,72 @@
+#ifndef CAN_DETAIL_POLICY
+#define CAN_DETAIL_POLICY
+
+//----------------------------------------------------------------------------------------
+// Adaptive detail for long captures: full detail (markers and field rows) is kept for the
+// first seconds of the capture, for a window after each error, and for frames of some
+// identifiers; other frames are reduced to a message row, or to statistics only. Does not
+// depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  DETAIL_FULL, // Adaptive detail disabled
+  DETAIL_ADAPTIVE_MESSAGES,
+  DETAIL_ADAPTIVE_STATISTICS
+} CANDetailLevel ;
+
+//----------------------------------------------------------------------------------------
+// Marks of a reduced frame are kept until its end; a frame with more marks (a bus stuck
+// in error) is shown with full detail.
+
+static const uint32_t DETAIL_MAX_PENDING_MARKS = 4096 ;
+
+//----------------------------------------------------------------------------------------
+// "7E0, 18DA10F1": hexadecimal identifiers, separated by commas, semicolons or spaces;
+// more than 3 digits is an extended identifier. Keys are sorted (see
+// CANErrorCounters::identifierKey). Returns false on syntax error.
+
+bool parseIdentifierList (const std::string & inText, std::vector <uint32_t> & outKeys) ;
+
+//----------------------------------------------------------------------------------------
+
+class CANDetailPolicy {
+
+  public: CANDetailPolicy (void) ;
+
+  public: void configure (const CANDetailLevel inLevel,
+                          const uint32_t inSampleRateHz,
+                          const uint64_t inStartSampleNumber,
+                          const uint32_t inFullDetailSeconds,
+                          const uint32_t inErrorWindowMilliSeconds,
+                          const std::vector <uint32_t> & inIdentifierKeys) ;
+
+  public: inline bool adaptive (void) const { return mLevel != DETAIL_FULL ; }
+
+  public: inline CANDetailLevel level (void) const { return mLevel ; }
+
+//--- Full detail is kept up to (excluding) this sample
+  public: inline bool fullDetailAt (const uint64_t inSampleNumber) const {
+    return inSampleNumber < mFullDetailEndSampleNumber ;
+  }
+
+  public: bool fullDetailIdentifier (const uint32_t inIdentifierKey) const ;
+
+//--- Opens (or extends) the window after an error
+  public: void enterError (const uint64_t inSampleNumber) ;
+
+  private: CANDetailLevel mLevel ;
+  private: uint64_t mErrorWindowSampleCount ;
+  private: uint64_t mFullDetailEndSampleNumber ;
+  private: std::vector <uint32_t> mIdentifierKeys ; // Sorted
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_DETAIL_POLICY
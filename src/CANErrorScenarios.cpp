@@ -0,0 +1,99 @@
+#include "CANErrorScenarios.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t ONE_HUNDRED_PERCENT = 1000 * 1000 ;
+
+//----------------------------------------------------------------------------------------
+
+const char * errorScenarioName (const CANErrorScenario inScenario) {
+  switch (inScenario) {
+  case SCENARIO_BURST : return "burst" ;
+  case SCENARIO_STUFF : return "stuff" ;
+  case SCENARIO_CRC : return "crc" ;
+  case SCENARIO_NO_ACK : return "ack" ;
+  case SCENARIO_FORM : return "form" ;
+  case SCENARIO_ACTIVE_FLAG : return "active" ;
+  case SCENARIO_PASSIVE_FLAG : return "passive" ;
+  case SCENARIO_OVERLOAD : return "overload" ;
+  case SCENARIO_BUS_OFF : return "busoff" ;
+  case SCENARIO_GLITCH : return "glitch" ;
+  case SCENARIO_COUNT : break ;
+  }
+  return "none" ;
+}
+
+//----------------------------------------------------------------------------------------
+
+CANErrorScenarios::CANErrorScenarios (void) :
+mThresholds () {
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANErrorScenarios::parse (const std::string & inText) {
+  uint32_t rates [SCENARIO_COUNT] ;
+  for (uint32_t i=0 ; i<SCENARIO_COUNT ; i++) {
+    rates [i] = 0 ;
+  }
+  bool ok = true ;
+  size_t idx = 0 ;
+  while (ok && (idx < inText.size ())) {
+    const char c = inText [idx] ;
+    if ((c == ' ') || (c == ',') || (c == ';') || (c == '\t')) {
+      idx += 1 ;
+    }else{
+    //--- Name
+      const size_t colon = inText.find (':', idx) ;
+      ok = colon != std::string::npos ;
+      uint32_t scenario = SCENARIO_COUNT ;
+      if (ok) {
+        const std::string name = inText.substr (idx, colon - idx) ;
+        for (uint32_t i=0 ; (i<SCENARIO_COUNT) && (scenario == SCENARIO_COUNT) ; i++) {
+          if (name == errorScenarioName (CANErrorScenario (i))) {
+            scenario = i ;
+          }
+        }
+        ok = scenario < SCENARIO_COUNT ;
+      }
+    //--- Rate
+      if (ok) {
+        const char * start = inText.c_str () + colon + 1 ;
+        char * end = NULL ;
+        const double percent = strtod (start, &end) ;
+        ok = (end != start) && (percent >= 0.0) && (percent <= 100.0) ;
+        if (ok) {
+          rates [scenario] = uint32_t (percent * (ONE_HUNDRED_PERCENT / 100) + 0.5) ;
+          idx = size_t (end - inText.c_str ()) ;
+        }
+      }
+    }
+  }
+  uint32_t thresholds [SCENARIO_COUNT] ;
+  uint32_t total = 0 ;
+  for (uint32_t i=0 ; i<SCENARIO_COUNT ; i++) {
+    total += rates [i] ;
+    thresholds [i] = total ;
+  }
+  ok = ok && (total <= ONE_HUNDRED_PERCENT) ;
+  if (ok) {
+    memcpy (mThresholds, thresholds, sizeof (mThresholds)) ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+CANErrorScenario CANErrorScenarios::select (const uint32_t inRandomValue) const {
+  const uint32_t draw = uint32_t ((uint64_t (inRandomValue) * ONE_HUNDRED_PERCENT) >> 32) ;
+  uint32_t scenario = 0 ;
+  while ((scenario < SCENARIO_COUNT) && (draw >= mThresholds [scenario])) {
+    scenario += 1 ;
+  }
+  return CANErrorScenario (scenario) ;
+}
+
+//----------------------------------------------------------------------------------------
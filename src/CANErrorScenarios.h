@@ -0,0 +1,55 @@
+#ifndef CAN_ERROR_SCENARIOS
+#define CAN_ERROR_SCENARIOS
+
+//----------------------------------------------------------------------------------------
+// Simulator error scenarios: each one has a rate, in percent of generated frames; at most
+// one scenario is applied to a frame. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  SCENARIO_BURST, // Consecutive bits toggled, then an active error frame
+  SCENARIO_STUFF, // Six identical bits in the stuffed part of the frame
+  SCENARIO_CRC, // Wrong CRC, not acknowledged, error flag after the ACK delimiter
+  SCENARIO_NO_ACK, // Recessive ACK slot, error flag from the ACK delimiter
+  SCENARIO_FORM, // Dominant CRC delimiter, ACK delimiter or EOF bit
+  SCENARIO_ACTIVE_FLAG, // Frame cut by an active error flag
+  SCENARIO_PASSIVE_FLAG, // Bit error of an error passive transmitter
+  SCENARIO_OVERLOAD, // Overload frame after the frame
+  SCENARIO_BUS_OFF, // 32 failed transmissions, then bus off recovery (128 x 11 bits)
+  SCENARIO_GLITCH, // Pulse shorter than a quarter of a bit
+  SCENARIO_COUNT,
+  SCENARIO_NONE = SCENARIO_COUNT
+} CANErrorScenario ;
+
+//----------------------------------------------------------------------------------------
+
+const char * errorScenarioName (const CANErrorScenario inScenario) ;
+
+//----------------------------------------------------------------------------------------
+
+class CANErrorScenarios {
+
+  public: CANErrorScenarios (void) ;
+
+//--- "burst:1, crc:0.5, glitch:5": name:percent pairs, separated by commas, semicolons
+// or spaces. Returns false on syntax error or if rates add up to more than 100%; the
+// scenarios are then unchanged.
+  public: bool parse (const std::string & inText) ;
+
+  public: inline bool enabled (void) const { return mThresholds [SCENARIO_COUNT - 1] > 0 ; }
+
+//--- inRandomValue is uniform on 32 bits
+  public: CANErrorScenario select (const uint32_t inRandomValue) const ;
+
+//--- Cumulative rates, in millionths of frames
+  private: uint32_t mThresholds [SCENARIO_COUNT] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_ERROR_SCENARIOS
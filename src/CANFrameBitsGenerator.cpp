@@ -0,0 +1,511 @@
+#include "CANFrameBitsGenerator.h"
+#include "CANFrameDecoder.h"
+
+//----------------------------------------------------------------------------------------
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+//----------------------------------------------------------------------------------------
+//  WORD HELPERS (bit 0 of a stream is the MSB of word 0)
+//----------------------------------------------------------------------------------------
+
+static inline uint32_t countLeadingZeros (const uint64_t inValue) {
+  uint32_t result = 64 ;
+  if (inValue != 0) {
+  #ifdef _MSC_VER
+    unsigned long index ;
+    _BitScanReverse64 (&index, inValue) ;
+    result = 63 - uint32_t (index) ;
+  #else
+    result = uint32_t (__builtin_clzll (inValue)) ;
+  #endif
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static inline void appendBits (uint64_t ioWords [],
+                               uint32_t & ioLength,
+                               const uint64_t inValue,
+                               const uint32_t inCount) {
+  if (inCount > 0) {
+    const uint64_t value = (inCount < 64) ? (inValue & ((1ULL << inCount) - 1)) : inValue ;
+    const uint32_t idx = ioLength / 64 ;
+    const uint32_t freeBits = 64 - ioLength % 64 ;
+    if (inCount <= freeBits) {
+      ioWords [idx] |= value << (freeBits - inCount) ;
+    }else{
+      ioWords [idx] |= value >> (inCount - freeBits) ;
+      ioWords [idx + 1] |= value << (64 - (inCount - freeBits)) ;
+    }
+    ioLength += inCount ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Returns the 64 bits starting at inIndex (inWords should have one extra word)
+
+static inline uint64_t wordAtBitIndex (const uint64_t inWords [], const uint32_t inIndex) {
+  const uint32_t idx = inIndex / 64 ;
+  const uint32_t offset = inIndex % 64 ;
+  uint64_t result = inWords [idx] ;
+  if (offset != 0) {
+    result = (result << offset) | (inWords [idx + 1] >> (64 - offset)) ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+//  CRC15, BYTE AT A TIME
+//----------------------------------------------------------------------------------------
+
+class CRC15Table {
+  public: CRC15Table (void) {
+    for (uint32_t i=0 ; i<256 ; i++) {
+      uint16_t crc = uint16_t (i << 7) ;
+      for (uint32_t bit=0 ; bit<8 ; bit++) {
+        const bool bit14 = (crc & (1 << 14)) != 0 ;
+        crc = uint16_t ((crc << 1) & 0x7FFF) ;
+        if (bit14) {
+          crc ^= 0x4599 ;
+        }
+      }
+      mTable [i] = crc ;
+    }
+  }
+
+  public: uint16_t mTable [256] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+static uint16_t computeCRC15 (const uint64_t inWords [], const uint32_t inLength) {
+  static const CRC15Table table ;
+  uint16_t crc = 0 ;
+  uint32_t idx = 0 ;
+//--- Leading bits, one at a time, so that the remaining length is a multiple of 8
+  const uint32_t leadingBitCount = inLength % 8 ;
+  if (leadingBitCount > 0) {
+    const uint64_t leadingBits = inWords [0] >> (64 - leadingBitCount) ;
+    for (int bitIdx = int (leadingBitCount) - 1 ; bitIdx >= 0 ; bitIdx--) {
+      const bool bit14 = (crc & (1 << 14)) != 0 ;
+      const bool crc_nxt = ((leadingBits >> bitIdx) & 1) ^ bit14 ;
+      crc = uint16_t ((crc << 1) & 0x7FFF) ;
+      if (crc_nxt) {
+        crc ^= 0x4599 ;
+      }
+    }
+    idx = leadingBitCount ;
+  }
+//--- Remaining bytes
+  while (idx < inLength) {
+    const uint32_t byte = uint32_t (wordAtBitIndex (inWords, idx) >> 56) ;
+    crc = uint16_t (((crc << 8) ^ table.mTable [((crc >> 7) ^ byte) & 0xFF]) & 0x7FFF) ;
+    idx += 8 ;
+  }
+  return crc ;
+}
+
+//----------------------------------------------------------------------------------------
+//  CAN FD CRC 17 AND CRC 21, BYTE AT A TIME
+//----------------------------------------------------------------------------------------
+
+static inline uint32_t fdCRCPolynomial (const uint32_t inCRCLength) {
+  return (inCRCLength == 17) ? 0x1685B : 0x102899 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static inline uint32_t enterBitInFDCRC (const uint32_t inCRC,
+                                        const bool inBit,
+                                        const uint32_t inCRCLength) {
+  const uint32_t mask = (1U << inCRCLength) - 1 ;
+  const bool crc_nxt = inBit ^ (((inCRC >> (inCRCLength - 1)) & 1) != 0) ;
+  uint32_t crc = (inCRC << 1) & mask ;
+  if (crc_nxt) {
+    crc ^= fdCRCPolynomial (inCRCLength) ;
+  }
+  return crc ;
+}
+
+//----------------------------------------------------------------------------------------
+
+class CRCFDTable {
+  public: CRCFDTable (void) {
+    for (uint32_t i=0 ; i<256 ; i++) {
+      uint32_t crc17 = i << 9 ;
+      uint32_t crc21 = i << 13 ;
+      for (uint32_t bit=0 ; bit<8 ; bit++) {
+        crc17 = enterBitInFDCRC (crc17, false, 17) ;
+        crc21 = enterBitInFDCRC (crc21, false, 21) ;
+      }
+      mCRC17 [i] = crc17 ;
+      mCRC21 [i] = crc21 ;
+    }
+  }
+
+  public: uint32_t mCRC17 [256] ;
+  public: uint32_t mCRC21 [256] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+// The CRC register is initialized with 1 followed by zeros
+
+static uint32_t computeFDCRC (const uint64_t inWords [],
+                              const uint32_t inLength,
+                              const uint32_t inCRCLength) {
+  static const CRCFDTable table ;
+  const uint32_t * byteTable = (inCRCLength == 17) ? table.mCRC17 : table.mCRC21 ;
+  const uint32_t mask = (1U << inCRCLength) - 1 ;
+  uint32_t crc = 1U << (inCRCLength - 1) ;
+  uint32_t idx = 0 ;
+//--- Leading bits, one at a time, so that the remaining length is a multiple of 8
+  const uint32_t leadingBitCount = inLength % 8 ;
+  if (leadingBitCount > 0) {
+    const uint64_t leadingBits = inWords [0] >> (64 - leadingBitCount) ;
+    for (int bitIdx = int (leadingBitCount) - 1 ; bitIdx >= 0 ; bitIdx--) {
+      crc = enterBitInFDCRC (crc, ((leadingBits >> bitIdx) & 1) != 0, inCRCLength) ;
+    }
+    idx = leadingBitCount ;
+  }
+//--- Remaining bytes
+  while (idx < inLength) {
+    const uint32_t byte = uint32_t (wordAtBitIndex (inWords, idx) >> 56) ;
+    crc = ((crc << 8) & mask) ^ byteTable [((crc >> (inCRCLength - 8)) ^ byte) & 0xFF] ;
+    idx += 8 ;
+  }
+  return crc ;
+}
+
+//----------------------------------------------------------------------------------------
+//  CANFrameBitsGenerator
+//----------------------------------------------------------------------------------------
+
+CANFrameBitsGenerator::CANFrameBitsGenerator (const uint32_t inIdentifier,
+                                              const FrameFormat inFrameFormat,
+                                              const uint8_t inDataLength,
+                                              const uint8_t inData [8],
+                                              const FrameType inFrameType,
+                                              const AckSlot inAckSlot,
+                                              const uint16_t inCRCErrorMask) {
+  CANFrameDescriptor descriptor ;
+  descriptor.mIdentifier = inIdentifier ;
+  descriptor.mFrameFormat = inFrameFormat ;
+  descriptor.mFrameType = inFrameType ;
+  descriptor.mAckSlot = inAckSlot ;
+  descriptor.mDataLength = inDataLength ;
+  descriptor.mFD = false ;
+  descriptor.mBRS = false ;
+  descriptor.mESI = false ;
+  for (uint32_t i=0 ; i<8 ; i++) {
+    descriptor.mData [i] = inData [i] ;
+  }
+  build (descriptor, inCRCErrorMask) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+CANFrameBitsGenerator::CANFrameBitsGenerator (const CANFrameDescriptor & inDescriptor) {
+  build (inDescriptor, 0) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+CANFrameBitsGenerator::CANFrameBitsGenerator (const CANFrameDescriptor & inDescriptor,
+                                              const uint32_t inCRCErrorMask) {
+  build (inDescriptor, inCRCErrorMask) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameBitsGenerator::build (const CANFrameDescriptor & inDescriptor,
+                                   const uint32_t inCRCErrorMask) {
+  mFrameLength = 0 ;
+  mStuffBitCount = 0 ;
+  mBRSIndex = 0 ;
+  const bool fd = inDescriptor.mFD ;
+  const bool remote = !fd && (inDescriptor.mFrameType == remoteFrame) ;
+  const uint32_t identifier = inDescriptor.mIdentifier ;
+  const uint8_t dataLength = (inDescriptor.mDataLength > 15) ? 15 : inDescriptor.mDataLength ;
+//--- Destuffed stream, SOF ... CRC: at most 41 + 512 + 21 bits, one extra word for reading
+  uint64_t destuffed [10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0} ;
+  uint32_t length = 0 ;
+  uint64_t header ;
+  if (inDescriptor.mFrameFormat == extendedFrame) {
+  //--- SOF, IDF 28-18, SRR, IDE, IDF 17-0, then
+  //    RTR, R1, R0, DLC (classic) or RRS, FDF, RES, BRS, ESI, DLC (CAN FD)
+    header = (uint64_t (identifier >> 18) & 0x7FF) << 2 ;
+    header |= 3 ; // SRR, IDE
+    header = (header << 18) | (identifier & 0x3FFFF) ;
+  }else{
+  //--- SOF, IDF 10-0, then
+  //    RTR, IDE, R0, DLC (classic) or RRS, IDE, FDF, RES, BRS, ESI, DLC (CAN FD)
+    header = identifier & 0x7FF ;
+  }
+  if (fd) {
+    header = (header << 1) ; // RRS
+    if (inDescriptor.mFrameFormat == standardFrame) {
+      header = (header << 1) ; // IDE
+    }
+    header = (header << 2) | 2 ; // FDF, RES
+    header = (header << 1) | inDescriptor.mBRS ;
+    header = (header << 1) | inDescriptor.mESI ;
+    header = (header << 4) | dataLength ;
+  }else{
+    header = (header << 1) | remote ;
+    header = (header << 6) | dataLength ;
+  }
+  const uint32_t headerLength = (inDescriptor.mFrameFormat == extendedFrame)
+    ? (fd ? 41 : 39)
+    : (fd ? 22 : 19) ;
+  appendBits (destuffed, length, header, headerLength) ;
+//--- Enter DATA, up to 8 bytes per append
+  const uint32_t dataByteCount = remote ? 0 : canDataLengthForCode (dataLength, fd) ;
+  uint32_t dataIdx = 0 ;
+  while (dataIdx < dataByteCount) {
+    const uint32_t n = ((dataByteCount - dataIdx) < 8) ? (dataByteCount - dataIdx) : 8 ;
+    uint64_t data = 0 ;
+    for (uint32_t i = 0 ; i < n ; i++) {
+      data = (data << 8) | inDescriptor.mData [dataIdx + i] ;
+    }
+    appendBits (destuffed, length, data, 8 * n) ;
+    dataIdx += n ;
+  }
+//--- Enter CRC SEQUENCE (a non zero mask generates a CRC error, stuffing remains valid)
+//    and stuff; the CAN FD CRC covers stuffed bits, so it is computed after stuffing
+  for (uint32_t i=0 ; i<=CAN_FRAME_WORD_COUNT ; i++) {
+    mWords [i] = 0 ;
+  }
+  for (uint32_t i=0 ; i<CAN_FRAME_WORD_COUNT ; i++) {
+    mStuffWords [i] = 0 ;
+  }
+  if (fd) {
+    stuff (destuffed, length, false) ;
+    appendFDCRCField (inCRCErrorMask, (dataByteCount > 16) ? 21 : 17) ;
+  //--- BRS bit: destuffed index 16 (standard) or 35 (extended)
+    if (inDescriptor.mBRS) {
+      const uint32_t brsDestuffedIndex = (inDescriptor.mFrameFormat == extendedFrame) ? 35 : 16 ;
+      uint32_t destuffedIndex = 0 ;
+      uint32_t idx = 0 ;
+      while ((destuffedIndex < brsDestuffedIndex) || stuffBitAtIndex (idx)) {
+        destuffedIndex += !stuffBitAtIndex (idx) ;
+        idx ++ ;
+      }
+      mBRSIndex = idx ;
+    }
+  }else{
+    mCRC = (computeCRC15 (destuffed, length) ^ inCRCErrorMask) & 0x7FFF ;
+    appendBits (destuffed, length, mCRC, 15) ;
+    stuff (destuffed, length, true) ;
+  }
+//--- Enter CRC DEL, ACK SLOT
+  appendBits (mWords, mFrameLength, 1, 1) ;
+  appendBits (mWords, mFrameLength, inDescriptor.mAckSlot == ACK_SLOT_RECESSIVE, 1) ;
+//--- ACK DEL, EOF (7), INTERMISSION (3), all RECESSIVE
+  appendBits (mWords, mFrameLength, 0x7FF, 11) ;
+//--- Padding is recessive
+  const uint32_t offset = mFrameLength % 64 ;
+  if (offset != 0) {
+    mWords [mFrameLength / 64] |= UINT64_MAX >> offset ;
+  }
+  for (uint32_t i = wordCount () ; i<=CAN_FRAME_WORD_COUNT ; i++) {
+    mWords [i] = UINT64_MAX ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Stuff: the window is the last 4 emitted bits followed by up to 60 destuffed bits. CAN FD
+// dynamic stuffing does not insert a stuff bit after the last data bit.
+
+void CANFrameBitsGenerator::stuff (const uint64_t inDestuffed [],
+                                   const uint32_t inLength,
+                                   const bool inStuffBitAfterLastBit) {
+  uint64_t lastEmittedBits = 0xF ; // Bus idle is recessive
+  uint32_t idx = 0 ;
+  while (idx < inLength) {
+    const uint32_t n = ((inLength - idx) < 60) ? (inLength - idx) : 60 ;
+    const uint64_t window = (lastEmittedBits << 60) | (wordAtBitIndex (inDestuffed, idx) >> 4) ;
+  //--- Bit i (from MSB) of fiveSame is set if bits i ... i+4 of window are identical,
+  //    only runs ending at a destuffed bit of the window are considered
+    const uint64_t same = ~ (window ^ (window << 1)) ;
+    const uint64_t fiveSame = same & (same << 1) & (same << 2) & (same << 3) & ~ (UINT64_MAX >> n) ;
+    if (fiveSame == 0) {
+      appendBits (mWords, mFrameLength, window >> (60 - n), n) ;
+      lastEmittedBits = (window >> (60 - n)) & 0xF ;
+      idx += n ;
+    }else{ // Emit up to the fifth identical bit, then the stuff bit
+      const uint32_t first = countLeadingZeros (fiveSame) ;
+      appendBits (mWords, mFrameLength, window >> (59 - first), first + 1) ;
+      idx += first + 1 ;
+      if (inStuffBitAfterLastBit || (idx < inLength)) {
+        const uint64_t stuffBit = ((window >> (59 - first)) & 1) ^ 1 ;
+        mStuffWords [mFrameLength / 64] |= 1ULL << (63 - mFrameLength % 64) ;
+        appendBits (mWords, mFrameLength, stuffBit, 1) ;
+        lastEmittedBits = (((window >> (59 - first)) & 7) << 1) | stuffBit ;
+        mStuffBitCount += 1 ;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// CAN FD: stuff count (Gray code of the dynamic stuff bit count modulo 8, even parity)
+// and CRC, a fixed stuff bit (complement of the previous bit) before them and every 4
+// bits. The CRC covers the stuffed bits from SOF and the stuff count.
+
+void CANFrameBitsGenerator::appendFDCRCField (const uint32_t inCRCErrorMask,
+                                              const uint32_t inCRCLength) {
+  const uint32_t count = mStuffBitCount % 8 ;
+  const uint32_t gray = count ^ (count >> 1) ;
+  const uint32_t parity = (gray ^ (gray >> 1) ^ (gray >> 2)) & 1 ;
+  const uint32_t stuffCount = (gray << 1) | parity ;
+  uint32_t crc = computeFDCRC (mWords, mFrameLength, inCRCLength) ;
+  for (int bitIdx = 3 ; bitIdx >= 0 ; bitIdx--) {
+    crc = enterBitInFDCRC (crc, ((stuffCount >> bitIdx) & 1) != 0, inCRCLength) ;
+  }
+  mCRC = (crc ^ inCRCErrorMask) & ((1U << inCRCLength) - 1) ;
+//--- Emit by groups of 4 bits, each one preceded by a fixed stuff bit
+  const uint64_t field = (uint64_t (stuffCount) << inCRCLength) | mCRC ;
+  const uint32_t fieldLength = 4 + inCRCLength ;
+  uint32_t idx = 0 ;
+  while (idx < fieldLength) {
+    const uint64_t stuffBit = bitAtIndex (mFrameLength - 1) ? 0 : 1 ;
+    mStuffWords [mFrameLength / 64] |= 1ULL << (63 - mFrameLength % 64) ;
+    appendBits (mWords, mFrameLength, stuffBit, 1) ;
+    mStuffBitCount += 1 ;
+    const uint32_t n = ((fieldLength - idx) < 4) ? (fieldLength - idx) : 4 ;
+    appendBits (mWords, mFrameLength, field >> (fieldLength - idx - n), n) ;
+    idx += n ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+uint32_t CANFrameBitsGenerator::runLengths (uint8_t outRuns [CAN_FD_FRAME_MAX_BIT_COUNT]) const {
+  uint32_t runCount = 0 ;
+  uint32_t idx = 0 ;
+  while (idx < mFrameLength) {
+    const uint64_t window = wordAtBitIndex (mWords, idx) ;
+    uint32_t runLength = countLeadingZeros (((window >> 63) != 0) ? ~ window : window) ;
+    if (runLength > (mFrameLength - idx)) {
+      runLength = mFrameLength - idx ;
+    }
+    outRuns [runCount] = uint8_t (runLength) ;
+    runCount ++ ;
+    idx += runLength ;
+  }
+  return runCount ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANFrameBitsGenerator::bitAtIndex (const uint32_t inIndex) const {
+  bool result = true ; // RECESSIF
+  if (inIndex < mFrameLength) {
+    result = ((mWords [inIndex / 64] >> (63 - inIndex % 64)) & 1) != 0 ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANFrameBitsGenerator::stuffBitAtIndex (const uint32_t inIndex) const {
+  bool result = false ;
+  if (inIndex < mFrameLength) {
+    result = ((mStuffWords [inIndex / 64] >> (63 - inIndex % 64)) & 1) != 0 ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+//  CANFrameBatch
+//----------------------------------------------------------------------------------------
+
+CANFrameBatch::CANFrameBatch (void) :
+mWords (),
+mFrameStarts (),
+mBitLength (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameBatch::clear (void) {
+  mWords.clear () ;
+  mFrameStarts.clear () ;
+  mBitLength = 0 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameBatch::reserve (const size_t inFrameCount) {
+  mFrameStarts.reserve (mFrameStarts.size () + inFrameCount) ;
+  mWords.reserve (mWords.size () + inFrameCount * CAN_FRAME_WORD_COUNT) ;
+}
+
+//----------------------------------------------------------------------------------------
+// Bits after mBitLength are kept recessive (set), so a frame is merged with an AND.
+
+void CANFrameBatch::append (const CANFrameBitsGenerator & inFrame) {
+  mFrameStarts.push_back (mBitLength) ;
+  const uint32_t offset = uint32_t (mBitLength % 64) ;
+  const uint64_t * words = inFrame.words () ;
+  const uint32_t wordCount = inFrame.wordCount () ;
+  for (uint32_t i=0 ; i<wordCount ; i++) {
+    if (offset == 0) {
+      mWords.push_back (words [i]) ;
+    }else{
+      mWords.back () &= (words [i] >> offset) | ~ (UINT64_MAX >> offset) ;
+      mWords.push_back ((words [i] << (64 - offset)) | (UINT64_MAX >> offset)) ;
+    }
+  }
+  mBitLength += inFrame.frameLength () ;
+  mWords.resize (size_t ((mBitLength + 63) / 64)) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameBatch::generate (const CANFrameDescriptor inFrames [], const size_t inFrameCount) {
+  reserve (inFrameCount) ;
+  for (size_t i=0 ; i<inFrameCount ; i++) {
+    const CANFrameBitsGenerator frame (inFrames [i]) ;
+    append (frame) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameBatch::appendIdle (const uint32_t inBitCount) {
+  mBitLength += inBitCount ;
+  mWords.resize (size_t ((mBitLength + 63) / 64), UINT64_MAX) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameBatch::truncate (const uint64_t inBitLength) {
+  mBitLength = inBitLength ;
+  mWords.resize (size_t ((mBitLength + 63) / 64)) ;
+  if ((mBitLength % 64) != 0) {
+    mWords.back () |= UINT64_MAX >> (mBitLength % 64) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameBatch::invertBit (const uint64_t inIndex) {
+  mWords [size_t (inIndex / 64)] ^= 1ULL << (63 - inIndex % 64) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANFrameBatch::bitAtIndex (const uint64_t inIndex) const {
+  bool result = true ; // RECESSIF
+  if (inIndex < mBitLength) {
+    result = ((mWords [size_t (inIndex / 64)] >> (63 - inIndex % 64)) & 1) != 0 ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
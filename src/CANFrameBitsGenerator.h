@@ -0,0 +1,158 @@
+#ifndef CAN_FRAME_BITS_GENERATOR
+#define CAN_FRAME_BITS_GENERATOR
+
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {standardFrame, extendedFrame} FrameFormat ;
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {dataFrame, remoteFrame} FrameType ;
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {ACK_SLOT_DOMINANT, ACK_SLOT_RECESSIVE} AckSlot ;
+
+//----------------------------------------------------------------------------------------
+// Longest classic frame: extended, 8 data bytes, worst case stuffing, plus CRC DEL,
+// ACK SLOT, ACK DEL, EOF and INTERMISSION
+
+static const uint32_t CAN_FRAME_MAX_BIT_COUNT = 160 ;
+
+//--- Longest CAN FD frame: extended, 64 data bytes, worst case dynamic stuffing (41 + 512
+//    + 137 bits), stuff count and CRC 21 with their 7 fixed stuff bits, plus CRC DEL, ACK
+//    SLOT, ACK DEL, EOF and INTERMISSION
+static const uint32_t CAN_FD_FRAME_MAX_BIT_COUNT = 735 ;
+
+static const uint32_t CAN_FRAME_WORD_COUNT = (CAN_FD_FRAME_MAX_BIT_COUNT + 63) / 64 ;
+
+//----------------------------------------------------------------------------------------
+
+class CANFrameDescriptor {
+  public: uint32_t mIdentifier ;
+  public: FrameFormat mFrameFormat ;
+  public: FrameType mFrameType ; // CAN FD frames are data frames
+  public: AckSlot mAckSlot ;
+  public: uint8_t mDataLength ; // DLC
+  public: bool mFD ;
+  public: bool mBRS ; // CAN FD: data phase at the data bit rate
+  public: bool mESI ; // CAN FD
+  public: uint8_t mData [64] ; // 8 bytes at most for a classic frame
+} ;
+
+//----------------------------------------------------------------------------------------
+//  CAN FRAME GENERATOR
+//----------------------------------------------------------------------------------------
+// The destuffed stream (SOF ... CRC) is assembled in 64-bit words, the CRC is computed a
+// byte at a time, and stuffing searches 60 bits at a time for five identical bits, so
+// that the loop runs once per stuff bit instead of once per bit.
+// CAN FD frames (ISO 11898-1:2015): dynamic stuffing ends with the data field, without a
+// stuff bit after its last bit; the stuff count (Gray code and parity) and the CRC 17 or
+// CRC 21 follow, with a fixed stuff bit before them and every 4 bits. The CRC covers the
+// stuffed bits from SOF, and the stuff count.
+// The stuffed frame is available:
+//   - as packed words: bit i is bit (63 - i % 64) of word i / 64, padding is recessive;
+//   - as a run-length list: runs alternate, the first one (SOF) is dominant.
+
+class CANFrameBitsGenerator {
+  public : CANFrameBitsGenerator (const uint32_t inIdentifier,
+                                  const FrameFormat inFrameFormat,
+                                  const uint8_t inDataLength,
+                                  const uint8_t inData [8],
+                                  const FrameType inFrameType,
+                                  const AckSlot inAckSlot,
+                                  const uint16_t inCRCErrorMask) ;
+
+  public : CANFrameBitsGenerator (const CANFrameDescriptor & inDescriptor) ;
+
+//--- A non zero inCRCErrorMask generates a CRC error (CRC 15, 17 or 21), stuffing remains
+//    valid
+  public : CANFrameBitsGenerator (const CANFrameDescriptor & inDescriptor,
+                                  const uint32_t inCRCErrorMask) ;
+
+//--- Public methods
+  public : inline uint32_t frameLength (void) const { return mFrameLength ; }
+  public : bool bitAtIndex (const uint32_t inIndex) const ;
+  public : bool stuffBitAtIndex (const uint32_t inIndex) const ;
+  public : inline uint32_t stuffBitCount (void) const { return mStuffBitCount ; } // Fixed included
+  public : inline uint32_t crc (void) const { return mCRC ; } // As sent
+
+//--- CAN FD frame with BRS set: index of the BRS bit, the data bit rate applies from its
+//    sample point up to the sample point of the CRC delimiter (bit frameLength () - 13);
+//    0 otherwise
+  public : inline uint32_t brsIndex (void) const { return mBRSIndex ; }
+
+  public : inline const uint64_t * words (void) const { return mWords ; }
+  public : inline uint32_t wordCount (void) const { return (mFrameLength + 63) / 64 ; }
+
+//--- Returns the run count; run i is recessive if i is odd
+  public : uint32_t runLengths (uint8_t outRuns [CAN_FD_FRAME_MAX_BIT_COUNT]) const ;
+
+//--- Private methods (used during frame generation)
+  private: void build (const CANFrameDescriptor & inDescriptor,
+                       const uint32_t inCRCErrorMask) ;
+
+  private: void stuff (const uint64_t inDestuffed [],
+                       const uint32_t inLength,
+                       const bool inStuffBitAfterLastBit) ;
+
+  private: void appendFDCRCField (const uint32_t inCRCErrorMask, const uint32_t inCRCLength) ;
+
+//--- Private properties (one extra word, so that 64 bits can be read at any index)
+  private: uint64_t mWords [CAN_FRAME_WORD_COUNT + 1] ;
+  private: uint64_t mStuffWords [CAN_FRAME_WORD_COUNT] ; // Stuff bits are set
+  private: uint32_t mFrameLength ;
+  private: uint32_t mStuffBitCount ;
+  private: uint32_t mBRSIndex ;
+  private: uint32_t mCRC ;
+} ;
+
+//----------------------------------------------------------------------------------------
+//  CAN FRAME BATCH
+//----------------------------------------------------------------------------------------
+// Frames are stored back-to-back in one contiguous bit buffer, packed as in
+// CANFrameBitsGenerator::words (); each frame ends with its INTERMISSION, so the buffer
+// is a valid bus stream.
+
+class CANFrameBatch {
+  public : CANFrameBatch (void) ;
+
+  public : void clear (void) ;
+
+  public : void reserve (const size_t inFrameCount) ;
+
+  public : void append (const CANFrameBitsGenerator & inFrame) ;
+
+  public : void generate (const CANFrameDescriptor inFrames [], const size_t inFrameCount) ;
+
+//--- Recessive bits (bus idle) after the last frame
+  public : void appendIdle (const uint32_t inBitCount) ;
+
+//--- Bits from inBitLength become bus idle; inBitLength should not be below the start of
+//    the last frame
+  public : void truncate (const uint64_t inBitLength) ;
+
+//--- Error injection: inIndex should be below bitLength ()
+  public : void invertBit (const uint64_t inIndex) ;
+
+  public : bool bitAtIndex (const uint64_t inIndex) const ;
+
+  public : inline uint64_t bitLength (void) const { return mBitLength ; }
+  public : inline const uint64_t * words (void) const { return mWords.data () ; }
+  public : inline size_t frameCount (void) const { return mFrameStarts.size () ; }
+  public : inline uint64_t frameStartAtIndex (const size_t inIndex) const { return mFrameStarts [inIndex] ; }
+
+  private: std::vector <uint64_t> mWords ;
+  private: std::vector <uint64_t> mFrameStarts ;
+  private: uint64_t mBitLength ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_FRAME_BITS_GENERATOR
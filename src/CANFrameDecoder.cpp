@@ -0,0 +1,968 @@
+#include "CANFrameDecoder.h"
+#include "CANDestuffTable.h"
+
+//----------------------------------------------------------------------------------------
+//   CRC TABLES: remainder of inBits x^n modulo the generator, for CRC 15 (n = 15), CRC 17
+//   (n = 17) and CRC 21 (n = 21). The register of a CRC of width n advances by k bits
+//   (k <= 8) as: (register << k) ^ remainder ((register >> (n - k)) ^ bits)
+//----------------------------------------------------------------------------------------
+
+class CANCRCTableBuilder {
+  public: CANCRCTableBuilder (void) {
+    for (uint32_t byte = 0 ; byte < 256 ; byte++) {
+      uint32_t crc15 = 0 ;
+      uint32_t crc17 = 0 ;
+      uint32_t crc21 = 0 ;
+      for (uint32_t i=0 ; i<8 ; i++) {
+        const bool bit = ((byte << i) & 0x80) != 0 ;
+        const bool crc15_nxt = bit ^ ((crc15 >> 14) & 1) ;
+        crc15 = ((crc15 << 1) & 0x7FFF) ^ (crc15_nxt ? 0x4599 : 0) ;
+        const bool crc17_nxt = bit ^ ((crc17 >> 16) & 1) ;
+        crc17 = ((crc17 << 1) & 0x1FFFF) ^ (crc17_nxt ? 0x1685B : 0) ;
+        const bool crc21_nxt = bit ^ ((crc21 >> 20) & 1) ;
+        crc21 = ((crc21 << 1) & 0x1FFFFF) ^ (crc21_nxt ? 0x102899 : 0) ;
+      }
+      mCRC15 [byte] = uint16_t (crc15) ;
+      mCRC17 [byte] = crc17 ;
+      mCRC21 [byte] = crc21 ;
+    }
+  }
+
+  public: uint16_t mCRC15 [256] ;
+  public: uint32_t mCRC17 [256] ;
+  public: uint32_t mCRC21 [256] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+static const CANCRCTableBuilder gCRCTables ;
+
+static inline uint16_t crc15Remainder (const uint8_t inBits) { return gCRCTables.mCRC15 [inBits] ; }
+static inline uint32_t crc17Remainder (const uint8_t inBits) { return gCRCTables.mCRC17 [inBits] ; }
+static inline uint32_t crc21Remainder (const uint8_t inBits) { return gCRCTables.mCRC21 [inBits] ; }
+
+//----------------------------------------------------------------------------------------
+//   Error kinds and flags
+//----------------------------------------------------------------------------------------
+
+const char * errorKindName (const CANErrorKind inKind) {
+  switch (inKind) {
+  case CAN_STUFF_ERROR : return "Stuff error" ;
+  case CAN_CRC_ERROR : return "CRC error" ;
+  case CAN_CRC_DELIMITER_ERROR : return "CRC DEL form error" ;
+  case CAN_ACK_DELIMITER_ERROR : return "ACK DEL form error" ;
+  case CAN_EOF_ERROR : return "EOF form error" ;
+  case CAN_INTERMISSION_ERROR : return "IFS form error" ;
+  case CAN_ACK_ERROR : return "ACK error" ;
+  case CAN_RESERVED_BIT_ERROR : return "Reserved bit error" ;
+  case CAN_OVERLOAD_FRAME : return "Overload frame" ;
+  case CAN_TRUNCATED_FRAME : return "Truncated frame" ;
+  case CAN_ERROR_KIND_COUNT : break ;
+  }
+  return "Error" ;
+}
+
+//----------------------------------------------------------------------------------------
+
+const char * errorFlagName (const CANErrorFlag inFlag) {
+  switch (inFlag) {
+  case CAN_ACTIVE_ERROR_FLAG : return "active" ;
+  case CAN_PASSIVE_ERROR_FLAG : return "passive" ;
+  case CAN_NO_ERROR_FLAG : break ;
+  }
+  return "none" ;
+}
+
+//----------------------------------------------------------------------------------------
+//   Data length
+//----------------------------------------------------------------------------------------
+
+uint8_t canDataLengthForCode (const uint8_t inDataCodeLength, const bool inFD) {
+  static const uint8_t fdDataLength [16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} ;
+  const uint8_t dlc = inDataCodeLength & 0xF ;
+  return inFD ? fdDataLength [dlc] : ((dlc > 8) ? 8 : dlc) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+int hexDigitValue (const char inChar) {
+  int result = -1 ;
+  if ((inChar >= '0') && (inChar <= '9')) {
+    result = inChar - '0' ;
+  }else if ((inChar >= 'A') && (inChar <= 'F')) {
+    result = inChar - 'A' + 10 ;
+  }else if ((inChar >= 'a') && (inChar <= 'f')) {
+    result = inChar - 'a' + 10 ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool parseHexDigits (const char * & ioCursor,
+                     const char * inEnd,
+                     const uint32_t inMaxDigitCount,
+                     uint64_t & outValue,
+                     uint32_t & outDigitCount) {
+  outValue = 0 ;
+  outDigitCount = 0 ;
+  while ((ioCursor < inEnd) && (hexDigitValue (*ioCursor) >= 0) && (outDigitCount < inMaxDigitCount)) {
+    outValue = (outValue << 4) | uint64_t (hexDigitValue (*ioCursor)) ;
+    outDigitCount += 1 ;
+    ioCursor += 1 ;
+  }
+  return (outDigitCount > 0) && ((ioCursor == inEnd) || (hexDigitValue (*ioCursor) < 0)) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool parseHexDigits (const std::string & inText,
+                     size_t & ioIndex,
+                     const uint32_t inMaxDigitCount,
+                     uint64_t & outValue,
+                     uint32_t & outDigitCount) {
+  const char * cursor = inText.data () + ioIndex ;
+  const bool ok = parseHexDigits (cursor, inText.data () + inText.size (), inMaxDigitCount, outValue, outDigitCount) ;
+  ioIndex = size_t (cursor - inText.data ()) ;
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANErrorCounters
+//----------------------------------------------------------------------------------------
+
+CANErrorCounters::CANErrorCounters (void) :
+mKindCount (),
+mErrorFlagCount (),
+mIdentifierErrorCount () {
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANErrorCounters::parseIdentifierKey (const std::string & inText,
+                                           size_t & ioIndex,
+                                           uint32_t & outKey) {
+  uint64_t value = 0 ;
+  uint32_t digitCount = 0 ;
+  bool ok = parseHexDigits (inText, ioIndex, 8, value, digitCount) ;
+  const bool extended = digitCount > 3 ;
+  ok = ok && (value <= (extended ? 0x1FFFFFFFU : 0x7FFU)) ;
+  outKey = identifierKey (uint32_t (value), extended) ;
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANErrorCounters::clear (void) {
+  for (uint32_t i=0 ; i<CAN_ERROR_KIND_COUNT ; i++) {
+    mKindCount [i] = 0 ;
+  }
+  for (uint32_t i=0 ; i<3 ; i++) {
+    mErrorFlagCount [i] = 0 ;
+  }
+  mIdentifierErrorCount.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+uint64_t CANErrorCounters::total (void) const {
+  uint64_t result = 0 ;
+  for (uint32_t i=0 ; i<CAN_ERROR_KIND_COUNT ; i++) {
+    result += mKindCount [i] ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANFrameDecoder
+//----------------------------------------------------------------------------------------
+
+CANFrameDecoder::CANFrameDecoder (CANFrameDecoderDelegate * inDelegate) :
+mDelegate (inDelegate),
+mSamplesPerBit (1),
+mNominalSamplesPerBit (1),
+mDataSamplesPerBit (1),
+mCANFDEnabled (false),
+mFrameFieldEngineState (IDLE),
+mFieldBitIndex (0),
+mConsecutiveBitCountOfSamePolarity (0),
+mPreviousBit (true),
+mUnstuffingActive (false),
+mStartOfFrameSampleNumber (0),
+mStuffBitCount (0),
+mStuffBitTotal (0),
+mStartOfFieldSampleNumber (0),
+mIdentifier (0),
+mFrameType (dataFrame),
+mExtended (false),
+mAcked (false),
+mDataCodeLength (0),
+mReceivedDataCodeLength (0),
+mData (),
+mCRC15Accumulator (0),
+mCRC15 (0),
+mIdentifierKnown (false),
+mFD (false),
+mBRS (false),
+mESI (false),
+mCRC17Accumulator (0),
+mCRC21Accumulator (0),
+mFDCRC (0),
+mReceivedFDCRC (0),
+mReceivedStuffCount (0),
+mDynamicStuffBitCount (0),
+mFixedStuffBitExpected (false),
+mStuffCountError (false),
+mErrorCounters (),
+mErrorKind (CAN_STUFF_ERROR),
+mDominantBitCountInError (0),
+mLongestDominantRunInError (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::setCANFD (const bool inEnabled, const uint32_t inDataSamplesPerBit) {
+  mCANFDEnabled = inEnabled ;
+  mDataSamplesPerBit = inDataSamplesPerBit ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::reset (const uint32_t inSamplesPerBit, const bool inPreviousBit) {
+  mSamplesPerBit = inSamplesPerBit ;
+  mNominalSamplesPerBit = inSamplesPerBit ;
+  mFrameFieldEngineState = IDLE ;
+  mPreviousBit = inPreviousBit ;
+  mUnstuffingActive = false ;
+  mStuffBitTotal = 0 ;
+  mErrorCounters.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+//  CAN FRAME DECODER
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::enterBit (const bool inBitValue,
+                                const uint64_t inSampleNumber) {
+  if (mUnstuffingActive) { // CAN FD CRCs include dynamic stuff bits
+    enterBitInFDCRC (inBitValue) ;
+  }
+  if (!mUnstuffingActive) {
+    decodeFrameBit (inBitValue, inSampleNumber) ;
+  }else if ((mConsecutiveBitCountOfSamePolarity == 5) && (inBitValue != mPreviousBit)) {
+   // Stuff bit - discarded
+    addMark (inSampleNumber, MARK_X);
+    mConsecutiveBitCountOfSamePolarity = 1 ;
+    mPreviousBit = inBitValue ;
+    mStuffBitCount += 1 ;
+    mStuffBitTotal += 1 ;
+  }else if ((mConsecutiveBitCountOfSamePolarity == 5) && (mPreviousBit == inBitValue)) { // Stuff Error
+    addMark (inSampleNumber, MARK_ERROR_X);
+    enterInErrorMode (inSampleNumber + mSamplesPerBit / 2, CAN_STUFF_ERROR) ;
+    mConsecutiveBitCountOfSamePolarity += 1 ;
+  }else if (mPreviousBit == inBitValue) {
+    mConsecutiveBitCountOfSamePolarity += 1 ;
+    decodeFrameBit (inBitValue, inSampleNumber) ;
+  }else{
+    mConsecutiveBitCountOfSamePolarity = 1 ;
+    mPreviousBit = inBitValue ;
+    decodeFrameBit (inBitValue, inSampleNumber) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+uint32_t CANFrameDecoder::enterBits (const uint8_t inBits,
+                                     const uint32_t inCount,
+                                     const uint64_t inFirstSampleNumber) {
+  const uint32_t samplesPerBit = mSamplesPerBit ;
+  uint32_t idx = 0 ;
+  while ((idx < inCount) && (mSamplesPerBit == samplesPerBit)) {
+    const uint64_t sampleNumber = inFirstSampleNumber + uint64_t (idx) * samplesPerBit ;
+    if (mUnstuffingActive && (mFrameFieldEngineState != DECODER_ERROR)) {
+      idx += enterStuffedBits (uint8_t (inBits << idx), inCount - idx, sampleNumber) ;
+    }else{
+      enterBit (((inBits << idx) & 0x80) != 0, sampleNumber) ;
+      idx += 1 ;
+    }
+  }
+  return idx ;
+}
+
+//----------------------------------------------------------------------------------------
+
+uint64_t CANFrameDecoder::enterLevel (const bool inBit, uint64_t & ioBitStart, const uint64_t inLevelEnd) {
+  uint64_t enteredBitCount = 0 ;
+  uint32_t bitSampleCount = mSamplesPerBit ;
+  while ((ioBitStart + bitSampleCount - bitSampleCount / 2) <= inLevelEnd) {
+    const uint64_t samplePoint = ioBitStart + bitSampleCount / 2 ;
+    const uint64_t bitCount = 1 + (inLevelEnd - (ioBitStart + bitSampleCount - bitSampleCount / 2)) / bitSampleCount ;
+    const uint32_t count = enterBits (inBit ? 0xFF : 0x00, (bitCount < 8) ? uint32_t (bitCount) : 8, samplePoint) ;
+    enteredBitCount += count ;
+    const uint64_t lastSamplePoint = samplePoint + uint64_t (count - 1) * bitSampleCount ;
+    bitSampleCount = mSamplesPerBit ;
+    ioBitStart = lastSamplePoint + bitSampleCount - bitSampleCount / 2 ;
+  }
+  return enteredBitCount ;
+}
+
+//----------------------------------------------------------------------------------------
+// Bits are handled while unstuffing is active, the bit time is unchanged, and the decoder
+// is not in error (its handler also updates the run state). The run state (mPreviousBit,
+// mConsecutiveBitCountOfSamePolarity) is then updated for the bits entered, as enterBit
+// does. 8 raw bits without stuff error that do not end the DATA field are consumed as a
+// whole (enterDestuffedDataBits).
+
+uint32_t CANFrameDecoder::enterStuffedBits (const uint8_t inBits,
+                                            const uint32_t inCount,
+                                            const uint64_t inFirstSampleNumber) {
+  const CANDestuffEntry & entry = destuffEntry (mPreviousBit,
+                                                uint32_t (mConsecutiveBitCountOfSamePolarity),
+                                                inBits) ;
+  if ((inCount == 8)
+   && (entry.mErrorIndex == 8)
+   && (mFrameFieldEngineState == DATA)
+   && ((mFieldBitIndex + int (entry.mOutputCount)) < (8 * mDataCodeLength))) {
+    enterDestuffedDataBits (entry, inBits, inFirstSampleNumber) ;
+    advanceDestuffState (mPreviousBit, mConsecutiveBitCountOfSamePolarity, inBits, 8) ;
+    return 8 ;
+  }
+  const uint32_t samplesPerBit = mSamplesPerBit ;
+  uint32_t idx = 0 ;
+  bool goOn = true ;
+  while (goOn && (idx < inCount)) {
+    const bool bit = ((inBits << idx) & 0x80) != 0 ;
+    const uint64_t sampleNumber = inFirstSampleNumber + uint64_t (idx) * samplesPerBit ;
+    enterBitInFDCRC (bit) ; // CAN FD CRCs include dynamic stuff bits
+    if (idx == entry.mErrorIndex) {
+      addMark (sampleNumber, MARK_ERROR_X);
+      enterInErrorMode (sampleNumber + samplesPerBit / 2, CAN_STUFF_ERROR) ;
+    }else if (((entry.mStuffMask << idx) & 0x80) != 0) { // Stuff bit - discarded
+      addMark (sampleNumber, MARK_X);
+      mStuffBitCount += 1 ;
+      mStuffBitTotal += 1 ;
+    }else{
+      decodeFrameBit (bit, sampleNumber) ;
+    }
+    idx += 1 ;
+    goOn = mUnstuffingActive
+      && (mSamplesPerBit == samplesPerBit)
+      && (mFrameFieldEngineState != DECODER_ERROR)
+    ;
+  }
+  advanceDestuffState (mPreviousBit, mConsecutiveBitCountOfSamePolarity, inBits, idx) ;
+  return idx ;
+}
+
+//----------------------------------------------------------------------------------------
+// Same as handle_DATA_state for each destuffed bit: the destuffed bits are shifted into the
+// data bytes at once, and the CRC registers advance by table (CRC 15 over the destuffed
+// bits, CAN FD CRCs over the 8 raw bits). Markers and data bubbles follow, in bit order.
+
+void CANFrameDecoder::enterDestuffedDataBits (const CANDestuffEntry & inEntry,
+                                              const uint8_t inBits,
+                                              const uint64_t inFirstSampleNumber) {
+  const uint32_t outputCount = inEntry.mOutputCount ;
+  mCRC15Accumulator = uint16_t (((uint32_t (mCRC15Accumulator) << outputCount) & 0x7FFF)
+    ^ crc15Remainder (uint8_t ((mCRC15Accumulator >> (15 - outputCount)) ^ (inEntry.mOutputBits >> (8 - outputCount))))) ;
+  mCRC17Accumulator = ((mCRC17Accumulator << 8) & 0x1FFFF) ^ crc17Remainder (uint8_t ((mCRC17Accumulator >> 9) ^ inBits)) ;
+  mCRC21Accumulator = ((mCRC21Accumulator << 8) & 0x1FFFFF) ^ crc21Remainder (uint8_t ((mCRC21Accumulator >> 13) ^ inBits)) ;
+//--- Data bytes: the destuffed bits span at most two of them
+  const uint32_t firstFieldBitIndex = uint32_t (mFieldBitIndex) ;
+  uint32_t bits = inEntry.mOutputBits ;
+  uint32_t remaining = outputCount ;
+  while (remaining > 0) {
+    const uint32_t freeCount = 8 - uint32_t (mFieldBitIndex) % 8 ;
+    const uint32_t count = (remaining < freeCount) ? remaining : freeCount ;
+    uint8_t & byte = mData [mFieldBitIndex / 8] ;
+    byte = uint8_t ((uint32_t (byte) << count) | (bits >> (8 - count))) ;
+    bits = (bits << count) & 0xFF ;
+    remaining -= count ;
+    mFieldBitIndex += int (count) ;
+  }
+  const uint32_t stuffBitCount = 8 - outputCount ;
+  mStuffBitCount += stuffBitCount ;
+  mStuffBitTotal += stuffBitCount ;
+//--- Markers and bubbles
+  const uint32_t samplesPerBit = mSamplesPerBit ;
+  uint32_t fieldBitIndex = firstFieldBitIndex ;
+  for (uint32_t idx=0 ; idx<8 ; idx++) {
+    const uint64_t sampleNumber = inFirstSampleNumber + uint64_t (idx) * samplesPerBit ;
+    if (((inEntry.mStuffMask << idx) & 0x80) != 0) { // Stuff bit - discarded
+      addMark (sampleNumber, MARK_X);
+    }else{
+      addMark (sampleNumber, MARK_DOT);
+      fieldBitIndex += 1 ;
+      if ((fieldBitIndex % 8) == 0) {
+        const uint32_t dataIndex = (fieldBitIndex - 1) / 8 ;
+        addBubble (DATA_FIELD_RESULT, mData [dataIndex], dataIndex, sampleNumber + samplesPerBit / 2) ;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::decodeFrameBit (const bool inBitValue,
+                                      const uint64_t inSampleNumber) {
+  switch (mFrameFieldEngineState) {
+  case IDLE :
+    handle_IDLE_state (inBitValue, inSampleNumber) ;
+    break ;
+  case IDENTIFIER :
+    handle_IDENTIFIER_state (inBitValue, inSampleNumber) ;
+    break ;
+  case EXTENDED_IDF :
+    handle_EXTENDED_IDF_state (inBitValue, inSampleNumber) ;
+    break ;
+  case CONTROL :
+    handle_CONTROL_state (inBitValue, inSampleNumber) ;
+    break ;
+  case DATA :
+    handle_DATA_state (inBitValue, inSampleNumber) ;
+    break ;
+  case CRC15 :
+    handle_CRC15_state (inBitValue, inSampleNumber) ;
+    break ;
+  case CRC_FD :
+    handle_CRCFD_state (inBitValue, inSampleNumber) ;
+    break ;
+  case CRC_DEL :
+    handle_CRCDEL_state (inBitValue, inSampleNumber) ;
+    break ;
+  case ACK :
+    handle_ACK_state (inBitValue, inSampleNumber) ;
+    break ;
+  case END_OF_FRAME :
+    handle_ENDOFFRAME_state (inBitValue, inSampleNumber) ;
+    break ;
+  case INTERMISSION :
+    handle_INTERMISSION_state (inBitValue, inSampleNumber) ;
+    break ;
+  case DECODER_ERROR :
+    handle_DECODER_ERROR_state (inBitValue, inSampleNumber) ;
+    break ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_IDLE_state (const bool inBitValue,
+                                         const uint64_t inSampleNumber) {
+  if (inBitValue) {
+    addMark (inSampleNumber, MARK_STOP) ;
+  }else{ // SOF
+    mUnstuffingActive = true ;
+    mCRC15Accumulator = 0 ;
+    mCRC17Accumulator = 1 << 16 ;
+    mCRC21Accumulator = 1 << 20 ;
+    mConsecutiveBitCountOfSamePolarity = 1 ;
+    mPreviousBit = false ;
+    enterBitInCRC15 (inBitValue) ;
+    enterBitInFDCRC (inBitValue) ;
+    addMark (inSampleNumber, MARK_START) ;
+    mFieldBitIndex = 0 ;
+    mIdentifier = 0 ;
+    mExtended = false ;
+    mFD = false ;
+    mBRS = false ;
+    mESI = false ;
+    mIdentifierKnown = false ;
+    mFrameFieldEngineState = IDENTIFIER ;
+    mStartOfFieldSampleNumber = inSampleNumber + mSamplesPerBit / 2 ;
+    mStartOfFrameSampleNumber = inSampleNumber ;
+    mStuffBitCount = 0 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_IDENTIFIER_state (const bool inBitValue,
+                                               const uint64_t inSampleNumber) {
+  enterBitInCRC15 (inBitValue) ;
+  mFieldBitIndex ++ ;
+  if (mFieldBitIndex <= 11) { // Standard identifier
+    addMark (inSampleNumber, MARK_DOT);
+    mIdentifier <<= 1 ;
+    mIdentifier |= inBitValue ;
+  }else if (mFieldBitIndex == 12) { // RTR bit
+    addMark (inSampleNumber, inBitValue ? MARK_UP_ARROW : MARK_DOWN_ARROW) ;
+    mFrameType = inBitValue ? remoteFrame : dataFrame  ;
+  }else{ // IDE
+    addMark (inSampleNumber, MARK_DOT);
+    if (inBitValue) {
+      mFrameFieldEngineState = EXTENDED_IDF ;
+      mExtended = true ;
+      mFieldBitIndex = 0 ;
+    }else{
+      mIdentifierKnown = true ;
+      addBubble (STANDARD_IDENTIFIER_FIELD_RESULT,
+                 mIdentifier,
+                 mFrameType == dataFrame, // 0 -> remote, 1 -> data
+                 inSampleNumber - mSamplesPerBit / 2) ;
+      mDataCodeLength = 0 ;
+      mFrameFieldEngineState = CONTROL ;
+      mFieldBitIndex = 1 ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_EXTENDED_IDF_state (const bool inBitValue,
+                                                 const uint64_t inSampleNumber) {
+  enterBitInCRC15 (inBitValue) ;
+  mFieldBitIndex ++ ;
+  if (mFieldBitIndex <= 18) { // Extended identifier
+    addMark (inSampleNumber, MARK_DOT);
+    mIdentifier <<= 1 ;
+    mIdentifier |= inBitValue ;
+  }else if (mFieldBitIndex == 19) { // RTR bit
+    addMark (inSampleNumber, inBitValue ? MARK_UP_ARROW : MARK_DOWN_ARROW) ;
+    mFrameType = inBitValue ? remoteFrame : dataFrame  ;
+  }else{ // R1: should be dominant (CAN 2.0B), FDF (CAN FD)
+    const bool fdFrame = inBitValue && mCANFDEnabled ;
+    addMark (inSampleNumber, fdFrame ? MARK_ONE : (inBitValue ? MARK_ERROR_X : MARK_ZERO)) ;
+    mIdentifierKnown = true ;
+    if (fdFrame) {
+      mFD = true ;
+      mFrameType = dataFrame ; // RTR is RRS
+    }
+    addBubble (EXTENDED_IDENTIFIER_FIELD_RESULT,
+               mIdentifier,
+               mFrameType == dataFrame, // 0 -> remote, 1 -> data
+               inSampleNumber - mSamplesPerBit / 2) ;
+    if (fdFrame) {
+      mFrameFieldEngineState = CONTROL ;
+      mFieldBitIndex = 2 ; // Next is res bit
+      mDataCodeLength = 0 ;
+    }else if (inBitValue) {
+      enterInErrorMode (inSampleNumber + mSamplesPerBit / 2, CAN_RESERVED_BIT_ERROR) ;
+    }else{
+      mFrameFieldEngineState = CONTROL ;
+      mFieldBitIndex = 1 ;
+      mDataCodeLength = 0 ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_CONTROL_state (const bool inBitValue,
+                                            const uint64_t inSampleNumber) {
+  enterBitInCRC15 (inBitValue) ;
+  mFieldBitIndex ++ ;
+  if (mFieldBitIndex == 2) { // R0 (CAN 2.0B), FDF of standard frames (CAN FD)
+    if (inBitValue && mCANFDEnabled && !mExtended) {
+      addMark (inSampleNumber, MARK_ONE) ;
+      mFD = true ;
+      mFrameType = dataFrame ; // RTR is RRS
+    }else{
+      addMark (inSampleNumber, inBitValue ? MARK_ERROR_X : MARK_ZERO) ;
+      if (inBitValue) {
+        enterInErrorMode (inSampleNumber + mSamplesPerBit / 2, CAN_RESERVED_BIT_ERROR) ;
+      }
+    }
+  }else if (mFD && (mFieldBitIndex == 3)) { // res
+    addMark (inSampleNumber, inBitValue ? MARK_ERROR_X : MARK_ZERO) ;
+    if (inBitValue) {
+      enterInErrorMode (inSampleNumber + mSamplesPerBit / 2, CAN_RESERVED_BIT_ERROR) ;
+    }
+  }else if (mFD && (mFieldBitIndex == 4)) { // BRS: data bit rate from its sample point
+    addMark (inSampleNumber, inBitValue ? MARK_UP_ARROW : MARK_DOT) ;
+    mBRS = inBitValue ;
+    if (mBRS) {
+      mSamplesPerBit = mDataSamplesPerBit ;
+    }
+  }else if (mFD && (mFieldBitIndex == 5)) { // ESI
+    addMark (inSampleNumber, MARK_DOT) ;
+    mESI = inBitValue ;
+  }else{
+    addMark (inSampleNumber, MARK_DOT);
+    mDataCodeLength <<= 1 ;
+    mDataCodeLength |= inBitValue ;
+    if (mFieldBitIndex == (mFD ? 9 : 6)) {
+      const uint64_t flags = (mFD ? CAN_FD_FDF_FLAG : 0)
+                           | (mBRS ? CAN_FD_BRS_FLAG : 0)
+                           | (mESI ? CAN_FD_ESI_FLAG : 0) ;
+      addBubble (CONTROL_FIELD_RESULT, mDataCodeLength, flags, inSampleNumber + mSamplesPerBit / 2) ;
+      mFieldBitIndex = 0 ;
+      mReceivedDataCodeLength = mDataCodeLength ;
+      mDataCodeLength = canDataLengthForCode (uint8_t (mDataCodeLength), mFD) ;
+      if ((mDataCodeLength == 0) || (mFrameType == remoteFrame)) {
+        enterCRCField () ;
+      }else{
+        mFrameFieldEngineState = DATA ;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_DATA_state (const bool inBitValue,
+                                         const uint64_t inSampleNumber) {
+  enterBitInCRC15 (inBitValue) ;
+  addMark (inSampleNumber, MARK_DOT);
+  mData [mFieldBitIndex / 8] <<= 1 ;
+  mData [mFieldBitIndex / 8] |= inBitValue ;
+  mFieldBitIndex ++ ;
+  if ((mFieldBitIndex % 8) == 0) {
+    const uint32_t dataIndex = (mFieldBitIndex - 1) / 8 ;
+    addBubble (DATA_FIELD_RESULT, mData [dataIndex], dataIndex, inSampleNumber + mSamplesPerBit / 2) ;
+  }
+  if (mFieldBitIndex == (8 * mDataCodeLength)) {
+    enterCRCField () ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::enterCRCField (void) {
+  mFieldBitIndex = 0 ;
+  if (mFD) { // Dynamic stuffing ends with the data field
+    mUnstuffingActive = false ;
+    mDynamicStuffBitCount = mStuffBitCount ;
+    mFixedStuffBitExpected = true ;
+    mReceivedStuffCount = 0 ;
+    mReceivedFDCRC = 0 ;
+    mFrameFieldEngineState = CRC_FD ;
+  }else{
+    mCRC15 = mCRC15Accumulator ;
+    mFrameFieldEngineState = CRC15 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_CRC15_state (const bool inBitValue,
+                                          const uint64_t inSampleNumber) {
+  enterBitInCRC15 (inBitValue) ;
+  addMark (inSampleNumber, MARK_DOT);
+  mFieldBitIndex ++ ;
+  if (mFieldBitIndex == 15) {
+    mFieldBitIndex = 0 ;
+    mFrameFieldEngineState = CRC_DEL ;
+    addBubble (CRC_FIELD_RESULT, mCRC15, mCRC15Accumulator, inSampleNumber + mSamplesPerBit / 2) ;
+    if (mCRC15Accumulator != 0) {
+      mFrameFieldEngineState = DECODER_ERROR ;
+      countError (CAN_CRC_ERROR) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// CAN FD: stuff count (3 bit Gray code of the dynamic stuff bit count modulo 8, parity
+// bit), then CRC 17 (up to 16 data bytes) or CRC 21. A fixed stuff bit, the complement of
+// the previous bit, comes first and after every 4 bits.
+
+void CANFrameDecoder::handle_CRCFD_state (const bool inBitValue,
+                                          const uint64_t inSampleNumber) {
+  const int crcLength = (mDataCodeLength > 16) ? 21 : 17 ;
+  if (mFixedStuffBitExpected) {
+    mFixedStuffBitExpected = false ;
+    if (inBitValue == mPreviousBit) {
+      addMark (inSampleNumber, MARK_ERROR_X) ;
+      enterInErrorMode (inSampleNumber + mSamplesPerBit / 2, CAN_STUFF_ERROR) ;
+    }else{
+      addMark (inSampleNumber, MARK_X) ;
+      mStuffBitCount += 1 ;
+      mStuffBitTotal += 1 ;
+    }
+  }else{
+    addMark (inSampleNumber, MARK_DOT) ;
+    mFieldBitIndex ++ ;
+    if (mFieldBitIndex <= 4) { // Stuff count
+      enterBitInFDCRC (inBitValue) ;
+      mReceivedStuffCount = uint8_t ((mReceivedStuffCount << 1) | inBitValue) ;
+      if (mFieldBitIndex == 4) {
+        mFDCRC = (crcLength == 17) ? mCRC17Accumulator : mCRC21Accumulator ;
+        const uint8_t gray = mReceivedStuffCount >> 1 ;
+        const uint8_t count = gray ^ (gray >> 1) ^ (gray >> 2) ;
+        const bool parityError = ((gray ^ (gray >> 1) ^ (gray >> 2) ^ mReceivedStuffCount) & 1) != 0 ;
+        mStuffCountError = parityError || (count != (mDynamicStuffBitCount % 8)) ;
+        addBubble (STUFF_COUNT_FIELD_RESULT, count, mStuffCountError, inSampleNumber + mSamplesPerBit / 2) ;
+      }
+    }else{ // CRC
+      mReceivedFDCRC = (mReceivedFDCRC << 1) | inBitValue ;
+      if (mFieldBitIndex == (4 + crcLength)) {
+        mFieldBitIndex = 0 ;
+        mFrameFieldEngineState = CRC_DEL ;
+        addBubble (CRC_FIELD_RESULT, mReceivedFDCRC, mReceivedFDCRC ^ mFDCRC, inSampleNumber + mSamplesPerBit / 2) ;
+        if (mStuffCountError || (mReceivedFDCRC != mFDCRC)) {
+          mFrameFieldEngineState = DECODER_ERROR ;
+          mSamplesPerBit = mNominalSamplesPerBit ;
+          countError (CAN_CRC_ERROR) ;
+        }
+      }
+    }
+    if (((mFieldBitIndex % 4) == 0) && (mFieldBitIndex > 0)) {
+      mFixedStuffBitExpected = true ;
+    }
+  }
+  mPreviousBit = inBitValue ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_CRCDEL_state (const bool inBitValue,
+                                           const uint64_t inSampleNumber) {
+  mUnstuffingActive = false ;
+  mSamplesPerBit = mNominalSamplesPerBit ; // End of CAN FD data phase, at sample point
+  if (inBitValue) {
+    addMark (inSampleNumber, MARK_ONE) ;
+    mStartOfFieldSampleNumber = inSampleNumber + mSamplesPerBit / 2 ;
+    mFrameFieldEngineState = ACK ;
+  }else{
+    enterInErrorMode (inSampleNumber, CAN_CRC_DELIMITER_ERROR) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_ACK_state (const bool inBitValue,
+                                        const uint64_t inSampleNumber) {
+  mFieldBitIndex ++ ;
+  if (mFieldBitIndex == 1) { // ACK SLOT
+    addMark (inSampleNumber, inBitValue ? MARK_ERROR_SQUARE : MARK_DOWN_ARROW);
+    mAcked = !inBitValue ;
+    if (!mAcked) {
+      countError (CAN_ACK_ERROR) ;
+    }
+  }else{ // ACK DELIMITER
+    addBubble (ACK_FIELD_RESULT, !mAcked, 0, inSampleNumber + mSamplesPerBit / 2) ;
+    mFrameFieldEngineState = END_OF_FRAME ;
+    if (inBitValue) {
+      addMark (inSampleNumber, MARK_ONE) ;
+    }else{
+      addMark (inSampleNumber, MARK_ERROR_DOT) ;
+      enterInErrorMode (inSampleNumber, CAN_ACK_DELIMITER_ERROR) ;
+    }
+    mFieldBitIndex = 0 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_ENDOFFRAME_state (const bool inBitValue,
+                                               const uint64_t inSampleNumber) {
+  mFieldBitIndex ++ ;
+  if (inBitValue) {
+    addMark (inSampleNumber, MARK_ONE) ;
+  }else if (mFieldBitIndex < 7) {
+    enterInErrorMode (inSampleNumber, CAN_EOF_ERROR) ;
+  }
+  if (mFieldBitIndex == 7) {
+    addBubble (EOF_FIELD_RESULT, 0, 0, inSampleNumber + mSamplesPerBit / 2) ;
+    mFieldBitIndex = 0 ;
+    mFrameFieldEngineState = INTERMISSION ;
+  //--- The frame is valid for receivers at the last but one bit of EOF
+    CANDecodedMessage message ;
+    message.mStartSampleNumber = mStartOfFrameSampleNumber ;
+    message.mEndSampleNumber = inSampleNumber + mSamplesPerBit / 2 ;
+    message.mIdentifier = mIdentifier ;
+    message.mExtended = mExtended ;
+    message.mRemote = mFrameType == remoteFrame ;
+    message.mAcked = mAcked ;
+    message.mFD = mFD ;
+    message.mBRS = mBRS ;
+    message.mESI = mESI ;
+    message.mDataCodeLength = uint8_t (mReceivedDataCodeLength) ;
+    message.mDataLength = (mFrameType == remoteFrame) ? 0 : uint8_t (mDataCodeLength) ;
+    for (uint32_t i=0 ; i<64 ; i++) {
+      message.mData [i] = (i < message.mDataLength) ? mData [i] : 0 ;
+    }
+    message.mStuffBitCount = uint32_t (mStuffBitCount) ;
+    mDelegate->addMessage (message) ;
+    mIdentifierKnown = false ; // Following errors do not belong to this frame
+  //--- Dominant last bit of EOF: overload frame
+    if (!inBitValue) {
+      enterInErrorMode (inSampleNumber, CAN_OVERLOAD_FRAME) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_INTERMISSION_state (const bool inBitValue,
+                                                 const uint64_t inSampleNumber) {
+  if (inBitValue) {
+    addMark (inSampleNumber, MARK_ONE) ;
+    mFieldBitIndex ++ ;
+    if (mFieldBitIndex == 3) {
+      const uint64_t frameSampleCount = inSampleNumber - mStartOfFrameSampleNumber ;
+      addBubble (INTERMISSION_FIELD_RESULT,
+                 frameSampleCount,
+                 mStuffBitCount,
+                 inSampleNumber + mSamplesPerBit / 2) ;
+      mFieldBitIndex = 0 ;
+      mFrameFieldEngineState = IDLE ;
+    }
+  }else if (mFieldBitIndex < 2) { // Dominant first or second bit of INTERMISSION
+    enterInErrorMode (inSampleNumber, CAN_OVERLOAD_FRAME) ;
+  }else{ // Dominant third bit: SOF of the next frame (ISO 11898-1), INTERMISSION ends before
+    const uint64_t frameSampleCount = inSampleNumber - mSamplesPerBit - mStartOfFrameSampleNumber ;
+    addBubble (INTERMISSION_FIELD_RESULT,
+               frameSampleCount,
+               mStuffBitCount,
+               inSampleNumber - mSamplesPerBit / 2) ;
+    mFieldBitIndex = 0 ;
+    mFrameFieldEngineState = IDLE ;
+    handle_IDLE_state (inBitValue, inSampleNumber) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::handle_DECODER_ERROR_state (const bool inBitValue,
+                                                  const uint64_t inSampleNumber) {
+  mUnstuffingActive = false ;
+  addMark (inSampleNumber, MARK_ERROR_DOT);
+  if (!inBitValue) {
+    mDominantBitCountInError = (mPreviousBit == inBitValue) ? (mDominantBitCountInError + 1) : 1 ;
+    if (mLongestDominantRunInError < mDominantBitCountInError) {
+      mLongestDominantRunInError = mDominantBitCountInError ;
+    }
+  }
+  if (mPreviousBit != inBitValue) {
+    mConsecutiveBitCountOfSamePolarity = 1 ;
+    mPreviousBit = inBitValue ;
+  }else if (inBitValue) {
+    mConsecutiveBitCountOfSamePolarity += 1 ;
+    if (mConsecutiveBitCountOfSamePolarity == 11) {
+      addErrorBubble (inSampleNumber + mSamplesPerBit / 2) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::addErrorBubble (const uint64_t inEndSampleNumber) {
+  CANErrorFlag flag = CAN_NO_ERROR_FLAG ;
+  if (mLongestDominantRunInError >= 6) {
+    flag = CAN_ACTIVE_ERROR_FLAG ;
+  }else if (mLongestDominantRunInError == 0) {
+    flag = CAN_PASSIVE_ERROR_FLAG ;
+  }
+  mErrorCounters.mErrorFlagCount [flag] += 1 ;
+  const uint64_t identifier = mIdentifierKnown
+    ? ((uint64_t (1) << 32) | CANErrorCounters::identifierKey (mIdentifier, mExtended))
+    : 0
+  ;
+  addBubble (CAN_ERROR_RESULT,
+             uint64_t (mErrorKind) | (uint64_t (flag) << 8),
+             identifier,
+             inEndSampleNumber) ;
+  mFrameFieldEngineState = IDLE ;
+}
+
+//----------------------------------------------------------------------------------------
+// A truncated frame is counted by kind only: it is not an error of its identifier. The
+// frame length of an incomplete INTERMISSION field runs up to its last received bit. An
+// error row does not end before it starts: the last bit entered, sampled before
+// inSampleNumber, may end half a bit after it.
+
+void CANFrameDecoder::endOfSamples (const uint64_t inSampleNumber) {
+  const uint64_t endSampleNumber = (inSampleNumber > mStartOfFieldSampleNumber)
+    ? inSampleNumber
+    : mStartOfFieldSampleNumber
+  ;
+  switch (mFrameFieldEngineState) {
+  case IDLE :
+    break ;
+  case DECODER_ERROR :
+    addErrorBubble (endSampleNumber) ;
+    break ;
+  case INTERMISSION :
+    { const uint64_t end = mStartOfFieldSampleNumber + uint64_t (mFieldBitIndex) * mSamplesPerBit ;
+      addBubble (INTERMISSION_FIELD_RESULT,
+                 end - mSamplesPerBit / 2 - mStartOfFrameSampleNumber,
+                 mStuffBitCount,
+                 end) ;
+    }
+    break ;
+  default :
+    mErrorCounters.mKindCount [CAN_TRUNCATED_FRAME] += 1 ;
+    addBubble (CAN_ERROR_RESULT,
+               uint64_t (CAN_TRUNCATED_FRAME) | (uint64_t (CAN_NO_ERROR_FLAG) << 8),
+               mIdentifierKnown ? ((uint64_t (1) << 32) | CANErrorCounters::identifierKey (mIdentifier, mExtended)) : 0,
+               endSampleNumber) ;
+    break ;
+  }
+  mFieldBitIndex = 0 ;
+  mFrameFieldEngineState = IDLE ;
+  mUnstuffingActive = false ;
+  mSamplesPerBit = mNominalSamplesPerBit ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::enterBitInCRC15 (const bool inBitValue) {
+  const bool bit14 = (mCRC15Accumulator & (1 << 14)) != 0 ;
+  const bool crc_nxt = inBitValue ^ bit14 ;
+  mCRC15Accumulator <<= 1 ;
+  mCRC15Accumulator &= 0x7FFF ;
+  if (crc_nxt) {
+    mCRC15Accumulator ^= 0x4599 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// CRC 17 and CRC 21 registers start with their MSB set (ISO 11898-1:2015)
+
+void CANFrameDecoder::enterBitInFDCRC (const bool inBitValue) {
+  const bool crc17_nxt = inBitValue ^ ((mCRC17Accumulator >> 16) & 1) ;
+  mCRC17Accumulator = (mCRC17Accumulator << 1) & 0x1FFFF ;
+  if (crc17_nxt) {
+    mCRC17Accumulator ^= 0x1685B ;
+  }
+  const bool crc21_nxt = inBitValue ^ ((mCRC21Accumulator >> 20) & 1) ;
+  mCRC21Accumulator = (mCRC21Accumulator << 1) & 0x1FFFFF ;
+  if (crc21_nxt) {
+    mCRC21Accumulator ^= 0x102899 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::addMark (const uint64_t inSampleNumber,
+                               const CANDecoderMarker inMarker) {
+  mDelegate->addMark (inSampleNumber, inMarker) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::addBubble (const uint8_t inBubbleType,
+                                 const uint64_t inData1,
+                                 const uint64_t inData2,
+                                 const uint64_t inEndSampleNumber) {
+  mDelegate->addBubble (inBubbleType, inData1, inData2, mStartOfFieldSampleNumber, inEndSampleNumber) ;
+//--- Prepare for next bubble
+  mStartOfFieldSampleNumber = inEndSampleNumber ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::enterInErrorMode (const uint64_t inSampleNumber, const CANErrorKind inKind) {
+  mStartOfFieldSampleNumber = inSampleNumber ;
+  mSamplesPerBit = mNominalSamplesPerBit ; // Error and overload flags use the nominal bit rate
+  mFrameFieldEngineState = DECODER_ERROR ;
+  mUnstuffingActive = false ;
+  countError (inKind) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANFrameDecoder::countError (const CANErrorKind inKind) {
+  mErrorCounters.mKindCount [inKind] += 1 ;
+  if (mIdentifierKnown) {
+    mErrorCounters.mIdentifierErrorCount [CANErrorCounters::identifierKey (mIdentifier, mExtended)] += 1 ;
+  }
+  if (inKind != CAN_ACK_ERROR) {
+    mErrorKind = inKind ;
+    mDominantBitCountInError = 0 ;
+    mLongestDominantRunInError = 0 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,301 @@
+#ifndef CAN_FRAME_DECODER
+#define CAN_FRAME_DECODER
+
+//----------------------------------------------------------------------------------------
+// The CAN frame decoder does not depend on the Saleae SDK: it receives sampled bits, and
+// reports markers, fields and decoded messages to its delegate.
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+
+class CANDestuffEntry ;
+
+//----------------------------------------------------------------------------------------
+
+enum CanFrameType {
+  STANDARD_IDENTIFIER_FIELD_RESULT,
+  EXTENDED_IDENTIFIER_FIELD_RESULT,
+  CONTROL_FIELD_RESULT,
+  DATA_FIELD_RESULT,
+  CRC_FIELD_RESULT,
+  ACK_FIELD_RESULT,
+  EOF_FIELD_RESULT,
+  INTERMISSION_FIELD_RESULT,
+  CAN_ERROR_RESULT,
+  CAN_MESSAGE_RESULT, // Not sent by the decoder: whole frame, see CANMolinaroAnalyzerResults.h
+  STUFF_COUNT_FIELD_RESULT // CAN FD only
+} ;
+
+//----------------------------------------------------------------------------------------
+// CONTROL_FIELD_RESULT bubble: Data1 is the DLC, Data2 is a combination of:
+
+static const uint64_t CAN_FD_FDF_FLAG = 1 ;
+static const uint64_t CAN_FD_BRS_FLAG = 2 ;
+static const uint64_t CAN_FD_ESI_FLAG = 4 ;
+
+//----------------------------------------------------------------------------------------
+// Data byte count for a DLC: CAN 2.0B clamps to 8, CAN FD maps 9 ... 15 to 12 ... 64
+
+uint8_t canDataLengthForCode (const uint8_t inDataCodeLength, const bool inFD) ;
+
+//----------------------------------------------------------------------------------------
+// Hexadecimal text: value of a digit, -1 if inChar is not a digit
+
+int hexDigitValue (const char inChar) ;
+
+//--- Digits from ioCursor up to a character that is not a digit: fails if there is none,
+//    or more than inMaxDigitCount (at most 16)
+bool parseHexDigits (const char * & ioCursor,
+                     const char * inEnd,
+                     const uint32_t inMaxDigitCount,
+                     uint64_t & outValue,
+                     uint32_t & outDigitCount) ;
+
+bool parseHexDigits (const std::string & inText,
+                     size_t & ioIndex,
+                     const uint32_t inMaxDigitCount,
+                     uint64_t & outValue,
+                     uint32_t & outDigitCount) ;
+
+//----------------------------------------------------------------------------------------
+// CAN_ERROR_RESULT bubble: Data1 is CANErrorKind | (CANErrorFlag << 8), Data2 is the
+// identifier key (see CANErrorCounters) | (1 << 32) if the identifier is known, 0 otherwise
+
+typedef enum {
+  CAN_STUFF_ERROR,
+  CAN_CRC_ERROR,
+  CAN_CRC_DELIMITER_ERROR,
+  CAN_ACK_DELIMITER_ERROR,
+  CAN_EOF_ERROR,
+  CAN_INTERMISSION_ERROR, // Not raised: a dominant third INTERMISSION bit is a SOF
+  CAN_ACK_ERROR, // Counted only: decoding goes on
+  CAN_RESERVED_BIT_ERROR,
+  CAN_OVERLOAD_FRAME,
+  CAN_TRUNCATED_FRAME, // Not a bus error: decoding ended within the frame (see endOfSamples)
+  CAN_ERROR_KIND_COUNT
+} CANErrorKind ;
+
+const char * errorKindName (const CANErrorKind inKind) ;
+
+//----------------------------------------------------------------------------------------
+// Deduced from what follows the error: at least 6 dominant bits is an active error flag
+// (or an overload flag), only recessive bits is a passive error flag
+
+typedef enum {
+  CAN_NO_ERROR_FLAG,
+  CAN_ACTIVE_ERROR_FLAG,
+  CAN_PASSIVE_ERROR_FLAG
+} CANErrorFlag ;
+
+const char * errorFlagName (const CANErrorFlag inFlag) ;
+
+//----------------------------------------------------------------------------------------
+
+class CANErrorCounters {
+  public: CANErrorCounters (void) ;
+
+  public: void clear (void) ;
+
+  public: uint64_t total (void) const ;
+
+//--- Key is identifier | (1 << 31) for extended identifiers
+  public: static inline uint32_t identifierKey (const uint32_t inIdentifier, const bool inExtended) {
+    return inIdentifier | (inExtended ? (1U << 31) : 0) ;
+  }
+
+//--- Settings text: hexadecimal identifier from ioIndex, up to a character that is not a
+//    digit; more than 3 digits is an extended identifier
+  public: static bool parseIdentifierKey (const std::string & inText,
+                                          size_t & ioIndex,
+                                          uint32_t & outKey) ;
+
+  public: uint64_t mKindCount [CAN_ERROR_KIND_COUNT] ;
+  public: uint64_t mErrorFlagCount [3] ; // Indexed by CANErrorFlag
+  public: std::map <uint32_t, uint64_t> mIdentifierErrorCount ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  MARK_DOT, MARK_ERROR_DOT, MARK_ERROR_SQUARE, MARK_UP_ARROW, MARK_DOWN_ARROW,
+  MARK_X, MARK_ERROR_X, MARK_START, MARK_STOP, MARK_ONE, MARK_ZERO
+} CANDecoderMarker ;
+
+//----------------------------------------------------------------------------------------
+
+class CANDecodedMessage {
+  public: uint64_t mStartSampleNumber ; // SOF
+  public: uint64_t mEndSampleNumber ; // End of EOF
+  public: uint32_t mIdentifier ;
+  public: bool mExtended ;
+  public: bool mRemote ;
+  public: bool mAcked ;
+  public: bool mFD ;
+  public: bool mBRS ;
+  public: bool mESI ;
+  public: uint8_t mDataCodeLength ; // As transmitted (0 ... 15)
+  public: uint8_t mDataLength ; // Data byte count (0 ... 8, 0 ... 64 for CAN FD)
+  public: uint8_t mData [64] ;
+  public: uint32_t mStuffBitCount ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANFrameDecoderDelegate {
+  public: virtual ~CANFrameDecoderDelegate (void) {}
+
+  public: virtual void addMark (const uint64_t inSampleNumber, const CANDecoderMarker inMarker) = 0 ;
+
+  public: virtual void addBubble (const uint8_t inBubbleType,
+                                  const uint64_t inData1,
+                                  const uint64_t inData2,
+                                  const uint64_t inStartSampleNumber,
+                                  const uint64_t inEndSampleNumber) = 0 ;
+
+  public: virtual void addMessage (const CANDecodedMessage & inMessage) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANFrameDecoder {
+
+  public: CANFrameDecoder (CANFrameDecoderDelegate * inDelegate) ;
+
+//--- Reset decoder in IDLE state; inPreviousBit is the current bus level
+  public: void reset (const uint32_t inSamplesPerBit, const bool inPreviousBit) ;
+
+//--- CAN FD frames are accepted if enabled (call before reset); the data phase of frames
+//    with BRS set is sampled at inDataSamplesPerBit
+  public: void setCANFD (const bool inEnabled, const uint32_t inDataSamplesPerBit) ;
+
+  public: void enterBit (const bool inBit, const uint64_t inSampleNumber) ;
+
+//--- Same as inCount (1 ... 8) calls of enterBit, the first bit is bit 7 of inBits, sample
+//    points are samplesPerBit () apart. Stops after a bit that changes the bit time;
+//    returns the count of bits entered. Stuffed bits are destuffed by table lookup (see
+//    CANDestuffTable.h); within the DATA field, the destuffed bits of a lookup are consumed
+//    at once.
+  public: uint32_t enterBits (const uint8_t inBits,
+                              const uint32_t inCount,
+                              const uint64_t inFirstSampleNumber) ;
+
+//--- Bits of a level from the bit boundary ioBitStart up to inLevelEnd, up to 8 at a time
+//    (enterBits), sampled at the middle of each bit; the bit time can change at a sample
+//    point (CAN FD bit rate switch). ioBitStart is then the boundary of the next bit, the
+//    one an edge at inLevelEnd is expected at. Returns the count of bits entered.
+  public: uint64_t enterLevel (const bool inBit, uint64_t & ioBitStart, const uint64_t inLevelEnd) ;
+
+//--- No more bits are entered (end of decode window): a frame in progress is reported as a
+//    CAN_TRUNCATED_FRAME error, a pending error is reported with the error flag seen so far,
+//    an incomplete INTERMISSION field ends. The decoder is then in IDLE state.
+  public: void endOfSamples (const uint64_t inSampleNumber) ;
+
+//--- Current bit time: changes at the sample point of the BRS bit and of the CRC delimiter
+  public: inline uint32_t samplesPerBit (void) const { return mSamplesPerBit ; }
+
+  public: inline const CANErrorCounters & errorCounters (void) const { return mErrorCounters ; }
+
+//--- Stuff bits removed since reset (CAN FD fixed stuff bits included)
+  public: inline uint64_t stuffBitTotal (void) const { return mStuffBitTotal ; }
+
+  private: void decodeFrameBit (const bool inBit, const uint64_t inSampleNumber) ;
+
+  private: uint32_t enterStuffedBits (const uint8_t inBits,
+                                      const uint32_t inCount,
+                                      const uint64_t inFirstSampleNumber) ;
+
+  private: void enterDestuffedDataBits (const CANDestuffEntry & inEntry,
+                                        const uint8_t inBits,
+                                        const uint64_t inFirstSampleNumber) ;
+
+//--- Delegate
+  private: CANFrameDecoderDelegate * mDelegate ;
+  private: uint32_t mSamplesPerBit ;
+  private: uint32_t mNominalSamplesPerBit ;
+  private: uint32_t mDataSamplesPerBit ;
+  private: bool mCANFDEnabled ;
+
+//---------------- CAN decoder properties
+//--- CAN protocol
+  private: typedef enum  {
+    IDLE, IDENTIFIER, CONTROL, EXTENDED_IDF, DATA,
+    CRC15, CRC_FD, CRC_DEL, ACK, END_OF_FRAME, INTERMISSION, DECODER_ERROR
+  } FrameFieldEngineState ;
+
+  private: FrameFieldEngineState mFrameFieldEngineState ;
+  private: int mFieldBitIndex ;
+  private: int mConsecutiveBitCountOfSamePolarity ;
+  private: bool mPreviousBit ;
+  private: bool mUnstuffingActive ;
+
+  private: uint64_t mStartOfFrameSampleNumber ;
+  private: uint64_t mStuffBitCount ;
+  private: uint64_t mStuffBitTotal ; // Since reset, whether markers are sent or not
+  private: uint64_t mStartOfFieldSampleNumber ;
+
+//--- Received frame
+  private: typedef enum {dataFrame, remoteFrame} FrameType ;
+  private: uint32_t mIdentifier ;
+  private: FrameType mFrameType ; // data, remote
+  private: bool mExtended ;
+  private: bool mAcked ;
+  private: int mDataCodeLength ;
+  private: int mReceivedDataCodeLength ;
+  private: uint8_t mData [64] ;
+  private: uint16_t mCRC15Accumulator ;
+  private: uint16_t mCRC15 ;
+  private: bool mIdentifierKnown ;
+
+//--- CAN FD frame
+  private: bool mFD ;
+  private: bool mBRS ;
+  private: bool mESI ;
+  private: uint32_t mCRC17Accumulator ; // Both include dynamic stuff bits
+  private: uint32_t mCRC21Accumulator ;
+  private: uint32_t mFDCRC ;
+  private: uint32_t mReceivedFDCRC ;
+  private: uint8_t mReceivedStuffCount ; // Gray code and parity bit
+  private: uint64_t mDynamicStuffBitCount ;
+  private: bool mFixedStuffBitExpected ;
+  private: bool mStuffCountError ;
+
+//--- Errors
+  private: CANErrorCounters mErrorCounters ;
+  private: CANErrorKind mErrorKind ;
+  private: int mDominantBitCountInError ;
+  private: int mLongestDominantRunInError ;
+
+//---------------- CAN decoder methods
+  private: void enterBitInCRC15 (const bool inBit) ;
+  private: void enterBitInFDCRC (const bool inBit) ;
+  private: void enterCRCField (void) ;
+  private: void addMark (const uint64_t inSampleNumber, const CANDecoderMarker inMarker) ;
+  private: void addBubble (const uint8_t inBubbleType,
+                           const uint64_t inData1,
+                           const uint64_t inData2,
+                           const uint64_t inEndSampleNumber) ;
+  private: void enterInErrorMode (const uint64_t inSampleNumber, const CANErrorKind inKind) ;
+  private: void addErrorBubble (const uint64_t inEndSampleNumber) ;
+  private: void countError (const CANErrorKind inKind) ;
+
+  private: void handle_IDLE_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_IDENTIFIER_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_EXTENDED_IDF_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_CONTROL_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_DATA_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_CRC15_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_CRCFD_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_CRCDEL_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_ACK_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_ENDOFFRAME_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_INTERMISSION_state (const bool inBit, const uint64_t inSampleNumber) ;
+  private: void handle_DECODER_ERROR_state (const bool inBit, const uint64_t inSampleNumber) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_FRAME_DECODER
@@ -0,0 +1,280 @@
+#include "CANGatewayCorrelator.h"
+
+//----------------------------------------------------------------------------------------
+//   Identifier remapping
+//----------------------------------------------------------------------------------------
+
+bool parseGatewayRemaps (const std::string & inText,
+                         std::vector <CANGatewayRemap> & outRemaps) {
+  outRemaps.clear () ;
+  bool ok = true ;
+  size_t idx = 0 ;
+  while (ok && (idx < inText.size ())) {
+    const char c = inText [idx] ;
+    if ((c == ' ') || (c == ',') || (c == ';') || (c == '\t')) {
+      idx += 1 ;
+    }else{
+      CANGatewayRemap remap ;
+      ok = CANErrorCounters::parseIdentifierKey (inText, idx, remap.mIngressKey) ;
+      ok = ok && (idx < inText.size ()) && (inText [idx] == ':') ;
+      idx += 1 ;
+      ok = ok && CANErrorCounters::parseIdentifierKey (inText, idx, remap.mEgressKey) ;
+      if (ok) {
+        outRemaps.push_back (remap) ;
+      }
+    }
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+//   Latency histogram
+//----------------------------------------------------------------------------------------
+
+static uint32_t latencyBucket (const uint64_t inMicroSeconds) {
+  uint32_t result = uint32_t (inMicroSeconds) ;
+  if (inMicroSeconds >= 16) {
+    uint32_t octave = 4 ;
+    while ((inMicroSeconds >> (octave + 1)) != 0) {
+      octave += 1 ;
+    }
+    const uint32_t subBucket = uint32_t (inMicroSeconds >> (octave - 3)) & 7 ;
+    result = 16 + (octave - 4) * 8 + subBucket ;
+    if (result >= GATEWAY_HISTOGRAM_SIZE) {
+      result = GATEWAY_HISTOGRAM_SIZE - 1 ;
+    }
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static uint64_t bucketLowerBound (const uint32_t inBucket) {
+  uint64_t result = inBucket ;
+  if (inBucket >= 16) {
+    const uint32_t octave = 4 + (inBucket - 16) / 8 ;
+    const uint64_t subBucket = (inBucket - 16) % 8 ;
+    result = (8 + subBucket) << (octave - 3) ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+CANGatewayStatistics::CANGatewayStatistics (void) :
+mForwardedCount (0),
+mMissingCount (0),
+mDuplicatedCount (0),
+mMinimumMicroSeconds (UINT64_MAX),
+mMaximumMicroSeconds (0),
+mTotalMicroSeconds (0),
+mChanged (false) {
+  for (uint32_t i=0 ; i<GATEWAY_HISTOGRAM_SIZE ; i++) {
+    mHistogram [i] = 0 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+uint64_t CANGatewayStatistics::percentileMicroSeconds (const uint32_t inPercent) const {
+  uint64_t result = 0 ;
+  if (mForwardedCount > 0) {
+    const uint64_t rank = (mForwardedCount * inPercent + 99) / 100 ; // 1 ... count
+    uint64_t count = 0 ;
+    uint32_t bucket = 0 ;
+    while ((count + mHistogram [bucket]) < rank) {
+      count += mHistogram [bucket] ;
+      bucket += 1 ;
+    }
+    result = bucketLowerBound (bucket) ;
+    if (result < mMinimumMicroSeconds) {
+      result = mMinimumMicroSeconds ;
+    }else if (result > mMaximumMicroSeconds) {
+      result = mMaximumMicroSeconds ;
+    }
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANGatewayCorrelator
+//----------------------------------------------------------------------------------------
+
+CANGatewayCorrelator::KeyState::KeyState (void) :
+mWaiting (),
+mForwarded (false),
+mLastForwardedSampleNumber (0),
+mLastForwardedIngressKey (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANGatewayCorrelator::CANGatewayCorrelator (CANGatewayCorrelatorDelegate * inDelegate) :
+mDelegate (inDelegate),
+mEnabled (false),
+mSampleRateHz (1),
+mWindowSampleCount (0),
+mRemaps (),
+mKeyStates (),
+mExpiries (),
+mStatistics () {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANGatewayCorrelator::configure (const bool inEnabled,
+                                      const uint32_t inSampleRateHz,
+                                      const uint32_t inWindowMilliSeconds,
+                                      const std::vector <CANGatewayRemap> & inRemaps) {
+  mEnabled = inEnabled ;
+  mSampleRateHz = (inSampleRateHz > 0) ? inSampleRateHz : 1 ;
+  mWindowSampleCount = uint64_t (mSampleRateHz) * inWindowMilliSeconds / 1000 ;
+  mRemaps.clear () ;
+  for (size_t i=0 ; i<inRemaps.size () ; i++) {
+    mRemaps [inRemaps [i].mIngressKey] = inRemaps [i].mEgressKey ;
+  }
+  mKeyStates.clear () ;
+  mExpiries.clear () ;
+  mStatistics.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+// FNV-1a over egress identifier key, frame format and payload; a 64-bit hash collision is
+// taken as a match
+
+uint64_t CANGatewayCorrelator::hash (const uint32_t inEgressKey, const CANDecodedMessage & inMessage) {
+  uint64_t h = 14695981039346656037ULL ;
+  for (uint32_t i=0 ; i<4 ; i++) {
+    h = (h ^ ((inEgressKey >> (8 * i)) & 0xFF)) * 1099511628211ULL ;
+  }
+  const uint32_t format = (inMessage.mRemote ? 1U : 0U) | (inMessage.mFD ? 2U : 0U) ;
+  h = (h ^ format) * 1099511628211ULL ;
+  h = (h ^ inMessage.mDataLength) * 1099511628211ULL ;
+  const uint32_t dataLength = inMessage.mRemote ? 0 : inMessage.mDataLength ;
+  for (uint32_t i=0 ; i<dataLength ; i++) {
+    h = (h ^ inMessage.mData [i]) * 1099511628211ULL ;
+  }
+  return h ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANGatewayCorrelator::enterIngress (const CANDecodedMessage & inMessage) {
+  const uint32_t ingressKey = CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended) ;
+  const std::map <uint32_t, uint32_t>::const_iterator it = mRemaps.find (ingressKey) ;
+  const uint32_t egressKey = (it != mRemaps.end ()) ? it->second : ingressKey ;
+  const uint64_t h = hash (egressKey, inMessage) ;
+  Waiting waiting ;
+  waiting.mSampleNumber = inMessage.mEndSampleNumber ;
+  waiting.mIngressKey = ingressKey ;
+  mKeyStates [h].mWaiting.push_back (waiting) ;
+  Expiry expiry ;
+  expiry.mSampleNumber = inMessage.mEndSampleNumber ;
+  expiry.mHash = h ;
+  mExpiries.push_back (expiry) ;
+}
+
+//----------------------------------------------------------------------------------------
+// Egress messages without any ingress message within the window (originated by the
+// gateway, or forwards of messages sent before the capture) are ignored
+
+void CANGatewayCorrelator::enterEgress (const CANDecodedMessage & inMessage) {
+  const uint64_t egressSampleNumber = inMessage.mEndSampleNumber ;
+  expire (egressSampleNumber) ;
+  const uint32_t egressKey = CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended) ;
+  const std::unordered_map <uint64_t, KeyState>::iterator it = mKeyStates.find (hash (egressKey, inMessage)) ;
+  if (it != mKeyStates.end ()) {
+    KeyState & state = it->second ;
+    if (!state.mWaiting.empty () && (state.mWaiting.front ().mSampleNumber <= egressSampleNumber)) {
+      const Waiting waiting = state.mWaiting.front () ;
+      state.mWaiting.pop_front () ;
+      state.mForwarded = true ;
+      state.mLastForwardedSampleNumber = waiting.mSampleNumber ;
+      state.mLastForwardedIngressKey = waiting.mIngressKey ;
+      const uint64_t latency = (egressSampleNumber - waiting.mSampleNumber) * 1000000 / mSampleRateHz ;
+      CANGatewayStatistics & statistics = mStatistics [waiting.mIngressKey] ;
+      statistics.mForwardedCount += 1 ;
+      statistics.mTotalMicroSeconds += latency ;
+      if (statistics.mMinimumMicroSeconds > latency) {
+        statistics.mMinimumMicroSeconds = latency ;
+      }
+      if (statistics.mMaximumMicroSeconds < latency) {
+        statistics.mMaximumMicroSeconds = latency ;
+      }
+      statistics.mHistogram [latencyBucket (latency)] += 1 ;
+      statistics.mChanged = true ;
+    }else if (state.mForwarded && ((egressSampleNumber - state.mLastForwardedSampleNumber) <= mWindowSampleCount)) {
+      CANGatewayStatistics & statistics = mStatistics [state.mLastForwardedIngressKey] ;
+      statistics.mDuplicatedCount += 1 ;
+      statistics.mChanged = true ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANGatewayCorrelator::advance (const uint64_t inSampleNumber) {
+  expire (inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+// Key states are released once their last ingress message leaves the window
+
+void CANGatewayCorrelator::expire (const uint64_t inSampleNumber) {
+  while (!mExpiries.empty () && ((mExpiries.front ().mSampleNumber + mWindowSampleCount) < inSampleNumber)) {
+    const Expiry expiry = mExpiries.front () ;
+    mExpiries.pop_front () ;
+    const std::unordered_map <uint64_t, KeyState>::iterator it = mKeyStates.find (expiry.mHash) ;
+    if (it != mKeyStates.end ()) {
+      KeyState & state = it->second ;
+      if (!state.mWaiting.empty () && (state.mWaiting.front ().mSampleNumber == expiry.mSampleNumber)) {
+        CANGatewayStatistics & statistics = mStatistics [state.mWaiting.front ().mIngressKey] ;
+        statistics.mMissingCount += 1 ;
+        statistics.mChanged = true ;
+        state.mWaiting.pop_front () ;
+      }
+      const bool forwardInWindow = state.mForwarded
+        && ((state.mLastForwardedSampleNumber + mWindowSampleCount) >= inSampleNumber) ;
+      if (state.mWaiting.empty () && !forwardInWindow) {
+        mKeyStates.erase (it) ;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANGatewayCorrelator::summarize (const uint64_t inSampleNumber) {
+  std::map <uint32_t, CANGatewayStatistics>::iterator it ;
+  for (it = mStatistics.begin () ; it != mStatistics.end () ; it++) {
+    if (it->second.mChanged) {
+      mDelegate->addGatewayStatistics (it->first, it->second, inSampleNumber) ;
+      it->second.mChanged = false ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANGatewayCorrelator::addMark (const uint64_t /* inSampleNumber */,
+                                    const CANDecoderMarker /* inMarker */) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANGatewayCorrelator::addBubble (const uint8_t /* inBubbleType */,
+                                      const uint64_t /* inData1 */,
+                                      const uint64_t /* inData2 */,
+                                      const uint64_t /* inStartSampleNumber */,
+                                      const uint64_t /* inEndSampleNumber */) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANGatewayCorrelator::addMessage (const CANDecodedMessage & inMessage) {
+  if (mEnabled) {
+    enterEgress (inMessage) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
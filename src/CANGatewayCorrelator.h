@@ -0,0 +1,144 @@
+#ifndef CAN_GATEWAY_CORRELATOR
+#define CAN_GATEWAY_CORRELATOR
+
+//----------------------------------------------------------------------------------------
+// Gateway latency: messages of the input channel (ingress) are matched with the same
+// messages forwarded on a second channel (egress), by a hash join on identifier (after
+// remapping) and payload. Each ingress message waits in the table for at most the window;
+// the oldest waiting one is matched first. Unmatched ingress messages are missing
+// forwards; an egress message that finds no waiting ingress message, while one with the
+// same key was forwarded within the window, is a duplicate. Latency is measured from the
+// end of frame on the ingress bus to the end of frame on the egress bus. Does not depend
+// on the Saleae SDK.
+//
+// The egress channel decoder sends its messages here (CANFrameDecoderDelegate); the
+// analyzer decodes the egress channel behind the input channel, so that an ingress
+// message is always entered before its forwards.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// Identifiers are keys (see CANErrorCounters::identifierKey)
+
+class CANGatewayRemap {
+  public: uint32_t mIngressKey ;
+  public: uint32_t mEgressKey ;
+} ;
+
+//----------------------------------------------------------------------------------------
+// "100:200, 18FF0001:18FF0081": ingress identifier, forwarded as egress identifier, in
+// hexadecimal; more than 3 digits is an extended identifier. Identifiers that are not
+// listed are forwarded unchanged. Returns false on syntax error.
+
+bool parseGatewayRemaps (const std::string & inText,
+                         std::vector <CANGatewayRemap> & outRemaps) ;
+
+//----------------------------------------------------------------------------------------
+// Latency histogram, in microseconds: one bucket per value below 16, then 8 buckets per
+// power of two (12.5 % resolution), up to about 2 hours.
+
+static const uint32_t GATEWAY_HISTOGRAM_SIZE = 256 ;
+
+class CANGatewayStatistics {
+  public: CANGatewayStatistics (void) ;
+
+//--- Lower bound of the bucket that holds the given percentile (clamped to min ... max)
+  public: uint64_t percentileMicroSeconds (const uint32_t inPercent) const ;
+
+  public: uint64_t mForwardedCount ;
+  public: uint64_t mMissingCount ;
+  public: uint64_t mDuplicatedCount ;
+  public: uint64_t mMinimumMicroSeconds ;
+  public: uint64_t mMaximumMicroSeconds ;
+  public: uint64_t mTotalMicroSeconds ;
+  public: bool mChanged ; // Since the last summary
+  public: uint32_t mHistogram [GATEWAY_HISTOGRAM_SIZE] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANGatewayCorrelatorDelegate {
+  public: virtual ~CANGatewayCorrelatorDelegate (void) {}
+
+//--- Sent by summarize for each ingress identifier with activity since the last summary
+  public: virtual void addGatewayStatistics (const uint32_t inIdentifierKey,
+                                             const CANGatewayStatistics & inStatistics,
+                                             const uint64_t inSampleNumber) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANGatewayCorrelator : public CANFrameDecoderDelegate {
+
+  public: CANGatewayCorrelator (CANGatewayCorrelatorDelegate * inDelegate) ;
+
+  public: void configure (const bool inEnabled,
+                          const uint32_t inSampleRateHz,
+                          const uint32_t inWindowMilliSeconds,
+                          const std::vector <CANGatewayRemap> & inRemaps) ;
+
+  public: inline bool enabled (void) const { return mEnabled ; }
+
+  public: void enterIngress (const CANDecodedMessage & inMessage) ;
+
+  public: void enterEgress (const CANDecodedMessage & inMessage) ;
+
+//--- The egress channel has been decoded up to inSampleNumber: ingress messages older
+//    than the window are missing forwards
+  public: void advance (const uint64_t inSampleNumber) ;
+
+  public: void summarize (const uint64_t inSampleNumber) ;
+
+//--- CANFrameDecoderDelegate, egress channel decoder: only messages are used
+  public: virtual void addMark (const uint64_t inSampleNumber, const CANDecoderMarker inMarker) ;
+
+  public: virtual void addBubble (const uint8_t inBubbleType,
+                                  const uint64_t inData1,
+                                  const uint64_t inData2,
+                                  const uint64_t inStartSampleNumber,
+                                  const uint64_t inEndSampleNumber) ;
+
+  public: virtual void addMessage (const CANDecodedMessage & inMessage) ;
+
+  private: class Waiting {
+    public: uint64_t mSampleNumber ; // Ingress end of frame
+    public: uint32_t mIngressKey ;
+  } ;
+
+  private: class Expiry {
+    public: uint64_t mSampleNumber ;
+    public: uint64_t mHash ;
+  } ;
+
+//--- Per (egress identifier, payload) hash
+  private: class KeyState {
+    public: KeyState (void) ;
+    public: std::deque <Waiting> mWaiting ; // Oldest first
+    public: bool mForwarded ;
+    public: uint64_t mLastForwardedSampleNumber ; // Ingress end of frame
+    public: uint32_t mLastForwardedIngressKey ;
+  } ;
+
+  private: static uint64_t hash (const uint32_t inEgressKey, const CANDecodedMessage & inMessage) ;
+  private: void expire (const uint64_t inSampleNumber) ;
+
+  private: CANGatewayCorrelatorDelegate * mDelegate ;
+  private: bool mEnabled ;
+  private: uint32_t mSampleRateHz ;
+  private: uint64_t mWindowSampleCount ;
+  private: std::map <uint32_t, uint32_t> mRemaps ; // Ingress key -> egress key
+  private: std::unordered_map <uint64_t, KeyState> mKeyStates ;
+  private: std::deque <Expiry> mExpiries ; // All ingress messages in the window, oldest first
+  private: std::map <uint32_t, CANGatewayStatistics> mStatistics ; // By ingress key
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_GATEWAY_CORRELATOR
@@ -0,0 +1,148 @@
+#include "CANHeadlessDecoder.h"
+
+#include <math.h>
+
+//----------------------------------------------------------------------------------------
+//   CANBatchStatistics
+//----------------------------------------------------------------------------------------
+
+CANBatchStatistics::CANBatchStatistics (void) :
+mCaptureSeconds (0.0),
+mBusySeconds (0.0),
+mMessageCount (0),
+mDataByteCount (0),
+mErrors (),
+mIdentifierMessageCount () {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANBatchStatistics::merge (const CANBatchStatistics & inStatistics) {
+  mCaptureSeconds += inStatistics.mCaptureSeconds ;
+  mBusySeconds += inStatistics.mBusySeconds ;
+  mMessageCount += inStatistics.mMessageCount ;
+  mDataByteCount += inStatistics.mDataByteCount ;
+  for (uint32_t i=0 ; i<CAN_ERROR_KIND_COUNT ; i++) {
+    mErrors.mKindCount [i] += inStatistics.mErrors.mKindCount [i] ;
+  }
+  for (uint32_t i=0 ; i<3 ; i++) {
+    mErrors.mErrorFlagCount [i] += inStatistics.mErrors.mErrorFlagCount [i] ;
+  }
+  std::map <uint32_t, uint64_t>::const_iterator it ;
+  for (it = inStatistics.mErrors.mIdentifierErrorCount.begin () ; it != inStatistics.mErrors.mIdentifierErrorCount.end () ; it++) {
+    mErrors.mIdentifierErrorCount [it->first] += it->second ;
+  }
+  for (it = inStatistics.mIdentifierMessageCount.begin () ; it != inStatistics.mIdentifierMessageCount.end () ; it++) {
+    mIdentifierMessageCount [it->first] += it->second ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+double CANBatchStatistics::busLoadPercent (void) const {
+  return (mCaptureSeconds > 0.0) ? (100.0 * mBusySeconds / mCaptureSeconds) : 0.0 ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANHeadlessDecoder
+//----------------------------------------------------------------------------------------
+
+CANHeadlessDecoder::CANHeadlessDecoder (void) :
+mDecoder (this),
+mSampleRateHz (1),
+mWriter (NULL),
+mWriteError (),
+mBusySampleCount (0),
+mStatistics (NULL) {
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANHeadlessDecoder::decode (const CANCaptureFile & inCapture,
+                                 const CANHeadlessSettings & inSettings,
+                                 CANColumnarWriter * ioWriter,
+                                 CANBatchStatistics & outStatistics,
+                                 std::string & outError) {
+  const uint32_t samplesPerBit = (inSettings.mBitRate > 0) ? (inSettings.mSampleRateHz / inSettings.mBitRate) : 0 ;
+  const uint32_t dataSamplesPerBit = (inSettings.mDataBitRate > 0) ? (inSettings.mSampleRateHz / inSettings.mDataBitRate) : 0 ;
+  if ((samplesPerBit < 2) || (inSettings.mCANFD && (dataSamplesPerBit < 2))) {
+    outError = "the sample rate should be at least twice the bit rates" ;
+    return false ;
+  }
+  outStatistics = CANBatchStatistics () ;
+  mSampleRateHz = inSettings.mSampleRateHz ;
+  mWriter = ioWriter ;
+  mWriteError.clear () ;
+  mBusySampleCount = 0 ;
+  mStatistics = &outStatistics ;
+  mDecoder.setCANFD (inSettings.mCANFD, (dataSamplesPerBit > 0) ? dataSamplesPerBit : 1) ;
+//--- Transition times, as sample numbers from the capture begin
+  const double begin = inCapture.beginSeconds () ;
+  const double rate = double (inSettings.mSampleRateHz) ;
+  const uint64_t transitionCount = inCapture.transitionCount () ;
+  const uint64_t endSampleNumber = uint64_t (llround ((inCapture.endSeconds () - begin) * rate)) ;
+//--- Synchronize to recessive level
+  bool bit = inCapture.initialLevelHigh () ^ inSettings.mInverted ;
+  uint64_t transition = 0 ;
+  uint64_t start = 0 ;
+  if (!bit && (transitionCount > 0)) {
+    start = uint64_t (llround ((inCapture.transitionSeconds (0) - begin) * rate)) ;
+    bit = true ;
+    transition = 1 ;
+  }
+  mDecoder.reset (samplesPerBit, bit) ;
+  while (transition < transitionCount) {
+    const double seconds = inCapture.transitionSeconds (transition) - begin ;
+    const uint64_t nextEdge = (seconds > 0.0) ? uint64_t (llround (seconds * rate)) : 0 ;
+    if (nextEdge > start) {
+      uint64_t bitStart = start ;
+      mDecoder.enterLevel (bit, bitStart, nextEdge) ;
+      start = nextEdge ;
+    }
+    bit = !bit ;
+    transition += 1 ;
+  }
+  if (endSampleNumber > start) {
+    mDecoder.enterLevel (bit, start, endSampleNumber) ;
+  }
+  mDecoder.endOfSamples (endSampleNumber) ;
+//--- Statistics
+  outStatistics.mCaptureSeconds = inCapture.endSeconds () - begin ;
+  outStatistics.mBusySeconds = double (mBusySampleCount) / rate ;
+  outStatistics.mErrors = mDecoder.errorCounters () ;
+  mWriter = NULL ;
+  mStatistics = NULL ;
+  const bool ok = mWriteError.empty () ;
+  if (!ok) {
+    outError = mWriteError ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANHeadlessDecoder::addMark (const uint64_t /* inSampleNumber */, const CANDecoderMarker /* inMarker */) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANHeadlessDecoder::addBubble (const uint8_t /* inBubbleType */,
+                                    const uint64_t /* inData1 */,
+                                    const uint64_t /* inData2 */,
+                                    const uint64_t /* inStartSampleNumber */,
+                                    const uint64_t /* inEndSampleNumber */) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANHeadlessDecoder::addMessage (const CANDecodedMessage & inMessage) {
+  mStatistics->mMessageCount += 1 ;
+  mStatistics->mDataByteCount += inMessage.mDataLength ;
+  mStatistics->mIdentifierMessageCount [CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended)] += 1 ;
+  mBusySampleCount += inMessage.mEndSampleNumber - inMessage.mStartSampleNumber ;
+  if ((mWriter != NULL) && mWriteError.empty ()) {
+    mWriter->append (inMessage, mWriteError) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+#ifndef CAN_HEADLESS_DECODER
+#define CAN_HEADLESS_DECODER
+
+//----------------------------------------------------------------------------------------
+// Headless decoder: a capture file (see CANCaptureFile.h) goes through a CANFrameDecoder,
+// with the bit sampling of the analyzer worker thread (hard synchronization at each edge,
+// no glitch filter), outside Logic 2. Decoded messages are optionally written to a
+// columnar file (see CANColumnarFile.h), and counted in statistics that can be merged
+// across captures. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include "CANCaptureFile.h"
+#include "CANColumnarFile.h"
+#include "CANFrameDecoder.h"
+
+#include <map>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+
+class CANHeadlessSettings {
+  public: uint32_t mSampleRateHz ; // Transition times are rounded to this rate
+  public: uint32_t mBitRate ;
+  public: bool mCANFD ;
+  public: uint32_t mDataBitRate ;
+  public: bool mInverted ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANBatchStatistics {
+
+  public: CANBatchStatistics (void) ;
+
+  public: void merge (const CANBatchStatistics & inStatistics) ;
+
+//--- Time of valid frames (SOF ... end of EOF), in percent of the capture time
+  public: double busLoadPercent (void) const ;
+
+  public: double mCaptureSeconds ;
+  public: double mBusySeconds ;
+  public: uint64_t mMessageCount ;
+  public: uint64_t mDataByteCount ;
+  public: CANErrorCounters mErrors ;
+  public: std::map <uint32_t, uint64_t> mIdentifierMessageCount ; // By identifier key
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANHeadlessDecoder : public CANFrameDecoderDelegate {
+
+  public: CANHeadlessDecoder (void) ;
+
+//--- Decodes the whole capture; messages are appended to ioWriter if not NULL, a frame in
+//    progress at the capture end is counted as truncated. Returns false (outError is set)
+//    on invalid settings or write error.
+  public: bool decode (const CANCaptureFile & inCapture,
+                       const CANHeadlessSettings & inSettings,
+                       CANColumnarWriter * ioWriter,
+                       CANBatchStatistics & outStatistics,
+                       std::string & outError) ;
+
+//--- CANFrameDecoderDelegate
+  public: virtual void addMark (const uint64_t inSampleNumber, const CANDecoderMarker inMarker) ;
+
+  public: virtual void addBubble (const uint8_t inBubbleType,
+                                  const uint64_t inData1,
+                                  const uint64_t inData2,
+                                  const uint64_t inStartSampleNumber,
+                                  const uint64_t inEndSampleNumber) ;
+
+  public: virtual void addMessage (const CANDecodedMessage & inMessage) ;
+
+  private: CANFrameDecoder mDecoder ;
+  private: uint32_t mSampleRateHz ;
+  private: CANColumnarWriter * mWriter ;
+  private: std::string mWriteError ; // First one
+  private: uint64_t mBusySampleCount ;
+  private: CANBatchStatistics * mStatistics ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_HEADLESS_DECODER
@@ -0,0 +1,342 @@
+#include "CANISOTPReassembler.h"
+
+//----------------------------------------------------------------------------------------
+//   Address pairs
+//----------------------------------------------------------------------------------------
+
+bool parseISOTPAddressPairs (const std::string & inText,
+                             std::vector <CANISOTPAddressPair> & outPairs) {
+  outPairs.clear () ;
+  bool ok = true ;
+  size_t idx = 0 ;
+  while (ok && (idx < inText.size ())) {
+    const char c = inText [idx] ;
+    if ((c == ' ') || (c == ',') || (c == ';') || (c == '\t')) {
+      idx += 1 ;
+    }else{
+      CANISOTPAddressPair pair ;
+      ok = CANErrorCounters::parseIdentifierKey (inText, idx, pair.mFirstKey) ;
+      ok = ok && (idx < inText.size ()) && (inText [idx] == ':') ;
+      idx += 1 ;
+      ok = ok && CANErrorCounters::parseIdentifierKey (inText, idx, pair.mSecondKey) ;
+      ok = ok && (pair.mFirstKey != pair.mSecondKey) ;
+      if (ok) {
+        outPairs.push_back (pair) ;
+      }
+    }
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+//   Error kinds
+//----------------------------------------------------------------------------------------
+
+const char * isotpErrorKindName (const ISOTPErrorKind inKind) {
+  switch (inKind) {
+  case ISOTP_SEQUENCE_ERROR : return "Sequence error" ;
+  case ISOTP_TIMEOUT : return "Timeout" ;
+  case ISOTP_UNEXPECTED_CONSECUTIVE_FRAME : return "Unexpected CF" ;
+  case ISOTP_INTERRUPTED : return "Interrupted" ;
+  case ISOTP_OVERFLOW : return "Overflow" ;
+  case ISOTP_POOL_EXHAUSTED : return "No free buffer" ;
+  case ISOTP_ERROR_KIND_COUNT : break ;
+  }
+  return "Error" ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANISOTPReassembler
+//----------------------------------------------------------------------------------------
+
+CANISOTPReassembler::Stream::Stream (const uint32_t inIdentifierKey) :
+mIdentifierKey (inIdentifierKey),
+mActive (false),
+mDiscarding (false),
+mBufferIndex (0),
+mReceivedLength (0),
+mNextSequenceNumber (0),
+mLastActivitySampleNumber (0),
+mHasPreviousConsecutiveFrame (false),
+mPreviousConsecutiveFrameEnd (0),
+mSeparationSumMicroSeconds (0),
+mPDU () {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANISOTPReassembler::CANISOTPReassembler (CANISOTPReassemblerDelegate * inDelegate) :
+mDelegate (inDelegate),
+mSampleRateHz (1),
+mTimeoutSampleCount (0),
+mStreams (),
+mStreamIndex (),
+mBufferPool (),
+mFreeBuffers () {
+}
+
+//----------------------------------------------------------------------------------------
+// Streams 2n and 2n+1 are the two identifiers of a pair: a flow control frame received by
+// stream i applies to stream i ^ 1. A pair with an already configured identifier is ignored.
+
+void CANISOTPReassembler::configure (const std::vector <CANISOTPAddressPair> & inPairs,
+                                     const uint32_t inSampleRateHz) {
+  mSampleRateHz = (inSampleRateHz > 0) ? inSampleRateHz : 1 ;
+  mTimeoutSampleCount = uint64_t (mSampleRateHz) * ISOTP_TIMEOUT_MILLISECONDS / 1000 ;
+  mStreams.clear () ;
+  mStreamIndex.clear () ;
+  for (size_t i=0 ; i<inPairs.size () ; i++) {
+    const CANISOTPAddressPair & pair = inPairs [i] ;
+    if ((mStreamIndex.count (pair.mFirstKey) == 0) && (mStreamIndex.count (pair.mSecondKey) == 0)) {
+      mStreamIndex [pair.mFirstKey] = uint32_t (mStreams.size ()) ;
+      mStreams.push_back (Stream (pair.mFirstKey)) ;
+      mStreamIndex [pair.mSecondKey] = uint32_t (mStreams.size ()) ;
+      mStreams.push_back (Stream (pair.mSecondKey)) ;
+    }
+  }
+  mFreeBuffers.clear () ;
+  if (mStreams.empty ()) {
+    std::vector <uint8_t> ().swap (mBufferPool) ;
+  }else{
+    mBufferPool.resize (size_t (ISOTP_BUFFER_COUNT) * ISOTP_BUFFER_SIZE) ;
+    mFreeBuffers.reserve (ISOTP_BUFFER_COUNT) ;
+    for (uint32_t i=0 ; i<ISOTP_BUFFER_COUNT ; i++) {
+      mFreeBuffers.push_back (ISOTP_BUFFER_COUNT - 1 - i) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+uint64_t CANISOTPReassembler::microSeconds (const uint64_t inSampleCount) const {
+  return inSampleCount * 1000000 / mSampleRateHz ;
+}
+
+//----------------------------------------------------------------------------------------
+// The PCI is the high nibble of the first data byte
+
+void CANISOTPReassembler::enterMessage (const CANDecodedMessage & inMessage) {
+  checkTimeouts (inMessage) ;
+  const uint32_t key = CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended) ;
+  const std::map <uint32_t, uint32_t>::const_iterator it = mStreamIndex.find (key) ;
+  if ((it != mStreamIndex.end ()) && !inMessage.mRemote && (inMessage.mDataLength > 0)) {
+    Stream & stream = mStreams [it->second] ;
+    switch (inMessage.mData [0] >> 4) {
+    case 0 :
+      handleSingleFrame (stream, inMessage) ;
+      break ;
+    case 1 :
+      handleFirstFrame (stream, inMessage) ;
+      break ;
+    case 2 :
+      handleConsecutiveFrame (stream, inMessage) ;
+      break ;
+    case 3 :
+      handleFlowControl (mStreams [it->second ^ 1], inMessage) ;
+      break ;
+    default : // Not ISO-TP
+      break ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Checked for every stream when a frame is received: a timeout is reported at the end of
+// the first frame that starts after it
+
+void CANISOTPReassembler::checkTimeouts (const CANDecodedMessage & inMessage) {
+  for (size_t i=0 ; i<mStreams.size () ; i++) {
+    Stream & stream = mStreams [i] ;
+    if (stream.mActive && ((inMessage.mStartSampleNumber - stream.mLastActivitySampleNumber) > mTimeoutSampleCount)) {
+      abort (stream, ISOTP_TIMEOUT, inMessage.mEndSampleNumber) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// CAN FD frames longer than 8 bytes have an escape length: 0 in the PCI, length in byte 1
+
+void CANISOTPReassembler::handleSingleFrame (Stream & ioStream, const CANDecodedMessage & inMessage) {
+  uint32_t length = inMessage.mData [0] & 0x0F ;
+  uint32_t offset = 1 ;
+  if ((length == 0) && (inMessage.mDataLength > 8)) {
+    length = inMessage.mData [1] ;
+    offset = 2 ;
+  }
+  if ((length > 0) && ((length + offset) <= inMessage.mDataLength)) {
+    if (ioStream.mActive) {
+      abort (ioStream, ISOTP_INTERRUPTED, inMessage.mEndSampleNumber) ;
+    }
+    ioStream.mDiscarding = false ;
+    ISOTPPDU pdu = ISOTPPDU () ;
+    pdu.mIdentifierKey = ioStream.mIdentifierKey ;
+    pdu.mStartSampleNumber = inMessage.mStartSampleNumber ;
+    pdu.mEndSampleNumber = inMessage.mEndSampleNumber ;
+    pdu.mDurationMicroSeconds = microSeconds (inMessage.mEndSampleNumber - inMessage.mStartSampleNumber) ;
+    pdu.mLength = length ;
+    pdu.mData = inMessage.mData + offset ;
+    pdu.mStoredLength = length ;
+    mDelegate->addISOTPPDU (pdu) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// A first frame uses the whole CAN frame; a 12-bit length of 0 is followed by a 32-bit one.
+// The PDU must not fit in the first frame.
+
+void CANISOTPReassembler::handleFirstFrame (Stream & ioStream, const CANDecodedMessage & inMessage) {
+  uint32_t length = 0 ;
+  uint32_t offset = 2 ;
+  if (inMessage.mDataLength >= 8) {
+    length = (uint32_t (inMessage.mData [0] & 0x0F) << 8) | inMessage.mData [1] ;
+    if (length == 0) {
+      length = (uint32_t (inMessage.mData [2]) << 24) | (uint32_t (inMessage.mData [3]) << 16)
+             | (uint32_t (inMessage.mData [4]) << 8) | inMessage.mData [5] ;
+      offset = 6 ;
+    }
+  }
+  if (length > (inMessage.mDataLength - offset)) {
+    if (ioStream.mActive) {
+      abort (ioStream, ISOTP_INTERRUPTED, inMessage.mEndSampleNumber) ;
+    }
+    if (mFreeBuffers.empty ()) {
+      mDelegate->addISOTPError (ISOTP_POOL_EXHAUSTED, ioStream.mIdentifierKey, inMessage.mEndSampleNumber) ;
+      ioStream.mDiscarding = true ;
+    }else{
+      ioStream.mDiscarding = false ;
+      ioStream.mActive = true ;
+      ioStream.mBufferIndex = mFreeBuffers.back () ;
+      mFreeBuffers.pop_back () ;
+      ioStream.mReceivedLength = 0 ;
+      ioStream.mNextSequenceNumber = 1 ;
+      ioStream.mLastActivitySampleNumber = inMessage.mEndSampleNumber ;
+      ioStream.mHasPreviousConsecutiveFrame = false ;
+      ioStream.mSeparationSumMicroSeconds = 0 ;
+      ioStream.mPDU = ISOTPPDU () ;
+      ioStream.mPDU.mIdentifierKey = ioStream.mIdentifierKey ;
+      ioStream.mPDU.mStartSampleNumber = inMessage.mStartSampleNumber ;
+      ioStream.mPDU.mLength = length ;
+      appendData (ioStream, inMessage.mData + offset, inMessage.mDataLength - offset) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANISOTPReassembler::handleConsecutiveFrame (Stream & ioStream, const CANDecodedMessage & inMessage) {
+  const uint8_t sequenceNumber = inMessage.mData [0] & 0x0F ;
+  if (ioStream.mDiscarding) {
+    // Already reported
+  }else if (!ioStream.mActive) {
+    mDelegate->addISOTPError (ISOTP_UNEXPECTED_CONSECUTIVE_FRAME, ioStream.mIdentifierKey, inMessage.mEndSampleNumber) ;
+    ioStream.mDiscarding = true ;
+  }else if (sequenceNumber != ioStream.mNextSequenceNumber) {
+    abort (ioStream, ISOTP_SEQUENCE_ERROR, inMessage.mEndSampleNumber) ;
+  }else{
+    ISOTPPDU & pdu = ioStream.mPDU ;
+    if (ioStream.mHasPreviousConsecutiveFrame) {
+      const uint64_t separation = microSeconds (inMessage.mStartSampleNumber - ioStream.mPreviousConsecutiveFrameEnd) ;
+      if ((pdu.mSeparationCount == 0) || (pdu.mMinSeparationMicroSeconds > separation)) {
+        pdu.mMinSeparationMicroSeconds = separation ;
+      }
+      if (pdu.mMaxSeparationMicroSeconds < separation) {
+        pdu.mMaxSeparationMicroSeconds = separation ;
+      }
+      if (pdu.mHasFlowControl && (separation < pdu.mRequestedSeparationMicroSeconds)) {
+        pdu.mSeparationViolationCount += 1 ;
+      }
+      pdu.mSeparationCount += 1 ;
+      ioStream.mSeparationSumMicroSeconds += separation ;
+    }
+    pdu.mConsecutiveFrameCount += 1 ;
+    ioStream.mNextSequenceNumber = (sequenceNumber + 1) & 0x0F ;
+    ioStream.mHasPreviousConsecutiveFrame = true ;
+    ioStream.mPreviousConsecutiveFrameEnd = inMessage.mEndSampleNumber ;
+    ioStream.mLastActivitySampleNumber = inMessage.mEndSampleNumber ;
+    appendData (ioStream, inMessage.mData + 1, inMessage.mDataLength - 1U) ;
+    if (ioStream.mReceivedLength >= pdu.mLength) {
+      pdu.mEndSampleNumber = inMessage.mEndSampleNumber ;
+      pdu.mDurationMicroSeconds = microSeconds (inMessage.mEndSampleNumber - pdu.mStartSampleNumber) ;
+      pdu.mData = mBufferPool.data () + size_t (ioStream.mBufferIndex) * ISOTP_BUFFER_SIZE ;
+      pdu.mStoredLength = (pdu.mLength < ISOTP_BUFFER_SIZE) ? pdu.mLength : ISOTP_BUFFER_SIZE ;
+      if (pdu.mSeparationCount > 0) {
+        pdu.mMeanSeparationMicroSeconds = ioStream.mSeparationSumMicroSeconds / pdu.mSeparationCount ;
+      }
+      mDelegate->addISOTPPDU (pdu) ;
+      release (ioStream) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// ioStream is the stream that sends the PDU. STmin 0xF1 ... 0xF9 is 100 ... 900 µs,
+// reserved values are 127 ms.
+
+void CANISOTPReassembler::handleFlowControl (Stream & ioStream, const CANDecodedMessage & inMessage) {
+  if (ioStream.mActive && (inMessage.mDataLength >= 3)) {
+    ISOTPPDU & pdu = ioStream.mPDU ;
+    ioStream.mLastActivitySampleNumber = inMessage.mEndSampleNumber ;
+    switch (inMessage.mData [0] & 0x0F) {
+    case 0 : // Clear to send
+      { const uint8_t stMin = inMessage.mData [2] ;
+        pdu.mHasFlowControl = true ;
+        pdu.mFlowControlCount += 1 ;
+        pdu.mBlockSize = inMessage.mData [1] ;
+        if (stMin <= 0x7F) {
+          pdu.mRequestedSeparationMicroSeconds = uint32_t (stMin) * 1000 ;
+        }else if ((stMin >= 0xF1) && (stMin <= 0xF9)) {
+          pdu.mRequestedSeparationMicroSeconds = uint32_t (stMin - 0xF0) * 100 ;
+        }else{
+          pdu.mRequestedSeparationMicroSeconds = 127 * 1000 ;
+        }
+        ioStream.mHasPreviousConsecutiveFrame = false ; // Separation is measured in a block
+      }
+      break ;
+    case 1 : // Wait
+      pdu.mWaitCount += 1 ;
+      break ;
+    case 2 : // Overflow
+      abort (ioStream, ISOTP_OVERFLOW, inMessage.mEndSampleNumber) ;
+      break ;
+    default :
+      break ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Bytes beyond the announced length are padding; bytes beyond the buffer are dropped
+
+void CANISOTPReassembler::appendData (Stream & ioStream, const uint8_t * inData, const uint32_t inLength) {
+  const uint32_t remaining = ioStream.mPDU.mLength - ioStream.mReceivedLength ;
+  const uint32_t length = (inLength < remaining) ? inLength : remaining ;
+  uint8_t * buffer = mBufferPool.data () + size_t (ioStream.mBufferIndex) * ISOTP_BUFFER_SIZE ;
+  for (uint32_t i=0 ; i<length ; i++) {
+    const uint32_t idx = ioStream.mReceivedLength + i ;
+    if (idx < ISOTP_BUFFER_SIZE) {
+      buffer [idx] = inData [i] ;
+    }
+  }
+  ioStream.mReceivedLength += length ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANISOTPReassembler::abort (Stream & ioStream,
+                                 const ISOTPErrorKind inKind,
+                                 const uint64_t inSampleNumber) {
+  mDelegate->addISOTPError (inKind, ioStream.mIdentifierKey, inSampleNumber) ;
+  release (ioStream) ;
+  ioStream.mDiscarding = true ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANISOTPReassembler::release (Stream & ioStream) {
+  if (ioStream.mActive) {
+    ioStream.mActive = false ;
+    mFreeBuffers.push_back (ioStream.mBufferIndex) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,141 @@
+#ifndef CAN_ISOTP_REASSEMBLER
+#define CAN_ISOTP_REASSEMBLER
+
+//----------------------------------------------------------------------------------------
+// ISO 15765-2 (ISO-TP) reassembly of decoded CAN messages, normal addressing. Does not
+// depend on the Saleae SDK. PDU buffers are taken from a pool allocated by configure:
+// there is no allocation per CAN frame.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+//----------------------------------------------------------------------------------------
+// Identifiers are keys (see CANErrorCounters::identifierKey); each identifier of a pair
+// sends its PDUs, and the flow control frames of the PDUs sent by the other one.
+
+class CANISOTPAddressPair {
+  public: uint32_t mFirstKey ;
+  public: uint32_t mSecondKey ;
+} ;
+
+//----------------------------------------------------------------------------------------
+// "7E0:7E8, 18DA10F1:18DAF110": hexadecimal identifiers, separated by commas, semicolons
+// or spaces; more than 3 digits is an extended identifier. Returns false on syntax error.
+
+bool parseISOTPAddressPairs (const std::string & inText,
+                             std::vector <CANISOTPAddressPair> & outPairs) ;
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  ISOTP_SEQUENCE_ERROR, // Consecutive frame with an unexpected sequence number
+  ISOTP_TIMEOUT, // N_Bs or N_Cr elapsed
+  ISOTP_UNEXPECTED_CONSECUTIVE_FRAME, // No PDU in progress
+  ISOTP_INTERRUPTED, // Single or first frame while a PDU is in progress
+  ISOTP_OVERFLOW, // Flow control frame with overflow status
+  ISOTP_POOL_EXHAUSTED, // First frame dropped, no free buffer
+  ISOTP_ERROR_KIND_COUNT
+} ISOTPErrorKind ;
+
+const char * isotpErrorKindName (const ISOTPErrorKind inKind) ;
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t ISOTP_BUFFER_COUNT = 8 ;
+static const uint32_t ISOTP_BUFFER_SIZE = 64 * 1024 ; // Longer PDUs are truncated
+static const uint32_t ISOTP_TIMEOUT_MILLISECONDS = 1000 ; // N_Bs and N_Cr
+
+//----------------------------------------------------------------------------------------
+
+class ISOTPPDU {
+  public: uint32_t mIdentifierKey ; // Sender
+  public: uint64_t mStartSampleNumber ; // SOF of single or first frame
+  public: uint64_t mEndSampleNumber ; // End of EOF of last frame
+  public: uint64_t mDurationMicroSeconds ;
+  public: uint32_t mLength ; // As announced
+  public: const uint8_t * mData ; // Valid during the delegate call only
+  public: uint32_t mStoredLength ; // mLength, or ISOTP_BUFFER_SIZE if truncated
+  public: uint32_t mConsecutiveFrameCount ;
+  public: uint32_t mFlowControlCount ; // Clear to send
+  public: uint32_t mWaitCount ;
+//--- From the last clear to send flow control frame
+  public: bool mHasFlowControl ;
+  public: uint8_t mBlockSize ;
+  public: uint32_t mRequestedSeparationMicroSeconds ; // STmin
+//--- Measured from the end of a consecutive frame to the SOF of the next one, in a block
+  public: uint32_t mSeparationCount ;
+  public: uint64_t mMinSeparationMicroSeconds ;
+  public: uint64_t mMaxSeparationMicroSeconds ;
+  public: uint64_t mMeanSeparationMicroSeconds ;
+  public: uint32_t mSeparationViolationCount ; // Shorter than STmin
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANISOTPReassemblerDelegate {
+  public: virtual ~CANISOTPReassemblerDelegate (void) {}
+
+  public: virtual void addISOTPPDU (const ISOTPPDU & inPDU) = 0 ;
+
+  public: virtual void addISOTPError (const ISOTPErrorKind inKind,
+                                      const uint32_t inIdentifierKey,
+                                      const uint64_t inSampleNumber) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANISOTPReassembler {
+
+  public: CANISOTPReassembler (CANISOTPReassemblerDelegate * inDelegate) ;
+
+//--- Allocates the buffer pool if inPairs is not empty, and releases it otherwise
+  public: void configure (const std::vector <CANISOTPAddressPair> & inPairs,
+                          const uint32_t inSampleRateHz) ;
+
+  public: inline bool enabled (void) const { return !mStreams.empty () ; }
+
+//--- Sent at EOF by the CAN frame decoder
+  public: void enterMessage (const CANDecodedMessage & inMessage) ;
+
+//--- One stream per identifier of a configured pair
+  private: class Stream {
+    public: Stream (const uint32_t inIdentifierKey) ;
+    public: uint32_t mIdentifierKey ;
+    public: bool mActive ;
+    public: bool mDiscarding ; // Consecutive frames of a failed PDU are ignored
+    public: uint32_t mBufferIndex ;
+    public: uint32_t mReceivedLength ;
+    public: uint8_t mNextSequenceNumber ;
+    public: uint64_t mLastActivitySampleNumber ;
+    public: bool mHasPreviousConsecutiveFrame ;
+    public: uint64_t mPreviousConsecutiveFrameEnd ;
+    public: uint64_t mSeparationSumMicroSeconds ;
+    public: ISOTPPDU mPDU ;
+  } ;
+
+  private: void checkTimeouts (const CANDecodedMessage & inMessage) ;
+  private: void handleSingleFrame (Stream & ioStream, const CANDecodedMessage & inMessage) ;
+  private: void handleFirstFrame (Stream & ioStream, const CANDecodedMessage & inMessage) ;
+  private: void handleConsecutiveFrame (Stream & ioStream, const CANDecodedMessage & inMessage) ;
+  private: void handleFlowControl (Stream & ioStream, const CANDecodedMessage & inMessage) ;
+  private: void appendData (Stream & ioStream, const uint8_t * inData, const uint32_t inLength) ;
+  private: void abort (Stream & ioStream, const ISOTPErrorKind inKind, const uint64_t inSampleNumber) ;
+  private: void release (Stream & ioStream) ;
+  private: uint64_t microSeconds (const uint64_t inSampleCount) const ;
+
+  private: CANISOTPReassemblerDelegate * mDelegate ;
+  private: uint32_t mSampleRateHz ;
+  private: uint64_t mTimeoutSampleCount ;
+  private: std::vector <Stream> mStreams ;
+  private: std::map <uint32_t, uint32_t> mStreamIndex ; // Identifier key -> stream index
+  private: std::vector <uint8_t> mBufferPool ; // ISOTP_BUFFER_COUNT * ISOTP_BUFFER_SIZE
+  private: std::vector <uint32_t> mFreeBuffers ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_ISOTP_REASSEMBLER
@@ -0,0 +1,303 @@
+#include "CANJ1939Decoder.h"
+
+//----------------------------------------------------------------------------------------
+//   Identifier
+//----------------------------------------------------------------------------------------
+
+J1939Identifier j1939Identifier (const uint32_t inIdentifier) {
+  J1939Identifier result ;
+  const uint8_t pduFormat = uint8_t (inIdentifier >> 16) ;
+  const uint8_t pduSpecific = uint8_t (inIdentifier >> 8) ;
+  result.mPriority = uint8_t ((inIdentifier >> 26) & 0x7) ;
+  result.mSourceAddress = uint8_t (inIdentifier) ;
+  if (pduFormat < 240) {
+    result.mPGN = (inIdentifier >> 8) & 0x3FF00 ;
+    result.mDestinationAddress = pduSpecific ;
+  }else{
+    result.mPGN = (inIdentifier >> 8) & 0x3FFFF ;
+    result.mDestinationAddress = J1939_GLOBAL_ADDRESS ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+//   Error kinds
+//----------------------------------------------------------------------------------------
+
+const char * j1939ErrorKindName (const J1939ErrorKind inKind) {
+  switch (inKind) {
+  case J1939_SEQUENCE_ERROR : return "Sequence error" ;
+  case J1939_TIMEOUT : return "Timeout" ;
+  case J1939_INTERRUPTED : return "Interrupted" ;
+  case J1939_ABORTED : return "Aborted" ;
+  case J1939_NO_FREE_SESSION : return "No free session" ;
+  case J1939_ERROR_KIND_COUNT : break ;
+  }
+  return "Error" ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANJ1939Decoder
+//----------------------------------------------------------------------------------------
+
+CANJ1939Decoder::Session::Session (void) :
+mActive (false),
+mBroadcast (false),
+mSourceAddress (0),
+mDestinationAddress (0),
+mPGN (0),
+mSize (0),
+mPacketCount (0),
+mNextPacket (0),
+mClearToSendCount (0),
+mStartSampleNumber (0),
+mLastActivitySampleNumber (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANJ1939Decoder::CANJ1939Decoder (CANJ1939DecoderDelegate * inDelegate) :
+mDelegate (inDelegate),
+mSampleRateHz (1),
+mTimeoutSampleCount (0),
+mSessions (),
+mSessionBuffers (),
+mSessionIndex (),
+mFreeSessions (),
+mPGNCounters (),
+mLastSummarySampleNumber (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANJ1939Decoder::configure (const bool inEnabled,
+                                 const uint32_t inSampleRateHz,
+                                 const uint64_t inStartSampleNumber) {
+  mSampleRateHz = (inSampleRateHz > 0) ? inSampleRateHz : 1 ;
+  mTimeoutSampleCount = uint64_t (mSampleRateHz) * J1939_TIMEOUT_MILLISECONDS / 1000 ;
+  mPGNCounters.clear () ;
+  mLastSummarySampleNumber = inStartSampleNumber ;
+  mFreeSessions.clear () ;
+  if (inEnabled) {
+    mSessions.assign (J1939_SESSION_COUNT, Session ()) ;
+    mSessionBuffers.resize (size_t (J1939_SESSION_COUNT) * J1939_MAX_TRANSPORT_SIZE) ;
+    mSessionIndex.assign (0x10000, uint8_t (J1939_SESSION_COUNT)) ;
+    mFreeSessions.reserve (J1939_SESSION_COUNT) ;
+    for (uint32_t i=0 ; i<J1939_SESSION_COUNT ; i++) {
+      mFreeSessions.push_back (uint8_t (J1939_SESSION_COUNT - 1 - i)) ;
+    }
+  }else{
+    std::vector <Session> ().swap (mSessions) ;
+    std::vector <uint8_t> ().swap (mSessionBuffers) ;
+    std::vector <uint8_t> ().swap (mSessionIndex) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANJ1939Decoder::enterMessage (const CANDecodedMessage & inMessage) {
+  if (inMessage.mExtended) {
+    const J1939Identifier identifier = j1939Identifier (inMessage.mIdentifier) ;
+    mPGNCounters [identifier.mPGN].mFrameCount += 1 ;
+    if (!inMessage.mRemote && (inMessage.mDataLength >= 8)) {
+      if (identifier.mPGN == J1939_TP_CM_PGN) {
+        handleConnectionManagement (identifier, inMessage) ;
+      }else if (identifier.mPGN == J1939_TP_DT_PGN) {
+        handleDataTransfer (identifier, inMessage) ;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Rates are computed over the interval since the previous summary
+
+void CANJ1939Decoder::summarize (const uint64_t inSampleNumber) {
+  const uint64_t sampleCount = inSampleNumber - mLastSummarySampleNumber ;
+  if (sampleCount > 0) {
+    std::map <uint32_t, J1939PGNCounters>::iterator it ;
+    for (it = mPGNCounters.begin () ; it != mPGNCounters.end () ; it++) {
+      J1939PGNCounters & counters = it->second ;
+      if (counters.mFrameCount != counters.mFrameCountAtLastSummary) {
+        const uint64_t frameCount = counters.mFrameCount - counters.mFrameCountAtLastSummary ;
+        mDelegate->addJ1939PGNRate (it->first, counters, frameCount * mSampleRateHz / sampleCount, inSampleNumber) ;
+        counters.mFrameCountAtLastSummary = counters.mFrameCount ;
+      }
+    }
+    mLastSummarySampleNumber = inSampleNumber ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// TP.CM: control byte, then size (bytes 1-2) and packet count (3) for BAM and RTS, and
+// the PGN of the transported message in bytes 5-7
+
+void CANJ1939Decoder::handleConnectionManagement (const J1939Identifier & inIdentifier,
+                                                  const CANDecodedMessage & inMessage) {
+  const uint8_t * d = inMessage.mData ;
+  const uint32_t pgn = uint32_t (d [5]) | (uint32_t (d [6]) << 8) | (uint32_t (d [7] & 0x03) << 16) ;
+  const uint32_t size = uint32_t (d [1]) | (uint32_t (d [2]) << 8) ;
+  const uint32_t packetCount = d [3] ;
+  const bool validSize = (size > 8) && (size <= J1939_MAX_TRANSPORT_SIZE)
+                      && (packetCount > 0) && ((packetCount * 7) >= size) ;
+  switch (d [0]) {
+  case 16 : // RTS, from the originator
+  case 32 : // BAM
+    if (validSize) {
+      Session * s = openSession (inIdentifier.mSourceAddress, inIdentifier.mDestinationAddress, pgn, inMessage) ;
+      if (s != NULL) {
+        s->mBroadcast = d [0] == 32 ;
+        s->mSize = size ;
+        s->mPacketCount = packetCount ;
+      }
+    }
+    break ;
+  case 17 : // CTS, from the responder: next packet (byte 2), 0 packets (byte 1) is a hold
+    { Session * s = session (inIdentifier.mDestinationAddress, inIdentifier.mSourceAddress) ;
+      if ((s != NULL) && !s->mBroadcast) {
+        if (timedOut (*s, inMessage.mStartSampleNumber)) {
+          abort (*s, J1939_TIMEOUT, inMessage.mEndSampleNumber) ;
+        }else{
+          s->mClearToSendCount += 1 ;
+          s->mLastActivitySampleNumber = inMessage.mEndSampleNumber ;
+          if (d [1] > 0) {
+            s->mNextPacket = d [2] ;
+          }
+        }
+      }
+    }
+    break ;
+  case 255 : // Connection abort, from either side
+    { Session * s = session (inIdentifier.mSourceAddress, inIdentifier.mDestinationAddress) ;
+      if (s == NULL) {
+        s = session (inIdentifier.mDestinationAddress, inIdentifier.mSourceAddress) ;
+      }
+      if (s != NULL) {
+        abort (*s, J1939_ABORTED, inMessage.mEndSampleNumber) ;
+      }
+    }
+    break ;
+  default : // End of message acknowledgment: the message has been sent at its last packet
+    break ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// TP.DT: sequence number (1 ... 255), then 7 data bytes. Packets of a session that started
+// before the capture are ignored.
+
+void CANJ1939Decoder::handleDataTransfer (const J1939Identifier & inIdentifier,
+                                          const CANDecodedMessage & inMessage) {
+  Session * s = session (inIdentifier.mSourceAddress, inIdentifier.mDestinationAddress) ;
+  if (s != NULL) {
+    const uint32_t sequenceNumber = inMessage.mData [0] ;
+    if (timedOut (*s, inMessage.mStartSampleNumber)) {
+      abort (*s, J1939_TIMEOUT, inMessage.mEndSampleNumber) ;
+    }else if (sequenceNumber != s->mNextPacket) {
+      abort (*s, J1939_SEQUENCE_ERROR, inMessage.mEndSampleNumber) ;
+    }else{
+      const size_t sessionIndex = size_t (s - mSessions.data ()) ;
+      uint8_t * buffer = mSessionBuffers.data () + sessionIndex * J1939_MAX_TRANSPORT_SIZE ;
+      const uint32_t offset = (sequenceNumber - 1) * 7 ;
+      for (uint32_t i=0 ; (i<7) && ((offset + i) < s->mSize) ; i++) {
+        buffer [offset + i] = inMessage.mData [1 + i] ;
+      }
+      s->mNextPacket += 1 ;
+      s->mLastActivitySampleNumber = inMessage.mEndSampleNumber ;
+      if (sequenceNumber == s->mPacketCount) {
+        J1939TransportMessage message ;
+        message.mPGN = s->mPGN ;
+        message.mSourceAddress = s->mSourceAddress ;
+        message.mDestinationAddress = s->mDestinationAddress ;
+        message.mBroadcast = s->mBroadcast ;
+        message.mSize = s->mSize ;
+        message.mData = buffer ;
+        message.mPacketCount = s->mPacketCount ;
+        message.mClearToSendCount = s->mClearToSendCount ;
+        message.mStartSampleNumber = s->mStartSampleNumber ;
+        message.mEndSampleNumber = inMessage.mEndSampleNumber ;
+        message.mDurationMicroSeconds = (inMessage.mEndSampleNumber - s->mStartSampleNumber) * 1000000 / mSampleRateHz ;
+        mDelegate->addJ1939TransportMessage (message) ;
+        release (*s) ;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+CANJ1939Decoder::Session * CANJ1939Decoder::session (const uint8_t inSourceAddress,
+                                                     const uint8_t inDestinationAddress) {
+  const uint8_t idx = mSessionIndex [sessionKey (inSourceAddress, inDestinationAddress)] ;
+  return (idx < J1939_SESSION_COUNT) ? &mSessions [idx] : NULL ;
+}
+
+//----------------------------------------------------------------------------------------
+// A session in progress with the same addresses is closed. If every slot is in use, timed
+// out sessions are released first (the only scan of the session table).
+
+CANJ1939Decoder::Session * CANJ1939Decoder::openSession (const uint8_t inSourceAddress,
+                                                         const uint8_t inDestinationAddress,
+                                                         const uint32_t inPGN,
+                                                         const CANDecodedMessage & inMessage) {
+  Session * s = session (inSourceAddress, inDestinationAddress) ;
+  if (s != NULL) {
+    const bool expired = timedOut (*s, inMessage.mStartSampleNumber) ;
+    abort (*s, expired ? J1939_TIMEOUT : J1939_INTERRUPTED, inMessage.mEndSampleNumber) ;
+    s = NULL ;
+  }
+  if (mFreeSessions.empty ()) {
+    for (size_t i=0 ; i<mSessions.size () ; i++) {
+      if (timedOut (mSessions [i], inMessage.mStartSampleNumber)) {
+        abort (mSessions [i], J1939_TIMEOUT, inMessage.mEndSampleNumber) ;
+      }
+    }
+  }
+  if (mFreeSessions.empty ()) {
+    mDelegate->addJ1939TransportError (J1939_NO_FREE_SESSION, inPGN, inSourceAddress, inDestinationAddress,
+                                       inMessage.mEndSampleNumber) ;
+  }else{
+    const uint8_t idx = mFreeSessions.back () ;
+    mFreeSessions.pop_back () ;
+    mSessionIndex [sessionKey (inSourceAddress, inDestinationAddress)] = idx ;
+    s = &mSessions [idx] ;
+    s->mActive = true ;
+    s->mSourceAddress = inSourceAddress ;
+    s->mDestinationAddress = inDestinationAddress ;
+    s->mPGN = inPGN ;
+    s->mNextPacket = 1 ;
+    s->mClearToSendCount = 0 ;
+    s->mStartSampleNumber = inMessage.mStartSampleNumber ;
+    s->mLastActivitySampleNumber = inMessage.mEndSampleNumber ;
+  }
+  return s ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANJ1939Decoder::timedOut (const Session & inSession, const uint64_t inSampleNumber) const {
+  return inSession.mActive && ((inSampleNumber - inSession.mLastActivitySampleNumber) > mTimeoutSampleCount) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANJ1939Decoder::abort (Session & ioSession,
+                             const J1939ErrorKind inKind,
+                             const uint64_t inSampleNumber) {
+  mDelegate->addJ1939TransportError (inKind, ioSession.mPGN, ioSession.mSourceAddress,
+                                     ioSession.mDestinationAddress, inSampleNumber) ;
+  release (ioSession) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANJ1939Decoder::release (Session & ioSession) {
+  if (ioSession.mActive) {
+    ioSession.mActive = false ;
+    const uint32_t key = sessionKey (ioSession.mSourceAddress, ioSession.mDestinationAddress) ;
+    mFreeSessions.push_back (mSessionIndex [key]) ;
+    mSessionIndex [key] = uint8_t (J1939_SESSION_COUNT) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
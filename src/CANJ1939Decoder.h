@@ -0,0 +1,159 @@
+#ifndef CAN_J1939_DECODER
+#define CAN_J1939_DECODER
+
+//----------------------------------------------------------------------------------------
+// SAE J1939 decoding of 29-bit identifiers, per PGN counters, and reassembly of
+// transport protocol sessions (TP.CM / TP.DT, BAM and RTS/CTS). Does not depend on the
+// Saleae SDK. Sessions use preallocated slots, found through a table indexed by source
+// and destination address: constant time per frame, memory bounded by configure.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+
+#include <stddef.h>
+#include <vector>
+#include <map>
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t J1939_TP_CM_PGN = 0xEC00 ;
+static const uint32_t J1939_TP_DT_PGN = 0xEB00 ;
+static const uint8_t J1939_GLOBAL_ADDRESS = 0xFF ;
+
+//----------------------------------------------------------------------------------------
+// PDU1 (PF < 240): PS is the destination address, not part of the PGN. PDU2: PS is the
+// group extension, destination is global.
+
+class J1939Identifier {
+  public: uint8_t mPriority ;
+  public: uint32_t mPGN ; // 18 bits: EDP, DP, PF, PS (PDU2 only)
+  public: uint8_t mSourceAddress ;
+  public: uint8_t mDestinationAddress ;
+} ;
+
+J1939Identifier j1939Identifier (const uint32_t inIdentifier) ;
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t J1939_SESSION_COUNT = 64 ;
+static const uint32_t J1939_MAX_TRANSPORT_SIZE = 1785 ; // 255 packets of 7 bytes
+static const uint32_t J1939_TIMEOUT_MILLISECONDS = 1250 ; // T2, T3; T1 is 750 ms
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  J1939_SEQUENCE_ERROR, // TP.DT with an unexpected sequence number
+  J1939_TIMEOUT,
+  J1939_INTERRUPTED, // New BAM or RTS while a session is in progress
+  J1939_ABORTED, // Connection abort
+  J1939_NO_FREE_SESSION, // All slots are in use
+  J1939_ERROR_KIND_COUNT
+} J1939ErrorKind ;
+
+const char * j1939ErrorKindName (const J1939ErrorKind inKind) ;
+
+//----------------------------------------------------------------------------------------
+
+class J1939TransportMessage {
+  public: uint32_t mPGN ; // Of the transported message
+  public: uint8_t mSourceAddress ;
+  public: uint8_t mDestinationAddress ; // J1939_GLOBAL_ADDRESS for BAM
+  public: bool mBroadcast ; // BAM, otherwise RTS/CTS
+  public: uint32_t mSize ;
+  public: const uint8_t * mData ; // Valid during the delegate call only
+  public: uint32_t mPacketCount ;
+  public: uint32_t mClearToSendCount ;
+  public: uint64_t mStartSampleNumber ; // SOF of BAM or RTS
+  public: uint64_t mEndSampleNumber ; // End of EOF of last TP.DT
+  public: uint64_t mDurationMicroSeconds ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class J1939PGNCounters {
+  public: uint64_t mFrameCount ;
+  public: uint64_t mFrameCountAtLastSummary ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANJ1939DecoderDelegate {
+  public: virtual ~CANJ1939DecoderDelegate (void) {}
+
+  public: virtual void addJ1939TransportMessage (const J1939TransportMessage & inMessage) = 0 ;
+
+  public: virtual void addJ1939TransportError (const J1939ErrorKind inKind,
+                                               const uint32_t inPGN,
+                                               const uint8_t inSourceAddress,
+                                               const uint8_t inDestinationAddress,
+                                               const uint64_t inSampleNumber) = 0 ;
+
+//--- Sent by summarize for each PGN received since the previous summary
+  public: virtual void addJ1939PGNRate (const uint32_t inPGN,
+                                        const J1939PGNCounters & inCounters,
+                                        const uint64_t inFramesPerSecond,
+                                        const uint64_t inSampleNumber) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANJ1939Decoder {
+
+  public: CANJ1939Decoder (CANJ1939DecoderDelegate * inDelegate) ;
+
+//--- Allocates the session slots if enabled, and releases them otherwise
+  public: void configure (const bool inEnabled,
+                          const uint32_t inSampleRateHz,
+                          const uint64_t inStartSampleNumber) ;
+
+  public: inline bool enabled (void) const { return !mSessions.empty () ; }
+
+//--- Sent at EOF by the CAN frame decoder; standard frames are ignored
+  public: void enterMessage (const CANDecodedMessage & inMessage) ;
+
+  public: void summarize (const uint64_t inSampleNumber) ;
+
+  private: class Session {
+    public: Session (void) ;
+    public: bool mActive ;
+    public: bool mBroadcast ;
+    public: uint8_t mSourceAddress ;
+    public: uint8_t mDestinationAddress ;
+    public: uint32_t mPGN ;
+    public: uint32_t mSize ;
+    public: uint32_t mPacketCount ;
+    public: uint32_t mNextPacket ; // 1 ... mPacketCount
+    public: uint32_t mClearToSendCount ;
+    public: uint64_t mStartSampleNumber ;
+    public: uint64_t mLastActivitySampleNumber ;
+  } ;
+
+  private: static inline uint32_t sessionKey (const uint8_t inSourceAddress, const uint8_t inDestinationAddress) {
+    return (uint32_t (inSourceAddress) << 8) | inDestinationAddress ;
+  }
+
+  private: void handleConnectionManagement (const J1939Identifier & inIdentifier, const CANDecodedMessage & inMessage) ;
+  private: void handleDataTransfer (const J1939Identifier & inIdentifier, const CANDecodedMessage & inMessage) ;
+  private: Session * session (const uint8_t inSourceAddress, const uint8_t inDestinationAddress) ;
+  private: Session * openSession (const uint8_t inSourceAddress,
+                                  const uint8_t inDestinationAddress,
+                                  const uint32_t inPGN,
+                                  const CANDecodedMessage & inMessage) ;
+  private: bool timedOut (const Session & inSession, const uint64_t inSampleNumber) const ;
+  private: void abort (Session & ioSession, const J1939ErrorKind inKind, const uint64_t inSampleNumber) ;
+  private: void release (Session & ioSession) ;
+
+  private: CANJ1939DecoderDelegate * mDelegate ;
+  private: uint32_t mSampleRateHz ;
+  private: uint64_t mTimeoutSampleCount ;
+  private: std::vector <Session> mSessions ;
+  private: std::vector <uint8_t> mSessionBuffers ; // J1939_SESSION_COUNT * J1939_MAX_TRANSPORT_SIZE
+  private: std::vector <uint8_t> mSessionIndex ; // By sessionKey, J1939_SESSION_COUNT if none
+  private: std::vector <uint8_t> mFreeSessions ;
+  private: std::map <uint32_t, J1939PGNCounters> mPGNCounters ;
+  private: uint64_t mLastSummarySampleNumber ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_J1939_DECODER
@@ -0,0 +1,299 @@
+#include "CANLiveLog.h"
+
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+
+#ifdef _WIN32
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------------
+
+static_assert ((LIVE_LOG_QUEUE_SIZE & (LIVE_LOG_QUEUE_SIZE - 1)) == 0, "LIVE_LOG_QUEUE_SIZE") ;
+
+//----------------------------------------------------------------------------------------
+
+static const char * CSV_HEADER = "Time [s],Identifier,Extended,Remote,FD,BRS,ESI,DLC,Data,Acked\n" ;
+
+//----------------------------------------------------------------------------------------
+
+static void syncFile (FILE * inFile) {
+  fflush (inFile) ;
+#ifdef _WIN32
+  _commit (_fileno (inFile)) ;
+#else
+  fsync (fileno (inFile)) ;
+#endif
+}
+
+//----------------------------------------------------------------------------------------
+
+CANLiveLog::CANLiveLog (void) :
+mQueue (),
+mPadding0 (),
+mHead (0),
+mPadding1 (),
+mTail (0),
+mPadding2 (),
+mDroppedCount (0),
+mPadding3 (),
+mWrittenCount (0),
+mStopRequested (false),
+mFailed (false),
+mErrorMutex (),
+mError (),
+mThread (),
+mPath (),
+mFormat (LIVE_LOG_CANDUMP),
+mRotationBytes (0),
+mSampleRateHz (1),
+mFile (NULL),
+mFileIndex (0),
+mFileSize (0),
+mUnsynced (false),
+mBuffer () {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANLiveLog::~ CANLiveLog (void) {
+  stop () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANLiveLog::start (const std::string & inPath,
+                        const CANLiveLogFormat inFormat,
+                        const uint64_t inRotationBytes,
+                        const uint32_t inSampleRateHz,
+                        std::string & outError) {
+  stop () ;
+  mPath = inPath ;
+  mFormat = inFormat ;
+  mRotationBytes = inRotationBytes ;
+  mSampleRateHz = (inSampleRateHz > 0) ? inSampleRateHz : 1 ;
+  mFileIndex = 0 ;
+  mHead.store (0, std::memory_order_relaxed) ;
+  mTail.store (0, std::memory_order_relaxed) ;
+  mDroppedCount.store (0, std::memory_order_relaxed) ;
+  mWrittenCount.store (0, std::memory_order_relaxed) ;
+  mFailed.store (false, std::memory_order_relaxed) ;
+  { std::lock_guard <std::mutex> lock (mErrorMutex) ;
+    mError.clear () ;
+  }
+  mBuffer.clear () ;
+  mBuffer.reserve (LIVE_LOG_WRITE_SIZE + 512) ;
+  const bool ok = openFile () ;
+  if (ok) {
+    mQueue.resize (LIVE_LOG_QUEUE_SIZE) ;
+    mStopRequested.store (false, std::memory_order_relaxed) ;
+    mThread = std::thread (&CANLiveLog::run, this) ;
+  }else{
+    outError = error () ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANLiveLog::stop (void) {
+  if (mThread.joinable ()) {
+    mStopRequested.store (true, std::memory_order_release) ;
+    mThread.join () ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANLiveLog::push (const CANDecodedMessage & inMessage) {
+  const uint64_t head = mHead.load (std::memory_order_relaxed) ;
+  if ((head - mTail.load (std::memory_order_acquire)) >= LIVE_LOG_QUEUE_SIZE) {
+    mDroppedCount.fetch_add (1, std::memory_order_relaxed) ;
+  }else{
+    mQueue [head & (LIVE_LOG_QUEUE_SIZE - 1)] = inMessage ;
+    mHead.store (head + 1, std::memory_order_release) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+std::string CANLiveLog::error (void) const {
+  std::string result ;
+  if (mFailed.load (std::memory_order_acquire)) {
+    std::lock_guard <std::mutex> lock (mErrorMutex) ;
+    result = mError ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANLiveLog::fail (const std::string & inError) {
+  { std::lock_guard <std::mutex> lock (mErrorMutex) ;
+    mError = inError ;
+  }
+  mFailed.store (true, std::memory_order_release) ;
+  if (mFile != NULL) {
+    fclose (mFile) ;
+    mFile = NULL ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+//  WRITER THREAD
+//----------------------------------------------------------------------------------------
+
+bool CANLiveLog::openFile (void) {
+  std::string path = mPath ;
+  if (mRotationBytes > 0) {
+    char suffix [16] ;
+    snprintf (suffix, sizeof (suffix), ".%03u", mFileIndex) ;
+    path += suffix ;
+  }
+  mFile = fopen (path.c_str (), "wb") ;
+  mFileSize = 0 ;
+  if (mFile == NULL) {
+    fail (path + ": " + strerror (errno)) ;
+  }else if (mFormat == LIVE_LOG_CSV) {
+    fputs (CSV_HEADER, mFile) ;
+    mFileSize = strlen (CSV_HEADER) ;
+  }
+  return mFile != NULL ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANLiveLog::run (void) {
+  std::chrono::steady_clock::time_point lastWrite = std::chrono::steady_clock::now () ;
+  std::chrono::steady_clock::time_point lastSync = lastWrite ;
+  bool goOn = true ;
+  while (goOn) {
+    const bool stopRequested = mStopRequested.load (std::memory_order_acquire) ;
+    const bool received = drain () ;
+    goOn = !stopRequested || received ; // After a stop request, until the queue is empty
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now () ;
+    if ((mBuffer.size () >= LIVE_LOG_WRITE_SIZE)
+     || (!mBuffer.empty () && (!goOn || ((now - lastWrite) >= std::chrono::seconds (1))))) {
+      writeBuffer () ;
+      lastWrite = now ;
+    }
+    if (mUnsynced && (!goOn || ((now - lastSync) >= std::chrono::seconds (1)))) {
+      if (mFile != NULL) {
+        syncFile (mFile) ;
+      }
+      mUnsynced = false ;
+      lastSync = now ;
+    }
+    if (goOn && !received) {
+      std::this_thread::sleep_for (std::chrono::milliseconds (10)) ;
+    }
+  }
+  if (mFile != NULL) {
+    fclose (mFile) ;
+    mFile = NULL ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Returns true if at least one message was dequeued; stops when the buffer is full.
+// After a write error, messages are dequeued and counted as dropped.
+
+bool CANLiveLog::drain (void) {
+  uint64_t tail = mTail.load (std::memory_order_relaxed) ;
+  const uint64_t head = mHead.load (std::memory_order_acquire) ;
+  const bool received = tail != head ;
+  while ((tail != head) && (mBuffer.size () < LIVE_LOG_WRITE_SIZE)) {
+    if (mFile != NULL) {
+      format (mQueue [tail & (LIVE_LOG_QUEUE_SIZE - 1)]) ;
+    }else{
+      mDroppedCount.fetch_add (1, std::memory_order_relaxed) ;
+    }
+    tail += 1 ;
+    mTail.store (tail, std::memory_order_release) ;
+  }
+  return received ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANLiveLog::format (const CANDecodedMessage & inMessage) {
+  static const char hexDigits [] = "0123456789ABCDEF" ;
+  char data [129] ;
+  const uint32_t dataLength = inMessage.mRemote ? 0 : inMessage.mDataLength ;
+  for (uint32_t i=0 ; i<dataLength ; i++) {
+    data [2 * i] = hexDigits [inMessage.mData [i] >> 4] ;
+    data [2 * i + 1] = hexDigits [inMessage.mData [i] & 0xF] ;
+  }
+  data [2 * dataLength] = '\0' ;
+  const unsigned long long seconds = inMessage.mStartSampleNumber / mSampleRateHz ;
+  const unsigned long long microSeconds = (inMessage.mStartSampleNumber % mSampleRateHz) * 1000000 / mSampleRateHz ;
+  char identifier [9] ;
+  snprintf (identifier, sizeof (identifier), inMessage.mExtended ? "%08X" : "%03X", inMessage.mIdentifier) ;
+  char line [256] ;
+  int length = 0 ;
+  switch (mFormat) {
+  case LIVE_LOG_CANDUMP :
+    if (inMessage.mFD) {
+      const unsigned flags = (inMessage.mBRS ? 1 : 0) | (inMessage.mESI ? 2 : 0) ;
+      length = snprintf (line, sizeof (line), "(%llu.%06llu) can0 %s##%X%s\n",
+                         seconds, microSeconds, identifier, flags, data) ;
+    }else{
+      length = snprintf (line, sizeof (line), "(%llu.%06llu) can0 %s#%s\n",
+                         seconds, microSeconds, identifier, inMessage.mRemote ? "R" : data) ;
+    }
+    break ;
+  case LIVE_LOG_CSV :
+    length = snprintf (line, sizeof (line), "%llu.%06llu,%s,%u,%u,%u,%u,%u,%u,%s,%u\n",
+                       seconds, microSeconds, identifier,
+                       inMessage.mExtended, inMessage.mRemote, inMessage.mFD, inMessage.mBRS, inMessage.mESI,
+                       inMessage.mDataCodeLength, data, inMessage.mAcked) ;
+    break ;
+  }
+  if (length > 0) {
+    mBuffer.append (line, size_t (length)) ;
+  }
+  mWrittenCount.fetch_add (1, std::memory_order_relaxed) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+// With rotation, the buffer is split on line boundaries, so that no file exceeds the
+// rotation size (unless a single line does).
+
+void CANLiveLog::writeBuffer (void) {
+  const size_t headerSize = (mFormat == LIVE_LOG_CSV) ? strlen (CSV_HEADER) : 0 ;
+  size_t written = 0 ;
+  while ((mFile != NULL) && (written < mBuffer.size ())) {
+    size_t length = mBuffer.size () - written ;
+    if ((mRotationBytes > 0) && ((mFileSize + length) > mRotationBytes)) {
+      const size_t room = (mFileSize < mRotationBytes) ? size_t (mRotationBytes - mFileSize) : 0 ;
+      const size_t lastNewLine = (room > 0) ? mBuffer.rfind ('\n', written + room - 1) : std::string::npos ;
+      if ((lastNewLine != std::string::npos) && (lastNewLine >= written)) {
+        length = lastNewLine + 1 - written ;
+      }else if (mFileSize > headerSize) { // Current file is full
+        length = 0 ;
+      }else{ // Line longer than the rotation size
+        length = mBuffer.find ('\n', written) + 1 - written ;
+      }
+    }
+    if (length == 0) {
+      syncFile (mFile) ;
+      fclose (mFile) ;
+      mFile = NULL ;
+      mFileIndex += 1 ;
+      openFile () ;
+    }else if (fwrite (mBuffer.data () + written, 1, length, mFile) != length) {
+      fail (std::string ("write: ") + strerror (errno)) ;
+    }else{
+      written += length ;
+      mFileSize += length ;
+      mUnsynced = true ;
+    }
+  }
+  mBuffer.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+#ifndef CAN_LIVE_LOG
+#define CAN_LIVE_LOG
+
+//----------------------------------------------------------------------------------------
+// Live log: decoded messages are written to a log file while the capture runs, so that a
+// crash or a full disk loses at most the last seconds. The decoder thread pushes messages
+// into a bounded single producer / single consumer queue and never waits: when the queue
+// is full, the message is dropped and counted. A writer thread formats messages into a
+// large buffer, appends it to the file at least every second, and syncs the file to disk
+// every second; with rotation, a new file is started when the current one would exceed
+// the rotation size. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  LIVE_LOG_CANDUMP, // candump -L lines: (seconds) can0 IDF#DATA
+  LIVE_LOG_CSV
+} CANLiveLogFormat ;
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t LIVE_LOG_QUEUE_SIZE = 65536 ; // Messages, power of 2
+static const size_t LIVE_LOG_WRITE_SIZE = 1 << 20 ; // Bytes per write
+static const size_t LIVE_LOG_CACHE_LINE_SIZE = 64 ; // Bytes
+
+//----------------------------------------------------------------------------------------
+
+class CANLiveLog {
+
+  public: CANLiveLog (void) ;
+
+  public: ~ CANLiveLog (void) ;
+
+//--- Stops a running log, opens the (first) file and starts the writer thread. With
+// inRotationBytes > 0, files are inPath.000, inPath.001, ...; otherwise inPath. Time
+// stamps are seconds from sample 0. On failure, outError is set.
+  public: bool start (const std::string & inPath,
+                      const CANLiveLogFormat inFormat,
+                      const uint64_t inRotationBytes,
+                      const uint32_t inSampleRateHz,
+                      std::string & outError) ;
+
+//--- Writes pending messages, then closes the file
+  public: void stop (void) ;
+
+  public: inline bool isRunning (void) const { return mThread.joinable () ; }
+
+//--- Decoder thread, wait free
+  public: void push (const CANDecodedMessage & inMessage) ;
+
+  public: inline uint64_t droppedCount (void) const { return mDroppedCount.load (std::memory_order_relaxed) ; }
+  public: inline uint64_t writtenCount (void) const { return mWrittenCount.load (std::memory_order_relaxed) ; }
+
+//--- Empty while no write error occurred; then the log stops writing
+  public: std::string error (void) const ;
+
+//--- Writer thread
+  private: void run (void) ;
+  private: bool drain (void) ;
+  private: void format (const CANDecodedMessage & inMessage) ;
+  private: void writeBuffer (void) ;
+  private: bool openFile (void) ;
+  private: void fail (const std::string & inError) ;
+
+//--- Padding keeps mHead, mTail and mDroppedCount one cache line apart, without
+//    over-aligning the class (it is allocated by plain new, with the analyzer)
+  private: std::vector <CANDecodedMessage> mQueue ;
+  private: char mPadding0 [LIVE_LOG_CACHE_LINE_SIZE] ;
+  private: std::atomic <uint64_t> mHead ; // Written by the decoder thread
+  private: char mPadding1 [LIVE_LOG_CACHE_LINE_SIZE - sizeof (std::atomic <uint64_t>)] ;
+  private: std::atomic <uint64_t> mTail ; // Written by the writer thread
+  private: char mPadding2 [LIVE_LOG_CACHE_LINE_SIZE - sizeof (std::atomic <uint64_t>)] ;
+  private: std::atomic <uint64_t> mDroppedCount ;
+  private: char mPadding3 [LIVE_LOG_CACHE_LINE_SIZE - sizeof (std::atomic <uint64_t>)] ;
+  private: std::atomic <uint64_t> mWrittenCount ;
+  private: std::atomic <bool> mStopRequested ;
+  private: std::atomic <bool> mFailed ;
+  private: mutable std::mutex mErrorMutex ;
+  private: std::string mError ;
+  private: std::thread mThread ;
+
+//--- Writer thread state
+  private: std::string mPath ;
+  private: CANLiveLogFormat mFormat ;
+  private: uint64_t mRotationBytes ;
+  private: uint32_t mSampleRateHz ;
+  private: FILE * mFile ;
+  private: uint32_t mFileIndex ;
+  private: uint64_t mFileSize ;
+  private: bool mUnsynced ;
+  private: std::string mBuffer ;
+
+//--- No copy
+  private: CANLiveLog (const CANLiveLog &) ;
+  private: CANLiveLog & operator = (const CANLiveLog &) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_LIVE_LOG
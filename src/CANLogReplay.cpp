@@ -0,0 +1,296 @@
+#include "CANLogReplay.h"
+#include "CANFrameDecoder.h"
+
+#include <errno.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------------
+//   Line parsing
+//----------------------------------------------------------------------------------------
+// SECONDS[.FRACTION], at most 9 fraction digits are significant
+
+static bool parseTimeStamp (const char * & ioCursor, const char * inEnd, uint64_t & outNanoSeconds) {
+  uint64_t seconds = 0 ;
+  const char * first = ioCursor ;
+  while ((ioCursor < inEnd) && (*ioCursor >= '0') && (*ioCursor <= '9') && (seconds < 1000000000000ULL)) {
+    seconds = seconds * 10 + uint64_t (*ioCursor - '0') ;
+    ioCursor += 1 ;
+  }
+  bool ok = ioCursor > first ;
+  uint64_t nanoSeconds = 0 ;
+  if (ok && (ioCursor < inEnd) && (*ioCursor == '.')) {
+    ioCursor += 1 ;
+    uint64_t scale = 100000000 ;
+    while ((ioCursor < inEnd) && (*ioCursor >= '0') && (*ioCursor <= '9')) {
+      nanoSeconds += uint64_t (*ioCursor - '0') * scale ;
+      scale /= 10 ;
+      ioCursor += 1 ;
+    }
+  }
+  outNanoSeconds = seconds * 1000000000 + nanoSeconds ;
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool parseHex (const char * & ioCursor,
+                      const char * inEnd,
+                      uint32_t & outValue,
+                      uint32_t & outDigitCount) {
+  uint64_t value = 0 ;
+  const bool ok = parseHexDigits (ioCursor, inEnd, 8, value, outDigitCount) ;
+  outValue = uint32_t (value) ;
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+// Data bytes, two hexadecimal digits each, up to a character that is not a digit
+
+static bool parseData (const char * & ioCursor, const char * inEnd, CANFrameDescriptor & ioFrame) {
+  ioFrame.mDataLength = 0 ;
+  bool ok = true ;
+  while (ok && (ioCursor < inEnd) && (hexDigitValue (*ioCursor) >= 0)) {
+    ok = (ioFrame.mDataLength < 8) && ((ioCursor + 1) < inEnd) && (hexDigitValue (ioCursor [1]) >= 0) ;
+    if (ok) {
+      ioFrame.mData [ioFrame.mDataLength] = uint8_t ((hexDigitValue (ioCursor [0]) << 4) | hexDigitValue (ioCursor [1])) ;
+      ioFrame.mDataLength += 1 ;
+      ioCursor += 2 ;
+    }
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool parseFlag (const char * & ioCursor, const char * inEnd, bool & outFlag) {
+  const bool ok = (ioCursor < inEnd) && ((*ioCursor == '0') || (*ioCursor == '1')) ;
+  if (ok) {
+    outFlag = *ioCursor == '1' ;
+    ioCursor += 1 ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static inline bool skip (const char * & ioCursor, const char * inEnd, const char inChar) {
+  const bool ok = (ioCursor < inEnd) && (*ioCursor == inChar) ;
+  if (ok) {
+    ioCursor += 1 ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool validIdentifier (const uint32_t inIdentifier, const FrameFormat inFormat) {
+  return inIdentifier <= ((inFormat == extendedFrame) ? 0x1FFFFFFFU : 0x7FFU) ;
+}
+
+//----------------------------------------------------------------------------------------
+// (SECONDS) INTERFACE IDF#DATA | IDF#R[DLC]; IDF##FLAGSDATA is CAN FD
+
+static bool parseCandumpLine (const char * inCursor, const char * inEnd, CANReplayMessage & outMessage) {
+  CANFrameDescriptor & frame = outMessage.mFrame ;
+  bool ok = skip (inCursor, inEnd, '(')
+    && parseTimeStamp (inCursor, inEnd, outMessage.mNanoSeconds)
+    && skip (inCursor, inEnd, ')')
+    && skip (inCursor, inEnd, ' ')
+  ;
+  while (ok && (inCursor < inEnd) && (*inCursor != ' ')) { // Interface
+    inCursor += 1 ;
+  }
+  uint32_t digitCount = 0 ;
+  ok = ok
+    && skip (inCursor, inEnd, ' ')
+    && parseHex (inCursor, inEnd, frame.mIdentifier, digitCount)
+    && ((digitCount == 3) || (digitCount == 8))
+    && skip (inCursor, inEnd, '#')
+    && ((inCursor == inEnd) || (*inCursor != '#')) // CAN FD
+  ;
+  if (ok) {
+    frame.mFrameFormat = (digitCount == 8) ? extendedFrame : standardFrame ;
+    frame.mAckSlot = ACK_SLOT_DOMINANT ;
+    frame.mFD = false ;
+    frame.mBRS = false ;
+    frame.mESI = false ;
+    ok = validIdentifier (frame.mIdentifier, frame.mFrameFormat) ;
+  }
+  if (ok && skip (inCursor, inEnd, 'R')) {
+    frame.mFrameType = remoteFrame ;
+    frame.mDataLength = 0 ;
+    if ((inCursor < inEnd) && (*inCursor >= '0') && (*inCursor <= '8')) {
+      frame.mDataLength = uint8_t (*inCursor - '0') ;
+      inCursor += 1 ;
+    }
+  }else if (ok) {
+    frame.mFrameType = dataFrame ;
+    ok = parseData (inCursor, inEnd, frame) ;
+  }
+  return ok && (inCursor == inEnd) ;
+}
+
+//----------------------------------------------------------------------------------------
+// SECONDS,IDF,EXTENDED,REMOTE,FD,BRS,ESI,DLC,DATA,ACKED
+
+static bool parseCSVLine (const char * inCursor, const char * inEnd, CANReplayMessage & outMessage) {
+  CANFrameDescriptor & frame = outMessage.mFrame ;
+  uint32_t digitCount = 0 ;
+  bool extended = false ;
+  bool remote = false ;
+  bool fd = false ;
+  bool brs = false ;
+  bool esi = false ;
+  uint32_t dataCodeLength = 0 ;
+  bool acked = false ;
+  bool ok = parseTimeStamp (inCursor, inEnd, outMessage.mNanoSeconds)
+    && skip (inCursor, inEnd, ',')
+    && parseHex (inCursor, inEnd, frame.mIdentifier, digitCount)
+    && skip (inCursor, inEnd, ',')
+    && parseFlag (inCursor, inEnd, extended) && skip (inCursor, inEnd, ',')
+    && parseFlag (inCursor, inEnd, remote) && skip (inCursor, inEnd, ',')
+    && parseFlag (inCursor, inEnd, fd) && skip (inCursor, inEnd, ',')
+    && parseFlag (inCursor, inEnd, brs) && skip (inCursor, inEnd, ',')
+    && parseFlag (inCursor, inEnd, esi) && skip (inCursor, inEnd, ',')
+    && parseHex (inCursor, inEnd, dataCodeLength, digitCount) && skip (inCursor, inEnd, ',')
+    && parseData (inCursor, inEnd, frame) && skip (inCursor, inEnd, ',')
+    && parseFlag (inCursor, inEnd, acked)
+    && (inCursor == inEnd)
+    && !fd
+  ;
+  if (ok) {
+    frame.mFrameFormat = extended ? extendedFrame : standardFrame ;
+    frame.mFrameType = remote ? remoteFrame : dataFrame ;
+    frame.mAckSlot = acked ? ACK_SLOT_DOMINANT : ACK_SLOT_RECESSIVE ;
+    frame.mFD = false ;
+    frame.mBRS = false ;
+    frame.mESI = false ;
+    ok = validIdentifier (frame.mIdentifier, frame.mFrameFormat) ;
+  }
+//--- A remote frame carries its DLC only; a DLC above 8 means 8 data bytes
+  if (ok && remote) {
+    ok = frame.mDataLength == 0 ;
+    frame.mDataLength = uint8_t ((dataCodeLength > 8) ? 8 : dataCodeLength) ;
+  }else if (ok) {
+    ok = frame.mDataLength == ((dataCodeLength > 8) ? 8 : dataCodeLength) ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANLogReplay::parseLine (const char * inLine,
+                              const char * inEnd,
+                              CANReplayMessage & outMessage) {
+  while ((inEnd > inLine) && ((inEnd [-1] == '\r') || (inEnd [-1] == ' '))) {
+    inEnd -= 1 ;
+  }
+  bool ok = inEnd > inLine ;
+  if (ok && (*inLine == '(')) {
+    ok = parseCandumpLine (inLine, inEnd, outMessage) ;
+  }else if (ok) {
+    ok = parseCSVLine (inLine, inEnd, outMessage) ; // Also rejects the header and comments
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANLogReplay
+//----------------------------------------------------------------------------------------
+
+CANLogReplay::CANLogReplay (void) :
+mFile (NULL),
+mChunk (),
+mChunkPosition (0),
+mChunkLength (0),
+mEndOfFile (false) {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANLogReplay::~ CANLogReplay (void) {
+  close () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANLogReplay::open (const std::string & inPath, std::string & outError) {
+  close () ;
+  mFile = fopen (inPath.c_str (), "rb") ;
+  const bool ok = mFile != NULL ;
+  if (ok) {
+    mChunk.resize (LOG_REPLAY_CHUNK_SIZE) ;
+    mChunkPosition = 0 ;
+    mChunkLength = 0 ;
+    mEndOfFile = false ;
+  }else{
+    outError = inPath + ": " + strerror (errno) ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANLogReplay::close (void) {
+  if (mFile != NULL) {
+    fclose (mFile) ;
+    mFile = NULL ;
+  }
+  std::vector <char> ().swap (mChunk) ;
+}
+
+//----------------------------------------------------------------------------------------
+// The unparsed tail of the chunk is moved to its start before the next read; a line that
+// does not fit in a chunk is dropped.
+
+bool CANLogReplay::nextLine (const char * & outLine, const char * & outEnd) {
+  bool found = false ;
+  bool dropping = false ;
+  while (!found && (mFile != NULL)) {
+    const char * first = mChunk.data () + mChunkPosition ;
+    const char * last = mChunk.data () + mChunkLength ;
+    const char * newLine = (const char *) memchr (first, '\n', size_t (last - first)) ;
+    if (newLine != NULL) {
+      mChunkPosition = size_t (newLine + 1 - mChunk.data ()) ;
+      found = !dropping ;
+      dropping = false ;
+      outLine = first ;
+      outEnd = newLine ;
+    }else if (mEndOfFile) {
+      mChunkPosition = mChunkLength ;
+      found = !dropping && (last > first) ;
+      outLine = first ;
+      outEnd = last ;
+      if (!found) {
+        close () ;
+      }
+    }else{
+      if ((mChunkPosition == 0) && (mChunkLength == mChunk.size ())) { // Line longer than a chunk
+        dropping = true ;
+        mChunkLength = 0 ;
+      }
+      memmove (mChunk.data (), first, mChunkLength - mChunkPosition) ;
+      mChunkLength -= mChunkPosition ;
+      mChunkPosition = 0 ;
+      const size_t requested = mChunk.size () - mChunkLength ;
+      const size_t readLength = fread (mChunk.data () + mChunkLength, 1, requested, mFile) ;
+      mChunkLength += readLength ;
+      mEndOfFile = readLength < requested ; // End of file or read error
+    }
+  }
+  return found ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANLogReplay::next (CANReplayMessage & outMessage) {
+  bool found = false ;
+  const char * line = NULL ;
+  const char * end = NULL ;
+  while (!found && nextLine (line, end)) {
+    found = parseLine (line, end, outMessage) ;
+  }
+  return found ;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,74 @@
+#ifndef CAN_LOG_REPLAY
+#define CAN_LOG_REPLAY
+
+//----------------------------------------------------------------------------------------
+// Log replay: messages of a recorded log are read one at a time, for the simulator to
+// re-encode them at their original time stamps. The file is read in chunks of
+// LOG_REPLAY_CHUNK_SIZE bytes, so that memory does not grow with the log size. Accepted
+// lines, the format being detected line by line:
+//   - candump -L: (SECONDS) INTERFACE IDF#DATA, IDF#R or IDF#RDLC; a 3-digit identifier
+//     is standard, an 8-digit one extended;
+//   - CSV, as written by the live log (see CANLiveLog.h): SECONDS,IDF,EXTENDED,REMOTE,
+//     FD,BRS,ESI,DLC,DATA,ACKED.
+// The simulator generates classic frames only: CAN FD messages are skipped, as are empty
+// lines, the CSV header, comments (#) and malformed lines. Does not depend on the Saleae
+// SDK.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameBitsGenerator.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+static const size_t LOG_REPLAY_CHUNK_SIZE = 1 << 20 ; // Bytes per read
+
+//----------------------------------------------------------------------------------------
+
+class CANReplayMessage {
+  public: uint64_t mNanoSeconds ; // Time stamp of the log
+  public: CANFrameDescriptor mFrame ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANLogReplay {
+
+  public: CANLogReplay (void) ;
+
+  public: ~ CANLogReplay (void) ;
+
+//--- Closes the current log, then opens inPath; on failure, outError is set
+  public: bool open (const std::string & inPath, std::string & outError) ;
+
+  public: void close (void) ;
+
+  public: inline bool isOpen (void) const { return mFile != NULL ; }
+
+//--- Returns false at the end of the log (or on read error), and then closes it
+  public: bool next (CANReplayMessage & outMessage) ;
+
+//--- Returns false if the line holds no classic CAN message
+  private: static bool parseLine (const char * inLine,
+                                  const char * inEnd,
+                                  CANReplayMessage & outMessage) ;
+
+//--- Next complete line of the chunk buffer, reading a chunk when needed
+  private: bool nextLine (const char * & outLine, const char * & outEnd) ;
+
+  private: FILE * mFile ;
+  private: std::vector <char> mChunk ;
+  private: size_t mChunkPosition ; // First unparsed byte
+  private: size_t mChunkLength ;
+  private: bool mEndOfFile ;
+
+//--- No copy
+  private: CANLogReplay (const CANLogReplay &) ;
+  private: CANLogReplay & operator = (const CANLogReplay &) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_LOG_REPLAY
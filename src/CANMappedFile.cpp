@@ -0,0 +1,112 @@
+#include "CANMappedFile.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------------
+
+CANMappedFile::CANMappedFile (void) :
+mSize (0),
+mData (NULL),
+#ifdef _WIN32
+mFileHandle (NULL),
+mMappingHandle (NULL) {
+#else
+mFileDescriptor (-1) {
+#endif
+}
+
+//----------------------------------------------------------------------------------------
+
+CANMappedFile::~ CANMappedFile (void) {
+  close () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANMappedFile::open (const std::string & inPath, std::string & outError) {
+  close () ;
+#ifdef _WIN32
+  HANDLE file = CreateFileA (inPath.c_str (), GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) ;
+  if (file == INVALID_HANDLE_VALUE) {
+    outError = inPath + ": CreateFile failed, error " + std::to_string (GetLastError ()) ;
+    return false ;
+  }
+  LARGE_INTEGER fileSize ;
+  if (!GetFileSizeEx (file, &fileSize) || (fileSize.QuadPart == 0)) {
+    outError = inPath + ": empty file" ;
+    CloseHandle (file) ;
+    return false ;
+  }
+  HANDLE mappingHandle = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL) ;
+  if (mappingHandle == NULL) {
+    outError = inPath + ": CreateFileMapping failed, error " + std::to_string (GetLastError ()) ;
+    CloseHandle (file) ;
+    return false ;
+  }
+  const void * mapping = MapViewOfFile (mappingHandle, FILE_MAP_READ, 0, 0, 0) ;
+  if (mapping == NULL) {
+    outError = inPath + ": MapViewOfFile failed, error " + std::to_string (GetLastError ()) ;
+    CloseHandle (mappingHandle) ;
+    CloseHandle (file) ;
+    return false ;
+  }
+  mFileHandle = file ;
+  mMappingHandle = mappingHandle ;
+  mSize = size_t (fileSize.QuadPart) ;
+#else
+  const int fd = ::open (inPath.c_str (), O_RDONLY) ;
+  if (fd < 0) {
+    outError = inPath + ": " + strerror (errno) ;
+    return false ;
+  }
+  struct stat status ;
+  if ((fstat (fd, &status) != 0) || (status.st_size == 0)) {
+    outError = inPath + ": empty file" ;
+    ::close (fd) ;
+    return false ;
+  }
+  const void * mapping = mmap (NULL, size_t (status.st_size), PROT_READ, MAP_SHARED, fd, 0) ;
+  if (mapping == MAP_FAILED) {
+    outError = inPath + ": mmap: " + strerror (errno) ;
+    ::close (fd) ;
+    return false ;
+  }
+  mFileDescriptor = fd ;
+  mSize = size_t (status.st_size) ;
+#endif
+  mData = static_cast <const uint8_t *> (mapping) ;
+  return true ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMappedFile::close (void) {
+  if (mData != NULL) {
+  #ifdef _WIN32
+    UnmapViewOfFile (mData) ;
+    CloseHandle (HANDLE (mMappingHandle)) ;
+    CloseHandle (HANDLE (mFileHandle)) ;
+    mMappingHandle = NULL ;
+    mFileHandle = NULL ;
+  #else
+    munmap (const_cast <uint8_t *> (mData), mSize) ;
+    ::close (mFileDescriptor) ;
+    mFileDescriptor = -1 ;
+  #endif
+    mSize = 0 ;
+    mData = NULL ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
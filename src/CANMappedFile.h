@@ -0,0 +1,48 @@
+#ifndef CAN_MAPPED_FILE
+#define CAN_MAPPED_FILE
+
+//----------------------------------------------------------------------------------------
+// Read only mapping of a whole file (mmap, or a file mapping on Windows), shared by the
+// readers of the columnar message file and of capture exports. Does not depend on the
+// Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+
+class CANMappedFile {
+
+  public: CANMappedFile (void) ;
+
+  public: ~ CANMappedFile (void) ;
+
+//--- Closes the current mapping, then maps inPath; on failure, outError is set. An empty
+//    file cannot be mapped.
+  public: bool open (const std::string & inPath, std::string & outError) ;
+
+  public: void close (void) ;
+
+  public: inline bool isOpen (void) const { return mData != NULL ; }
+  public: inline const uint8_t * data (void) const { return mData ; }
+  public: inline size_t size (void) const { return mSize ; }
+
+  private: size_t mSize ;
+  private: const uint8_t * mData ;
+#ifdef _WIN32
+  private: void * mFileHandle ;
+  private: void * mMappingHandle ;
+#else
+  private: int mFileDescriptor ;
+#endif
+
+//--- No copy
+  private: CANMappedFile (const CANMappedFile &) ;
+  private: CANMappedFile & operator = (const CANMappedFile &) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_MAPPED_FILE
@@ -0,0 +1,173 @@
+#include "CANMessageStore.h"
+
+//----------------------------------------------------------------------------------------
+//   Patterns
+//----------------------------------------------------------------------------------------
+
+static void skipSpaces (const std::string & inText, size_t & ioIndex) {
+  while ((ioIndex < inText.size ()) && ((inText [ioIndex] == ' ') || (inText [ioIndex] == '\t'))) {
+    ioIndex += 1 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool parsePattern (const std::string & inText,
+                          size_t & ioIndex,
+                          CANPayloadPattern & outPattern) {
+  outPattern.mIdentifierKey = 0 ;
+  outPattern.mIdentifierMask = 0 ;
+  outPattern.mPayload = 0 ;
+  outPattern.mPayloadMask = 0 ;
+  outPattern.mMinimumLength = 0 ;
+  bool ok = true ;
+//--- Identifier
+  if (inText [ioIndex] == '*') {
+    ioIndex += 1 ;
+  }else{
+    uint64_t identifier = 0 ;
+    uint32_t digitCount = 0 ;
+    ok = parseHexDigits (inText, ioIndex, 16, identifier, digitCount) ;
+    const bool extended = digitCount > 3 ;
+    const uint32_t identifierBits = extended ? 0x1FFFFFFFU : 0x7FFU ;
+    ok = ok && (identifier <= identifierBits) ;
+    uint64_t mask = identifierBits ;
+    if (ok && (ioIndex < inText.size ()) && (inText [ioIndex] == '/')) {
+      ioIndex += 1 ;
+      ok = parseHexDigits (inText, ioIndex, 16, mask, digitCount) && (mask <= identifierBits) ;
+    }
+    outPattern.mIdentifierKey = CANErrorCounters::identifierKey (uint32_t (identifier & mask), extended) ;
+    outPattern.mIdentifierMask = CANErrorCounters::identifierKey (uint32_t (mask), true) ;
+  }
+//--- Payload
+  skipSpaces (inText, ioIndex) ;
+  if (ok && (ioIndex < inText.size ()) && (inText [ioIndex] != ';')) {
+    uint64_t payload = 0 ;
+    uint32_t digitCount = 0 ;
+    ok = parseHexDigits (inText, ioIndex, 16, payload, digitCount) && ((digitCount % 2) == 0) ;
+    const uint32_t byteCount = digitCount / 2 ;
+    uint64_t mask = (byteCount == 8) ? ~ uint64_t (0) : ((uint64_t (1) << (8 * byteCount)) - 1) ;
+    if (ok && (ioIndex < inText.size ()) && (inText [ioIndex] == '/')) {
+      ioIndex += 1 ;
+      ok = parseHexDigits (inText, ioIndex, 16, mask, digitCount) && (digitCount == (2 * byteCount)) ;
+    }
+    if (ok) {
+      const uint32_t shift = 8 * (8 - byteCount) ;
+      outPattern.mPayloadMask = (shift == 64) ? 0 : (mask << shift) ;
+      outPattern.mPayload = (shift == 64) ? 0 : ((payload & mask) << shift) ;
+      for (uint32_t i=0 ; i<8 ; i++) { // Last masked byte
+        if (((outPattern.mPayloadMask >> (56 - 8 * i)) & 0xFF) != 0) {
+          outPattern.mMinimumLength = uint8_t (i + 1) ;
+        }
+      }
+    }
+  }
+  skipSpaces (inText, ioIndex) ;
+  return ok && ((ioIndex == inText.size ()) || (inText [ioIndex] == ';')) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool parsePayloadPatterns (const std::string & inText,
+                           std::vector <CANPayloadPattern> & outPatterns) {
+  outPatterns.clear () ;
+  bool ok = true ;
+  size_t idx = 0 ;
+  while (ok && (idx < inText.size ())) {
+    skipSpaces (inText, idx) ;
+    if (idx == inText.size ()) {
+      // End
+    }else if (inText [idx] == ';') {
+      idx += 1 ;
+    }else{
+      CANPayloadPattern pattern ;
+      ok = parsePattern (inText, idx, pattern) ;
+      if (ok) {
+        outPatterns.push_back (pattern) ;
+      }
+    }
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANMessageStore
+//----------------------------------------------------------------------------------------
+
+CANMessageStore::CANMessageStore (void) :
+mIdentifierKeys (),
+mDataLengths (),
+mPayloadHigh (),
+mPayloadLow (),
+mStartSampleNumbers (),
+mFrameIndexes () {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMessageStore::clear (void) {
+  mIdentifierKeys.clear () ;
+  mDataLengths.clear () ;
+  mPayloadHigh.clear () ;
+  mPayloadLow.clear () ;
+  mStartSampleNumbers.clear () ;
+  mFrameIndexes.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMessageStore::append (const CANDecodedMessage & inMessage, const uint64_t inFrameIndex) {
+  uint64_t payload = 0 ;
+  for (uint32_t i=0 ; (i<inMessage.mDataLength) && (i<8) ; i++) {
+    payload |= uint64_t (inMessage.mData [i]) << (56 - 8 * i) ;
+  }
+  mIdentifierKeys.push_back (CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended)) ;
+  mDataLengths.push_back (inMessage.mDataLength) ;
+  mPayloadHigh.push_back (uint32_t (payload >> 32)) ;
+  mPayloadLow.push_back (uint32_t (payload)) ;
+  mStartSampleNumbers.push_back (inMessage.mStartSampleNumber) ;
+  mFrameIndexes.push_back (inFrameIndex) ;
+}
+
+//----------------------------------------------------------------------------------------
+// Rows are compared by blocks. Compare loops have no branch and work on contiguous 32-bit
+// (or 8-bit) columns, so the compiler vectorizes them at -O3 (SSE2 on x86-64, NEON on
+// arm64); only the match flags of the block are then scanned.
+
+void CANMessageStore::search (const CANPayloadPattern & inPattern,
+                              const size_t inFirstRow,
+                              const size_t inEndRow,
+                              std::vector <size_t> & ioRows) const {
+  const size_t BLOCK_SIZE = CAN_MESSAGE_STORE_BLOCK_ROW_COUNT ;
+  const uint32_t identifierKey = inPattern.mIdentifierKey ;
+  const uint32_t identifierMask = inPattern.mIdentifierMask ;
+  const uint32_t highValue = uint32_t (inPattern.mPayload >> 32) ;
+  const uint32_t highMask = uint32_t (inPattern.mPayloadMask >> 32) ;
+  const uint32_t lowValue = uint32_t (inPattern.mPayload) ;
+  const uint32_t lowMask = uint32_t (inPattern.mPayloadMask) ;
+  const uint8_t minimumLength = inPattern.mMinimumLength ;
+  const size_t endRow = (inEndRow < size ()) ? inEndRow : size () ;
+  uint8_t match [BLOCK_SIZE] ;
+  for (size_t blockStart = inFirstRow ; blockStart < endRow ; blockStart += BLOCK_SIZE) {
+    const size_t count = ((endRow - blockStart) < BLOCK_SIZE) ? (endRow - blockStart) : BLOCK_SIZE ;
+    const uint32_t * keys = mIdentifierKeys.data () + blockStart ;
+    const uint32_t * high = mPayloadHigh.data () + blockStart ;
+    const uint32_t * low = mPayloadLow.data () + blockStart ;
+    const uint8_t * lengths = mDataLengths.data () + blockStart ;
+    for (size_t i=0 ; i<count ; i++) {
+      match [i] = uint8_t (((keys [i] & identifierMask) == identifierKey)
+                         & ((high [i] & highMask) == highValue)
+                         & ((low [i] & lowMask) == lowValue)) ;
+    }
+    for (size_t i=0 ; i<count ; i++) {
+      match [i] &= uint8_t (lengths [i] >= minimumLength) ;
+    }
+    for (size_t i=0 ; i<count ; i++) {
+      if (match [i] != 0) {
+        ioRows.push_back (blockStart + i) ;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+#ifndef CAN_MESSAGE_STORE
+#define CAN_MESSAGE_STORE
+
+//----------------------------------------------------------------------------------------
+// Columnar store of decoded messages (identifier, data length, first 8 data bytes as two
+// 32-bit columns, start sample, result frame index), and identifier / payload pattern
+// search over it. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// Payloads are packed as the mData2 of CAN_MESSAGE_RESULT frames: D0 in bits 56-63. A
+// message matches if (key & mIdentifierMask) == mIdentifierKey, (payload & mPayloadMask)
+// == mPayload, and it has at least mMinimumLength data bytes.
+
+class CANPayloadPattern {
+  public: uint32_t mIdentifierKey ; // See CANErrorCounters::identifierKey
+  public: uint32_t mIdentifierMask ;
+  public: uint64_t mPayload ;
+  public: uint64_t mPayloadMask ;
+  public: uint8_t mMinimumLength ;
+} ;
+
+//----------------------------------------------------------------------------------------
+// Patterns separated by semicolons: "IDF[/MASK] [DATA[/MASK]]", hexadecimal, "*" is any
+// identifier; more than 3 identifier digits is an extended identifier. DATA is D0 first,
+// up to 8 bytes; its mask defaults to all bits of the given bytes. "1A0 00000004/00000004"
+// is bit 2 of D3 set in standard frame 0x1A0. Returns false on syntax error.
+
+bool parsePayloadPatterns (const std::string & inText,
+                           std::vector <CANPayloadPattern> & outPatterns) ;
+
+//----------------------------------------------------------------------------------------
+// Frame index of a message stored without its own result frame (dropped from results)
+
+static const uint64_t CAN_MESSAGE_STORE_NO_FRAME = UINT64_MAX ;
+
+//----------------------------------------------------------------------------------------
+// search compares rows by blocks of this size
+
+static const size_t CAN_MESSAGE_STORE_BLOCK_ROW_COUNT = 256 ;
+
+//----------------------------------------------------------------------------------------
+
+class CANMessageStore {
+
+  public: CANMessageStore (void) ;
+
+  public: void clear (void) ;
+
+  public: void append (const CANDecodedMessage & inMessage, const uint64_t inFrameIndex) ;
+
+  public: inline size_t size (void) const { return mIdentifierKeys.size () ; }
+
+  public: inline uint32_t identifierKey (const size_t inRow) const { return mIdentifierKeys [inRow] ; }
+  public: inline uint8_t dataLength (const size_t inRow) const { return mDataLengths [inRow] ; }
+  public: inline uint64_t payload (const size_t inRow) const {
+    return (uint64_t (mPayloadHigh [inRow]) << 32) | mPayloadLow [inRow] ;
+  }
+  public: inline uint64_t startSampleNumber (const size_t inRow) const { return mStartSampleNumbers [inRow] ; }
+  public: inline uint64_t frameIndex (const size_t inRow) const { return mFrameIndexes [inRow] ; }
+
+//--- Appends the matching rows of [inFirstRow, inEndRow) to ioRows, in increasing order
+  public: void search (const CANPayloadPattern & inPattern,
+                       const size_t inFirstRow,
+                       const size_t inEndRow,
+                       std::vector <size_t> & ioRows) const ;
+
+  private: std::vector <uint32_t> mIdentifierKeys ;
+  private: std::vector <uint8_t> mDataLengths ;
+  private: std::vector <uint32_t> mPayloadHigh ; // D0 ... D3
+  private: std::vector <uint32_t> mPayloadLow ; // D4 ... D7
+  private: std::vector <uint64_t> mStartSampleNumbers ;
+  private: std::vector <uint64_t> mFrameIndexes ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_MESSAGE_STORE
@@ -3,6 +3,7 @@
 
 #include <AnalyzerChannelData.h>
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 
@@ -13,7 +14,48 @@
 CANMolinaroAnalyzer::CANMolinaroAnalyzer () :
 Analyzer2 (),
 mSettings (new CANMolinaroAnalyzerSettings ()),
-mSimulationInitilized (false) {
+mSimulationInitilized (false),
+mDecoder (this),
+mOneFramePerMessage (false),
+mPendingFieldFrames (),
+mPendingMessage (),
+mHasPendingMessage (false),
+mMessageFields (),
+mISOTP (this),
+mJ1939 (this),
+mPayloadPatterns (),
+mMessageStore (),
+mMessageFrameIndex (0),
+mMatchingRows (),
+mMatches (),
+mLiveTap (),
+mLiveLog (),
+mLiveLogDroppedCountAtLastSummary (0),
+mLiveLogErrorReported (false),
+mGateway (this),
+mGatewayDecoder (&mGateway),
+mGatewayChannel (NULL),
+mGatewayBitStart (0),
+mPhaseErrors (this),
+mPeriods (this),
+mResponseTimes (this),
+mGlitchCount (0),
+mGlitchCountAtLastSummary (0),
+mChangedMessagesOnly (false),
+mDeltaFilter (this),
+mDetailPolicy (),
+mFrameInProgress (false),
+mReducedFrame (false),
+mFullDetailFrame (true),
+mPendingMarks (),
+mTrafficMessageCount (0),
+mTrafficMessageCountAtLastSummary (0),
+mTrafficDataByteCount (0),
+mTrafficDataByteCountAtLastSummary (0),
+mNextSummarySampleNumber (0),
+mErrorCountAtLastSummary (0),
+mInstrumentation (),
+mFirstSampleNumber (0) {
   SetAnalyzerSettings (mSettings.get()) ;
   UseFrameV2 () ;
 }
@@ -44,28 +86,242 @@ void CANMolinaroAnalyzer::SetupResults () {
 void CANMolinaroAnalyzer::WorkerThread (void) {
   const bool inverted = mSettings->inverted () ;
   mSampleRateHz = GetSampleRate () ;
+  mResults->clearTextCache () ;
   AnalyzerChannelData * serial = GetAnalyzerChannelData (mSettings->mInputChannel) ;
 //--- Sample settings
   const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
+  const U32 dataSamplesPerBit = mSampleRateHz / mSettings->dataBitRate () ;
+  mDecoder.setCANFD (mSettings->canFD (), (dataSamplesPerBit > 0) ? dataSamplesPerBit : 1) ;
+//--- Decode window: jump to its start, the decoder starts at a bus idle
+  uint64_t windowEndSampleNumber = UINT64_MAX ;
+  if (!mSettings->decodeWindow ().wholeCapture ()) {
+    uint64_t windowStartSampleNumber ;
+    mSettings->decodeWindow ().resolve (mSampleRateHz,
+                                        serial->GetSampleNumber (),
+                                        GetTriggerSample (),
+                                        windowStartSampleNumber,
+                                        windowEndSampleNumber) ;
+    if (windowStartSampleNumber > serial->GetSampleNumber ()) {
+      serial->AdvanceToAbsPosition (windowStartSampleNumber) ;
+    }
+    synchronizeToBusIdle (serial, inverted, samplesPerBit) ;
+  }
 //--- Synchronize to recessive level
   if (serial->GetBitState () == (inverted ? BIT_HIGH : BIT_LOW)) {
     serial->AdvanceToNextEdge () ;
   }
 //--- Initial bit state
-  mFrameFieldEngineState = IDLE ;
-  mPreviousBit = (serial->GetBitState () == BIT_HIGH) ^ inverted ;
-  mUnstuffingActive = false ;
+  mDecoder.reset (samplesPerBit, (serial->GetBitState () == BIT_HIGH) ^ inverted) ;
+  mNextSummarySampleNumber = serial->GetSampleNumber () + mSampleRateHz ;
+  mErrorCountAtLastSummary = 0 ;
+  mOneFramePerMessage = mSettings->oneFramePerMessage () ;
+  mPendingFieldFrames.clear () ;
+  mHasPendingMessage = false ;
+  mChangedMessagesOnly = mSettings->changedMessagesOnly () ;
+  mDeltaFilter.clear () ;
+  mDetailPolicy.configure (mSettings->detailLevel (),
+                           mSampleRateHz,
+                           serial->GetSampleNumber (),
+                           mSettings->fullDetailSeconds (),
+                           mSettings->errorDetailMilliSeconds (),
+                           mSettings->fullDetailIdentifierKeys ()) ;
+  endFrame () ;
+  mTrafficMessageCount = 0 ;
+  mTrafficMessageCountAtLastSummary = 0 ;
+  mTrafficDataByteCount = 0 ;
+  mTrafficDataByteCountAtLastSummary = 0 ;
+  mISOTP.configure (mSettings->isotpAddressPairs (), mSampleRateHz) ;
+  mJ1939.configure (mSettings->j1939 (), mSampleRateHz, serial->GetSampleNumber ()) ;
+  mPayloadPatterns = mSettings->payloadPatterns () ;
+  mMessageStore.clear () ;
+  mInstrumentation.reset () ;
+  mFirstSampleNumber = serial->GetSampleNumber () ;
+  if (mSettings->liveTapName ().empty ()) {
+    mLiveTap.close () ;
+  }else{
+    std::string error ;
+    if (!mLiveTap.open (mSettings->liveTapName (), mSampleRateHz, error)) {
+      FrameV2 frameV2 ;
+      frameV2.AddString ("Name", mSettings->liveTapName ().c_str ()) ;
+      frameV2.AddString ("Error", error.c_str ()) ;
+      addFrameV2 (frameV2, "Live tap error", mFirstSampleNumber, mFirstSampleNumber) ;
+    }
+  }
+  mLiveLogDroppedCountAtLastSummary = 0 ;
+  mLiveLogErrorReported = false ;
+  if (mSettings->liveLogPath ().empty ()) {
+    mLiveLog.stop () ;
+  }else{
+    std::string error ;
+    const uint64_t rotationBytes = uint64_t (mSettings->liveLogRotationMegaBytes ()) * 1024 * 1024 ;
+    if (!mLiveLog.start (mSettings->liveLogPath (), mSettings->liveLogFormat (), rotationBytes, mSampleRateHz, error)) {
+      FrameV2 frameV2 ;
+      frameV2.AddString ("File", mSettings->liveLogPath ().c_str ()) ;
+      frameV2.AddString ("Error", error.c_str ()) ;
+      addFrameV2 (frameV2, "Live log error", mFirstSampleNumber, mFirstSampleNumber) ;
+    }
+  }
+//--- Gateway egress channel: starts at a bus idle, decoded behind the input channel
+  mGatewayChannel = NULL ;
+  mGateway.configure (mSettings->gatewayEnabled (),
+                      mSampleRateHz,
+                      mSettings->gatewayWindowMilliSeconds (),
+                      mSettings->gatewayRemaps ()) ;
+  if (mGateway.enabled ()) {
+    const U32 gatewaySamplesPerBit = mSampleRateHz / mSettings->gatewayBitRate () ;
+    const U32 gatewayDataSamplesPerBit = mSampleRateHz / mSettings->gatewayDataBitRate () ;
+    mGatewayChannel = GetAnalyzerChannelData (mSettings->mGatewayChannel) ;
+    mGatewayDecoder.setCANFD (mSettings->canFD (), (gatewayDataSamplesPerBit > 0) ? gatewayDataSamplesPerBit : 1) ;
+    if (mGatewayChannel->GetSampleNumber () < serial->GetSampleNumber ()) {
+      mGatewayChannel->AdvanceToAbsPosition (serial->GetSampleNumber ()) ;
+    }
+    synchronizeToBusIdle (mGatewayChannel, inverted, gatewaySamplesPerBit) ;
+    mGatewayDecoder.reset (gatewaySamplesPerBit, (mGatewayChannel->GetBitState () == BIT_HIGH) ^ inverted) ;
+    mGatewayBitStart = mGatewayChannel->GetSampleNumber () ;
+  }
+//--- Phase errors
+  mPhaseErrors.configure (mSettings->phaseErrorMode (), mSettings->phaseWarningPercent ()) ;
+//--- Period statistics
+  mPeriods.configure (mSettings->periodStatistics (), mSampleRateHz) ;
+//--- Response time analysis, at the nominal bit rate
+  mResponseTimes.configure (mSettings->responseTimeAnalysis (), mSampleRateHz, samplesPerBit) ;
+//--- Glitch filter: minimum pulse width, relative to the shortest bit
+  const U32 shortestBitSampleCount = (mSettings->canFD () && (dataSamplesPerBit < samplesPerBit))
+    ? dataSamplesPerBit
+    : samplesPerBit
+  ;
+  const U64 minimumPulseWidth = U64 (shortestBitSampleCount) * mSettings->glitchFilterPercent () / 100 ;
+  mGlitchCount = 0 ;
+  mGlitchCountAtLastSummary = 0 ;
   while (1) {
     const bool currentBitValue = (serial->GetBitState () == BIT_HIGH) ^ inverted ;
     const U64 start = serial->GetSampleNumber () ;
-    const U64 nextEdge = serial->GetSampleOfNextEdge () ;
-    const U64 bitCount = (nextEdge - start + samplesPerBit / 2) / samplesPerBit ;
-    for (U64 i=0 ; i<bitCount ; i++) {
-      enterBit (currentBitValue, start + i * samplesPerBit + samplesPerBit / 2) ;
+    if (start >= windowEndSampleNumber) {
+      endOfWindow (serial, start, inverted) ;
     }
-    mResults->CommitResults () ;
-    serial->AdvanceToNextEdge () ;
+    if (mGatewayChannel != NULL) {
+      decodeGatewayChannel (start, inverted) ;
+    }
+    U64 nextEdge ;
+    { InstrumentationTimerScope scope (mInstrumentation, INSTR_CHANNEL_DATA_TIME) ;
+      nextEdge = serial->GetSampleOfNextEdge () ;
+    }
+    mInstrumentation.count (INSTR_EDGES) ;
+    if (minimumPulseWidth > 0) {
+      nextEdge = skipGlitches (serial, nextEdge, minimumPulseWidth) ;
+    }
+  //--- Bits of the level (hard synchronization at its start edge), up to the window end
+    const U64 levelEnd = (nextEdge < windowEndSampleNumber) ? nextEdge : windowEndSampleNumber ;
+    uint64_t bitStart = start ;
+    mInstrumentation.count (INSTR_BITS, mDecoder.enterLevel (currentBitValue, bitStart, levelEnd)) ;
+    if (levelEnd < nextEdge) {
+      endOfWindow (serial, levelEnd, inverted) ;
+    }
+  //--- bitStart is the bit boundary expected by the decoder: the phase error of the edge
+    if (mPhaseErrors.enabled ()) {
+      mPhaseErrors.enterEdge (nextEdge, S64 (nextEdge) - S64 (bitStart), mDecoder.samplesPerBit ()) ;
+    }
+    commitResults () ;
+    if (minimumPulseWidth == 0) { // Otherwise, skipGlitches has advanced to nextEdge
+      InstrumentationTimerScope scope (mInstrumentation, INSTR_CHANNEL_DATA_TIME) ;
+      serial->AdvanceToNextEdge () ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Bus integration (ISO 11898-1): a frame can start only after 11 consecutive recessive
+// bits. The channel is left in such a sequence, the decoder starts in its idle state.
+
+void CANMolinaroAnalyzer::synchronizeToBusIdle (AnalyzerChannelData * inChannel,
+                                                const bool inInverted,
+                                                const U32 inSamplesPerBit) {
+  const U32 idleSampleCount = 11 * inSamplesPerBit ;
+  bool found = false ;
+  while (!found) {
+    const bool recessive = (inChannel->GetBitState () == BIT_HIGH) ^ inInverted ;
+    found = recessive && !inChannel->WouldAdvancingCauseTransition (idleSampleCount) ;
+    if (!found) {
+      inChannel->AdvanceToNextEdge () ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// The egress channel is decoded up to inSampleNumber, the start of the input channel
+// level about to be decoded: a forward is entered after the message it forwards. Bits of
+// the current level are entered up to inSampleNumber, without waiting for its end, so that
+// the end of frame of the last egress message is not delayed until the next one.
+
+void CANMolinaroAnalyzer::decodeGatewayChannel (const U64 inSampleNumber, const bool inInverted) {
+  bool transition = true ;
+  while (transition) {
+    transition = mGatewayChannel->WouldAdvancingToAbsPositionCauseTransition (inSampleNumber) ;
+    const U64 levelEnd = transition ? mGatewayChannel->GetSampleOfNextEdge () : inSampleNumber ;
+    const bool bitValue = (mGatewayChannel->GetBitState () == BIT_HIGH) ^ inInverted ;
+    mGatewayDecoder.enterLevel (bitValue, mGatewayBitStart, levelEnd) ;
+    if (transition) {
+      mGatewayChannel->AdvanceToNextEdge () ;
+      mGatewayBitStart = mGatewayChannel->GetSampleNumber () ;
+    }
+  }
+  mGateway.advance (inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+// At the decode window end, the frame in progress is reported as truncated
+// (CANFrameDecoder::endOfSamples), pending rows are flushed and the summaries are sent.
+// Does not return (see ignoreRemainingSamples).
+
+void CANMolinaroAnalyzer::endOfWindow (AnalyzerChannelData * inChannel,
+                                       const U64 inWindowEndSampleNumber,
+                                       const bool inInverted) {
+  mDecoder.endOfSamples (inWindowEndSampleNumber) ;
+  if (mGatewayChannel != NULL) {
+    decodeGatewayChannel (inWindowEndSampleNumber, inInverted) ;
+    mGatewayDecoder.endOfSamples (inWindowEndSampleNumber) ;
+  }
+  flushPendingMessage (true) ;
+  flushPendingFieldFrames () ;
+  addSummaries (inWindowEndSampleNumber) ;
+  ignoreRemainingSamples (inChannel) ;
+}
+
+//----------------------------------------------------------------------------------------
+// After the decode window, the channel is advanced one second at a time without being
+// decoded, until the analysis is terminated by the host.
+
+void CANMolinaroAnalyzer::ignoreRemainingSamples (AnalyzerChannelData * inChannel) {
+  commitResults () ;
+  while (1) {
+    inChannel->AdvanceToAbsPosition (inChannel->GetSampleNumber () + mSampleRateHz) ;
+    ReportProgress (inChannel->GetSampleNumber ()) ;
+    CheckIfThreadShouldExit () ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// inNextEdge ends the current level. The pulse that follows it is a glitch if it is
+// shorter than inMinimumPulseWidth: the level is then unchanged, and the next edge is
+// examined. Returns the first edge followed by a pulse wide enough, the channel is left
+// at this edge. The level before it has to be known before its bits are sampled, so
+// decoding lags by one pulse.
+
+U64 CANMolinaroAnalyzer::skipGlitches (AnalyzerChannelData * inChannel,
+                                       const U64 inNextEdge,
+                                       const U64 inMinimumPulseWidth) {
+  InstrumentationTimerScope scope (mInstrumentation, INSTR_CHANNEL_DATA_TIME) ;
+  U64 edge = inNextEdge ;
+  inChannel->AdvanceToNextEdge () ;
+  U64 pulseEnd = inChannel->GetSampleOfNextEdge () ;
+  while ((pulseEnd - edge) < inMinimumPulseWidth) {
+    mGlitchCount += 1 ;
+    inChannel->AdvanceToNextEdge () ; // Back to the current level
+    edge = inChannel->GetSampleOfNextEdge () ;
+    inChannel->AdvanceToNextEdge () ;
+    pulseEnd = inChannel->GetSampleOfNextEdge () ;
   }
+  return edge ;
 }
 
 //----------------------------------------------------------------------------------------
@@ -91,7 +347,19 @@ U32 CANMolinaroAnalyzer::GenerateSimulationData (U64 minimum_sample_index,
 //----------------------------------------------------------------------------------------
 
 U32 CANMolinaroAnalyzer::GetMinimumSampleRateHz () {
-  return mSettings->mBitRate * 5 ;
+  U32 fastestBitRate = mSettings->mBitRate ;
+  if (mSettings->canFD () && (mSettings->dataBitRate () > fastestBitRate)) {
+    fastestBitRate = mSettings->dataBitRate () ;
+  }
+  if (mSettings->gatewayEnabled ()) {
+    if (mSettings->gatewayBitRate () > fastestBitRate) {
+      fastestBitRate = mSettings->gatewayBitRate () ;
+    }
+    if (mSettings->canFD () && (mSettings->gatewayDataBitRate () > fastestBitRate)) {
+      fastestBitRate = mSettings->gatewayDataBitRate () ;
+    }
+  }
+  return fastestBitRate * 5 ;
 }
 
 //----------------------------------------------------------------------------------------
@@ -119,433 +387,906 @@ void DestroyAnalyzer (Analyzer* analyzer) {
 }
 
 //----------------------------------------------------------------------------------------
-//  CAN FRAME DECODER
-//----------------------------------------------------------------------------------------
-
-void CANMolinaroAnalyzer::enterBit (const bool inBitValue,
-                                    const U64 inSampleNumber) {
-  if (!mUnstuffingActive) {
-    decodeFrameBit (inBitValue, inSampleNumber) ;
-  }else if ((mConsecutiveBitCountOfSamePolarity == 5) && (inBitValue != mPreviousBit)) {
-   // Stuff bit - discarded
-    addMark (inSampleNumber, AnalyzerResults::X);
-    mConsecutiveBitCountOfSamePolarity = 1 ;
-    mPreviousBit = inBitValue ;
-    mStuffBitCount += 1 ;
-  }else if ((mConsecutiveBitCountOfSamePolarity == 5) && (mPreviousBit == inBitValue)) { // Stuff Error
-    addMark (inSampleNumber, AnalyzerResults::ErrorX);
-    const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-    enterInErrorMode (inSampleNumber + samplesPerBit / 2) ;
-    mConsecutiveBitCountOfSamePolarity += 1 ;
-  }else if (mPreviousBit == inBitValue) {
-    mConsecutiveBitCountOfSamePolarity += 1 ;
-    decodeFrameBit (inBitValue, inSampleNumber) ;
+//  CAN FRAME DECODER DELEGATE
+//----------------------------------------------------------------------------------------
+
+static const AnalyzerResults::MarkerType markerTable [] = { // Indexed by CANDecoderMarker
+  AnalyzerResults::Dot,
+  AnalyzerResults::ErrorDot,
+  AnalyzerResults::ErrorSquare,
+  AnalyzerResults::UpArrow,
+  AnalyzerResults::DownArrow,
+  AnalyzerResults::X,
+  AnalyzerResults::ErrorX,
+  AnalyzerResults::Start,
+  AnalyzerResults::Stop,
+  AnalyzerResults::One,
+  AnalyzerResults::Zero
+} ;
+
+//----------------------------------------------------------------------------------------
+
+// With adaptive detail, marks out of frames are sent only in full detail windows, and
+// marks of a reduced frame are kept until the frame is promoted, or dropped at its end.
+
+void CANMolinaroAnalyzer::addMark (const uint64_t inSampleNumber,
+                                   const CANDecoderMarker inMarker) {
+  if ((inMarker == MARK_START) && mPhaseErrors.enabled ()) {
+    mPhaseErrors.beginFrame () ;
+  }
+  if (!mDetailPolicy.adaptive ()) {
+    addMarker (inSampleNumber, inMarker) ;
   }else{
-    mConsecutiveBitCountOfSamePolarity = 1 ;
-    mPreviousBit = inBitValue ;
-    decodeFrameBit (inBitValue, inSampleNumber) ;
+    if (inMarker == MARK_START) {
+      beginFrame (inSampleNumber) ;
+    }
+    if (!mFrameInProgress) {
+      if (mDetailPolicy.fullDetailAt (inSampleNumber)) {
+        addMarker (inSampleNumber, inMarker) ;
+      }
+    }else if (mFullDetailFrame) {
+      addMarker (inSampleNumber, inMarker) ;
+    }else{
+      PendingMark mark ;
+      mark.mSampleNumber = inSampleNumber ;
+      mark.mMarker = inMarker ;
+      mPendingMarks.push_back (mark) ;
+      if (mPendingMarks.size () >= DETAIL_MAX_PENDING_MARKS) {
+        promoteFrame () ;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzer::addMarker (const uint64_t inSampleNumber,
+                                     const CANDecoderMarker inMarker) {
+  { InstrumentationTimerScope scope (mInstrumentation, INSTR_ADD_MARKER_TIME) ;
+    mResults->AddMarker (inSampleNumber, markerTable [inMarker], mSettings->mInputChannel);
   }
+  mInstrumentation.count (INSTR_MARKERS) ;
 }
 
 //----------------------------------------------------------------------------------------
 
-void CANMolinaroAnalyzer::decodeFrameBit (const bool inBitValue,
-                                          const U64 inSampleNumber) {
-  switch (mFrameFieldEngineState) {
-  case IDLE :
-    handle_IDLE_state (inBitValue, inSampleNumber) ;
+void CANMolinaroAnalyzer::addBubble (const uint8_t inBubbleType,
+                                     const uint64_t inData1,
+                                     const uint64_t inData2,
+                                     const uint64_t inStartSampleNumber,
+                                     const uint64_t inEndSampleNumber) {
+  Frame frame ;
+  frame.mType = inBubbleType ;
+  frame.mFlags = 0 ;
+  frame.mStartingSampleInclusive = inStartSampleNumber ;
+  frame.mEndingSampleInclusive = inEndSampleNumber ;
+  frame.mData1 = inData1 ;
+  frame.mData2 = inData2 ;
+  if (!mFullDetailFrame) { // Reduced frame: an error or a selected identifier promotes it
+    const bool promote = (inBubbleType == CAN_ERROR_RESULT)
+      || ((inBubbleType == STANDARD_IDENTIFIER_FIELD_RESULT)
+       && mDetailPolicy.fullDetailIdentifier (CANErrorCounters::identifierKey (uint32_t (inData1), false)))
+      || ((inBubbleType == EXTENDED_IDENTIFIER_FIELD_RESULT)
+       && mDetailPolicy.fullDetailIdentifier (CANErrorCounters::identifierKey (uint32_t (inData1), true)))
+    ;
+    if (promote) {
+      promoteFrame () ;
+    }
+  }
+  if ((inBubbleType == CAN_ERROR_RESULT) && mDetailPolicy.adaptive ()) {
+    mDetailPolicy.enterError (inEndSampleNumber) ;
+  }
+  if (!mOneFramePerMessage && !mReducedFrame) {
+    const U64 frameIndex = addFrame (frame) ;
+    if ((inBubbleType == STANDARD_IDENTIFIER_FIELD_RESULT) || (inBubbleType == EXTENDED_IDENTIFIER_FIELD_RESULT)) {
+      mMessageFrameIndex = frameIndex ;
+    }
+  }else if (inBubbleType == CAN_ERROR_RESULT) {
+    flushPendingMessage (true) ;
+    flushPendingFieldFrames () ;
+    addFrame (frame) ;
+  }else{
+    mPendingFieldFrames.push_back (frame) ;
+    if (inBubbleType == INTERMISSION_FIELD_RESULT) {
+      flushPendingMessage (false) ;
+      flushPendingFieldFrames () ;
+    }
+  }
+
+  if (mFullDetailFrame && (!mChangedMessagesOnly || (inBubbleType == CAN_ERROR_RESULT))) {
+    addFieldFrameV2 (inBubbleType, inData1, inData2, inStartSampleNumber, inEndSampleNumber) ;
+  }
+  if (mPhaseErrors.enabled ()) {
+    switch (inBubbleType) {
+    case STANDARD_IDENTIFIER_FIELD_RESULT :
+      mPhaseErrors.setIdentifier (CANErrorCounters::identifierKey (uint32_t (inData1), false)) ;
+      break ;
+    case EXTENDED_IDENTIFIER_FIELD_RESULT :
+      mPhaseErrors.setIdentifier (CANErrorCounters::identifierKey (uint32_t (inData1), true)) ;
+      break ;
+    case ACK_FIELD_RESULT : // Starts at the ACK slot: from the CRC delimiter sample point
+      mPhaseErrors.setTransmitterEnd (inStartSampleNumber - mDecoder.samplesPerBit () / 2) ;
+      break ;
+    case INTERMISSION_FIELD_RESULT :
+    case CAN_ERROR_RESULT :
+      mPhaseErrors.endFrame (inEndSampleNumber) ;
+      break ;
+    default :
+      break ;
+    }
+  }
+  if (mResponseTimes.enabled () && (inBubbleType == INTERMISSION_FIELD_RESULT)) {
+    mResponseTimes.enterFrameLength (inData1) ;
+  }
+  if ((inBubbleType == INTERMISSION_FIELD_RESULT) || (inBubbleType == CAN_ERROR_RESULT)) {
+    endFrame () ;
+  }
+
+//--- Delayed to the end of a reduced frame, as its field rows may still be sent, and
+//    while field frames are pending, as the message row spans the whole message
+  if ((inEndSampleNumber >= mNextSummarySampleNumber) && mFullDetailFrame && mPendingFieldFrames.empty ()) {
+    addSummaries (inEndSampleNumber) ;
+  }
+
+  commitResults () ;
+  { InstrumentationTimerScope scope (mInstrumentation, INSTR_REPORT_PROGRESS_TIME) ;
+    ReportProgress (inEndSampleNumber) ;
+  }
+  mInstrumentation.count (INSTR_PROGRESS_REPORTS) ;
+}
+
+//----------------------------------------------------------------------------------------
+// Data table row of a field (or of an error)
+
+void CANMolinaroAnalyzer::addFieldFrameV2 (const uint8_t inBubbleType,
+                                           const uint64_t inData1,
+                                           const uint64_t inData2,
+                                           const uint64_t inStartSampleNumber,
+                                           const uint64_t inEndSampleNumber) {
+  FrameV2 frameV2 ;
+  switch (inBubbleType) {
+  case STANDARD_IDENTIFIER_FIELD_RESULT :
+    { const U8 idf [2] = { U8 (inData1 >> 8), U8 (inData1) } ;
+      frameV2.AddByteArray ("Value", idf, 2) ;
+      addFrameV2 (frameV2, "Std Idf", inStartSampleNumber, inEndSampleNumber) ;
+    }
     break ;
-  case IDENTIFIER :
-    handle_IDENTIFIER_state (inBitValue, inSampleNumber) ;
+  case EXTENDED_IDENTIFIER_FIELD_RESULT :
+    { const U8 idf [4] = {
+        U8 (inData1 >> 24), U8 (inData1 >> 16), U8 (inData1 >> 8), U8 (inData1)
+      } ;
+      frameV2.AddByteArray ("Value", idf, 4) ;
+      if (mJ1939.enabled ()) {
+        const J1939Identifier j1939 = j1939Identifier (uint32_t (inData1)) ;
+        frameV2.AddInteger ("Priority", S64 (j1939.mPriority)) ;
+        frameV2.AddInteger ("PGN", S64 (j1939.mPGN)) ;
+        frameV2.AddByte ("SA", j1939.mSourceAddress) ;
+        frameV2.AddByte ("DA", j1939.mDestinationAddress) ;
+      }
+      addFrameV2 (frameV2, "Ext Idf", inStartSampleNumber, inEndSampleNumber) ;
+    }
     break ;
-  case EXTENDED_IDF :
-    handle_EXTENDED_IDF_state (inBitValue, inSampleNumber) ;
+  case CONTROL_FIELD_RESULT :
+    frameV2.AddByte ("Value", inData1) ;
+    if ((inData2 & CAN_FD_FDF_FLAG) != 0) {
+      frameV2.AddBoolean ("BRS", (inData2 & CAN_FD_BRS_FLAG) != 0) ;
+      frameV2.AddBoolean ("ESI", (inData2 & CAN_FD_ESI_FLAG) != 0) ;
+    }
+    addFrameV2 (frameV2, ((inData2 & CAN_FD_FDF_FLAG) != 0) ? "FD Ctrl" : "Ctrl", inStartSampleNumber, inEndSampleNumber) ;
     break ;
-  case CONTROL :
-    handle_CONTROL_state (inBitValue, inSampleNumber) ;
+  case DATA_FIELD_RESULT :
+    { frameV2.AddByte ("Value", inData1) ;
+      std::stringstream str ;
+      str << "D" << inData2 ;
+      addFrameV2 (frameV2, str.str ().c_str (), inStartSampleNumber, inEndSampleNumber) ;
+    }
     break ;
-  case DATA :
-    handle_DATA_state (inBitValue, inSampleNumber) ;
+  case CRC_FIELD_RESULT :
+    if (inData1 > 0xFFFF) { // CAN FD CRC 17, CRC 21
+      const U8 crc [3] = { U8 (inData1 >> 16), U8 (inData1 >> 8), U8 (inData1) } ;
+      frameV2.AddByteArray ("Value", crc, 3) ;
+      addFrameV2 (frameV2, "CRC", inStartSampleNumber, inEndSampleNumber) ;
+    }else{
+      const U8 crc [2] = { U8 (inData1 >> 8), U8 (inData1) } ;
+      frameV2.AddByteArray ("Value", crc, 2) ;
+      addFrameV2 (frameV2, "CRC", inStartSampleNumber, inEndSampleNumber) ;
+    }
     break ;
-  case CRC15 :
-    handle_CRC15_state (inBitValue, inSampleNumber) ;
+  case STUFF_COUNT_FIELD_RESULT :
+    frameV2.AddByte ("Value", inData1) ;
+    addFrameV2 (frameV2, "SBC", inStartSampleNumber, inEndSampleNumber) ;
     break ;
-  case CRC_DEL :
-    handle_CRCDEL_state (inBitValue, inSampleNumber) ;
+  case ACK_FIELD_RESULT :
+	frameV2.AddByte("Value", inData1);
+    addFrameV2 (frameV2, "ACK", inStartSampleNumber, inEndSampleNumber) ;
     break ;
-  case ACK :
-    handle_ACK_state (inBitValue, inSampleNumber) ;
+  case EOF_FIELD_RESULT :
+    addFrameV2 (frameV2, "EOF", inStartSampleNumber, inEndSampleNumber) ;
     break ;
-  case END_OF_FRAME :
-    handle_ENDOFFRAME_state (inBitValue, inSampleNumber) ;
+  case INTERMISSION_FIELD_RESULT :
+    { const U64 frameSampleCount = inData1 ;
+      const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
+      const U64 length = (frameSampleCount + samplesPerBit / 2) / samplesPerBit ;
+      const U64 stuffBitCount = inData2 ;
+      const U64 durationMicroSeconds = frameSampleCount * 1000000 / mSampleRateHz ;
+      std::stringstream str ;
+      str << length << " bits, "
+          << durationMicroSeconds << "µs, "
+          << stuffBitCount << " stuff bit" << ((inData2 > 1) ? "s" : "") ;
+      frameV2.AddString ("Value", str.str ().c_str ()) ;
+      addFrameV2 (frameV2, "IFS", inStartSampleNumber, inEndSampleNumber) ;
+    }
     break ;
-  case INTERMISSION :
-    handle_INTERMISSION_state (inBitValue, inSampleNumber) ;
+  case CAN_ERROR_RESULT :
+    { const CANErrorKind kind = CANErrorKind (inData1 & 0xFF) ;
+      const CANErrorFlag flag = CANErrorFlag ((inData1 >> 8) & 0xFF) ;
+      const CANErrorCounters & counters = mDecoder.errorCounters () ;
+      frameV2.AddString ("Type", errorKindName (kind)) ;
+      frameV2.AddString ("Flag", errorFlagName (flag)) ;
+      frameV2.AddInteger ("Count", S64 (counters.mKindCount [kind])) ;
+      if ((inData2 >> 32) != 0) { // Identifier is known
+        const uint32_t key = uint32_t (inData2) ;
+        const std::map <uint32_t, uint64_t>::const_iterator it = counters.mIdentifierErrorCount.find (key) ;
+        frameV2.AddInteger ("Idf", S64 (key & 0x7FFFFFFF)) ;
+        frameV2.AddInteger ("Idf errors", S64 ((it == counters.mIdentifierErrorCount.end ()) ? 0 : it->second)) ;
+      }
+      addFrameV2 (frameV2, "Error", inStartSampleNumber, inEndSampleNumber) ;
+    }
     break ;
-  case DECODER_ERROR :
-    handle_DECODER_ERROR_state (inBitValue, inSampleNumber) ;
+  default:
+    addFrameV2 (frameV2, "?", inStartSampleNumber, inEndSampleNumber) ;
     break ;
   }
 }
 
 //----------------------------------------------------------------------------------------
+// Summary rows, sent once per second of capture and at the decode window end
 
-void CANMolinaroAnalyzer::handle_IDLE_state (const bool inBitValue,
-                                             const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  if (inBitValue) {
-    addMark (inSampleNumber, AnalyzerResults::Stop) ;
-  }else{ // SOF
-    mUnstuffingActive = true ;
-    mCRC15Accumulator = 0 ;
-    mConsecutiveBitCountOfSamePolarity = 1 ;
-    mPreviousBit = false ;
-    enterBitInCRC15 (inBitValue) ;
-    addMark (inSampleNumber, AnalyzerResults::Start) ;
-    mFieldBitIndex = 0 ;
-    mIdentifier = 0 ;
-    mFrameFieldEngineState = IDENTIFIER ;
-    mStartOfFieldSampleNumber = inSampleNumber + samplesPerBit / 2 ;
-    mStartOfFrameSampleNumber = inSampleNumber ;
-    mStuffBitCount = 0 ;
+void CANMolinaroAnalyzer::addSummaries (const uint64_t inSampleNumber) {
+  addErrorSummary (inSampleNumber) ;
+  addGlitchSummary (inSampleNumber) ;
+  if (mLiveLog.isRunning ()) {
+    addLiveLogSummary (inSampleNumber) ;
+  }
+  if (mJ1939.enabled ()) {
+    mJ1939.summarize (inSampleNumber) ;
+  }
+  if (mGateway.enabled ()) {
+    mGateway.summarize (inSampleNumber) ;
+  }
+  if (mPhaseErrors.enabled ()) {
+    mPhaseErrors.summarize (inSampleNumber) ;
+  }
+  if (mPeriods.enabled ()) {
+    mPeriods.summarize (inSampleNumber) ;
   }
+  if (mResponseTimes.enabled ()) {
+    mResponseTimes.summarize (inSampleNumber) ;
+  }
+  if (mMessageStore.size () > 0) {
+    searchStoredMessages (inSampleNumber) ;
+  }
+  if (mChangedMessagesOnly) {
+    mDeltaFilter.flushRepeats (inSampleNumber) ;
+  }
+  if (mDetailPolicy.level () == DETAIL_ADAPTIVE_STATISTICS) {
+    addTrafficSummary (inSampleNumber) ;
+  }
+  addInstrumentationSummary (inSampleNumber) ;
+  mNextSummarySampleNumber = inSampleNumber + mSampleRateHz ;
 }
 
 //----------------------------------------------------------------------------------------
-
-void CANMolinaroAnalyzer::handle_IDENTIFIER_state (const bool inBitValue,
-                                                   const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  enterBitInCRC15 (inBitValue) ;
-  mFieldBitIndex ++ ;
-  if (mFieldBitIndex <= 11) { // Standard identifier
-    addMark (inSampleNumber, AnalyzerResults::Dot);
-    mIdentifier <<= 1 ;
-    mIdentifier |= inBitValue ;
-  }else if (mFieldBitIndex == 12) { // RTR bit
-    addMark (inSampleNumber, inBitValue ? AnalyzerResults::UpArrow : AnalyzerResults::DownArrow) ;
-    mFrameType = inBitValue ? remoteFrame : dataFrame  ;
-  }else{ // IDE
-    addMark (inSampleNumber, AnalyzerResults::Dot);
-    if (inBitValue) {
-      mFrameFieldEngineState = EXTENDED_IDF ;
-      mFieldBitIndex = 0 ;
-    }else{
-      addBubble (STANDARD_IDENTIFIER_FIELD_RESULT,
-                 mIdentifier,
-                 mFrameType == dataFrame, // 0 -> remote, 1 -> data
-                 inSampleNumber - samplesPerBit / 2) ;
-      mDataCodeLength = 0 ;
-      mFrameFieldEngineState = CONTROL ;
-      mFieldBitIndex = 1 ;
+// One row per second of capture, only if error counters have changed
+
+void CANMolinaroAnalyzer::addErrorSummary (const uint64_t inSampleNumber) {
+  const CANErrorCounters & counters = mDecoder.errorCounters () ;
+  const uint64_t total = counters.total () ;
+  if (total != mErrorCountAtLastSummary) {
+    mErrorCountAtLastSummary = total ;
+    FrameV2 frameV2 ;
+    for (uint32_t i=0 ; i<CAN_ERROR_KIND_COUNT ; i++) {
+      frameV2.AddInteger (errorKindName (CANErrorKind (i)), S64 (counters.mKindCount [i])) ;
     }
+    frameV2.AddInteger ("Active error flags", S64 (counters.mErrorFlagCount [CAN_ACTIVE_ERROR_FLAG])) ;
+    frameV2.AddInteger ("Passive error flags", S64 (counters.mErrorFlagCount [CAN_PASSIVE_ERROR_FLAG])) ;
+    frameV2.AddInteger ("Identifiers in error", S64 (counters.mIdentifierErrorCount.size ())) ;
+    addFrameV2 (frameV2, "Error summary", inSampleNumber, inSampleNumber) ;
   }
 }
 
 //----------------------------------------------------------------------------------------
-
-void CANMolinaroAnalyzer::handle_EXTENDED_IDF_state (const bool inBitValue,
-                                                     const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  enterBitInCRC15 (inBitValue) ;
-  mFieldBitIndex ++ ;
-  if (mFieldBitIndex <= 18) { // Extended identifier
-    addMark (inSampleNumber, AnalyzerResults::Dot);
-    mIdentifier <<= 1 ;
-    mIdentifier |= inBitValue ;
-  }else if (mFieldBitIndex == 19) { // RTR bit
-    addMark (inSampleNumber, inBitValue ? AnalyzerResults::UpArrow : AnalyzerResults::DownArrow) ;
-    mFrameType = inBitValue ? remoteFrame : dataFrame  ;
-  }else{ // R1: should be dominant
-    addMark (inSampleNumber, inBitValue ? AnalyzerResults::ErrorX : AnalyzerResults::Zero) ;
-    addBubble (EXTENDED_IDENTIFIER_FIELD_RESULT,
-               mIdentifier,
-               mFrameType == dataFrame, // 0 -> remote, 1 -> data
-               inSampleNumber - samplesPerBit / 2) ;
-    if (inBitValue) {
-      enterInErrorMode (inSampleNumber + samplesPerBit / 2) ;
-    }else{
-      mFrameFieldEngineState = CONTROL ;
-      mFieldBitIndex = 1 ;
-      mDataCodeLength = 0 ;
-    }
+// One row per second of capture, only if pulses have been suppressed
+
+void CANMolinaroAnalyzer::addGlitchSummary (const uint64_t inSampleNumber) {
+  if (mGlitchCount != mGlitchCountAtLastSummary) {
+    FrameV2 frameV2 ;
+    frameV2.AddInteger ("Suppressed pulses", S64 (mGlitchCount)) ;
+    frameV2.AddInteger ("Since last summary", S64 (mGlitchCount - mGlitchCountAtLastSummary)) ;
+    addFrameV2 (frameV2, "Glitch summary", inSampleNumber, inSampleNumber) ;
+    mGlitchCountAtLastSummary = mGlitchCount ;
   }
 }
 
 //----------------------------------------------------------------------------------------
 
-void CANMolinaroAnalyzer::handle_CONTROL_state (const bool inBitValue,
-                                                const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  enterBitInCRC15 (inBitValue) ;
-  mFieldBitIndex ++ ;
-  if (mFieldBitIndex == 2) { // R0
-    addMark (inSampleNumber, inBitValue ? AnalyzerResults::ErrorX : AnalyzerResults::Zero) ;
-    if (inBitValue) {
-      enterInErrorMode (inSampleNumber + samplesPerBit / 2) ;
-    }
+void CANMolinaroAnalyzer::addMessage (const CANDecodedMessage & inMessage) {
+  mTrafficMessageCount += 1 ;
+  mTrafficDataByteCount += inMessage.mDataLength ;
+  if (mOneFramePerMessage || mReducedFrame) {
+    mPendingMessage = inMessage ;
+    mHasPendingMessage = true ;
   }else{
-    addMark (inSampleNumber, AnalyzerResults::Dot);
-    mDataCodeLength <<= 1 ;
-    mDataCodeLength |= inBitValue ;
-    if (mFieldBitIndex == 6) {
-      addBubble (CONTROL_FIELD_RESULT, mDataCodeLength, 0, inSampleNumber + samplesPerBit / 2) ;
-      mFieldBitIndex = 0 ;
-      if (mDataCodeLength > 8) {
-        mDataCodeLength = 8 ;
-      }
-      mCRC15 = mCRC15Accumulator ;
-      mFrameFieldEngineState = ((mDataCodeLength == 0) || (mFrameType == remoteFrame))
-        ? CRC15
-        : DATA
-      ;
+    storeMessage (inMessage, mMessageFrameIndex) ;
+  }
+  if (mISOTP.enabled ()) {
+    mISOTP.enterMessage (inMessage) ;
+  }
+  if (mJ1939.enabled ()) {
+    mJ1939.enterMessage (inMessage) ;
+  }
+  if (mGateway.enabled ()) {
+    mGateway.enterIngress (inMessage) ;
+  }
+  if (mPeriods.enabled ()) {
+    mPeriods.enterMessage (CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended),
+                           inMessage.mStartSampleNumber) ;
+  }
+  if (mResponseTimes.enabled ()) {
+    mResponseTimes.enterMessage (CANErrorCounters::identifierKey (inMessage.mIdentifier, inMessage.mExtended),
+                                 inMessage.mStartSampleNumber) ;
+  }
+  if (mLiveTap.isOpen ()) {
+    mLiveTap.publish (inMessage) ;
+  }
+  if (mLiveLog.isRunning ()) {
+    mLiveLog.push (inMessage) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// One row per second of capture, only if messages have been dropped since the last one,
+// or when a write error occurs
+
+void CANMolinaroAnalyzer::addLiveLogSummary (const uint64_t inSampleNumber) {
+  const U64 droppedCount = mLiveLog.droppedCount () ;
+  const std::string error = mLiveLogErrorReported ? std::string () : mLiveLog.error () ;
+  if ((droppedCount != mLiveLogDroppedCountAtLastSummary) || !error.empty ()) {
+    FrameV2 frameV2 ;
+    frameV2.AddInteger ("Written", S64 (mLiveLog.writtenCount ())) ;
+    frameV2.AddInteger ("Dropped", S64 (droppedCount)) ;
+    if (!error.empty ()) {
+      frameV2.AddString ("Error", error.c_str ()) ;
+      mLiveLogErrorReported = true ;
     }
+    addFrameV2 (frameV2, "Live log summary", inSampleNumber, inSampleNumber) ;
+    mLiveLogDroppedCountAtLastSummary = droppedCount ;
   }
 }
 
 //----------------------------------------------------------------------------------------
+//  PAYLOAD SEARCH
+//----------------------------------------------------------------------------------------
+// Messages are stored until a block is full, then the block is searched for all patterns
+// and the store is cleared. A pending block is also searched every second of capture
+// (with the summaries) and at the end of the decode window. "Match" rows are sent when
+// their block is searched, in message order; they give the sample of the message.
+
+void CANMolinaroAnalyzer::storeMessage (const CANDecodedMessage & inMessage, const U64 inFrameIndex) {
+  if (!mPayloadPatterns.empty ()) {
+    mMessageStore.append (inMessage, inFrameIndex) ;
+    if (mMessageStore.size () >= CAN_MESSAGE_STORE_BLOCK_ROW_COUNT) {
+      searchStoredMessages (inMessage.mEndSampleNumber) ;
+    }
+  }
+}
 
-void CANMolinaroAnalyzer::handle_DATA_state (const bool inBitValue,
-                                             const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  enterBitInCRC15 (inBitValue) ;
-  addMark (inSampleNumber, AnalyzerResults::Dot);
-  mData [mFieldBitIndex / 8] <<= 1 ;
-  mData [mFieldBitIndex / 8] |= inBitValue ;
-  mFieldBitIndex ++ ;
-  if ((mFieldBitIndex % 8) == 0) {
-    const U32 dataIndex = (mFieldBitIndex - 1) / 8 ;
-    addBubble (DATA_FIELD_RESULT, mData [dataIndex], dataIndex, inSampleNumber + samplesPerBit / 2) ;
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzer::searchStoredMessages (const U64 inSampleNumber) {
+  const size_t patternCount = mPayloadPatterns.size () ;
+  mMatches.clear () ;
+  for (size_t i=0 ; i<patternCount ; i++) {
+    mMatchingRows.clear () ;
+    mMessageStore.search (mPayloadPatterns [i], 0, mMessageStore.size (), mMatchingRows) ;
+    for (size_t m=0 ; m<mMatchingRows.size () ; m++) {
+      mMatches.push_back (mMatchingRows [m] * patternCount + i) ;
+    }
   }
-  if (mFieldBitIndex == (8 * mDataCodeLength)) {
-    mFieldBitIndex = 0 ;
-    mFrameFieldEngineState = CRC15 ;
-    mCRC15 = mCRC15Accumulator ;
+  std::sort (mMatches.begin (), mMatches.end ()) ;
+  for (size_t m=0 ; m<mMatches.size () ; m++) {
+    const size_t row = mMatches [m] / patternCount ;
+    FrameV2 frameV2 ;
+    frameV2.AddInteger ("Pattern", S64 (mMatches [m] % patternCount + 1)) ;
+    frameV2.AddInteger ("Idf", S64 (mMessageStore.identifierKey (row) & 0x7FFFFFFF)) ;
+    if (mMessageStore.frameIndex (row) != CAN_MESSAGE_STORE_NO_FRAME) {
+      frameV2.AddInteger ("Frame", S64 (mMessageStore.frameIndex (row))) ;
+    }
+    frameV2.AddInteger ("Sample", S64 (mMessageStore.startSampleNumber (row))) ;
+    addFrameV2 (frameV2, "Match", inSampleNumber, inSampleNumber) ;
   }
+  mMessageStore.clear () ;
 }
 
 //----------------------------------------------------------------------------------------
+//  ISO-TP REASSEMBLER DELEGATE
+//----------------------------------------------------------------------------------------
+// Rows are sent at the end of the last CAN frame of the PDU, so results stay in order
 
-void CANMolinaroAnalyzer::handle_CRC15_state (const bool inBitValue,
-                                              const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  enterBitInCRC15 (inBitValue) ;
-  addMark (inSampleNumber, AnalyzerResults::Dot);
-  mFieldBitIndex ++ ;
-  if (mFieldBitIndex == 15) {
-    mFieldBitIndex = 0 ;
-    mFrameFieldEngineState = CRC_DEL ;
-    addBubble (CRC_FIELD_RESULT, mCRC15, mCRC15Accumulator, inSampleNumber + samplesPerBit / 2) ;
-    if (mCRC15Accumulator != 0) {
-      mFrameFieldEngineState = DECODER_ERROR ;
+void CANMolinaroAnalyzer::addISOTPPDU (const ISOTPPDU & inPDU) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("Idf", S64 (inPDU.mIdentifierKey & 0x7FFFFFFF)) ;
+  frameV2.AddInteger ("Length", S64 (inPDU.mLength)) ;
+  frameV2.AddByteArray ("Data", inPDU.mData, inPDU.mStoredLength) ;
+  if (inPDU.mStoredLength < inPDU.mLength) {
+    frameV2.AddBoolean ("Truncated", true) ;
+  }
+  frameV2.AddInteger ("Duration µs", S64 (inPDU.mDurationMicroSeconds)) ;
+  if (inPDU.mConsecutiveFrameCount > 0) {
+    frameV2.AddInteger ("CF", S64 (inPDU.mConsecutiveFrameCount)) ;
+    frameV2.AddInteger ("FC", S64 (inPDU.mFlowControlCount)) ;
+    frameV2.AddInteger ("FC wait", S64 (inPDU.mWaitCount)) ;
+    if (inPDU.mHasFlowControl) {
+      frameV2.AddInteger ("BS", S64 (inPDU.mBlockSize)) ;
+      frameV2.AddInteger ("STmin µs", S64 (inPDU.mRequestedSeparationMicroSeconds)) ;
+    }
+    if (inPDU.mSeparationCount > 0) {
+      frameV2.AddInteger ("ST min µs", S64 (inPDU.mMinSeparationMicroSeconds)) ;
+      frameV2.AddInteger ("ST mean µs", S64 (inPDU.mMeanSeparationMicroSeconds)) ;
+      frameV2.AddInteger ("ST max µs", S64 (inPDU.mMaxSeparationMicroSeconds)) ;
+      frameV2.AddInteger ("STmin violations", S64 (inPDU.mSeparationViolationCount)) ;
     }
   }
+  addFrameV2 (frameV2, "ISO-TP", inPDU.mEndSampleNumber, inPDU.mEndSampleNumber) ;
 }
 
 //----------------------------------------------------------------------------------------
 
-void CANMolinaroAnalyzer::handle_CRCDEL_state (const bool inBitValue,
-                                               const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  mUnstuffingActive = false ;
-  if (inBitValue) {
-    addMark (inSampleNumber, AnalyzerResults::One) ;
-  }else{
-    enterInErrorMode (inSampleNumber) ;
-  }
-  mStartOfFieldSampleNumber = inSampleNumber + samplesPerBit / 2 ;
-  mFrameFieldEngineState = ACK ;
+void CANMolinaroAnalyzer::addISOTPError (const ISOTPErrorKind inKind,
+                                         const uint32_t inIdentifierKey,
+                                         const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddString ("Type", isotpErrorKindName (inKind)) ;
+  frameV2.AddInteger ("Idf", S64 (inIdentifierKey & 0x7FFFFFFF)) ;
+  addFrameV2 (frameV2, "ISO-TP error", inSampleNumber, inSampleNumber) ;
 }
 
 //----------------------------------------------------------------------------------------
+//  J1939 DECODER DELEGATE
+//----------------------------------------------------------------------------------------
+// As ISO-TP rows, transport rows are sent at the end of the last TP.DT frame
 
-void CANMolinaroAnalyzer::handle_ACK_state (const bool inBitValue,
-                                            const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  mFieldBitIndex ++ ;
-  if (mFieldBitIndex == 1) { // ACK SLOT
-    addMark (inSampleNumber, inBitValue ? AnalyzerResults::ErrorSquare : AnalyzerResults::DownArrow);
-    mAcked = inBitValue;
-  }else{ // ACK DELIMITER
-    addBubble (ACK_FIELD_RESULT, mAcked, 0, inSampleNumber + samplesPerBit / 2) ;
-    mFrameFieldEngineState = END_OF_FRAME ;
-    if (inBitValue) {
-      addMark (inSampleNumber, AnalyzerResults::One) ;
-    }else{
-      addMark (inSampleNumber, AnalyzerResults::ErrorDot) ;
-      enterInErrorMode (inSampleNumber) ;
-    }
-    mFieldBitIndex = 0 ;
+void CANMolinaroAnalyzer::addJ1939TransportMessage (const J1939TransportMessage & inMessage) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("PGN", S64 (inMessage.mPGN)) ;
+  frameV2.AddByte ("SA", inMessage.mSourceAddress) ;
+  frameV2.AddByte ("DA", inMessage.mDestinationAddress) ;
+  frameV2.AddString ("Session", inMessage.mBroadcast ? "BAM" : "RTS/CTS") ;
+  frameV2.AddInteger ("Size", S64 (inMessage.mSize)) ;
+  frameV2.AddByteArray ("Data", inMessage.mData, inMessage.mSize) ;
+  frameV2.AddInteger ("Packets", S64 (inMessage.mPacketCount)) ;
+  if (!inMessage.mBroadcast) {
+    frameV2.AddInteger ("CTS", S64 (inMessage.mClearToSendCount)) ;
   }
+  frameV2.AddInteger ("Duration µs", S64 (inMessage.mDurationMicroSeconds)) ;
+  addFrameV2 (frameV2, "J1939 TP", inMessage.mEndSampleNumber, inMessage.mEndSampleNumber) ;
 }
 
 //----------------------------------------------------------------------------------------
 
-void CANMolinaroAnalyzer::handle_ENDOFFRAME_state (const bool inBitValue,
-                                                   const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  if (inBitValue) {
-    addMark (inSampleNumber, AnalyzerResults::One) ;
-  }else{
-    enterInErrorMode (inSampleNumber) ;
+void CANMolinaroAnalyzer::addJ1939TransportError (const J1939ErrorKind inKind,
+                                                  const uint32_t inPGN,
+                                                  const uint8_t inSourceAddress,
+                                                  const uint8_t inDestinationAddress,
+                                                  const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddString ("Type", j1939ErrorKindName (inKind)) ;
+  frameV2.AddInteger ("PGN", S64 (inPGN)) ;
+  frameV2.AddByte ("SA", inSourceAddress) ;
+  frameV2.AddByte ("DA", inDestinationAddress) ;
+  addFrameV2 (frameV2, "J1939 TP error", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+// One row per PGN received during the last second of capture
+
+void CANMolinaroAnalyzer::addJ1939PGNRate (const uint32_t inPGN,
+                                           const J1939PGNCounters & inCounters,
+                                           const uint64_t inFramesPerSecond,
+                                           const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("PGN", S64 (inPGN)) ;
+  frameV2.AddInteger ("Frames/s", S64 (inFramesPerSecond)) ;
+  frameV2.AddInteger ("Frames", S64 (inCounters.mFrameCount)) ;
+  addFrameV2 (frameV2, "J1939 PGN", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+//  DELTA FILTER DELEGATE
+//----------------------------------------------------------------------------------------
+// Repeats folded during the last second of capture, one row per identifier
+
+void CANMolinaroAnalyzer::addRepeats (const uint32_t inIdentifierKey,
+                                      const uint64_t inRepeatCount,
+                                      const uint64_t inLastSeenSampleNumber,
+                                      const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("Idf", S64 (inIdentifierKey & 0x7FFFFFFF)) ;
+  frameV2.AddInteger ("Repeats", S64 (inRepeatCount)) ;
+  frameV2.AddInteger ("Last seen", S64 (inLastSeenSampleNumber)) ;
+  addFrameV2 (frameV2, "Unchanged", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+//  GATEWAY CORRELATOR DELEGATE
+//----------------------------------------------------------------------------------------
+// Cumulated since the start of the capture; percentiles have a 12.5 % resolution
+
+void CANMolinaroAnalyzer::addGatewayStatistics (const uint32_t inIdentifierKey,
+                                                const CANGatewayStatistics & inStatistics,
+                                                const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("Idf", S64 (inIdentifierKey & 0x7FFFFFFF)) ;
+  frameV2.AddInteger ("Forwarded", S64 (inStatistics.mForwardedCount)) ;
+  frameV2.AddInteger ("Missing", S64 (inStatistics.mMissingCount)) ;
+  frameV2.AddInteger ("Duplicated", S64 (inStatistics.mDuplicatedCount)) ;
+  if (inStatistics.mForwardedCount > 0) {
+    frameV2.AddInteger ("Min µs", S64 (inStatistics.mMinimumMicroSeconds)) ;
+    frameV2.AddInteger ("Median µs", S64 (inStatistics.percentileMicroSeconds (50))) ;
+    frameV2.AddInteger ("P99 µs", S64 (inStatistics.percentileMicroSeconds (99))) ;
+    frameV2.AddInteger ("Max µs", S64 (inStatistics.mMaximumMicroSeconds)) ;
+    frameV2.AddInteger ("Mean µs", S64 (inStatistics.mTotalMicroSeconds / inStatistics.mForwardedCount)) ;
   }
-  mFieldBitIndex ++ ;
-  if (mFieldBitIndex == 7) {
-    addBubble (EOF_FIELD_RESULT, 0, 0, inSampleNumber + samplesPerBit / 2) ;
-    mFieldBitIndex = 0 ;
-    mFrameFieldEngineState = INTERMISSION ;
+  addFrameV2 (frameV2, "Gateway latency", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+//  PHASE ERRORS DELEGATE
+//----------------------------------------------------------------------------------------
+// Errors in percent of the bit time; the decoder samples at 50 %, the margin is what is
+// left between the worst edge and the sample point
+
+static void addPhaseErrorFields (FrameV2 & ioFrameV2, const CANPhaseHistogram & inHistogram) {
+  ioFrameV2.AddInteger ("Edges", S64 (inHistogram.mEdgeCount)) ;
+  if (inHistogram.mEdgeCount > 0) {
+    ioFrameV2.AddDouble ("Min %", inHistogram.mMinimum / 100.0) ;
+    ioFrameV2.AddDouble ("Max %", inHistogram.mMaximum / 100.0) ;
+    ioFrameV2.AddDouble ("Mean %", double (inHistogram.mTotal) / double (inHistogram.mEdgeCount) / 100.0) ;
   }
 }
 
 //----------------------------------------------------------------------------------------
 
-void CANMolinaroAnalyzer::handle_INTERMISSION_state (const bool inBitValue,
-                                                     const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  if (inBitValue) {
-    addMark (inSampleNumber, AnalyzerResults::One) ;
-  }else{
-    enterInErrorMode (inSampleNumber) ;
+void CANMolinaroAnalyzer::addPhaseErrorFrame (const CANPhaseHistogram & inFrame,
+                                              const bool inWarning,
+                                              const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  addPhaseErrorFields (frameV2, inFrame) ;
+  frameV2.AddDouble ("Margin %", (PHASE_FULL_BIT / 2 - inFrame.worst ()) / 100.0) ;
+  frameV2.AddBoolean ("Warning", inWarning) ;
+  frameV2.AddString ("Histogram", inFrame.binText ().c_str ()) ;
+  addFrameV2 (frameV2, "Phase errors", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzer::addPhaseErrorSummary (const CANPhaseHistogram & inCapture,
+                                                const uint64_t inWarningCount,
+                                                const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  addPhaseErrorFields (frameV2, inCapture) ;
+  frameV2.AddInteger ("Warnings", S64 (inWarningCount)) ;
+  frameV2.AddString ("Histogram", inCapture.binText ().c_str ()) ;
+  addFrameV2 (frameV2, "Phase summary", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzer::addPhaseErrorIdentifier (const uint32_t inIdentifierKey,
+                                                   const CANPhaseHistogram & inHistogram,
+                                                   const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("Idf", S64 (inIdentifierKey & 0x7FFFFFFF)) ;
+  addPhaseErrorFields (frameV2, inHistogram) ;
+  frameV2.AddString ("Histogram", inHistogram.binText ().c_str ()) ;
+  addFrameV2 (frameV2, "Phase errors by identifier", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+//  PERIOD STATISTICS DELEGATE
+//----------------------------------------------------------------------------------------
+// Cumulated since the start of the capture; percentiles have a 0.8 % resolution, jitter
+// is max - min
+
+void CANMolinaroAnalyzer::addPeriodStatistics (const CANPeriodEntry & inEntry,
+                                               const CANPeriodStatistics & inStatistics,
+                                               const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("Idf", S64 (inEntry.mIdentifierKey & 0x7FFFFFFF)) ;
+  frameV2.AddInteger ("Messages", S64 (inEntry.mMessageCount)) ;
+  frameV2.AddInteger ("Min µs", S64 (inEntry.mMinimumMicroSeconds)) ;
+  uint64_t percentile ;
+  if (inStatistics.percentileMicroSeconds (inEntry, 1, percentile)) {
+    frameV2.AddInteger ("P1 µs", S64 (percentile)) ;
+  }
+  if (inStatistics.percentileMicroSeconds (inEntry, 50, percentile)) {
+    frameV2.AddInteger ("Median µs", S64 (percentile)) ;
   }
-  mFieldBitIndex ++ ;
-  if (mFieldBitIndex == 3) {
-    const U64 frameSampleCount = inSampleNumber - mStartOfFrameSampleNumber ;
-    addBubble (INTERMISSION_FIELD_RESULT,
-               frameSampleCount,
-               mStuffBitCount,
-               inSampleNumber + samplesPerBit / 2) ;
-    mFieldBitIndex = 0 ;
-    mFrameFieldEngineState = IDLE ;
+  if (inStatistics.percentileMicroSeconds (inEntry, 99, percentile)) {
+    frameV2.AddInteger ("P99 µs", S64 (percentile)) ;
   }
+  frameV2.AddInteger ("Max µs", S64 (inEntry.mMaximumMicroSeconds)) ;
+  frameV2.AddInteger ("Mean µs", S64 (inEntry.mTotalMicroSeconds / inEntry.periodCount ())) ;
+  frameV2.AddInteger ("Jitter µs", S64 (inEntry.mMaximumMicroSeconds - inEntry.mMinimumMicroSeconds)) ;
+  addFrameV2 (frameV2, "Period statistics", inSampleNumber, inSampleNumber) ;
 }
 
 //----------------------------------------------------------------------------------------
+//  RESPONSE TIME DELEGATE
+//----------------------------------------------------------------------------------------
+// Rows are sent when a result changes, so a steady bus quickly stops sending them
 
-void CANMolinaroAnalyzer::handle_DECODER_ERROR_state (const bool inBitValue,
-                                                      const U64 inSampleNumber) {
-  const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-  mUnstuffingActive = false ;
-  addMark (inSampleNumber, AnalyzerResults::ErrorDot);
-  if (mPreviousBit != inBitValue) {
-    mConsecutiveBitCountOfSamePolarity = 1 ;
-    mPreviousBit = inBitValue ;
-  }else if (inBitValue) {
-    mConsecutiveBitCountOfSamePolarity += 1 ;
-    if (mConsecutiveBitCountOfSamePolarity == 11) {
-      addBubble (CAN_ERROR_RESULT, 0, 0, inSampleNumber + samplesPerBit / 2) ;
-      mFrameFieldEngineState = IDLE ;
+void CANMolinaroAnalyzer::addResponseTime (const CANResponseTimeResult & inResult,
+                                           const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("Idf", S64 (inResult.mIdentifierKey & 0x7FFFFFFF)) ;
+  frameV2.AddInteger ("Priority", S64 (inResult.mPriorityRank)) ;
+  frameV2.AddInteger ("Period µs", S64 (inResult.mPeriodMicroSeconds)) ;
+  frameV2.AddInteger ("Frame µs", S64 (inResult.mFrameMicroSeconds)) ;
+  frameV2.AddInteger ("Blocking µs", S64 (inResult.mBlockingMicroSeconds)) ;
+  frameV2.AddInteger ("Queueing µs", S64 (inResult.mQueueingMicroSeconds)) ;
+  frameV2.AddInteger ("Bound µs", S64 (inResult.mResponseMicroSeconds)) ;
+  frameV2.AddInteger ("Observed µs", S64 (inResult.mObservedMicroSeconds)) ;
+  frameV2.AddString ("Status", responseTimeStatusName (inResult.mStatus)) ;
+  addFrameV2 (frameV2, "Response time", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzer::addResponseTimeSummary (const uint32_t inIdentifierCount,
+                                                  const double inUtilizationPercent,
+                                                  const uint32_t inAtRiskCount,
+                                                  const uint32_t inExceededCount,
+                                                  const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("Identifiers", S64 (inIdentifierCount)) ;
+  frameV2.AddDouble ("Utilization %", inUtilizationPercent) ;
+  frameV2.AddInteger ("At risk", S64 (inAtRiskCount)) ;
+  frameV2.AddInteger ("Exceeded", S64 (inExceededCount)) ;
+  addFrameV2 (frameV2, "Response time summary", inSampleNumber, inSampleNumber) ;
+}
+
+//----------------------------------------------------------------------------------------
+//  ADAPTIVE DETAIL
+//----------------------------------------------------------------------------------------
+// A frame that starts out of full detail windows goes through the one frame per message
+// path, whatever the result frames setting: its fields are pending until its end.
+
+void CANMolinaroAnalyzer::beginFrame (const uint64_t inSampleNumber) {
+  mFrameInProgress = true ;
+  mReducedFrame = !mDetailPolicy.fullDetailAt (inSampleNumber) ;
+  mFullDetailFrame = !mReducedFrame ;
+  mPendingMarks.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+// Sends the kept marks, and the rows of the pending fields
+
+void CANMolinaroAnalyzer::promoteFrame (void) {
+  mFullDetailFrame = true ;
+  for (size_t i=0 ; i<mPendingMarks.size () ; i++) {
+    addMarker (mPendingMarks [i].mSampleNumber, mPendingMarks [i].mMarker) ;
+  }
+  mPendingMarks.clear () ;
+  if (!mChangedMessagesOnly) {
+    for (size_t i=0 ; i<mPendingFieldFrames.size () ; i++) {
+      const Frame & field = mPendingFieldFrames [i] ;
+      addFieldFrameV2 (field.mType,
+                       field.mData1,
+                       field.mData2,
+                       field.mStartingSampleInclusive,
+                       field.mEndingSampleInclusive) ;
     }
   }
 }
 
 //----------------------------------------------------------------------------------------
 
-void CANMolinaroAnalyzer::enterBitInCRC15 (const bool inBitValue) {
-  const bool bit14 = (mCRC15Accumulator & (1 << 14)) != 0 ;
-  const bool crc_nxt = inBitValue ^ bit14 ;
-  mCRC15Accumulator <<= 1 ;
-  mCRC15Accumulator &= 0x7FFF ;
-  if (crc_nxt) {
-    mCRC15Accumulator ^= 0x4599 ;
-  }
+void CANMolinaroAnalyzer::endFrame (void) {
+  mFrameInProgress = false ;
+  mReducedFrame = false ;
+  mFullDetailFrame = true ;
+  mPendingMarks.clear () ;
 }
 
 //----------------------------------------------------------------------------------------
+// Statistics only detail: one row per second of capture
 
-void CANMolinaroAnalyzer::addMark (const U64 inSampleNumber,
-                                   const AnalyzerResults::MarkerType inMarker) {
-  mResults->AddMarker (inSampleNumber, inMarker, mSettings->mInputChannel);
+void CANMolinaroAnalyzer::addTrafficSummary (const uint64_t inSampleNumber) {
+  FrameV2 frameV2 ;
+  frameV2.AddInteger ("Messages", S64 (mTrafficMessageCount)) ;
+  frameV2.AddInteger ("Messages since last summary", S64 (mTrafficMessageCount - mTrafficMessageCountAtLastSummary)) ;
+  frameV2.AddInteger ("Data bytes since last summary", S64 (mTrafficDataByteCount - mTrafficDataByteCountAtLastSummary)) ;
+  addFrameV2 (frameV2, "Traffic summary", inSampleNumber, inSampleNumber) ;
+  mTrafficMessageCountAtLastSummary = mTrafficMessageCount ;
+  mTrafficDataByteCountAtLastSummary = mTrafficDataByteCount ;
 }
 
+//----------------------------------------------------------------------------------------
+//  ONE FRAME PER MESSAGE
 //----------------------------------------------------------------------------------------
 
-void CANMolinaroAnalyzer::addBubble (const U8 inBubbleType,
-                                     const U64 inData1,
-                                     const U64 inData2,
-                                     const U64 inEndSampleNumber) {
-  Frame frame ;
-  frame.mType = inBubbleType ;
-  frame.mFlags = 0 ;
-  frame.mStartingSampleInclusive = mStartOfFieldSampleNumber ;
-  frame.mEndingSampleInclusive = inEndSampleNumber ;
-  frame.mData1 = inData1 ;
-  frame.mData2 = inData2 ;
-  mResults->AddFrame (frame) ;
+U64 CANMolinaroAnalyzer::addFrame (const Frame & inFrame) {
+  U64 frameIndex ;
+  { InstrumentationTimerScope scope (mInstrumentation, INSTR_ADD_FRAME_TIME) ;
+    frameIndex = mResults->AddFrame (inFrame) ;
+  }
+  mInstrumentation.count (INSTR_FRAMES) ;
+  return frameIndex ;
+}
 
-  FrameV2 frameV2 ;
-  switch (inBubbleType) {
-  case STANDARD_IDENTIFIER_FIELD_RESULT :
-    { const U8 idf [2] = { U8 (inData1 >> 8), U8 (inData1) } ;
-      frameV2.AddByteArray ("Value", idf, 2) ;
-      mResults->AddFrameV2 (frameV2, "Std Idf", mStartOfFieldSampleNumber, inEndSampleNumber) ;
-    }
-    break ;
-  case EXTENDED_IDENTIFIER_FIELD_RESULT :
-    { const U8 idf [4] = {
-        U8 (inData1 >> 24), U8 (inData1 >> 16), U8 (inData1 >> 8), U8 (inData1)
-      } ;
-      frameV2.AddByteArray ("Value", idf, 4) ;
-      mResults->AddFrameV2 (frameV2, "Ext Idf", mStartOfFieldSampleNumber, inEndSampleNumber) ;
-    }
-    break ;
-  case CONTROL_FIELD_RESULT :
-    frameV2.AddByte ("Value", inData1) ;
-    mResults->AddFrameV2 (frameV2, "Ctrl", mStartOfFieldSampleNumber, inEndSampleNumber) ;
-    break ;
-  case DATA_FIELD_RESULT :
-    { frameV2.AddByte ("Value", inData1) ;
-      std::stringstream str ;
-      str << "D" << inData2 ;
-      mResults->AddFrameV2 (frameV2, str.str ().c_str (), mStartOfFieldSampleNumber, inEndSampleNumber) ;
-    }
-    break ;
-  case CRC_FIELD_RESULT :
-    { const U8 crc [2] = { U8 (inData1 >> 8), U8 (inData1) } ;
-      frameV2.AddByteArray ("Value", crc, 2) ;
-      mResults->AddFrameV2 (frameV2, "CRC", mStartOfFieldSampleNumber, inEndSampleNumber) ;
+//----------------------------------------------------------------------------------------
+// Pending fields are the fields of the message (from SOF up to EOF, or IFS if the
+// intermission has completed). Offsets are stored on 24 bits: a (very) slow frame falls
+// back to field frames. In changed messages only mode, an unchanged message is dropped,
+// unless it is followed by an error (inForced) or it is not acknowledged; it is still
+// stored. The message row spans the CAN_MESSAGE_RESULT frame.
+
+void CANMolinaroAnalyzer::flushPendingMessage (const bool inForced) {
+  uint64_t foldedCount = 0 ;
+  if (mHasPendingMessage && mChangedMessagesOnly
+   && !mDeltaFilter.enter (mPendingMessage, inForced || !mPendingMessage.mAcked, foldedCount)) {
+    mHasPendingMessage = false ;
+    mPendingFieldFrames.clear () ;
+    storeMessage (mPendingMessage, CAN_MESSAGE_STORE_NO_FRAME) ;
+  }
+  if (mHasPendingMessage && !mFullDetailFrame && (mDetailPolicy.level () == DETAIL_ADAPTIVE_STATISTICS)) {
+    mHasPendingMessage = false ;
+    mPendingFieldFrames.clear () ;
+    storeMessage (mPendingMessage, CAN_MESSAGE_STORE_NO_FRAME) ;
+  }
+  if (mHasPendingMessage) {
+    mHasPendingMessage = false ;
+    const U64 start = mPendingMessage.mStartSampleNumber ;
+    const U64 end = mPendingFieldFrames.empty ()
+      ? mPendingMessage.mEndSampleNumber
+      : mPendingFieldFrames.back ().mEndingSampleInclusive
+    ;
+    if ((end - start) <= CAN_MESSAGE_FIELD_MAX_OFFSET) {
+      uint32_t crc = 0 ;
+      mMessageFields.clear () ;
+      for (size_t i=0 ; i<mPendingFieldFrames.size () ; i++) {
+        const Frame & field = mPendingFieldFrames [i] ;
+        uint8_t value = 0 ;
+        switch (field.mType) {
+        case DATA_FIELD_RESULT :
+        case STUFF_COUNT_FIELD_RESULT :
+          value = uint8_t (field.mData1) ;
+          break ;
+        case INTERMISSION_FIELD_RESULT :
+          value = uint8_t ((field.mData2 > 255) ? 255 : field.mData2) ;
+          break ;
+        case CRC_FIELD_RESULT :
+          crc = uint32_t (field.mData1) ;
+          break ;
+        default :
+          break ;
+        }
+        CANMessageField f ;
+        f.set (uint32_t (field.mStartingSampleInclusive - start),
+               uint32_t (field.mEndingSampleInclusive - start),
+               field.mType,
+               value) ;
+        mMessageFields.push_back (f) ;
+      }
+      Frame frame ;
+      frame.mType = CAN_MESSAGE_RESULT ;
+      frame.mFlags = 0 ;
+      frame.mStartingSampleInclusive = start ;
+      frame.mEndingSampleInclusive = end ;
+      frame.mData1 = packedMessageData1 (mPendingMessage, crc) ;
+      frame.mData2 = 0 ;
+      for (uint32_t i=0 ; (i<mPendingMessage.mDataLength) && (i<8) ; i++) {
+        frame.mData2 |= U64 (mPendingMessage.mData [i]) << (56 - 8 * i) ;
+      }
+      mResults->addMessageFields (start, mMessageFields) ;
+      mMessageFrameIndex = addFrame (frame) ;
+      mPendingFieldFrames.clear () ;
+      if (mChangedMessagesOnly || !mFullDetailFrame) {
+        FrameV2 frameV2 ;
+        frameV2.AddInteger ("Idf", S64 (mPendingMessage.mIdentifier)) ;
+        frameV2.AddBoolean ("Extended", mPendingMessage.mExtended) ;
+        frameV2.AddInteger ("DLC", S64 (mPendingMessage.mDataCodeLength)) ;
+        frameV2.AddByteArray ("Data", mPendingMessage.mData, mPendingMessage.mDataLength) ;
+        if (mChangedMessagesOnly) {
+          frameV2.AddInteger ("Unchanged before", S64 (foldedCount)) ;
+          addFrameV2 (frameV2, mPendingMessage.mRemote ? "Changed remote" : "Changed", start, end) ;
+        }else{
+          addFrameV2 (frameV2, mPendingMessage.mRemote ? "Remote message" : "Message", start, end) ;
+        }
+      }
+      storeMessage (mPendingMessage, mMessageFrameIndex) ;
+    }else{ // Sent as field frames: the identifier field frame is the message frame
+      flushPendingFieldFrames () ;
+      storeMessage (mPendingMessage, mMessageFrameIndex) ;
     }
-    break ;
-  case ACK_FIELD_RESULT :
-	frameV2.AddByte("Value", inData1);
-    mResults->AddFrameV2 (frameV2, "ACK", mStartOfFieldSampleNumber, inEndSampleNumber) ;
-    break ;
-  case EOF_FIELD_RESULT :
-    mResults->AddFrameV2 (frameV2, "EOF", mStartOfFieldSampleNumber, inEndSampleNumber) ;
-    break ;
-  case INTERMISSION_FIELD_RESULT :
-    { const U64 frameSampleCount = inData1 ;
-      const U32 samplesPerBit = mSampleRateHz / mSettings->mBitRate ;
-      const U64 length = (frameSampleCount + samplesPerBit / 2) / samplesPerBit ;
-      const U64 stuffBitCount = inData2 ;
-      const U64 durationMicroSeconds = frameSampleCount * 1000000 / mSampleRateHz ;
-      std::stringstream str ;
-      str << length << " bits, "
-          << durationMicroSeconds << "µs, "
-          << stuffBitCount << " stuff bit" << ((inData2 > 1) ? "s" : "") ;
-      frameV2.AddString ("Value", str.str ().c_str ()) ;
-      mResults->AddFrameV2 (frameV2, "IFS", mStartOfFieldSampleNumber, inEndSampleNumber) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Fields of an incomplete frame (or of a message too long for the side table)
+
+void CANMolinaroAnalyzer::flushPendingFieldFrames (void) {
+  for (size_t i=0 ; i<mPendingFieldFrames.size () ; i++) {
+    const U64 frameIndex = addFrame (mPendingFieldFrames [i]) ;
+    const uint8_t type = mPendingFieldFrames [i].mType ;
+    if ((type == STANDARD_IDENTIFIER_FIELD_RESULT) || (type == EXTENDED_IDENTIFIER_FIELD_RESULT)) {
+      mMessageFrameIndex = frameIndex ;
     }
-    break ;
-  case CAN_ERROR_RESULT :
-    mResults->AddFrameV2 (frameV2, "Error", mStartOfFieldSampleNumber, inEndSampleNumber) ;
-    break ;
-  default:
-    mResults->AddFrameV2 (frameV2, "?", mStartOfFieldSampleNumber, inEndSampleNumber) ;
-    break ;
   }
+  mPendingFieldFrames.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+//  INSTRUMENTATION (see CANMolinaroInstrumentation.h)
+//----------------------------------------------------------------------------------------
 
-  mResults->CommitResults () ;
-  ReportProgress (frame.mEndingSampleInclusive) ;
-//--- Prepare for next bubble
-  mStartOfFieldSampleNumber = inEndSampleNumber ;
+void CANMolinaroAnalyzer::addFrameV2 (const FrameV2 & inFrameV2,
+                                      const char * inType,
+                                      const U64 inStartSampleNumber,
+                                      const U64 inEndSampleNumber) {
+  { InstrumentationTimerScope scope (mInstrumentation, INSTR_ADD_FRAME_V2_TIME) ;
+    mResults->AddFrameV2 (inFrameV2, inType, inStartSampleNumber, inEndSampleNumber) ;
+  }
+  mInstrumentation.count (INSTR_FRAMES_V2) ;
 }
 
 //----------------------------------------------------------------------------------------
 
-void CANMolinaroAnalyzer::enterInErrorMode (const U64 inSampleNumber) {
-  mStartOfFieldSampleNumber = inSampleNumber ;
-  mFrameFieldEngineState = DECODER_ERROR ;
-  mUnstuffingActive = false ;
+void CANMolinaroAnalyzer::commitResults (void) {
+  { InstrumentationTimerScope scope (mInstrumentation, INSTR_COMMIT_RESULTS_TIME) ;
+    mResults->CommitResults () ;
+  }
+  mInstrumentation.count (INSTR_COMMITS) ;
+}
+
+//----------------------------------------------------------------------------------------
+// Cumulative counters, one row per second of capture. Decoder time is the worker thread
+// time not spent in SDK calls. Result bytes are an estimate: a marker is a sample number
+// and a type, a FrameV2 row is counted as a Frame plus its key / value strings.
+
+void CANMolinaroAnalyzer::addInstrumentationSummary (const uint64_t inSampleNumber) {
+  if (CANMolinaroInstrumentation::enabled) {
+    const uint64_t elapsed = mInstrumentation.elapsedNanoseconds () ;
+    uint64_t sdkTime = 0 ;
+    for (uint32_t i=0 ; i<INSTR_TIMER_COUNT ; i++) {
+      sdkTime += mInstrumentation.nanoseconds (InstrumentationTimer (i)) ;
+    }
+    const uint64_t resultBytes =
+      mInstrumentation.counter (INSTR_MARKERS) * (sizeof (U64) + sizeof (U32))
+    + mInstrumentation.counter (INSTR_FRAMES) * sizeof (Frame)
+    + mInstrumentation.counter (INSTR_FRAMES_V2) * (sizeof (Frame) + 32)
+    ;
+    const uint64_t captureMicroSeconds = (inSampleNumber - mFirstSampleNumber) * 1000000 / mSampleRateHz ;
+    FrameV2 frameV2 ;
+    frameV2.AddInteger ("Edges", S64 (mInstrumentation.counter (INSTR_EDGES))) ;
+    frameV2.AddInteger ("Bits", S64 (mInstrumentation.counter (INSTR_BITS))) ;
+    frameV2.AddInteger ("Stuff bits", S64 (mDecoder.stuffBitTotal ())) ;
+    frameV2.AddInteger ("Markers", S64 (mInstrumentation.counter (INSTR_MARKERS))) ;
+    frameV2.AddInteger ("Frames", S64 (mInstrumentation.counter (INSTR_FRAMES))) ;
+    frameV2.AddInteger ("FramesV2", S64 (mInstrumentation.counter (INSTR_FRAMES_V2))) ;
+    frameV2.AddInteger ("Commits", S64 (mInstrumentation.counter (INSTR_COMMITS))) ;
+    frameV2.AddInteger ("Progress reports", S64 (mInstrumentation.counter (INSTR_PROGRESS_REPORTS))) ;
+    frameV2.AddInteger ("Decoder µs", S64 ((elapsed - sdkTime) / 1000)) ;
+    frameV2.AddInteger ("Channel data µs", S64 (mInstrumentation.nanoseconds (INSTR_CHANNEL_DATA_TIME) / 1000)) ;
+    frameV2.AddInteger ("AddMarker µs", S64 (mInstrumentation.nanoseconds (INSTR_ADD_MARKER_TIME) / 1000)) ;
+    frameV2.AddInteger ("AddFrame µs", S64 (mInstrumentation.nanoseconds (INSTR_ADD_FRAME_TIME) / 1000)) ;
+    frameV2.AddInteger ("AddFrameV2 µs", S64 (mInstrumentation.nanoseconds (INSTR_ADD_FRAME_V2_TIME) / 1000)) ;
+    frameV2.AddInteger ("CommitResults µs", S64 (mInstrumentation.nanoseconds (INSTR_COMMIT_RESULTS_TIME) / 1000)) ;
+    frameV2.AddInteger ("ReportProgress µs", S64 (mInstrumentation.nanoseconds (INSTR_REPORT_PROGRESS_TIME) / 1000)) ;
+    frameV2.AddInteger ("Result bytes/s", S64 ((captureMicroSeconds == 0) ? 0 : (resultBytes * 1000000 / captureMicroSeconds))) ;
+    addFrameV2 (frameV2, "Instrumentation", inSampleNumber, inSampleNumber) ;
+  }
 }
 
 //----------------------------------------------------------------------------------------
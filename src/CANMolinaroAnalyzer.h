@@ -6,6 +6,19 @@
 #include <Analyzer.h>
 #include "CANMolinaroAnalyzerResults.h"
 #include "CANMolinaroSimulationDataGenerator.h"
+#include "CANFrameDecoder.h"
+#include "CANISOTPReassembler.h"
+#include "CANJ1939Decoder.h"
+#include "CANMessageStore.h"
+#include "CANSharedMemoryTap.h"
+#include "CANLiveLog.h"
+#include "CANGatewayCorrelator.h"
+#include "CANPhaseErrors.h"
+#include "CANPeriodStatistics.h"
+#include "CANResponseTimeAnalysis.h"
+#include "CANDeltaFilter.h"
+#include "CANDetailPolicy.h"
+#include "CANMolinaroInstrumentation.h"
 
 //----------------------------------------------------------------------------------------
 
@@ -13,7 +26,15 @@ class CANMolinaroAnalyzerSettings;
 
 //----------------------------------------------------------------------------------------
 
-class ANALYZER_EXPORT CANMolinaroAnalyzer : public Analyzer2 {
+class ANALYZER_EXPORT CANMolinaroAnalyzer : public Analyzer2,
+                                           public CANFrameDecoderDelegate,
+                                           public CANISOTPReassemblerDelegate,
+                                           public CANJ1939DecoderDelegate,
+                                           public CANDeltaFilterDelegate,
+                                           public CANGatewayCorrelatorDelegate,
+                                           public CANPhaseErrorsDelegate,
+                                           public CANPeriodStatisticsDelegate,
+                                           public CANResponseTimeDelegate {
 
   public: CANMolinaroAnalyzer();
 
@@ -32,17 +53,12 @@ class ANALYZER_EXPORT CANMolinaroAnalyzer : public Analyzer2 {
 
   public: virtual bool NeedsRerun();
 
-  private: void enterBit (const bool inBit, const U64 inSampleNumber) ;
-  private: void decodeFrameBit (const bool inBit, const U64 inSampleNumber) ;
-
-
 //--- Protected properties
   protected: std::unique_ptr < CANMolinaroAnalyzerSettings > mSettings;
   protected: std::unique_ptr < CANMolinaroAnalyzerResults > mResults;
 
   protected: CANMolinaroSimulationDataGenerator mSimulationDataGenerator;
   protected: bool mSimulationInitilized ;
-  protected: bool mAcked ;
 
   //Serial analysis vars:
   protected: U32 mSampleRateHz;
@@ -52,49 +68,192 @@ class ANALYZER_EXPORT CANMolinaroAnalyzer : public Analyzer2 {
   public: inline U32 sampleRateHz (void) const { return mSampleRateHz ;  }
   public: U32 bitRate (void) const ;
 
-//---------------- CAN decoder properties
-//--- CAN protocol
-  private: typedef enum  {
-    IDLE, IDENTIFIER, CONTROL, EXTENDED_IDF, DATA,
-    CRC15, CRC_DEL, ACK, END_OF_FRAME, INTERMISSION, DECODER_ERROR
-  } FrameFieldEngineState ;
-
-  private: FrameFieldEngineState mFrameFieldEngineState ;
-  private: int mFieldBitIndex ;
-  private: int mConsecutiveBitCountOfSamePolarity ;
-  private: bool mPreviousBit ;
-  private: bool mUnstuffingActive ;
-
-  private: U64 mStartOfFrameSampleNumber ;
-  private: U64 mStuffBitCount ;
-  private: U64 mStartOfFieldSampleNumber ;
-
-//--- Received frame
-  private: typedef enum {dataFrame, remoteFrame} FrameType ;
-  private: uint32_t mIdentifier ;
-  private: FrameType mFrameType ; // data, remote
-  private: int mDataCodeLength ;
-  private: uint8_t mData [8] ;
-  private: U16 mCRC15Accumulator ;
-  private: U16 mCRC15 ;
-
-//---------------- CAN decoder methods
-  private: void enterBitInCRC15 (const bool inBit) ;
-  private: void addMark (const U64 inSampleNumber, const AnalyzerResults::MarkerType inMarker) ;
-  private: void addBubble (const U8 inBubbleType, const U64 inData1, const U64 inData2, const U64 inEndSampleNumber) ;
-  private: void enterInErrorMode (const U64 inSampleNumber) ;
-
-  private: void handle_IDLE_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_IDENTIFIER_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_EXTENDED_IDF_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_CONTROL_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_DATA_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_CRC15_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_CRCDEL_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_ACK_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_ENDOFFRAME_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_INTERMISSION_state (const bool inBit, const U64 inSampleNumber) ;
-  private: void handle_DECODER_ERROR_state (const bool inBit, const U64 inSampleNumber) ;
+//---------------- CAN decoder
+  private: CANFrameDecoder mDecoder ;
+
+//---------------- One frame per message (see CANMolinaroAnalyzerResults.h)
+  private: bool mOneFramePerMessage ;
+  private: std::vector <Frame> mPendingFieldFrames ; // Fields of the current CAN frame
+  private: CANDecodedMessage mPendingMessage ; // Valid at EOF, sent at IFS end
+  private: bool mHasPendingMessage ;
+  private: std::vector <CANMessageField> mMessageFields ;
+  private: U64 addFrame (const Frame & inFrame) ;
+  private: void flushPendingMessage (const bool inForced) ;
+  private: void flushPendingFieldFrames (void) ;
+
+//---------------- ISO-TP reassembly
+  private: CANISOTPReassembler mISOTP ;
+
+//---------------- J1939
+  private: CANJ1939Decoder mJ1939 ;
+
+//---------------- Payload search (see CANMessageStore.h)
+  private: std::vector <CANPayloadPattern> mPayloadPatterns ;
+  private: CANMessageStore mMessageStore ;
+  private: U64 mMessageFrameIndex ; // Identifier field frame, or CAN_MESSAGE_RESULT frame
+  private: std::vector <size_t> mMatchingRows ;
+  private: std::vector <size_t> mMatches ; // row * pattern count + pattern index
+  private: void storeMessage (const CANDecodedMessage & inMessage, const U64 inFrameIndex) ;
+  private: void searchStoredMessages (const U64 inSampleNumber) ;
+
+//---------------- Live tap (see CANSharedMemoryTap.h)
+  private: CANSharedMemoryTap mLiveTap ;
+
+//---------------- Live log (see CANLiveLog.h)
+  private: CANLiveLog mLiveLog ;
+  private: U64 mLiveLogDroppedCountAtLastSummary ;
+  private: bool mLiveLogErrorReported ;
+  private: void addLiveLogSummary (const uint64_t inSampleNumber) ;
+
+//---------------- Gateway latency (see CANGatewayCorrelator.h)
+  private: CANGatewayCorrelator mGateway ;
+  private: CANFrameDecoder mGatewayDecoder ; // Egress channel, sends its messages to mGateway
+  private: AnalyzerChannelData * mGatewayChannel ;
+  private: uint64_t mGatewayBitStart ; // Bit boundary expected by mGatewayDecoder
+  private: void decodeGatewayChannel (const U64 inSampleNumber, const bool inInverted) ;
+
+//---------------- Phase errors (see CANPhaseErrors.h)
+  private: CANPhaseErrors mPhaseErrors ;
+
+//---------------- Period statistics (see CANPeriodStatistics.h)
+  private: CANPeriodStatistics mPeriods ;
+
+//---------------- Response time analysis (see CANResponseTimeAnalysis.h)
+  private: CANResponseTimeAnalysis mResponseTimes ;
+
+//---------------- Glitch filter
+  private: U64 mGlitchCount ;
+  private: U64 mGlitchCountAtLastSummary ;
+  private: U64 skipGlitches (AnalyzerChannelData * inChannel,
+                             const U64 inNextEdge,
+                             const U64 inMinimumPulseWidth) ;
+
+//---------------- Decode window (see CANDecodeWindow.h)
+  private: void synchronizeToBusIdle (AnalyzerChannelData * inChannel,
+                                      const bool inInverted,
+                                      const U32 inSamplesPerBit) ;
+  private: void endOfWindow (AnalyzerChannelData * inChannel,
+                             const U64 inWindowEndSampleNumber,
+                             const bool inInverted) ;
+  private: void ignoreRemainingSamples (AnalyzerChannelData * inChannel) ;
+
+//---------------- Changed messages only (see CANDeltaFilter.h)
+  private: bool mChangedMessagesOnly ;
+  private: CANDeltaFilter mDeltaFilter ;
+
+//---------------- Adaptive detail (see CANDetailPolicy.h)
+  private: CANDetailPolicy mDetailPolicy ;
+  private: bool mFrameInProgress ; // From SOF to IFS or error
+  private: bool mReducedFrame ; // Started out of full detail windows: one frame per message
+  private: bool mFullDetailFrame ; // Markers and field rows are sent
+  private: class PendingMark {
+    public: U64 mSampleNumber ;
+    public: CANDecoderMarker mMarker ;
+  } ;
+  private: std::vector <PendingMark> mPendingMarks ; // Of a reduced frame
+  private: U64 mTrafficMessageCount ;
+  private: U64 mTrafficMessageCountAtLastSummary ;
+  private: U64 mTrafficDataByteCount ;
+  private: U64 mTrafficDataByteCountAtLastSummary ;
+  private: void addMarker (const uint64_t inSampleNumber, const CANDecoderMarker inMarker) ;
+  private: void beginFrame (const uint64_t inSampleNumber) ;
+  private: void promoteFrame (void) ;
+  private: void endFrame (void) ;
+  private: void addTrafficSummary (const uint64_t inSampleNumber) ;
+
+//---------------- Summaries, one per second of capture
+  private: U64 mNextSummarySampleNumber ;
+  private: U64 mErrorCountAtLastSummary ;
+  private: void addSummaries (const uint64_t inSampleNumber) ;
+  private: void addErrorSummary (const uint64_t inSampleNumber) ;
+  private: void addGlitchSummary (const uint64_t inSampleNumber) ;
+  private: void addInstrumentationSummary (const uint64_t inSampleNumber) ;
+
+//---------------- Instrumentation
+  private: CANMolinaroInstrumentation mInstrumentation ;
+  private: U64 mFirstSampleNumber ;
+  private: void addFrameV2 (const FrameV2 & inFrameV2,
+                            const char * inType,
+                            const U64 inStartSampleNumber,
+                            const U64 inEndSampleNumber) ;
+  private: void commitResults (void) ;
+
+//---------------- CANFrameDecoderDelegate
+  public: virtual void addMark (const uint64_t inSampleNumber, const CANDecoderMarker inMarker) ;
+
+  public: virtual void addBubble (const uint8_t inBubbleType,
+                                  const uint64_t inData1,
+                                  const uint64_t inData2,
+                                  const uint64_t inStartSampleNumber,
+                                  const uint64_t inEndSampleNumber) ;
+
+  public: virtual void addMessage (const CANDecodedMessage & inMessage) ;
+
+  private: void addFieldFrameV2 (const uint8_t inBubbleType,
+                                 const uint64_t inData1,
+                                 const uint64_t inData2,
+                                 const uint64_t inStartSampleNumber,
+                                 const uint64_t inEndSampleNumber) ;
+
+//---------------- CANISOTPReassemblerDelegate
+  public: virtual void addISOTPPDU (const ISOTPPDU & inPDU) ;
+
+  public: virtual void addISOTPError (const ISOTPErrorKind inKind,
+                                      const uint32_t inIdentifierKey,
+                                      const uint64_t inSampleNumber) ;
+
+//---------------- CANJ1939DecoderDelegate
+  public: virtual void addJ1939TransportMessage (const J1939TransportMessage & inMessage) ;
+
+  public: virtual void addJ1939TransportError (const J1939ErrorKind inKind,
+                                               const uint32_t inPGN,
+                                               const uint8_t inSourceAddress,
+                                               const uint8_t inDestinationAddress,
+                                               const uint64_t inSampleNumber) ;
+
+  public: virtual void addJ1939PGNRate (const uint32_t inPGN,
+                                        const J1939PGNCounters & inCounters,
+                                        const uint64_t inFramesPerSecond,
+                                        const uint64_t inSampleNumber) ;
+
+//---------------- CANDeltaFilterDelegate
+  public: virtual void addRepeats (const uint32_t inIdentifierKey,
+                                   const uint64_t inRepeatCount,
+                                   const uint64_t inLastSeenSampleNumber,
+                                   const uint64_t inSampleNumber) ;
+
+//---------------- CANGatewayCorrelatorDelegate
+  public: virtual void addGatewayStatistics (const uint32_t inIdentifierKey,
+                                             const CANGatewayStatistics & inStatistics,
+                                             const uint64_t inSampleNumber) ;
+
+//---------------- CANPhaseErrorsDelegate
+  public: virtual void addPhaseErrorFrame (const CANPhaseHistogram & inFrame,
+                                           const bool inWarning,
+                                           const uint64_t inSampleNumber) ;
+
+  public: virtual void addPhaseErrorSummary (const CANPhaseHistogram & inCapture,
+                                             const uint64_t inWarningCount,
+                                             const uint64_t inSampleNumber) ;
+
+  public: virtual void addPhaseErrorIdentifier (const uint32_t inIdentifierKey,
+                                                const CANPhaseHistogram & inHistogram,
+                                                const uint64_t inSampleNumber) ;
+
+//---------------- CANPeriodStatisticsDelegate
+  public: virtual void addPeriodStatistics (const CANPeriodEntry & inEntry,
+                                            const CANPeriodStatistics & inStatistics,
+                                            const uint64_t inSampleNumber) ;
+
+//---------------- CANResponseTimeDelegate
+  public: virtual void addResponseTime (const CANResponseTimeResult & inResult,
+                                        const uint64_t inSampleNumber) ;
+
+  public: virtual void addResponseTimeSummary (const uint32_t inIdentifierCount,
+                                               const double inUtilizationPercent,
+                                               const uint32_t inAtRiskCount,
+                                               const uint32_t inExceededCount,
+                                               const uint64_t inSampleNumber) ;
 } ;
 
 //----------------------------------------------------------------------------------------
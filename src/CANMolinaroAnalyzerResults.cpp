@@ -2,9 +2,11 @@
 #include <AnalyzerHelpers.h>
 #include "CANMolinaroAnalyzer.h"
 #include "CANMolinaroAnalyzerSettings.h"
+#include "CANColumnarFile.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 //----------------------------------------------------------------------------------------
 
@@ -12,7 +14,8 @@ CANMolinaroAnalyzerResults::CANMolinaroAnalyzerResults (CANMolinaroAnalyzer* ana
                                                         CANMolinaroAnalyzerSettings* settings) :
 AnalyzerResults (),
 mSettings (settings),
-mAnalyzer (analyzer) {
+mAnalyzer (analyzer),
+mTextCache (TEXT_CACHE_BYTE_BUDGET) {
 }
 
 //----------------------------------------------------------------------------------------
@@ -51,11 +54,27 @@ void CANMolinaroAnalyzerResults::GenerateText (const Frame & inFrame,
 //    ioText << (((inFrame.mStartingSampleInclusive - triggerSample) * 1000000) / sampleRateHz) << " µs: " ;
     ioText << ((inFrame.mData2 == 0) ? "Ext Remote idf: " : "Ext Data idf: ") ;
     ioText << numberString ;
+    if (mSettings->j1939 ()) {
+      const J1939Identifier j1939 = j1939Identifier (uint32_t (inFrame.mData1)) ;
+      snprintf (numberString, 128, " (P%u PGN 0x%05X SA 0x%02X DA 0x%02X)",
+                j1939.mPriority, j1939.mPGN, j1939.mSourceAddress, j1939.mDestinationAddress) ;
+      ioText << numberString ;
+    }
     ioText << "\n" ;
     break ;
-  case CONTROL_FIELD_RESULT :
+  case CONTROL_FIELD_RESULT : // Data1: DLC, Data2: CAN FD flags
     if (inBubbleText) {
-      ioText << "Ctrl: " << inFrame.mData1 << "\n" ;
+      ioText << "Ctrl: " << inFrame.mData1 ;
+      if ((inFrame.mData2 & CAN_FD_FDF_FLAG) != 0) {
+        ioText << " FD" ;
+        if ((inFrame.mData2 & CAN_FD_BRS_FLAG) != 0) {
+          ioText << ", BRS" ;
+        }
+        if ((inFrame.mData2 & CAN_FD_ESI_FLAG) != 0) {
+          ioText << ", ESI" ;
+        }
+      }
+      ioText << "\n" ;
     }
     break ;
   case DATA_FIELD_RESULT :
@@ -78,6 +97,16 @@ void CANMolinaroAnalyzerResults::GenerateText (const Frame & inFrame,
       ioText << "CRC: " << numberString << "\n" ;
     }
     break ;
+  case STUFF_COUNT_FIELD_RESULT : // Data1: stuff count, Data2: is 0 if stuff count ok
+    if (inFrame.mData2 != 0) {
+      if (!inBubbleText) {
+        ioText << "  " ;
+      }
+      ioText << "SBC: " << inFrame.mData1 << " (error)\n" ;
+    }else if (inBubbleText) {
+      ioText << "SBC: " << inFrame.mData1 << "\n" ;
+    }
+    break ;
   case ACK_FIELD_RESULT :
     if (inBubbleText) {
       if (inFrame.mData1 != 0) {
@@ -104,6 +133,22 @@ void CANMolinaroAnalyzerResults::GenerateText (const Frame & inFrame,
              << "\n" ;
     }
     break ;
+  case CAN_ERROR_RESULT : // Data1: kind | (flag << 8), Data2: identifier key | (known << 32)
+    { const CANErrorFlag flag = CANErrorFlag ((inFrame.mData1 >> 8) & 0xFF) ;
+      if (!inBubbleText) {
+        ioText << "  " ;
+      }
+      ioText << errorKindName (CANErrorKind (inFrame.mData1 & 0xFF)) ;
+      if (!inBubbleText && (flag != CAN_NO_ERROR_FLAG)) {
+        ioText << ", " << errorFlagName (flag) << " error flag" ;
+      }
+      if (!inBubbleText && ((inFrame.mData2 >> 32) != 0)) {
+        snprintf (numberString, 128, "0x%llX", inFrame.mData2 & 0x7FFFFFFF) ;
+        ioText << ", idf " << numberString ;
+      }
+      ioText << "\n" ;
+    }
+    break ;
   default :
     ioText << "Error\n" ;
     break ;
@@ -115,11 +160,52 @@ void CANMolinaroAnalyzerResults::GenerateText (const Frame & inFrame,
 void CANMolinaroAnalyzerResults::GenerateBubbleText (const U64 inFrameIndex,
                                                      Channel & channel,
                                                      const DisplayBase inDisplayBase) {
-  const Frame frame = GetFrame (inFrameIndex) ;
-  std::stringstream text ;
-  GenerateText (frame, inDisplayBase, true, text) ;
   ClearResultStrings () ;
-  AddResultString (text.str().c_str ()) ;
+  std::vector <std::string> strings ;
+  if (!mTextCache.find (inFrameIndex, uint32_t (inDisplayBase), true, strings)) {
+    generateBubbleStrings (GetFrame (inFrameIndex), inDisplayBase, strings) ;
+    mTextCache.insert (inFrameIndex, uint32_t (inDisplayBase), true, strings) ;
+  }
+  for (size_t i=0 ; i<strings.size () ; i++) {
+    AddResultString (strings [i].c_str ()) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzerResults::generateBubbleStrings (const Frame & inFrame,
+                                                        const DisplayBase inDisplayBase,
+                                                        std::vector <std::string> & outStrings) {
+  if (inFrame.mType != CAN_MESSAGE_RESULT) {
+    std::stringstream text ;
+    GenerateText (inFrame, inDisplayBase, true, text) ;
+    outStrings.push_back (text.str ()) ;
+  }else{ // Shortest first: the identifier, the identifier field, all fields
+    std::vector <Frame> fields ;
+    fieldFrames (inFrame, fields) ;
+    if (fields.empty ()) {
+      rawMessageFieldFrames (inFrame, fields) ;
+    }
+    std::string allFields ;
+    for (size_t i=0 ; i<fields.size () ; i++) {
+      std::stringstream text ;
+      GenerateText (fields [i], inDisplayBase, true, text) ;
+      std::string fieldText = text.str () ;
+      if ((fieldText.length () > 0) && (fieldText [fieldText.length () - 1] == '\n')) {
+        fieldText.erase (fieldText.length () - 1) ;
+      }
+      if (i == 0) {
+        char numberString [32] = "" ;
+        snprintf (numberString, 32, "0x%llX", inFrame.mData1 & 0x1FFFFFFF) ;
+        outStrings.push_back (numberString) ;
+        outStrings.push_back (fieldText) ;
+      }else{
+        allFields += "  " ;
+      }
+      allFields += fieldText ;
+    }
+    outStrings.push_back (allFields) ;
+  }
 }
 
 //----------------------------------------------------------------------------------------
@@ -127,12 +213,22 @@ void CANMolinaroAnalyzerResults::GenerateBubbleText (const U64 inFrameIndex,
 void CANMolinaroAnalyzerResults::GenerateFrameTabularText (const U64 inFrameIndex,
                                                            const DisplayBase inDisplayBase) {
   #ifdef SUPPORTS_PROTOCOL_SEARCH
-    const Frame frame = GetFrame (inFrameIndex) ;
-    std::stringstream text ;
-    GenerateText (frame, inDisplayBase, false, text) ;
+    std::vector <std::string> strings ;
+    if (!mTextCache.find (inFrameIndex, uint32_t (inDisplayBase), false, strings)) {
+      std::vector <Frame> fields ;
+      fieldFrames (GetFrame (inFrameIndex), fields) ;
+      std::stringstream text ;
+      for (size_t i=0 ; i<fields.size () ; i++) {
+        GenerateText (fields [i], inDisplayBase, false, text) ;
+      }
+      if (text.str().length () > 0) {
+        strings.push_back (text.str ()) ;
+      }
+      mTextCache.insert (inFrameIndex, uint32_t (inDisplayBase), false, strings) ;
+    }
     ClearTabularText () ;
-    if (text.str().length () > 0) {
-      AddTabularText (text.str().c_str ()) ;
+    for (size_t i=0 ; i<strings.size () ; i++) {
+      AddTabularText (strings [i].c_str ()) ;
     }
   #endif
 }
@@ -143,6 +239,11 @@ void CANMolinaroAnalyzerResults::GenerateExportFile (const char* file,
                                                      DisplayBase display_base,
                                                      U32 export_type_user_id )
 {
+  if (export_type_user_id == EXPORT_COLUMNAR) {
+    generateColumnarExportFile (file) ;
+    return ;
+  }
+
   std::ofstream file_stream( file, std::ios::out );
 
   U64 trigger_sample = mAnalyzer->GetTriggerSample();
@@ -151,17 +252,21 @@ void CANMolinaroAnalyzerResults::GenerateExportFile (const char* file,
   file_stream << "Time [s],Value" << std::endl;
 
   U64 num_frames = GetNumFrames();
+  std::vector <Frame> fields ;
   for( U32 i=0; i < num_frames; i++ )
   {
-    Frame frame = GetFrame( i );
+    fields.clear () ;
+    fieldFrames (GetFrame (i), fields) ;
 
-    char time_str[128];
-    AnalyzerHelpers::GetTimeString( frame.mStartingSampleInclusive, trigger_sample, sample_rate, time_str, 128 );
+    for (size_t f=0 ; f<fields.size () ; f++) {
+      char time_str[128];
+      AnalyzerHelpers::GetTimeString( fields [f].mStartingSampleInclusive, trigger_sample, sample_rate, time_str, 128 );
 
-    char number_str[128];
-    AnalyzerHelpers::GetNumberString( frame.mData1, display_base, 8, number_str, 128 );
+      char number_str[128];
+      AnalyzerHelpers::GetNumberString( fields [f].mData1, display_base, 8, number_str, 128 );
 
-    file_stream << time_str << "," << number_str << std::endl;
+      file_stream << time_str << "," << number_str << std::endl;
+    }
 
     if( UpdateExportProgressAndCheckForCancel( i, num_frames ) == true )
     {
@@ -173,6 +278,76 @@ void CANMolinaroAnalyzerResults::GenerateExportFile (const char* file,
   file_stream.close();
 }
 
+//----------------------------------------------------------------------------------------
+// A message starts at its identifier field (SOF sample point half a bit before), and is
+// written at EOF; a CAN error frame drops it. The export has no way to report an error:
+// a failed write leaves a file without index, that the reader rejects.
+
+void CANMolinaroAnalyzerResults::generateColumnarExportFile (const char * inFile) {
+  const U32 samplesPerBit = mAnalyzer->sampleRateHz () / mAnalyzer->bitRate () ;
+  CANColumnarWriter writer ;
+  std::string error ;
+  bool ok = writer.open (inFile, mAnalyzer->GetSampleRate (), mAnalyzer->GetTriggerSample (), error) ;
+  CANDecodedMessage message ;
+  bool inMessage = false ;
+  const U64 frameCount = GetNumFrames () ;
+  std::vector <Frame> fields ;
+  for (U64 i=0 ; ok && (i<frameCount) ; i++) {
+    fields.clear () ;
+    fieldFrames (GetFrame (i), fields) ;
+    for (size_t f=0 ; ok && (f<fields.size ()) ; f++) {
+      const Frame & field = fields [f] ;
+      switch (field.mType) {
+      case STANDARD_IDENTIFIER_FIELD_RESULT :
+      case EXTENDED_IDENTIFIER_FIELD_RESULT :
+        inMessage = true ;
+        message.mStartSampleNumber = field.mStartingSampleInclusive - samplesPerBit / 2 ;
+        message.mIdentifier = uint32_t (field.mData1) ;
+        message.mExtended = field.mType == EXTENDED_IDENTIFIER_FIELD_RESULT ;
+        message.mRemote = field.mData2 == 0 ;
+        message.mAcked = false ;
+        message.mFD = false ;
+        message.mBRS = false ;
+        message.mESI = false ;
+        message.mDataCodeLength = 0 ;
+        message.mDataLength = 0 ;
+        break ;
+      case CONTROL_FIELD_RESULT : // Data1: DLC, Data2: CAN FD flags
+        message.mDataCodeLength = uint8_t (field.mData1) ;
+        message.mFD = (field.mData2 & CAN_FD_FDF_FLAG) != 0 ;
+        message.mBRS = (field.mData2 & CAN_FD_BRS_FLAG) != 0 ;
+        message.mESI = (field.mData2 & CAN_FD_ESI_FLAG) != 0 ;
+        break ;
+      case DATA_FIELD_RESULT : // Data1: byte, Data2: index
+        if (field.mData2 < 64) {
+          message.mData [field.mData2] = uint8_t (field.mData1) ;
+        }
+        break ;
+      case ACK_FIELD_RESULT :
+        message.mAcked = field.mData1 == 0 ;
+        break ;
+      case EOF_FIELD_RESULT :
+        if (inMessage) {
+          ok = writer.append (message, error) ;
+        }
+        inMessage = false ;
+        break ;
+      case CAN_ERROR_RESULT :
+        inMessage = false ;
+        break ;
+      default :
+        break ;
+      }
+    }
+    if (UpdateExportProgressAndCheckForCancel (i, frameCount)) {
+      ok = false ;
+    }
+  }
+  if (ok) {
+    writer.close (error) ;
+  }
+}
+
 //----------------------------------------------------------------------------------------
 
 
@@ -190,3 +365,119 @@ void CANMolinaroAnalyzerResults::GenerateTransactionTabularText( U64 transaction
 }
 
 //----------------------------------------------------------------------------------------
+//  ONE FRAME PER MESSAGE
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzerResults::addMessageFields (const U64 inMessageStartSampleNumber,
+                                                   const std::vector <CANMessageField> & inFields) {
+  std::lock_guard <std::mutex> lock (mMessageFieldsMutex) ;
+  mMessageStartSampleNumbers.push_back (inMessageStartSampleNumber) ;
+  mMessageFirstField.push_back (uint32_t (mMessageFields.size ())) ;
+  mMessageFields.insert (mMessageFields.end (), inFields.begin (), inFields.end ()) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzerResults::fieldFrames (const Frame & inFrame,
+                                              std::vector <Frame> & outFrames) {
+  if (inFrame.mType != CAN_MESSAGE_RESULT) {
+    outFrames.push_back (inFrame) ;
+  }else{
+  //--- Get fields from side table
+    std::vector <CANMessageField> fields ;
+    { std::lock_guard <std::mutex> lock (mMessageFieldsMutex) ;
+      const std::vector <U64>::const_iterator it = std::lower_bound (
+        mMessageStartSampleNumbers.begin (),
+        mMessageStartSampleNumbers.end (),
+        inFrame.mStartingSampleInclusive
+      ) ;
+      if ((it != mMessageStartSampleNumbers.end ()) && (*it == inFrame.mStartingSampleInclusive)) {
+        const size_t idx = size_t (it - mMessageStartSampleNumbers.begin ()) ;
+        const size_t first = mMessageFirstField [idx] ;
+        const size_t last = ((idx + 1) < mMessageFirstField.size ())
+          ? mMessageFirstField [idx + 1]
+          : mMessageFields.size ()
+        ;
+        fields.assign (mMessageFields.begin () + first, mMessageFields.begin () + last) ;
+      }
+    }
+  //--- Rebuild field frames, with the data sent by the decoder
+    const U32 samplesPerBit = mAnalyzer->sampleRateHz () / mAnalyzer->bitRate () ;
+    const U64 identifier = inFrame.mData1 & 0x1FFFFFFF ;
+    const bool remote = ((inFrame.mData1 >> 30) & 1) != 0 ;
+    const bool acked = ((inFrame.mData1 >> 31) & 1) != 0 ;
+    U64 dataIndex = 0 ;
+    for (size_t i=0 ; i<fields.size () ; i++) {
+      Frame frame ;
+      frame.mType = fields [i].type () ;
+      frame.mFlags = 0 ;
+      frame.mStartingSampleInclusive = inFrame.mStartingSampleInclusive + fields [i].startOffset () ;
+      frame.mEndingSampleInclusive = inFrame.mStartingSampleInclusive + fields [i].endOffset () ;
+      frame.mData1 = 0 ;
+      frame.mData2 = 0 ;
+      switch (fields [i].type ()) {
+      case STANDARD_IDENTIFIER_FIELD_RESULT :
+      case EXTENDED_IDENTIFIER_FIELD_RESULT :
+        frame.mData1 = identifier ;
+        frame.mData2 = !remote ;
+        break ;
+      case CONTROL_FIELD_RESULT :
+        frame.mData1 = (inFrame.mData1 >> 32) & 0xF ;
+        frame.mData2 = (inFrame.mData1 >> 57) & 0x7 ; // CAN_FD_xxx_FLAG
+        break ;
+      case DATA_FIELD_RESULT :
+        frame.mData1 = fields [i].value () ;
+        frame.mData2 = dataIndex ;
+        dataIndex += 1 ;
+        break ;
+      case STUFF_COUNT_FIELD_RESULT :
+        frame.mData1 = fields [i].value () ;
+        break ;
+      case CRC_FIELD_RESULT :
+        frame.mData1 = (inFrame.mData1 >> 36) & 0x1FFFFF ;
+        break ;
+      case ACK_FIELD_RESULT :
+        frame.mData1 = !acked ;
+        break ;
+      case INTERMISSION_FIELD_RESULT : // Frame length is counted up to the last IFS bit center
+        frame.mData1 = fields [i].endOffset () - samplesPerBit / 2 ;
+        frame.mData2 = fields [i].value () ;
+        break ;
+      default :
+        break ;
+      }
+      outFrames.push_back (frame) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroAnalyzerResults::rawMessageFieldFrames (const Frame & inFrame,
+                                                        std::vector <Frame> & outFrames) {
+  const bool extended = ((inFrame.mData1 >> 29) & 1) != 0 ;
+  const bool remote = ((inFrame.mData1 >> 30) & 1) != 0 ;
+  const U64 dataCodeLength = (inFrame.mData1 >> 32) & 0xF ;
+  Frame frame ;
+  frame.mFlags = 0 ;
+  frame.mStartingSampleInclusive = inFrame.mStartingSampleInclusive ;
+  frame.mEndingSampleInclusive = inFrame.mEndingSampleInclusive ;
+  frame.mType = extended ? EXTENDED_IDENTIFIER_FIELD_RESULT : STANDARD_IDENTIFIER_FIELD_RESULT ;
+  frame.mData1 = inFrame.mData1 & 0x1FFFFFFF ;
+  frame.mData2 = !remote ;
+  outFrames.push_back (frame) ;
+  frame.mType = CONTROL_FIELD_RESULT ;
+  frame.mData1 = dataCodeLength ;
+  frame.mData2 = (inFrame.mData1 >> 57) & 0x7 ; // CAN_FD_xxx_FLAG
+  outFrames.push_back (frame) ;
+//--- mData2 holds the first 8 data bytes, D0 in bits 56-63
+  const U64 dataCount = remote ? 0 : ((dataCodeLength < 8) ? dataCodeLength : 8) ;
+  frame.mType = DATA_FIELD_RESULT ;
+  for (U64 i=0 ; i<dataCount ; i++) {
+    frame.mData1 = (inFrame.mData2 >> (56 - 8 * i)) & 0xFF ;
+    frame.mData2 = i ;
+    outFrames.push_back (frame) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -4,26 +4,70 @@
 //----------------------------------------------------------------------------------------
 
 #include <AnalyzerResults.h>
+#include "CANFrameDecoder.h"
+#include "CANTextCache.h"
 
-//----------------------------------------------------------------------------------------
-
-enum CanFrameType {
-  STANDARD_IDENTIFIER_FIELD_RESULT,
-  EXTENDED_IDENTIFIER_FIELD_RESULT,
-  CONTROL_FIELD_RESULT,
-  DATA_FIELD_RESULT,
-  CRC_FIELD_RESULT,
-  ACK_FIELD_RESULT,
-  EOF_FIELD_RESULT,
-  INTERMISSION_FIELD_RESULT,
-  CAN_ERROR_RESULT
-} ;
+#include <vector>
+#include <mutex>
+#include <sstream>
 
 //----------------------------------------------------------------------------------------
 
 class CANMolinaroAnalyzer;
 class CANMolinaroAnalyzerSettings;
 
+//----------------------------------------------------------------------------------------
+// "One per message" result frames: a valid CAN frame is stored as a single
+// CAN_MESSAGE_RESULT Frame:
+//   - mData1: identifier (bits 0-28), extended (29), remote (30), acked (31),
+//             DLC as transmitted (32-35), CRC (36-56), FDF (57), BRS (58), ESI (59);
+//   - mData2: first data bytes, D0 in bits 56-63.
+// Field boundaries go to a side table, as sample offsets from the frame start, with data
+// bytes, stuff count and stuff bit count; field frames are rebuilt from both when a
+// bubble, a tabular text or an export is generated.
+// On simulated traffic, frames are 6 (all frame types) to 10.5 (standard data frames)
+// times fewer, but result storage is only 2.4 to 3.1 times smaller: a 40-byte Frame per
+// message, plus 8 bytes per field and 12 bytes per message of side table.
+
+static inline U64 packedMessageData1 (const CANDecodedMessage & inMessage, const uint32_t inCRC) {
+  return U64 (inMessage.mIdentifier & 0x1FFFFFFF)
+       | (U64 (inMessage.mExtended) << 29)
+       | (U64 (inMessage.mRemote) << 30)
+       | (U64 (inMessage.mAcked) << 31)
+       | (U64 (inMessage.mDataCodeLength & 0xF) << 32)
+       | (U64 (inCRC & 0x1FFFFF) << 36)
+       | (U64 (inMessage.mFD) << 57)
+       | (U64 (inMessage.mBRS) << 58)
+       | (U64 (inMessage.mESI) << 59)
+  ;
+}
+
+//----------------------------------------------------------------------------------------
+
+// 8 bytes per field: offsets on 24 bits, a frame longer than CAN_MESSAGE_FIELD_MAX_OFFSET
+// samples falls back to field frames.
+
+static const uint32_t CAN_MESSAGE_FIELD_MAX_OFFSET = 0xFFFFFF ;
+
+class CANMessageField {
+  public: inline void set (const uint32_t inStartOffset,
+                           const uint32_t inEndOffset,
+                           const uint8_t inType,
+                           const uint8_t inValue) {
+    mStartAndType = (inStartOffset & CAN_MESSAGE_FIELD_MAX_OFFSET) | (uint32_t (inType) << 24) ;
+    mEndAndValue = (inEndOffset & CAN_MESSAGE_FIELD_MAX_OFFSET) | (uint32_t (inValue) << 24) ;
+  }
+
+  public: inline uint32_t startOffset (void) const { return mStartAndType & CAN_MESSAGE_FIELD_MAX_OFFSET ; }
+  public: inline uint32_t endOffset (void) const { return mEndAndValue & CAN_MESSAGE_FIELD_MAX_OFFSET ; }
+  public: inline uint8_t type (void) const { return uint8_t (mStartAndType >> 24) ; } // CanFrameType
+//--- Data byte, stuff count, stuff bit count (IFS)
+  public: inline uint8_t value (void) const { return uint8_t (mEndAndValue >> 24) ; }
+
+  private: uint32_t mStartAndType ;
+  private: uint32_t mEndAndValue ;
+} ;
+
 //----------------------------------------------------------------------------------------
 
 class CANMolinaroAnalyzerResults : public AnalyzerResults {
@@ -38,15 +82,47 @@ public:
   virtual void GeneratePacketTabularText( U64 packet_id, DisplayBase display_base );
   virtual void GenerateTransactionTabularText( U64 transaction_id, DisplayBase display_base );
 
+//--- Called by the analyzer thread, before the CAN_MESSAGE_RESULT frame is added
+  public: void addMessageFields (const U64 inMessageStartSampleNumber,
+                                 const std::vector <CANMessageField> & inFields) ;
+
+//--- Called by the analyzer thread when results are regenerated
+  public: void clearTextCache (void) { mTextCache.clear () ; }
+
 protected: //functions
   void GenerateText (const Frame & inFrame,
                      const DisplayBase inDisplayBase,
                      const bool inBubbleText,
                      std::stringstream & ioText) ;
 
+//--- Bubble strings, shortest first
+  void generateBubbleStrings (const Frame & inFrame,
+                              const DisplayBase inDisplayBase,
+                              std::vector <std::string> & outStrings) ;
+
+//--- Appends the field frames of a frame: itself, or the rebuilt fields of a CAN_MESSAGE_RESULT
+  void fieldFrames (const Frame & inFrame, std::vector <Frame> & outFrames) ;
+
+//--- Identifier, control and first data fields of a CAN_MESSAGE_RESULT without side table
+//    entry, from mData1 and mData2; each spans the whole message
+  void rawMessageFieldFrames (const Frame & inFrame, std::vector <Frame> & outFrames) ;
+
+//--- Valid messages, rebuilt from field frames (see CANColumnarFile.h)
+  void generateColumnarExportFile (const char * inFile) ;
+
 protected:  //vars
   CANMolinaroAnalyzerSettings* mSettings;
   CANMolinaroAnalyzer* mAnalyzer;
+
+//--- Side table of CAN_MESSAGE_RESULT frames, sorted by start sample; fields of message i
+//    are mMessageFields [mMessageFirstField [i] ... mMessageFirstField [i+1] - 1]
+  std::mutex mMessageFieldsMutex ;
+  std::vector <U64> mMessageStartSampleNumbers ;
+  std::vector <uint32_t> mMessageFirstField ;
+  std::vector <CANMessageField> mMessageFields ;
+
+//--- Rendered bubble and tabular strings (see CANTextCache.h)
+  CANTextCache mTextCache ;
 };
 
 //----------------------------------------------------------------------------------------
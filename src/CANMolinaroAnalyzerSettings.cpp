@@ -6,18 +6,83 @@
 CANMolinaroAnalyzerSettings::CANMolinaroAnalyzerSettings (void) :
 mInputChannel (UNDEFINED_CHANNEL),
 mBitRate (125 * 1000),
+mGatewayChannel (UNDEFINED_CHANNEL),
 mInputChannelInterface (),
 mBitRateInterface (),
+mProtocolInterface (),
+mDataBitRateInterface (),
 mCanChannelInvertedInterface (),
+mGlitchFilterInterface (),
+mDecodeWindowInterface (),
+mWindowStartInterface (),
+mWindowEndInterface (),
 mSimulatorAckGenerationInterface (),
 mSimulatorFrameTypeGenerationInterface (),
 mSimulatorFrameValidityInterface (),
 mSimulatorRandomSeedInterface (),
+mSimulatorErrorScenariosInterface (),
+mSimulatorReplayLogInterface (),
+mResultFramesInterface (),
+mDetailInterface (),
+mFullDetailSecondsInterface (),
+mErrorDetailInterface (),
+mFullDetailIdentifiersInterface (),
+mISOTPAddressPairsInterface (),
+mJ1939Interface (),
+mPayloadSearchInterface (),
+mLiveTapInterface (),
+mLiveLogInterface (),
+mLiveLogFormatInterface (),
+mLiveLogRotationInterface (),
+mGatewayChannelInterface (),
+mGatewayBitRateInterface (),
+mGatewayDataBitRateInterface (),
+mGatewayWindowInterface (),
+mGatewayRemapInterface (),
+mPhaseErrorsInterface (),
+mPhaseWarningInterface (),
+mPeriodStatisticsInterface (),
+mResponseTimeInterface (),
 mSimulatorGeneratedAckSlot (GENERATE_ACK_DOMINANT),
 mSimulatorGeneratedFrameType (GENERATE_ALL_FRAME_TYPES),
 mGeneratedFrameValidity (GENERATE_VALID_FRAMES),
 mSimulatorRandomSeed (0),
-mInverted (false) {
+mInverted (false),
+mOneFramePerMessage (false),
+mCANFD (false),
+mDataBitRate (2 * 1000 * 1000),
+mISOTPAddressPairText (),
+mISOTPAddressPairs (),
+mJ1939 (false),
+mPayloadPatternText (),
+mPayloadPatterns (),
+mLiveTapName (),
+mGlitchFilterPercent (0),
+mChangedMessagesOnly (false),
+mDetailLevel (DETAIL_FULL),
+mFullDetailSeconds (10),
+mErrorDetailMilliSeconds (100),
+mFullDetailIdentifierText (),
+mFullDetailIdentifierKeys (),
+mDecodeWindowReference (WINDOW_WHOLE_CAPTURE),
+mWindowStartText (),
+mWindowEndText (),
+mDecodeWindow (),
+mErrorScenarioText (),
+mErrorScenarios (),
+mLiveLogPath (),
+mLiveLogFormat (LIVE_LOG_CANDUMP),
+mLiveLogRotationMegaBytes (0),
+mGatewayBitRate (125 * 1000),
+mGatewayDataBitRate (2 * 1000 * 1000),
+mGatewayWindowMilliSeconds (100),
+mGatewayRemapText (),
+mGatewayRemaps (),
+mPhaseErrorMode (PHASE_ERRORS_OFF),
+mPhaseWarningPercent (25),
+mPeriodStatistics (false),
+mSimulatorReplayLogPath (),
+mResponseTimeAnalysis (false) {
 //--- Input Channel interface
   mInputChannelInterface.reset (new AnalyzerSettingInterfaceChannel ());
   mInputChannelInterface->SetTitleAndTooltip ("Serial", "CAN 2.0B");
@@ -31,6 +96,25 @@ mInverted (false) {
   mBitRateInterface->SetMin (1) ;
   mBitRateInterface->SetInteger (mBitRate) ;
 
+//--- Protocol
+  mProtocolInterface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mProtocolInterface->SetTitleAndTooltip ("Protocol", "") ;
+  mProtocolInterface->AddNumber (0.0,
+                                 "CAN 2.0B",
+                                 "Classic CAN frames only, a recessive FDF bit is a reserved bit error") ;
+  mProtocolInterface->AddNumber (1.0,
+                                 "CAN FD (ISO)",
+                                 "Classic and ISO CAN FD frames") ;
+  mProtocolInterface->SetNumber (0.0) ;
+
+//--- Data phase bit rate interface
+  mDataBitRateInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mDataBitRateInterface->SetTitleAndTooltip ("CAN FD Data Bit Rate (bit/s)",
+                                             "Bit rate of CAN FD frames between the BRS bit and the CRC delimiter, if BRS is set.") ;
+  mDataBitRateInterface->SetMax (10 * 1000 * 1000) ;
+  mDataBitRateInterface->SetMin (1) ;
+  mDataBitRateInterface->SetInteger (mDataBitRate) ;
+
 //--- Add Channel level inversion
   mCanChannelInvertedInterface.reset (new AnalyzerSettingInterfaceNumberList ( )) ;
   mCanChannelInvertedInterface->SetTitleAndTooltip ("Dominant Logic Level", "" );
@@ -42,6 +126,219 @@ mInverted (false) {
                                            "High is the inverted dominant level") ;
   mCanChannelInvertedInterface->SetNumber (0.0) ;
 
+//--- Glitch filter
+  mGlitchFilterInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mGlitchFilterInterface->SetTitleAndTooltip ("Glitch Filter (% of bit)",
+                                              "Pulses shorter than this percentage of a bit (of a data phase bit for CAN FD) are ignored; 0 disables the filter. Suppressed pulses are counted in a \"Glitch summary\" row every second.") ;
+  mGlitchFilterInterface->SetMax (50) ;
+  mGlitchFilterInterface->SetMin (0) ;
+  mGlitchFilterInterface->SetInteger (mGlitchFilterPercent) ;
+
+//--- Decode window
+  mDecodeWindowInterface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mDecodeWindowInterface->SetTitleAndTooltip ("Decode Window", "") ;
+  mDecodeWindowInterface->AddNumber (0.0,
+                                     "Whole capture",
+                                     "The whole capture is decoded, window start and end are ignored") ;
+  mDecodeWindowInterface->AddNumber (1.0,
+                                     "Samples",
+                                     "Window start and end are absolute sample numbers") ;
+  mDecodeWindowInterface->AddNumber (2.0,
+                                     "Seconds",
+                                     "Window start and end are in seconds from the capture start") ;
+  mDecodeWindowInterface->AddNumber (3.0,
+                                     "Seconds from trigger",
+                                     "Window start and end are in seconds relative to the trigger, negative before it") ;
+  mDecodeWindowInterface->SetNumber (0.0) ;
+
+  mWindowStartInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mWindowStartInterface->SetTitleAndTooltip ("Window Start",
+                                             "Decoding starts at the first bus idle (11 recessive bits) after this point; empty is the capture start, or the trigger") ;
+  mWindowStartInterface->SetText ("") ;
+
+  mWindowEndInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mWindowEndInterface->SetTitleAndTooltip ("Window End",
+                                           "Decoding stops at the first edge after this point; empty is the capture end") ;
+  mWindowEndInterface->SetText ("") ;
+
+//--- Result frames
+  mResultFramesInterface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mResultFramesInterface->SetTitleAndTooltip ("Result Frames", "") ;
+  mResultFramesInterface->AddNumber (0.0,
+                                     "One per field",
+                                     "One bubble for each field of a CAN frame") ;
+  mResultFramesInterface->AddNumber (1.0,
+                                     "One per message",
+                                     "One bubble for each valid CAN frame, field texts are built when displayed; uses much less memory on long captures") ;
+  mResultFramesInterface->AddNumber (2.0,
+                                     "Changed messages only",
+                                     "As one per message, but a frame identical to the previous one of its identifier (same format, DLC and data, acknowledged) is folded: \"Unchanged\" rows give the repeat count of each identifier every second") ;
+  mResultFramesInterface->SetNumber (0.0) ;
+
+//--- Adaptive detail
+  mDetailInterface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mDetailInterface->SetTitleAndTooltip ("Detail", "") ;
+  mDetailInterface->AddNumber (0.0,
+                               "Full",
+                               "Markers and field rows for every frame") ;
+  mDetailInterface->AddNumber (1.0,
+                               "Adaptive, messages elsewhere",
+                               "Full detail for the first seconds, after errors and for some identifiers; other frames get one bubble and one \"Message\" row, without markers") ;
+  mDetailInterface->AddNumber (2.0,
+                               "Adaptive, statistics elsewhere",
+                               "Full detail for the first seconds, after errors and for some identifiers; other frames are only counted in a \"Traffic summary\" row every second") ;
+  mDetailInterface->SetNumber (0.0) ;
+
+  mFullDetailSecondsInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mFullDetailSecondsInterface->SetTitleAndTooltip ("Full Detail Seconds",
+                                                   "Adaptive detail: duration of full detail at the start of the capture") ;
+  mFullDetailSecondsInterface->SetMax (24 * 3600) ;
+  mFullDetailSecondsInterface->SetMin (0) ;
+  mFullDetailSecondsInterface->SetInteger (mFullDetailSeconds) ;
+
+  mErrorDetailInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mErrorDetailInterface->SetTitleAndTooltip ("Full Detail After Errors (ms)",
+                                             "Adaptive detail: a frame with an error has full detail, and so have the frames that start in this window after it") ;
+  mErrorDetailInterface->SetMax (600 * 1000) ;
+  mErrorDetailInterface->SetMin (0) ;
+  mErrorDetailInterface->SetInteger (mErrorDetailMilliSeconds) ;
+
+  mFullDetailIdentifiersInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mFullDetailIdentifiersInterface->SetTitleAndTooltip ("Full Detail Identifiers",
+                                                       "Adaptive detail: hexadecimal identifiers always shown with full detail, for example 7E0, 18DA10F1") ;
+  mFullDetailIdentifiersInterface->SetText ("") ;
+
+//--- ISO-TP reassembly
+  mISOTPAddressPairsInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mISOTPAddressPairsInterface->SetTitleAndTooltip ("ISO-TP Address Pairs",
+                                                   "Hexadecimal identifier pairs whose ISO-TP PDUs are reassembled, for example 7E0:7E8, 18DA10F1:18DAF110; more than 3 digits is an extended identifier. Empty disables reassembly.") ;
+  mISOTPAddressPairsInterface->SetText ("") ;
+
+//--- J1939
+  mJ1939Interface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mJ1939Interface->SetTitleAndTooltip ("J1939", "") ;
+  mJ1939Interface->AddNumber (0.0,
+                              "Off",
+                              "29-bit identifiers are not interpreted") ;
+  mJ1939Interface->AddNumber (1.0,
+                              "On",
+                              "29-bit identifiers are split into priority, PGN, source and destination addresses; transport protocol messages are reassembled, PGN rates are reported every second") ;
+  mJ1939Interface->SetNumber (0.0) ;
+
+//--- Payload search
+  mPayloadSearchInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mPayloadSearchInterface->SetTitleAndTooltip ("Payload Search",
+                                               "Hexadecimal patterns separated by semicolons: IDF[/MASK] [DATA[/MASK]], * is any identifier, DATA starts at D0. For example 1A0 00000004/00000004 is bit 2 of D3 set in frame 0x1A0. A \"Match\" row is added for each matching frame.") ;
+  mPayloadSearchInterface->SetText ("") ;
+
+//--- Live tap
+  mLiveTapInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mLiveTapInterface->SetTitleAndTooltip ("Live Tap",
+                                         "Shared memory segment name, for example /canmolinaro: decoded frames are written into a ring buffer other processes can read while the capture runs (see CANSharedMemoryTap.h). Empty disables the tap.") ;
+  mLiveTapInterface->SetText ("") ;
+
+//--- Live log
+  mLiveLogInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mLiveLogInterface->SetTitleAndTooltip ("Live Log File",
+                                         "Decoded frames are appended to this file while the capture runs, by a background thread (see CANLiveLog.h). Frames are dropped and counted if the disk cannot keep up. Empty disables the log.") ;
+  mLiveLogInterface->SetText ("") ;
+
+  mLiveLogFormatInterface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mLiveLogFormatInterface->SetTitleAndTooltip ("Live Log Format", "") ;
+  mLiveLogFormatInterface->AddNumber (double (LIVE_LOG_CANDUMP),
+                                      "candump",
+                                      "One line per frame: (seconds) can0 IDF#DATA, as written by candump -L") ;
+  mLiveLogFormatInterface->AddNumber (double (LIVE_LOG_CSV),
+                                      "CSV",
+                                      "One line per frame, with a header line") ;
+  mLiveLogFormatInterface->SetNumber (double (LIVE_LOG_CANDUMP)) ;
+
+  mLiveLogRotationInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mLiveLogRotationInterface->SetTitleAndTooltip ("Live Log Rotation (MB)",
+                                                 "A new file FILE.001, FILE.002, ... is started when the current one would exceed this size; the first one is FILE.000. 0 writes a single file.") ;
+  mLiveLogRotationInterface->SetMax (64 * 1024) ;
+  mLiveLogRotationInterface->SetMin (0) ;
+  mLiveLogRotationInterface->SetInteger (mLiveLogRotationMegaBytes) ;
+
+//--- Gateway latency
+  mGatewayChannelInterface.reset (new AnalyzerSettingInterfaceChannel ()) ;
+  mGatewayChannelInterface->SetTitleAndTooltip ("Gateway Egress",
+                                                "Bus on which a gateway forwards the frames of the input channel: frames are matched by identifier and payload, latency, missing and duplicated forwards are reported every second per identifier (see CANGatewayCorrelator.h). None disables the correlation.") ;
+  mGatewayChannelInterface->SetChannel (mGatewayChannel) ;
+  mGatewayChannelInterface->SetSelectionOfNoneIsAllowed (true) ;
+
+  mGatewayBitRateInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mGatewayBitRateInterface->SetTitleAndTooltip ("Gateway Egress Bit Rate (bit/s)", "") ;
+  mGatewayBitRateInterface->SetMax (1 * 1000 * 1000) ;
+  mGatewayBitRateInterface->SetMin (1) ;
+  mGatewayBitRateInterface->SetInteger (mGatewayBitRate) ;
+
+  mGatewayDataBitRateInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mGatewayDataBitRateInterface->SetTitleAndTooltip ("Gateway Egress Data Bit Rate (bit/s)",
+                                                    "CAN FD data phase bit rate of the egress bus") ;
+  mGatewayDataBitRateInterface->SetMax (20 * 1000 * 1000) ;
+  mGatewayDataBitRateInterface->SetMin (1) ;
+  mGatewayDataBitRateInterface->SetInteger (mGatewayDataBitRate) ;
+
+  mGatewayWindowInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mGatewayWindowInterface->SetTitleAndTooltip ("Gateway Window (ms)",
+                                               "Longest forwarding latency; a frame not forwarded within the window is missing. Keep it below the period of frames with an unchanging payload.") ;
+  mGatewayWindowInterface->SetMax (60 * 1000) ;
+  mGatewayWindowInterface->SetMin (1) ;
+  mGatewayWindowInterface->SetInteger (mGatewayWindowMilliSeconds) ;
+
+  mGatewayRemapInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mGatewayRemapInterface->SetTitleAndTooltip ("Gateway Identifier Remap",
+                                              "Hexadecimal INPUT:EGRESS identifier pairs, for example 100:200, 18FF0001:18FF0081. Other identifiers are forwarded unchanged.") ;
+  mGatewayRemapInterface->SetText ("") ;
+
+//--- Phase errors
+  mPhaseErrorsInterface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mPhaseErrorsInterface->SetTitleAndTooltip ("Phase Errors",
+                                             "Phase error of every edge within a frame, relative to the bit boundary expected by the decoder, in fixed bin histograms (see CANPhaseErrors.h)") ;
+  mPhaseErrorsInterface->AddNumber (double (PHASE_ERRORS_OFF),
+                                    "Off",
+                                    "Edges are not measured") ;
+  mPhaseErrorsInterface->AddNumber (double (PHASE_ERRORS_CAPTURE),
+                                    "Capture",
+                                    "Capture histogram every second, and a row for each frame beyond the warning threshold") ;
+  mPhaseErrorsInterface->AddNumber (double (PHASE_ERRORS_IDENTIFIERS),
+                                    "Capture and identifiers",
+                                    "Also a histogram per identifier, of the edges sent by the transmitter (SOF to CRC delimiter)") ;
+  mPhaseErrorsInterface->AddNumber (double (PHASE_ERRORS_FRAMES),
+                                    "Capture, identifiers and frames",
+                                    "Also a histogram row for every frame") ;
+  mPhaseErrorsInterface->SetNumber (double (mPhaseErrorMode)) ;
+
+  mPhaseWarningInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
+  mPhaseWarningInterface->SetTitleAndTooltip ("Phase Warning (% of bit)",
+                                              "A frame is flagged when one of its edges is at least this far from the expected bit boundary. The decoder samples at 50 % of the bit: an edge beyond 50 % is decoded as a wrong bit.") ;
+  mPhaseWarningInterface->SetMax (50) ;
+  mPhaseWarningInterface->SetMin (1) ;
+  mPhaseWarningInterface->SetInteger (mPhaseWarningPercent) ;
+
+//--- Period statistics
+  mPeriodStatisticsInterface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mPeriodStatisticsInterface->SetTitleAndTooltip ("Period Statistics", "") ;
+  mPeriodStatisticsInterface->AddNumber (0.0,
+                                         "Off",
+                                         "Message periods are not measured") ;
+  mPeriodStatisticsInterface->AddNumber (1.0,
+                                         "On",
+                                         "Time between consecutive messages of each identifier: count, min, max, mean and percentiles since the start of the capture, reported every second for identifiers that have been received (see CANPeriodStatistics.h)") ;
+  mPeriodStatisticsInterface->SetNumber (0.0) ;
+
+//--- Response time analysis
+  mResponseTimeInterface.reset (new AnalyzerSettingInterfaceNumberList ()) ;
+  mResponseTimeInterface->SetTitleAndTooltip ("Response Time Analysis", "") ;
+  mResponseTimeInterface->AddNumber (0.0,
+                                     "Off",
+                                     "No response time analysis") ;
+  mResponseTimeInterface->AddNumber (1.0,
+                                     "On",
+                                     "Worst-case queueing delay and response time bounds of each periodic identifier, from its observed mean period, longest frame and priority, compared with the observed response time; reported every second for identifiers whose result changed (see CANResponseTimeAnalysis.h)") ;
+  mResponseTimeInterface->SetNumber (0.0) ;
+
 //--- Simulator random Seed
   mSimulatorRandomSeedInterface.reset (new AnalyzerSettingInterfaceInteger ()) ;
   mSimulatorRandomSeedInterface->SetTitleAndTooltip ("Simulator Random Seed", "") ;
@@ -80,18 +377,61 @@ mInverted (false) {
   mSimulatorFrameValidityInterface->AddNumber (1.0, "Randomly toggle one bit", "") ;
   mSimulatorFrameValidityInterface->SetNumber (0.0) ;
 
+//--- Simulator error scenarios
+  mSimulatorErrorScenariosInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mSimulatorErrorScenariosInterface->SetTitleAndTooltip ("Simulator Error Scenarios",
+                                                         "Rates in percent of generated frames, for example burst:1, crc:0.5, glitch:5. Scenarios: burst, stuff, crc, ack (missing ACK), form, active and passive (error flags), overload, busoff, glitch. Empty generates frames as selected by the validity setting.") ;
+  mSimulatorErrorScenariosInterface->SetText ("") ;
+
+//--- Simulator log replay
+  mSimulatorReplayLogInterface.reset (new AnalyzerSettingInterfaceText ()) ;
+  mSimulatorReplayLogInterface->SetTitleAndTooltip ("Simulator Replay Log",
+                                                    "candump -L or live log CSV file: its classic CAN frames are simulated at their recorded time stamps, instead of random frames (see CANLogReplay.h). The file is read in chunks while the simulation runs. Empty generates random frames.") ;
+  mSimulatorReplayLogInterface->SetText ("") ;
+
 //--- Install interfaces
   AddInterface (mInputChannelInterface.get ()) ;
   AddInterface (mBitRateInterface.get ());
+  AddInterface (mProtocolInterface.get ());
+  AddInterface (mDataBitRateInterface.get ());
   AddInterface (mCanChannelInvertedInterface.get ());
+  AddInterface (mGlitchFilterInterface.get ());
+  AddInterface (mDecodeWindowInterface.get ());
+  AddInterface (mWindowStartInterface.get ());
+  AddInterface (mWindowEndInterface.get ());
+  AddInterface (mResultFramesInterface.get ());
+  AddInterface (mDetailInterface.get ());
+  AddInterface (mFullDetailSecondsInterface.get ());
+  AddInterface (mErrorDetailInterface.get ());
+  AddInterface (mFullDetailIdentifiersInterface.get ());
+  AddInterface (mISOTPAddressPairsInterface.get ());
+  AddInterface (mJ1939Interface.get ());
+  AddInterface (mPayloadSearchInterface.get ());
+  AddInterface (mLiveTapInterface.get ());
+  AddInterface (mLiveLogInterface.get ());
+  AddInterface (mLiveLogFormatInterface.get ());
+  AddInterface (mLiveLogRotationInterface.get ());
+  AddInterface (mGatewayChannelInterface.get ());
+  AddInterface (mGatewayBitRateInterface.get ());
+  AddInterface (mGatewayDataBitRateInterface.get ());
+  AddInterface (mGatewayWindowInterface.get ());
+  AddInterface (mGatewayRemapInterface.get ());
+  AddInterface (mPhaseErrorsInterface.get ());
+  AddInterface (mPhaseWarningInterface.get ());
+  AddInterface (mPeriodStatisticsInterface.get ());
+  AddInterface (mResponseTimeInterface.get ());
   AddInterface (mSimulatorRandomSeedInterface.get ());
   AddInterface (mSimulatorFrameTypeGenerationInterface.get ());
   AddInterface (mSimulatorAckGenerationInterface.get ());
   AddInterface (mSimulatorFrameValidityInterface.get ());
+  AddInterface (mSimulatorErrorScenariosInterface.get ());
+  AddInterface (mSimulatorReplayLogInterface.get ());
 
-//   AddExportOption( 0, "Export as text/csv file" );
-//   AddExportExtension( 0, "text", "txt" );
-//   AddExportExtension( 0, "csv", "csv" );
+  AddExportOption (EXPORT_TEXT, "Export as text/csv file") ;
+  AddExportExtension (EXPORT_TEXT, "text", "txt") ;
+  AddExportExtension (EXPORT_TEXT, "csv", "csv") ;
+  AddExportOption (EXPORT_COLUMNAR, "Export messages as columnar binary file") ;
+  AddExportExtension (EXPORT_COLUMNAR, "columnar", "ccol") ;
 
   ClearChannels () ;
   AddChannel (mInputChannel, "Serial", false) ;
@@ -108,13 +448,94 @@ bool CANMolinaroAnalyzerSettings::SetSettingsFromInterfaces (void) {
   mInputChannel = mInputChannelInterface->GetChannel () ;
   mBitRate = mBitRateInterface->GetInteger () ;
   mInverted = U32 (mCanChannelInvertedInterface->GetNumber ()) != 0 ;
+  mGlitchFilterPercent = mGlitchFilterInterface->GetInteger () ;
   mSimulatorRandomSeed = mSimulatorRandomSeedInterface->GetInteger () ;
   mSimulatorGeneratedAckSlot = U32 (mSimulatorAckGenerationInterface->GetNumber ()) ;
   mSimulatorGeneratedFrameType = U32 (mSimulatorFrameTypeGenerationInterface->GetNumber ()) ;
   mGeneratedFrameValidity = U32 (mSimulatorFrameValidityInterface->GetNumber ()) ;
+  mOneFramePerMessage = U32 (mResultFramesInterface->GetNumber ()) != 0 ;
+  mChangedMessagesOnly = U32 (mResultFramesInterface->GetNumber ()) == 2 ;
+  mCANFD = U32 (mProtocolInterface->GetNumber ()) != 0 ;
+  mDataBitRate = mDataBitRateInterface->GetInteger () ;
+  const std::string isotpAddressPairText = mISOTPAddressPairsInterface->GetText () ;
+  std::vector <CANISOTPAddressPair> isotpAddressPairs ;
+  if (!parseISOTPAddressPairs (isotpAddressPairText, isotpAddressPairs)) {
+    SetErrorText ("ISO-TP address pairs should be hexadecimal identifier pairs, for example 7E0:7E8, 7DF:7E8") ;
+    return false ;
+  }
+  mISOTPAddressPairText = isotpAddressPairText ;
+  mISOTPAddressPairs = isotpAddressPairs ;
+  mJ1939 = U32 (mJ1939Interface->GetNumber ()) != 0 ;
+  const std::string payloadPatternText = mPayloadSearchInterface->GetText () ;
+  std::vector <CANPayloadPattern> payloadPatterns ;
+  if (!parsePayloadPatterns (payloadPatternText, payloadPatterns)) {
+    SetErrorText ("Payload search patterns should be IDF[/MASK] [DATA[/MASK]] in hexadecimal, separated by semicolons, for example 1A0 00000004/00000004") ;
+    return false ;
+  }
+  mPayloadPatternText = payloadPatternText ;
+  mPayloadPatterns = payloadPatterns ;
+  const std::string liveTapName = mLiveTapInterface->GetText () ;
+  if (!liveTapName.empty () && !validLiveTapName (liveTapName)) {
+    SetErrorText ("Live tap name should be /NAME, with at most 64 letters, digits, '_', '-' or '.'") ;
+    return false ;
+  }
+  mLiveTapName = liveTapName ;
+  const std::string fullDetailIdentifierText = mFullDetailIdentifiersInterface->GetText () ;
+  std::vector <uint32_t> fullDetailIdentifierKeys ;
+  if (!parseIdentifierList (fullDetailIdentifierText, fullDetailIdentifierKeys)) {
+    SetErrorText ("Full detail identifiers should be hexadecimal identifiers, for example 7E0, 18DA10F1") ;
+    return false ;
+  }
+  mFullDetailIdentifierText = fullDetailIdentifierText ;
+  mFullDetailIdentifierKeys = fullDetailIdentifierKeys ;
+  mDetailLevel = U32 (mDetailInterface->GetNumber ()) ;
+  mFullDetailSeconds = mFullDetailSecondsInterface->GetInteger () ;
+  mErrorDetailMilliSeconds = mErrorDetailInterface->GetInteger () ;
+  const U32 decodeWindowReference = U32 (mDecodeWindowInterface->GetNumber ()) ;
+  const std::string windowStartText = mWindowStartInterface->GetText () ;
+  const std::string windowEndText = mWindowEndInterface->GetText () ;
+  if (!mDecodeWindow.set (CANDecodeWindowReference (decodeWindowReference), windowStartText, windowEndText)) {
+    SetErrorText ("Window start and end should be decimal numbers, not negative unless relative to the trigger, with the end after the start") ;
+    return false ;
+  }
+  mDecodeWindowReference = decodeWindowReference ;
+  mWindowStartText = windowStartText ;
+  mWindowEndText = windowEndText ;
+  const std::string errorScenarioText = mSimulatorErrorScenariosInterface->GetText () ;
+  if (!mErrorScenarios.parse (errorScenarioText)) {
+    SetErrorText ("Simulator error scenarios should be NAME:PERCENT pairs adding up to at most 100, for example burst:1, crc:0.5, glitch:5") ;
+    return false ;
+  }
+  mErrorScenarioText = errorScenarioText ;
+  mLiveLogPath = mLiveLogInterface->GetText () ;
+  mLiveLogFormat = U32 (mLiveLogFormatInterface->GetNumber ()) ;
+  mLiveLogRotationMegaBytes = mLiveLogRotationInterface->GetInteger () ;
+  const Channel gatewayChannel = mGatewayChannelInterface->GetChannel () ;
+  if ((gatewayChannel != UNDEFINED_CHANNEL) && (gatewayChannel == mInputChannel)) {
+    SetErrorText ("The gateway egress channel should differ from the input channel") ;
+    return false ;
+  }
+  const std::string gatewayRemapText = mGatewayRemapInterface->GetText () ;
+  std::vector <CANGatewayRemap> gatewayRemaps ;
+  if (!parseGatewayRemaps (gatewayRemapText, gatewayRemaps)) {
+    SetErrorText ("Gateway identifier remap should be hexadecimal INPUT:EGRESS identifier pairs, for example 100:200, 18FF0001:18FF0081") ;
+    return false ;
+  }
+  mGatewayChannel = gatewayChannel ;
+  mGatewayBitRate = mGatewayBitRateInterface->GetInteger () ;
+  mGatewayDataBitRate = mGatewayDataBitRateInterface->GetInteger () ;
+  mGatewayWindowMilliSeconds = mGatewayWindowInterface->GetInteger () ;
+  mGatewayRemapText = gatewayRemapText ;
+  mGatewayRemaps = gatewayRemaps ;
+  mPhaseErrorMode = U32 (mPhaseErrorsInterface->GetNumber ()) ;
+  mPhaseWarningPercent = mPhaseWarningInterface->GetInteger () ;
+  mPeriodStatistics = U32 (mPeriodStatisticsInterface->GetNumber ()) != 0 ;
+  mSimulatorReplayLogPath = mSimulatorReplayLogInterface->GetText () ;
+  mResponseTimeAnalysis = U32 (mResponseTimeInterface->GetNumber ()) != 0 ;
 
   ClearChannels () ;
   AddChannel (mInputChannel, "CAN", true) ;
+  AddChannel (mGatewayChannel, "Gateway egress", gatewayEnabled ()) ;
 
   return true ;
 }
@@ -131,6 +552,36 @@ const char * CANMolinaroAnalyzerSettings::SaveSettings (void) {
   text_archive << mSimulatorGeneratedAckSlot ;
   text_archive << mSimulatorGeneratedFrameType ;
   text_archive << mGeneratedFrameValidity ;
+  text_archive << mOneFramePerMessage ;
+  text_archive << mCANFD ;
+  text_archive << mDataBitRate ;
+  text_archive << mISOTPAddressPairText.c_str () ;
+  text_archive << mJ1939 ;
+  text_archive << mPayloadPatternText.c_str () ;
+  text_archive << mLiveTapName.c_str () ;
+  text_archive << mGlitchFilterPercent ;
+  text_archive << mChangedMessagesOnly ;
+  text_archive << mDetailLevel ;
+  text_archive << mFullDetailSeconds ;
+  text_archive << mErrorDetailMilliSeconds ;
+  text_archive << mFullDetailIdentifierText.c_str () ;
+  text_archive << mDecodeWindowReference ;
+  text_archive << mWindowStartText.c_str () ;
+  text_archive << mWindowEndText.c_str () ;
+  text_archive << mErrorScenarioText.c_str () ;
+  text_archive << mLiveLogPath.c_str () ;
+  text_archive << mLiveLogFormat ;
+  text_archive << mLiveLogRotationMegaBytes ;
+  text_archive << mGatewayChannel ;
+  text_archive << mGatewayBitRate ;
+  text_archive << mGatewayDataBitRate ;
+  text_archive << mGatewayWindowMilliSeconds ;
+  text_archive << mGatewayRemapText.c_str () ;
+  text_archive << mPhaseErrorMode ;
+  text_archive << mPhaseWarningPercent ;
+  text_archive << mPeriodStatistics ;
+  text_archive << mSimulatorReplayLogPath.c_str () ;
+  text_archive << mResponseTimeAnalysis ;
 
   return SetReturnString (text_archive.GetString ()) ;
 }
@@ -148,9 +599,132 @@ void CANMolinaroAnalyzerSettings::LoadSettings (const char* settings) {
   text_archive >> mSimulatorGeneratedAckSlot ;
   text_archive >> mSimulatorGeneratedFrameType ;
   text_archive >> mGeneratedFrameValidity ;
+  text_archive >> mOneFramePerMessage ;
+  text_archive >> mCANFD ;
+  text_archive >> mDataBitRate ;
+  const char * isotpAddressPairText = "" ;
+  if (text_archive >> &isotpAddressPairText) {
+    mISOTPAddressPairText = isotpAddressPairText ;
+  }
+  if (!parseISOTPAddressPairs (mISOTPAddressPairText, mISOTPAddressPairs)) {
+    mISOTPAddressPairText.clear () ;
+    mISOTPAddressPairs.clear () ;
+  }
+  text_archive >> mJ1939 ;
+  const char * payloadPatternText = "" ;
+  if (text_archive >> &payloadPatternText) {
+    mPayloadPatternText = payloadPatternText ;
+  }
+  if (!parsePayloadPatterns (mPayloadPatternText, mPayloadPatterns)) {
+    mPayloadPatternText.clear () ;
+    mPayloadPatterns.clear () ;
+  }
+  const char * liveTapName = "" ;
+  if (text_archive >> &liveTapName) {
+    mLiveTapName = liveTapName ;
+  }
+  if (!mLiveTapName.empty () && !validLiveTapName (mLiveTapName)) {
+    mLiveTapName.clear () ;
+  }
+  if (!(text_archive >> mGlitchFilterPercent) || (mGlitchFilterPercent > 50)) {
+    mGlitchFilterPercent = 0 ;
+  }
+  if (!(text_archive >> mChangedMessagesOnly)) {
+    mChangedMessagesOnly = false ;
+  }
+  mChangedMessagesOnly = mChangedMessagesOnly && mOneFramePerMessage ;
+  if (!(text_archive >> mDetailLevel) || (mDetailLevel > DETAIL_ADAPTIVE_STATISTICS)) {
+    mDetailLevel = DETAIL_FULL ;
+  }
+  if (!(text_archive >> mFullDetailSeconds)) {
+    mFullDetailSeconds = 10 ;
+  }
+  if (!(text_archive >> mErrorDetailMilliSeconds)) {
+    mErrorDetailMilliSeconds = 100 ;
+  }
+  const char * fullDetailIdentifierText = "" ;
+  if (text_archive >> &fullDetailIdentifierText) {
+    mFullDetailIdentifierText = fullDetailIdentifierText ;
+  }
+  if (!parseIdentifierList (mFullDetailIdentifierText, mFullDetailIdentifierKeys)) {
+    mFullDetailIdentifierText.clear () ;
+    mFullDetailIdentifierKeys.clear () ;
+  }
+  if (!(text_archive >> mDecodeWindowReference) || (mDecodeWindowReference > WINDOW_SECONDS_FROM_TRIGGER)) {
+    mDecodeWindowReference = WINDOW_WHOLE_CAPTURE ;
+  }
+  const char * windowStartText = "" ;
+  if (text_archive >> &windowStartText) {
+    mWindowStartText = windowStartText ;
+  }
+  const char * windowEndText = "" ;
+  if (text_archive >> &windowEndText) {
+    mWindowEndText = windowEndText ;
+  }
+  if (!mDecodeWindow.set (CANDecodeWindowReference (mDecodeWindowReference), mWindowStartText, mWindowEndText)) {
+    mDecodeWindowReference = WINDOW_WHOLE_CAPTURE ;
+    mWindowStartText.clear () ;
+    mWindowEndText.clear () ;
+    mDecodeWindow.set (WINDOW_WHOLE_CAPTURE, "", "") ;
+  }
+  const char * errorScenarioText = "" ;
+  if (text_archive >> &errorScenarioText) {
+    mErrorScenarioText = errorScenarioText ;
+  }
+  if (!mErrorScenarios.parse (mErrorScenarioText)) {
+    mErrorScenarioText.clear () ;
+    mErrorScenarios.parse ("") ;
+  }
+  const char * liveLogPath = "" ;
+  if (text_archive >> &liveLogPath) {
+    mLiveLogPath = liveLogPath ;
+  }
+  if (!(text_archive >> mLiveLogFormat) || (mLiveLogFormat > LIVE_LOG_CSV)) {
+    mLiveLogFormat = LIVE_LOG_CANDUMP ;
+  }
+  if (!(text_archive >> mLiveLogRotationMegaBytes)) {
+    mLiveLogRotationMegaBytes = 0 ;
+  }
+  if (!(text_archive >> mGatewayChannel)) {
+    mGatewayChannel = UNDEFINED_CHANNEL ;
+  }
+  if (!(text_archive >> mGatewayBitRate) || (mGatewayBitRate == 0)) {
+    mGatewayBitRate = 125 * 1000 ;
+  }
+  if (!(text_archive >> mGatewayDataBitRate) || (mGatewayDataBitRate == 0)) {
+    mGatewayDataBitRate = 2 * 1000 * 1000 ;
+  }
+  if (!(text_archive >> mGatewayWindowMilliSeconds) || (mGatewayWindowMilliSeconds == 0)) {
+    mGatewayWindowMilliSeconds = 100 ;
+  }
+  const char * gatewayRemapText = "" ;
+  if (text_archive >> &gatewayRemapText) {
+    mGatewayRemapText = gatewayRemapText ;
+  }
+  if (!parseGatewayRemaps (mGatewayRemapText, mGatewayRemaps)) {
+    mGatewayRemapText.clear () ;
+    mGatewayRemaps.clear () ;
+  }
+  if (!(text_archive >> mPhaseErrorMode) || (mPhaseErrorMode > PHASE_ERRORS_FRAMES)) {
+    mPhaseErrorMode = PHASE_ERRORS_OFF ;
+  }
+  if (!(text_archive >> mPhaseWarningPercent) || (mPhaseWarningPercent == 0) || (mPhaseWarningPercent > 50)) {
+    mPhaseWarningPercent = 25 ;
+  }
+  if (!(text_archive >> mPeriodStatistics)) {
+    mPeriodStatistics = false ;
+  }
+  const char * simulatorReplayLogPath = "" ;
+  if (text_archive >> &simulatorReplayLogPath) {
+    mSimulatorReplayLogPath = simulatorReplayLogPath ;
+  }
+  if (!(text_archive >> mResponseTimeAnalysis)) {
+    mResponseTimeAnalysis = false ;
+  }
 
  // ClearChannels();
   AddChannel (mInputChannel, "CAN 2.0B (Molinaro)", true) ;
+  AddChannel (mGatewayChannel, "Gateway egress", gatewayEnabled ()) ;
 
 //--- Update interface
   mInputChannelInterface->SetChannel (mInputChannel) ;
@@ -160,6 +734,35 @@ void CANMolinaroAnalyzerSettings::LoadSettings (const char* settings) {
   mSimulatorAckGenerationInterface->SetNumber (mSimulatorGeneratedAckSlot) ;
   mSimulatorFrameTypeGenerationInterface->SetNumber (mSimulatorGeneratedFrameType) ;
   mSimulatorFrameValidityInterface->SetNumber (mGeneratedFrameValidity) ;
+  mResultFramesInterface->SetNumber (mChangedMessagesOnly ? 2.0 : double (mOneFramePerMessage)) ;
+  mProtocolInterface->SetNumber (double (mCANFD)) ;
+  mDataBitRateInterface->SetInteger (mDataBitRate) ;
+  mISOTPAddressPairsInterface->SetText (mISOTPAddressPairText.c_str ()) ;
+  mJ1939Interface->SetNumber (double (mJ1939)) ;
+  mPayloadSearchInterface->SetText (mPayloadPatternText.c_str ()) ;
+  mLiveTapInterface->SetText (mLiveTapName.c_str ()) ;
+  mGlitchFilterInterface->SetInteger (mGlitchFilterPercent) ;
+  mDetailInterface->SetNumber (double (mDetailLevel)) ;
+  mFullDetailSecondsInterface->SetInteger (mFullDetailSeconds) ;
+  mErrorDetailInterface->SetInteger (mErrorDetailMilliSeconds) ;
+  mFullDetailIdentifiersInterface->SetText (mFullDetailIdentifierText.c_str ()) ;
+  mDecodeWindowInterface->SetNumber (double (mDecodeWindowReference)) ;
+  mWindowStartInterface->SetText (mWindowStartText.c_str ()) ;
+  mWindowEndInterface->SetText (mWindowEndText.c_str ()) ;
+  mSimulatorErrorScenariosInterface->SetText (mErrorScenarioText.c_str ()) ;
+  mLiveLogInterface->SetText (mLiveLogPath.c_str ()) ;
+  mLiveLogFormatInterface->SetNumber (double (mLiveLogFormat)) ;
+  mLiveLogRotationInterface->SetInteger (mLiveLogRotationMegaBytes) ;
+  mGatewayChannelInterface->SetChannel (mGatewayChannel) ;
+  mGatewayBitRateInterface->SetInteger (mGatewayBitRate) ;
+  mGatewayDataBitRateInterface->SetInteger (mGatewayDataBitRate) ;
+  mGatewayWindowInterface->SetInteger (mGatewayWindowMilliSeconds) ;
+  mGatewayRemapInterface->SetText (mGatewayRemapText.c_str ()) ;
+  mPhaseErrorsInterface->SetNumber (double (mPhaseErrorMode)) ;
+  mPhaseWarningInterface->SetInteger (mPhaseWarningPercent) ;
+  mPeriodStatisticsInterface->SetNumber (double (mPeriodStatistics)) ;
+  mSimulatorReplayLogInterface->SetText (mSimulatorReplayLogPath.c_str ()) ;
+  mResponseTimeInterface->SetNumber (double (mResponseTimeAnalysis)) ;
 }
 
 //----------------------------------------------------------------------------------------
@@ -6,6 +6,16 @@
 #include <AnalyzerSettings.h>
 #include <AnalyzerTypes.h>
 
+#include "CANISOTPReassembler.h"
+#include "CANMessageStore.h"
+#include "CANSharedMemoryTap.h"
+#include "CANDetailPolicy.h"
+#include "CANDecodeWindow.h"
+#include "CANErrorScenarios.h"
+#include "CANLiveLog.h"
+#include "CANGatewayCorrelator.h"
+#include "CANPhaseErrors.h"
+
 //----------------------------------------------------------------------------------------
 
 static const U32 GENERATE_ACK_DOMINANT = 0 ;
@@ -27,6 +37,11 @@ static const U32 GENERATE_ONE_RANDOM_ERROR_BIT = 1 ;
 
 //----------------------------------------------------------------------------------------
 
+static const U32 EXPORT_TEXT = 0 ;
+static const U32 EXPORT_COLUMNAR = 1 ; // See CANColumnarFile.h
+
+//----------------------------------------------------------------------------------------
+
 class CANMolinaroAnalyzerSettings : public AnalyzerSettings {
 
   public: CANMolinaroAnalyzerSettings (void) ;
@@ -41,8 +56,56 @@ class CANMolinaroAnalyzerSettings : public AnalyzerSettings {
   public: U32 mBitRate;
   public: U32 bitRate (void) const { return mBitRate ; }
 
+  public: bool canFD (void) const { return mCANFD ; }
+  public: U32 dataBitRate (void) const { return mDataBitRate ; }
+
   public: bool inverted (void) const { return mInverted ; }
 
+  public: U32 glitchFilterPercent (void) const { return mGlitchFilterPercent ; }
+
+  public: const CANDecodeWindow & decodeWindow (void) const { return mDecodeWindow ; }
+
+  public: bool oneFramePerMessage (void) const { return mOneFramePerMessage ; }
+
+  public: bool changedMessagesOnly (void) const { return mChangedMessagesOnly ; }
+
+  public: CANDetailLevel detailLevel (void) const { return CANDetailLevel (mDetailLevel) ; }
+  public: U32 fullDetailSeconds (void) const { return mFullDetailSeconds ; }
+  public: U32 errorDetailMilliSeconds (void) const { return mErrorDetailMilliSeconds ; }
+  public: const std::vector <uint32_t> & fullDetailIdentifierKeys (void) const {
+    return mFullDetailIdentifierKeys ;
+  }
+
+  public: const std::vector <CANISOTPAddressPair> & isotpAddressPairs (void) const {
+    return mISOTPAddressPairs ;
+  }
+
+  public: bool j1939 (void) const { return mJ1939 ; }
+
+  public: const std::vector <CANPayloadPattern> & payloadPatterns (void) const {
+    return mPayloadPatterns ;
+  }
+
+  public: const std::string & liveTapName (void) const { return mLiveTapName ; }
+
+  public: const std::string & liveLogPath (void) const { return mLiveLogPath ; }
+  public: CANLiveLogFormat liveLogFormat (void) const { return CANLiveLogFormat (mLiveLogFormat) ; }
+  public: U32 liveLogRotationMegaBytes (void) const { return mLiveLogRotationMegaBytes ; }
+
+  public: Channel mGatewayChannel ; // UNDEFINED_CHANNEL: no gateway correlation
+  public: bool gatewayEnabled (void) const { return mGatewayChannel != UNDEFINED_CHANNEL ; }
+  public: U32 gatewayBitRate (void) const { return mGatewayBitRate ; }
+  public: U32 gatewayDataBitRate (void) const { return mGatewayDataBitRate ; }
+  public: U32 gatewayWindowMilliSeconds (void) const { return mGatewayWindowMilliSeconds ; }
+  public: const std::vector <CANGatewayRemap> & gatewayRemaps (void) const { return mGatewayRemaps ; }
+
+  public: CANPhaseErrorMode phaseErrorMode (void) const { return CANPhaseErrorMode (mPhaseErrorMode) ; }
+  public: U32 phaseWarningPercent (void) const { return mPhaseWarningPercent ; }
+
+  public: bool periodStatistics (void) const { return mPeriodStatistics ; }
+
+  public: bool responseTimeAnalysis (void) const { return mResponseTimeAnalysis ; }
+
   public: U32 generatedAckSlot (void) const {
     return mSimulatorGeneratedAckSlot ;
   }
@@ -59,20 +122,92 @@ class CANMolinaroAnalyzerSettings : public AnalyzerSettings {
    return mSimulatorRandomSeed ;
   }
 
+  public: const CANErrorScenarios & errorScenarios (void) const {
+   return mErrorScenarios ;
+  }
+
+  public: const std::string & simulatorReplayLogPath (void) const {
+   return mSimulatorReplayLogPath ;
+  }
+
 
   protected: std::unique_ptr < AnalyzerSettingInterfaceChannel >  mInputChannelInterface;
   protected: std::unique_ptr < AnalyzerSettingInterfaceInteger >  mBitRateInterface;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mProtocolInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mDataBitRateInterface ;
   protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mCanChannelInvertedInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mGlitchFilterInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mDecodeWindowInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mWindowStartInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mWindowEndInterface ;
   protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mSimulatorAckGenerationInterface ;
   protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mSimulatorFrameTypeGenerationInterface ;
   protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mSimulatorFrameValidityInterface ;
   protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mSimulatorRandomSeedInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mSimulatorErrorScenariosInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mSimulatorReplayLogInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mResultFramesInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mDetailInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mFullDetailSecondsInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mErrorDetailInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mFullDetailIdentifiersInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mISOTPAddressPairsInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mJ1939Interface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mPayloadSearchInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mLiveTapInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mLiveLogInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mLiveLogFormatInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mLiveLogRotationInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceChannel > mGatewayChannelInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mGatewayBitRateInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mGatewayDataBitRateInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mGatewayWindowInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceText > mGatewayRemapInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mPhaseErrorsInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceInteger > mPhaseWarningInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mPeriodStatisticsInterface ;
+  protected: std::unique_ptr < AnalyzerSettingInterfaceNumberList > mResponseTimeInterface ;
 
   protected: U32 mSimulatorGeneratedAckSlot ;
   protected: U32 mSimulatorGeneratedFrameType ;
   protected: U32 mGeneratedFrameValidity ;
   protected: U32 mSimulatorRandomSeed ;
   protected: bool mInverted ;
+  protected: bool mOneFramePerMessage ;
+  protected: bool mCANFD ;
+  protected: U32 mDataBitRate ;
+  protected: std::string mISOTPAddressPairText ;
+  protected: std::vector <CANISOTPAddressPair> mISOTPAddressPairs ;
+  protected: bool mJ1939 ;
+  protected: std::string mPayloadPatternText ;
+  protected: std::vector <CANPayloadPattern> mPayloadPatterns ;
+  protected: std::string mLiveTapName ;
+  protected: U32 mGlitchFilterPercent ;
+  protected: bool mChangedMessagesOnly ; // Implies mOneFramePerMessage
+  protected: U32 mDetailLevel ; // CANDetailLevel
+  protected: U32 mFullDetailSeconds ;
+  protected: U32 mErrorDetailMilliSeconds ;
+  protected: std::string mFullDetailIdentifierText ;
+  protected: std::vector <uint32_t> mFullDetailIdentifierKeys ;
+  protected: U32 mDecodeWindowReference ; // CANDecodeWindowReference
+  protected: std::string mWindowStartText ;
+  protected: std::string mWindowEndText ;
+  protected: CANDecodeWindow mDecodeWindow ;
+  protected: std::string mErrorScenarioText ;
+  protected: CANErrorScenarios mErrorScenarios ;
+  protected: std::string mLiveLogPath ;
+  protected: U32 mLiveLogFormat ; // CANLiveLogFormat
+  protected: U32 mLiveLogRotationMegaBytes ; // 0: no rotation
+  protected: U32 mGatewayBitRate ;
+  protected: U32 mGatewayDataBitRate ;
+  protected: U32 mGatewayWindowMilliSeconds ;
+  protected: std::string mGatewayRemapText ;
+  protected: std::vector <CANGatewayRemap> mGatewayRemaps ;
+  protected: U32 mPhaseErrorMode ; // CANPhaseErrorMode
+  protected: U32 mPhaseWarningPercent ; // Of bit time
+  protected: bool mPeriodStatistics ;
+  protected: std::string mSimulatorReplayLogPath ; // Empty: random frames
+  protected: bool mResponseTimeAnalysis ;
 } ;
 
 //----------------------------------------------------------------------------------------
@@ -0,0 +1,142 @@
+#ifndef CANMOLINARO_INSTRUMENTATION_H
+#define CANMOLINARO_INSTRUMENTATION_H
+
+//----------------------------------------------------------------------------------------
+// Hot path instrumentation: compiled in only if CANMOLINARO_INSTRUMENTATION is defined
+// (CMake option of the same name); otherwise every method is an empty inline function.
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+
+#ifdef CANMOLINARO_INSTRUMENTATION
+  #include <chrono>
+#endif
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  INSTR_EDGES,
+  INSTR_BITS,
+  INSTR_MARKERS,
+  INSTR_FRAMES,
+  INSTR_FRAMES_V2,
+  INSTR_COMMITS,
+  INSTR_PROGRESS_REPORTS,
+  INSTR_COUNTER_COUNT
+} InstrumentationCounter ;
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  INSTR_CHANNEL_DATA_TIME, // GetSampleOfNextEdge, AdvanceToNextEdge
+  INSTR_ADD_MARKER_TIME,
+  INSTR_ADD_FRAME_TIME,
+  INSTR_ADD_FRAME_V2_TIME,
+  INSTR_COMMIT_RESULTS_TIME,
+  INSTR_REPORT_PROGRESS_TIME,
+  INSTR_TIMER_COUNT
+} InstrumentationTimer ;
+
+//----------------------------------------------------------------------------------------
+
+#ifdef CANMOLINARO_INSTRUMENTATION
+
+//----------------------------------------------------------------------------------------
+
+class CANMolinaroInstrumentation {
+  public: static const bool enabled = true ;
+
+  public: CANMolinaroInstrumentation (void) {
+    reset () ;
+  }
+
+  public: void reset (void) {
+    for (uint32_t i=0 ; i<INSTR_COUNTER_COUNT ; i++) {
+      mCounters [i] = 0 ;
+    }
+    for (uint32_t i=0 ; i<INSTR_TIMER_COUNT ; i++) {
+      mNanoseconds [i] = 0 ;
+    }
+    mStart = std::chrono::steady_clock::now () ;
+  }
+
+  public: inline void count (const InstrumentationCounter inCounter, const uint64_t inCount = 1) {
+    mCounters [inCounter] += inCount ;
+  }
+
+  public: inline void addTime (const InstrumentationTimer inTimer, const uint64_t inNanoseconds) {
+    mNanoseconds [inTimer] += inNanoseconds ;
+  }
+
+  public: inline uint64_t counter (const InstrumentationCounter inCounter) const {
+    return mCounters [inCounter] ;
+  }
+
+  public: inline uint64_t nanoseconds (const InstrumentationTimer inTimer) const {
+    return mNanoseconds [inTimer] ;
+  }
+
+  public: uint64_t elapsedNanoseconds (void) const {
+    return uint64_t (std::chrono::duration_cast <std::chrono::nanoseconds> (
+      std::chrono::steady_clock::now () - mStart
+    ).count ()) ;
+  }
+
+  private: uint64_t mCounters [INSTR_COUNTER_COUNT] ;
+  private: uint64_t mNanoseconds [INSTR_TIMER_COUNT] ;
+  private: std::chrono::steady_clock::time_point mStart ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class InstrumentationTimerScope {
+  public: InstrumentationTimerScope (CANMolinaroInstrumentation & inInstrumentation,
+                                     const InstrumentationTimer inTimer) :
+  mInstrumentation (inInstrumentation),
+  mTimer (inTimer),
+  mStart (std::chrono::steady_clock::now ()) {
+  }
+
+  public: ~ InstrumentationTimerScope (void) {
+    mInstrumentation.addTime (mTimer, uint64_t (std::chrono::duration_cast <std::chrono::nanoseconds> (
+      std::chrono::steady_clock::now () - mStart
+    ).count ())) ;
+  }
+
+  private: CANMolinaroInstrumentation & mInstrumentation ;
+  private: const InstrumentationTimer mTimer ;
+  private: const std::chrono::steady_clock::time_point mStart ;
+
+  private: InstrumentationTimerScope (const InstrumentationTimerScope &) ;
+  private: InstrumentationTimerScope & operator = (const InstrumentationTimerScope &) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#else
+
+//----------------------------------------------------------------------------------------
+
+class CANMolinaroInstrumentation {
+  public: static const bool enabled = false ;
+  public: inline void reset (void) {}
+  public: inline void count (const InstrumentationCounter, const uint64_t = 1) {}
+  public: inline void addTime (const InstrumentationTimer, const uint64_t) {}
+  public: inline uint64_t counter (const InstrumentationCounter) const { return 0 ; }
+  public: inline uint64_t nanoseconds (const InstrumentationTimer) const { return 0 ; }
+  public: inline uint64_t elapsedNanoseconds (void) const { return 0 ; }
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class InstrumentationTimerScope {
+  public: inline InstrumentationTimerScope (CANMolinaroInstrumentation &, const InstrumentationTimer) {}
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif
+
+//----------------------------------------------------------------------------------------
+
+#endif //CANMOLINARO_INSTRUMENTATION_H
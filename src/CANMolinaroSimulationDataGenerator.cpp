@@ -1,189 +1,11 @@
 #include "CANMolinaroSimulationDataGenerator.h"
 #include "CANMolinaroAnalyzerSettings.h"
+#include "CANFrameBitsGenerator.h"
 
 //----------------------------------------------------------------------------------------
 
 #include <AnalyzerHelpers.h>
 
-//----------------------------------------------------------------------------------------
-//  CAN FRAME GENERATOR
-//----------------------------------------------------------------------------------------
-
-typedef enum {standardFrame, extendedFrame} FrameFormat ;
-
-//----------------------------------------------------------------------------------------
-
-typedef enum {dataFrame, remoteFrame} FrameType ;
-
-//----------------------------------------------------------------------------------------
-
-typedef enum {ACK_SLOT_DOMINANT, ACK_SLOT_RECESSIVE} AckSlot ;
-
-//----------------------------------------------------------------------------------------
-
-class CANFrameBitsGenerator {
-  public : CANFrameBitsGenerator (const uint32_t inIdentifier,
-                                  const FrameFormat inFrameFormat,
-                                  const uint8_t inDataLength,
-                                  const uint8_t inData [8],
-                                  const FrameType inFrameType,
-                                  const AckSlot inAckSlot) ;
-
-//--- Public methods
-  public : inline uint32_t frameLength (void) const { return mFrameLength ; }
-  public : bool bitAtIndex (const uint32_t inIndex) const ;
-
-//--- Private methods (used during frame generation)
-  private: void enterBitAppendStuff (const bool inBit) ;
-
-  private: void enterBitNoStuff (const bool inBit) ;
-
-//--- Private properties
-  private: uint32_t mBits [5] ;
-  private: uint8_t mFrameLength ;
-
-//--- CRC computation
-  private : uint32_t mConsecutiveBitCount ;
-  private : bool mLastBitValue ;
-  private : uint16_t mCRCAccumulator ;
-} ;
-
-//----------------------------------------------------------------------------------------
-
-CANFrameBitsGenerator::CANFrameBitsGenerator (const uint32_t inIdentifier,
-                                              const FrameFormat inFrameFormat,
-                                              const uint8_t inDataLength,
-                                              const uint8_t inData [8],
-                                              const FrameType inFrameType,
-                                              const AckSlot inAckSlot) :
-mBits (),
-mFrameLength (0),
-mConsecutiveBitCount (1),
-mLastBitValue (true),
-mCRCAccumulator (0) {
-  for (uint32_t i=0 ; i<5 ; i++) {
-    mBits [i] = UINT32_MAX ;
-  }
-  const uint8_t dataLength = (inDataLength > 15) ? 15 : inDataLength ;
-//--- Generate frame
-  enterBitAppendStuff (false) ; // SOF
-  switch (inFrameFormat) {
-  case extendedFrame :
-    for (uint8_t idx = 28 ; idx >= 18 ; idx--) { // Identifier
-      const bool bit = (inIdentifier & (1 << idx)) != 0 ;
-      enterBitAppendStuff (bit) ;
-    }
-    enterBitAppendStuff (true) ; // SRR
-    enterBitAppendStuff (true) ; // IDE
-    for (int idx = 17 ; idx >= 0 ; idx--) { // Identifier
-      const bool bit = (inIdentifier & (1 << idx)) != 0 ;
-      enterBitAppendStuff (bit) ;
-    }
-    break ;
-  case standardFrame :
-    for (int idx = 10 ; idx >= 0 ; idx--) { // Identifier
-      const bool bit = (inIdentifier & (1 << idx)) != 0 ;
-      enterBitAppendStuff (bit) ;
-    }
-    break ;
-  }
-  enterBitAppendStuff (inFrameType == remoteFrame) ; // RTR
-  enterBitAppendStuff (false) ; // RESERVED 1
-  enterBitAppendStuff (false) ; // RESERVED 0
-  enterBitAppendStuff ((dataLength & 8) != 0) ; // DLC 3
-  enterBitAppendStuff ((dataLength & 4) != 0) ; // DLC 2
-  enterBitAppendStuff ((dataLength & 2) != 0) ; // DLC 1
-  enterBitAppendStuff ((dataLength & 1) != 0) ; // DLC 0
-//--- Enter DATA
-  if (inFrameType == dataFrame) {
-    const uint8_t maxLength = (dataLength > 8) ? 8 : dataLength ;
-    for (uint8_t dataIdx = 0 ; dataIdx < maxLength ; dataIdx ++) {
-      for (int bitIdx = 7 ; bitIdx >= 0 ; bitIdx--) {
-        enterBitAppendStuff ((inData [dataIdx] & (1 << bitIdx)) != 0) ;
-      }
-    }
-  }
-//--- Enter CRC SEQUENCE
-  const uint16_t frameCRC = mCRCAccumulator ;
-  for (int idx = 14 ; idx >= 0 ; idx--) {
-    const bool bit = (frameCRC & (1 << idx)) != 0 ;
-    enterBitAppendStuff (bit) ;
-  }
-//--- Enter ACK, EOF, INTERMISSION
-  enterBitNoStuff (true) ; // CRC DEL
-  switch (inAckSlot) {
-  case ACK_SLOT_DOMINANT :
-    enterBitNoStuff (false) ;
-    break ;
-  case ACK_SLOT_RECESSIVE :
-    enterBitNoStuff (true) ;
-    break ;
-  }
-//--- ACK DEL, EOF (7), INTERMISSION (3), all RECESSIVE
-  mFrameLength += 11 ;
-}
-
-//----------------------------------------------------------------------------------------
-
-void CANFrameBitsGenerator::enterBitAppendStuff (const bool inBit) {
-//--- Compute CRC
-  const bool bit14 = (mCRCAccumulator & (1 << 14)) != 0 ;
-  const bool crc_nxt = inBit ^ bit14 ;
-  mCRCAccumulator <<= 1 ;
-  mCRCAccumulator &= 0x7FFF ;
-  if (crc_nxt) {
-    mCRCAccumulator ^= 0x4599 ;
-  }
-//--- Emit bit
-  if (!inBit) {
-    const uint32_t idx = mFrameLength / 32 ;
-    const uint32_t offset = mFrameLength % 32 ;
-    mBits [idx] &= ~ (1U << offset) ;
-  }
-  mFrameLength ++ ;
-//--- Add a stuff bit ?
-  if (mLastBitValue == inBit) {
-    mConsecutiveBitCount += 1 ;
-    if (mConsecutiveBitCount == 5) {
-      mLastBitValue ^= true ;
-      if (!mLastBitValue) {
-        const uint32_t idx = mFrameLength / 32 ;
-        const uint32_t offset = mFrameLength % 32 ;
-        mBits [idx] &= ~ (1U << offset) ;
-      }
-      mFrameLength ++ ;
-      mConsecutiveBitCount = 1 ;
-    }
-  }else{
-    mLastBitValue = inBit ;
-    mConsecutiveBitCount = 1 ;
-  }
-}
-
-//----------------------------------------------------------------------------------------
-
-void CANFrameBitsGenerator::enterBitNoStuff (const bool inBit) {
-//--- Emit bit
-  if (!inBit) {
-    const uint32_t idx = mFrameLength / 32 ;
-    const uint32_t offset = mFrameLength % 32 ;
-    mBits [idx] &= ~ (1U << offset) ;
-  }
-  mFrameLength ++ ;
-}
-
-//----------------------------------------------------------------------------------------
-
-bool CANFrameBitsGenerator::bitAtIndex (const uint32_t inIndex) const {
-  bool result = true ; // RECESSIF
-  if (inIndex < mFrameLength) {
-    const uint32_t idx = inIndex / 32 ;
-    const uint32_t offset = inIndex % 32 ;
-    result = (mBits [idx] & (1U << offset)) != 0 ;
-  }
-  return result ;
-}
-
 //----------------------------------------------------------------------------------------
 //  CANMolinaroSimulationDataGenerator
 //----------------------------------------------------------------------------------------
@@ -192,6 +14,11 @@ CANMolinaroSimulationDataGenerator::CANMolinaroSimulationDataGenerator (void) :
 mSettings (nullptr),
 mSimulationSampleRateHz (0),
 mSeed (0),
+mReplay (),
+mReplaying (false),
+mReplayStarted (false),
+mReplayOriginNanoSeconds (0),
+mReplayOriginSampleNumber (0),
 mSerialSimulationData (new SimulationChannelDescriptor ()) {
 }
 
@@ -211,6 +38,14 @@ void CANMolinaroSimulationDataGenerator::Initialize (const U32 simulation_sample
   mSerialSimulationData->SetChannel (mSettings->mInputChannel);
   mSerialSimulationData->SetSampleRate (simulation_sample_rate) ;
   mSerialSimulationData->SetInitialBitState (BIT_HIGH) ;
+
+//--- Log replay; random frames are generated if the log cannot be opened
+  std::string error ;
+  mReplay.close () ;
+  mReplaying = !mSettings->simulatorReplayLogPath ().empty ()
+    && mReplay.open (mSettings->simulatorReplayLogPath (), error)
+  ;
+  mReplayStarted = false ;
 }
 
 //----------------------------------------------------------------------------------------
@@ -232,10 +67,17 @@ U32 CANMolinaroSimulationDataGenerator::GenerateSimulationData (const U64 larges
   const bool inverted = mSettings->inverted () ;
   mSerialSimulationData->TransitionIfNeeded (inverted ? BIT_LOW : BIT_HIGH) ;  // Edge for IDLE
   mSerialSimulationData->Advance (samplesPerBit * 11) ;
-  mSerialSimulationData->TransitionIfNeeded (inverted ? BIT_HIGH : BIT_LOW) ;  // Edge for SOF bit
-
-  while (mSerialSimulationData->GetCurrentSampleNumber() < adjusted_largest_sample_requested) {
-    createCANFrame (samplesPerBit, inverted) ;
+  if (mReplaying) {
+    while (mSerialSimulationData->GetCurrentSampleNumber() < adjusted_largest_sample_requested) {
+      if (!replayCANFrame (samplesPerBit, inverted)) { // End of log: the bus stays idle
+        sendIdle (adjusted_largest_sample_requested - mSerialSimulationData->GetCurrentSampleNumber (), inverted) ;
+      }
+    }
+  }else{
+    mSerialSimulationData->TransitionIfNeeded (inverted ? BIT_HIGH : BIT_LOW) ;  // Edge for SOF bit
+    while (mSerialSimulationData->GetCurrentSampleNumber() < adjusted_largest_sample_requested) {
+      createCANFrame (samplesPerBit, inverted) ;
+    }
   }
   mSerialSimulationData->TransitionIfNeeded (inverted ? BIT_LOW : BIT_HIGH) ; //we need to end recessive
 
@@ -282,31 +124,249 @@ void CANMolinaroSimulationDataGenerator::createCANFrame (const U32 inSamplesPerB
     ack = ((pseudoRandomValue () & 1) != 0) ? ACK_SLOT_DOMINANT : ACK_SLOT_RECESSIVE ;
     break ;
   }
+//--- Error scenario, at most one per frame
+  const CANErrorScenario scenario = mSettings->errorScenarios ().enabled ()
+    ? mSettings->errorScenarios ().select (pseudoRandomValue ())
+    : SCENARIO_NONE
+  ;
+  if ((scenario == SCENARIO_CRC) || (scenario == SCENARIO_NO_ACK)) {
+    ack = ACK_SLOT_RECESSIVE ;
+  }
+  const uint16_t crcErrorMask = (scenario == SCENARIO_CRC)
+    ? uint16_t (1 + pseudoRandomValue () % 0x7FFF)
+    : 0
+  ;
 //--- Generate frame
   uint8_t data [8] ;
   const FrameFormat format = extended ? extendedFrame : standardFrame ;
   const FrameType type = remote ? remoteFrame : dataFrame ;
   const uint32_t identifier = uint32_t (pseudoRandomValue ()) & (extended ? 0x1FFFFFFF : 0x7FF) ;
   const uint8_t dataLength = uint8_t (pseudoRandomValue ()) % 9 ;
-  if (! remoteFrame) {
+  if (! remote) {
     for (uint32_t i=0 ; i<dataLength ; i++) {
       data [i] = uint8_t (pseudoRandomValue ()) ;
     }
   }
-  const CANFrameBitsGenerator frame (identifier, format, dataLength, data, type, ack) ;
+  const CANFrameBitsGenerator frame (identifier, format, dataLength, data, type, ack, crcErrorMask) ;
+  if (scenario != SCENARIO_NONE) {
+    sendErrorScenario (frame, scenario, inSamplesPerBit, inInverted) ;
+    return ;
+  }
 //--- Generated bit error index
   U32 generatedErrorBitIndex = U32 (pseudoRandomValue ()) % frame.frameLength () ;
   if (simulatorFrameValidity == GENERATE_VALID_FRAMES) {
     generatedErrorBitIndex = 255 ;  // Means no generated error
   }
-//--- Now, send frame
-  for (U32 i=0 ; i < frame.frameLength () ; i++) {
-    const bool generateBitError = (i == generatedErrorBitIndex) ;
-    const bool bit = frame.bitAtIndex (i) ^ inInverted ^ generateBitError ;
-    mSerialSimulationData->TransitionIfNeeded (bit ? BIT_HIGH : BIT_LOW) ;
-    mSerialSimulationData->Advance (inSamplesPerBit) ;
+//--- Now, send frame, one run of identical bits at a time if there is no error to insert
+  if (generatedErrorBitIndex < frame.frameLength ()) {
+    for (U32 i=0 ; i < frame.frameLength () ; i++) {
+      const bool generateBitError = (i == generatedErrorBitIndex) ;
+      const bool bit = frame.bitAtIndex (i) ^ inInverted ^ generateBitError ;
+      mSerialSimulationData->TransitionIfNeeded (bit ? BIT_HIGH : BIT_LOW) ;
+      mSerialSimulationData->Advance (inSamplesPerBit) ;
+    }
+  }else{
+    sendFrame (frame, inSamplesPerBit, inInverted) ;
   }
 //  mSerialSimulationData->TransitionIfNeeded (inInverted ? BIT_LOW : BIT_HIGH) ; //we need to end recessive
 }
 
 //----------------------------------------------------------------------------------------
+
+void CANMolinaroSimulationDataGenerator::sendFrame (const CANFrameBitsGenerator & inFrame,
+                                                    const U32 inSamplesPerBit,
+                                                    const bool inInverted) {
+  uint8_t runs [CAN_FD_FRAME_MAX_BIT_COUNT] ;
+  const uint32_t runCount = inFrame.runLengths (runs) ;
+  for (U32 i=0 ; i < runCount ; i++) {
+    const bool bit = ((i & 1) != 0) ^ inInverted ; // Even runs are dominant
+    mSerialSimulationData->TransitionIfNeeded (bit ? BIT_HIGH : BIT_LOW) ;
+    mSerialSimulationData->Advance (inSamplesPerBit * runs [i]) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+//  LOG REPLAY
+//----------------------------------------------------------------------------------------
+// The first message of the log is sent at once; the following ones at the same distance
+// from it as in the log. A message whose time has passed (the bus was busy, or the log
+// time stamps go backwards) is sent right after the previous frame INTERMISSION.
+
+bool CANMolinaroSimulationDataGenerator::replayCANFrame (const U32 inSamplesPerBit,
+                                                         const bool inInverted) {
+  CANReplayMessage message ;
+  const bool ok = mReplay.next (message) ;
+  if (ok) {
+    const U64 currentSampleNumber = mSerialSimulationData->GetCurrentSampleNumber () ;
+    if (!mReplayStarted) {
+      mReplayStarted = true ;
+      mReplayOriginNanoSeconds = message.mNanoSeconds ;
+      mReplayOriginSampleNumber = currentSampleNumber ;
+    }
+    const uint64_t nanoSeconds = (message.mNanoSeconds > mReplayOriginNanoSeconds)
+      ? (message.mNanoSeconds - mReplayOriginNanoSeconds)
+      : 0
+    ;
+    const U64 sofSampleNumber = mReplayOriginSampleNumber
+      + (nanoSeconds / 1000000000) * mSimulationSampleRateHz
+      + (nanoSeconds % 1000000000) * mSimulationSampleRateHz / 1000000000
+    ;
+    if (sofSampleNumber > currentSampleNumber) {
+      sendIdle (sofSampleNumber - currentSampleNumber, inInverted) ;
+    }
+    const CANFrameBitsGenerator frame (message.mFrame) ;
+    sendFrame (frame, inSamplesPerBit, inInverted) ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroSimulationDataGenerator::sendIdle (const U64 inSampleCount, const bool inInverted) {
+  mSerialSimulationData->TransitionIfNeeded (inInverted ? BIT_LOW : BIT_HIGH) ;
+  U64 remaining = inSampleCount ;
+  while (remaining > 0) {
+    const U32 advance = U32 ((remaining > 0x40000000) ? 0x40000000 : remaining) ;
+    mSerialSimulationData->Advance (advance) ;
+    remaining -= advance ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+//  ERROR SCENARIOS
+//----------------------------------------------------------------------------------------
+// Bits of a CANFrameBitsGenerator frame of length L: the stuffed part (SOF ... CRC) ends
+// at L-14, then CRC DEL (L-13), ACK SLOT (L-12), ACK DEL (L-11), EOF (L-10 ... L-4) and
+// INTERMISSION (L-3 ... L-1). Error flags start at the bit that follows the error.
+
+void CANMolinaroSimulationDataGenerator::sendErrorScenario (const CANFrameBitsGenerator & inFrame,
+                                                            const CANErrorScenario inScenario,
+                                                            const U32 inSamplesPerBit,
+                                                            const bool inInverted) {
+  const U32 length = inFrame.frameLength () ;
+  const U32 crcDelimiterIndex = length - 13 ;
+  switch (inScenario) {
+  case SCENARIO_BURST :
+    { const U32 first = 1 + pseudoRandomValue () % (crcDelimiterIndex - 1) ;
+      const U32 burstLength = 2 + pseudoRandomValue () % 7 ;
+      sendFrameBits (inFrame, 0, first, false, inSamplesPerBit, inInverted) ;
+      sendFrameBits (inFrame, first, first + burstLength, true, inSamplesPerBit, inInverted) ;
+      sendErrorFrame (true, inSamplesPerBit, inInverted) ;
+    }
+    break ;
+  case SCENARIO_STUFF :
+    { const U32 idx = 1 + pseudoRandomValue () % (crcDelimiterIndex - 1) ;
+      sendFrameBits (inFrame, 0, idx, false, inSamplesPerBit, inInverted) ;
+      sendLevel (inFrame.bitAtIndex (idx - 1), 6, inSamplesPerBit, inInverted) ;
+      sendErrorFrame (true, inSamplesPerBit, inInverted) ;
+    }
+    break ;
+  case SCENARIO_CRC : // Up to ACK DEL
+    sendFrameBits (inFrame, 0, length - 10, false, inSamplesPerBit, inInverted) ;
+    sendErrorFrame (true, inSamplesPerBit, inInverted) ;
+    break ;
+  case SCENARIO_NO_ACK : // Up to ACK SLOT
+    sendFrameBits (inFrame, 0, length - 11, false, inSamplesPerBit, inInverted) ;
+    sendErrorFrame (true, inSamplesPerBit, inInverted) ;
+    break ;
+  case SCENARIO_FORM :
+    { const U32 r = pseudoRandomValue () % 8 ; // CRC DEL, ACK DEL, or one of the first 6 EOF bits
+      const U32 idx = crcDelimiterIndex + ((r == 0) ? 0 : (r + 1)) ;
+      sendFrameBits (inFrame, 0, idx, false, inSamplesPerBit, inInverted) ;
+      sendLevel (false, 1, inSamplesPerBit, inInverted) ;
+      sendErrorFrame (true, inSamplesPerBit, inInverted) ;
+    }
+    break ;
+  case SCENARIO_ACTIVE_FLAG : // Anywhere before the last EOF bit
+    sendFrameBits (inFrame, 0, 1 + pseudoRandomValue () % (length - 5), false, inSamplesPerBit, inInverted) ;
+    sendErrorFrame (true, inSamplesPerBit, inInverted) ;
+    break ;
+  case SCENARIO_PASSIVE_FLAG :
+    { const U32 idx = 1 + pseudoRandomValue () % (crcDelimiterIndex - 1) ;
+      sendFrameBits (inFrame, 0, idx, false, inSamplesPerBit, inInverted) ;
+      sendFrameBits (inFrame, idx, idx + 1, true, inSamplesPerBit, inInverted) ;
+      sendErrorFrame (false, inSamplesPerBit, inInverted) ;
+    }
+    break ;
+  case SCENARIO_OVERLOAD : // Flag from the first INTERMISSION bit
+    sendFrameBits (inFrame, 0, length - 3, false, inSamplesPerBit, inInverted) ;
+    sendErrorFrame (true, inSamplesPerBit, inInverted) ;
+    break ;
+  case SCENARIO_BUS_OFF : // Transmit error counter +8 per attempt: error passive at 128, bus off at 256
+    for (U32 attempt = 0 ; attempt < 32 ; attempt++) {
+      const U32 idx = 1 + pseudoRandomValue () % (crcDelimiterIndex - 1) ;
+      sendFrameBits (inFrame, 0, idx, false, inSamplesPerBit, inInverted) ;
+      sendFrameBits (inFrame, idx, idx + 1, true, inSamplesPerBit, inInverted) ;
+      sendErrorFrame (attempt < 16, inSamplesPerBit, inInverted) ;
+    }
+    sendLevel (true, 128 * 11, inSamplesPerBit, inInverted) ; // Bus off recovery
+    break ;
+  case SCENARIO_GLITCH :
+    sendGlitchedFrame (inFrame, inSamplesPerBit, inInverted) ;
+    break ;
+  case SCENARIO_COUNT :
+    break ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroSimulationDataGenerator::sendLevel (const bool inRecessive,
+                                                    const U32 inBitCount,
+                                                    const U32 inSamplesPerBit,
+                                                    const bool inInverted) {
+  mSerialSimulationData->TransitionIfNeeded ((inRecessive ^ inInverted) ? BIT_HIGH : BIT_LOW) ;
+  mSerialSimulationData->Advance (inSamplesPerBit * inBitCount) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANMolinaroSimulationDataGenerator::sendFrameBits (const CANFrameBitsGenerator & inFrame,
+                                                        const U32 inFirst,
+                                                        const U32 inEnd,
+                                                        const bool inToggled,
+                                                        const U32 inSamplesPerBit,
+                                                        const bool inInverted) {
+  for (U32 i=inFirst ; i<inEnd ; i++) {
+    sendLevel (inFrame.bitAtIndex (i) ^ inToggled, 1, inSamplesPerBit, inInverted) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// The active flag is overlapped by the flags of the nodes that detect the error only
+// when they see it, so 6 to 12 dominant bits.
+
+void CANMolinaroSimulationDataGenerator::sendErrorFrame (const bool inActive,
+                                                         const U32 inSamplesPerBit,
+                                                         const bool inInverted) {
+  if (inActive) {
+    sendLevel (false, 6 + pseudoRandomValue () % 7, inSamplesPerBit, inInverted) ;
+    sendLevel (true, 8 + 3, inSamplesPerBit, inInverted) ;
+  }else{
+    sendLevel (true, 6 + 8 + 3 + 8, inSamplesPerBit, inInverted) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// A pulse of 1 sample to a quarter of a bit, at a random place of a random bit; the frame
+// is otherwise unchanged (a pulse over a sample point is a bit error for the decoder).
+
+void CANMolinaroSimulationDataGenerator::sendGlitchedFrame (const CANFrameBitsGenerator & inFrame,
+                                                            const U32 inSamplesPerBit,
+                                                            const bool inInverted) {
+  const U32 glitchedBitIndex = pseudoRandomValue () % (inFrame.frameLength () - 3) ;
+  const U32 maxWidth = (inSamplesPerBit >= 8) ? (inSamplesPerBit / 4) : 1 ;
+  const U32 width = 1 + pseudoRandomValue () % maxWidth ;
+  const U32 offset = (inSamplesPerBit > width) ? (pseudoRandomValue () % (inSamplesPerBit - width)) : 0 ;
+  sendFrameBits (inFrame, 0, glitchedBitIndex, false, inSamplesPerBit, inInverted) ;
+  const bool bit = inFrame.bitAtIndex (glitchedBitIndex) ^ inInverted ;
+  mSerialSimulationData->TransitionIfNeeded (bit ? BIT_HIGH : BIT_LOW) ;
+  mSerialSimulationData->Advance (offset) ;
+  mSerialSimulationData->TransitionIfNeeded (bit ? BIT_LOW : BIT_HIGH) ;
+  mSerialSimulationData->Advance (width) ;
+  mSerialSimulationData->TransitionIfNeeded (bit ? BIT_HIGH : BIT_LOW) ;
+  mSerialSimulationData->Advance (inSamplesPerBit - offset - width) ;
+  sendFrameBits (inFrame, glitchedBitIndex + 1, inFrame.frameLength (), false, inSamplesPerBit, inInverted) ;
+}
+
+//----------------------------------------------------------------------------------------
@@ -6,9 +6,13 @@
 #include <SimulationChannelDescriptor.h>
 #include <string>
 
+#include "CANErrorScenarios.h"
+#include "CANLogReplay.h"
+
 //----------------------------------------------------------------------------------------
 
 class CANMolinaroAnalyzerSettings ;
+class CANFrameBitsGenerator ;
 
 //----------------------------------------------------------------------------------------
 
@@ -37,6 +41,52 @@ class CANMolinaroSimulationDataGenerator {
 
   protected: void createCANFrame (const U32 inSamplesPerBit, const bool inInverted) ;
 
+//--- One run of identical bits at a time
+  protected: void sendFrame (const CANFrameBitsGenerator & inFrame,
+                             const U32 inSamplesPerBit,
+                             const bool inInverted) ;
+
+//---------------- Log replay (see CANLogReplay.h)
+//--- Sends the next message of the log at its time stamp, or as soon as the previous one
+//    ends; returns false at the end of the log
+  protected: bool replayCANFrame (const U32 inSamplesPerBit, const bool inInverted) ;
+
+  protected: void sendIdle (const U64 inSampleCount, const bool inInverted) ;
+
+  protected: CANLogReplay mReplay ;
+  protected: bool mReplaying ; // A log is replayed instead of random frames
+  protected: bool mReplayStarted ; // Origins are set by the first message
+  protected: uint64_t mReplayOriginNanoSeconds ;
+  protected: U64 mReplayOriginSampleNumber ;
+
+//---------------- Error scenarios (see CANErrorScenarios.h)
+  protected: void sendErrorScenario (const CANFrameBitsGenerator & inFrame,
+                                     const CANErrorScenario inScenario,
+                                     const U32 inSamplesPerBit,
+                                     const bool inInverted) ;
+
+  protected: void sendLevel (const bool inRecessive,
+                             const U32 inBitCount,
+                             const U32 inSamplesPerBit,
+                             const bool inInverted) ;
+
+//--- Bits inFirst ... inEnd - 1 of the frame, toggled if inToggled
+  protected: void sendFrameBits (const CANFrameBitsGenerator & inFrame,
+                                 const U32 inFirst,
+                                 const U32 inEnd,
+                                 const bool inToggled,
+                                 const U32 inSamplesPerBit,
+                                 const bool inInverted) ;
+
+//--- Flag, delimiter, intermission, and suspend transmission if passive
+  protected: void sendErrorFrame (const bool inActive,
+                                  const U32 inSamplesPerBit,
+                                  const bool inInverted) ;
+
+  protected: void sendGlitchedFrame (const CANFrameBitsGenerator & inFrame,
+                                     const U32 inSamplesPerBit,
+                                     const bool inInverted) ;
+
   protected: SimulationChannelDescriptor * mSerialSimulationData ;
 } ;
 
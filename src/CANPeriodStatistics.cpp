@@ -0,0 +1,190 @@
+#include "CANPeriodStatistics.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t EMPTY_KEY = UINT32_MAX ; // Identifier keys are below 0xA0000000
+static const size_t INITIAL_TABLE_SIZE = 1024 ;
+
+//----------------------------------------------------------------------------------------
+//   Period histogram
+//----------------------------------------------------------------------------------------
+
+static uint32_t periodBucket (const uint64_t inMicroSeconds) {
+  uint64_t result = inMicroSeconds ;
+  if (inMicroSeconds >= PERIOD_SUB_BUCKET_COUNT) {
+    uint32_t octave = PERIOD_SUB_BUCKET_BITS ;
+    while ((inMicroSeconds >> (octave + 1)) != 0) {
+      octave += 1 ;
+    }
+    const uint64_t subBucket = (inMicroSeconds >> (octave - PERIOD_SUB_BUCKET_BITS)) & (PERIOD_SUB_BUCKET_COUNT - 1) ;
+    result = PERIOD_SUB_BUCKET_COUNT * (octave + 1 - PERIOD_SUB_BUCKET_BITS) + subBucket ;
+    if (result >= PERIOD_HISTOGRAM_SIZE) {
+      result = PERIOD_HISTOGRAM_SIZE - 1 ;
+    }
+  }
+  return uint32_t (result) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static uint64_t bucketLowerBound (const uint32_t inBucket) {
+  uint64_t result = inBucket ;
+  if (inBucket >= PERIOD_SUB_BUCKET_COUNT) {
+    const uint32_t octave = PERIOD_SUB_BUCKET_BITS - 1 + inBucket / PERIOD_SUB_BUCKET_COUNT ;
+    const uint64_t subBucket = inBucket % PERIOD_SUB_BUCKET_COUNT ;
+    result = (PERIOD_SUB_BUCKET_COUNT + subBucket) << (octave - PERIOD_SUB_BUCKET_BITS) ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+// Fibonacci hashing: identifier keys are often consecutive
+
+static inline size_t slot (const uint32_t inIdentifierKey, const size_t inTableSize) {
+  return size_t ((uint64_t (inIdentifierKey) * 0x9E3779B97F4A7C15ULL) >> 32) & (inTableSize - 1) ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANPeriodStatistics
+//----------------------------------------------------------------------------------------
+
+CANPeriodStatistics::CANPeriodStatistics (CANPeriodStatisticsDelegate * inDelegate) :
+mDelegate (inDelegate),
+mEnabled (false),
+mSampleRateHz (1),
+mEntries (),
+mEntryCount (0),
+mHistograms (),
+mChangedKeys () {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPeriodStatistics::configure (const bool inEnabled, const uint32_t inSampleRateHz) {
+  mEnabled = inEnabled ;
+  mSampleRateHz = (inSampleRateHz > 0) ? inSampleRateHz : 1 ;
+  mEntries.clear () ;
+  mEntryCount = 0 ;
+  mHistograms.clear () ;
+  if (mEnabled) {
+    CANPeriodEntry empty ;
+    empty.mIdentifierKey = EMPTY_KEY ;
+    mEntries.resize (INITIAL_TABLE_SIZE, empty) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// Returns the entry of the key, or the empty slot where it should be inserted
+
+CANPeriodEntry * CANPeriodStatistics::find (const uint32_t inIdentifierKey) {
+  const size_t mask = mEntries.size () - 1 ;
+  size_t idx = slot (inIdentifierKey, mEntries.size ()) ;
+  while ((mEntries [idx].mIdentifierKey != inIdentifierKey) && (mEntries [idx].mIdentifierKey != EMPTY_KEY)) {
+    idx = (idx + 1) & mask ;
+  }
+  return & mEntries [idx] ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPeriodStatistics::grow (void) {
+  std::vector <CANPeriodEntry> entries (mEntries.size () * 2) ;
+  for (size_t i=0 ; i<entries.size () ; i++) {
+    entries [i].mIdentifierKey = EMPTY_KEY ;
+  }
+  entries.swap (mEntries) ;
+  for (size_t i=0 ; i<entries.size () ; i++) {
+    if (entries [i].mIdentifierKey != EMPTY_KEY) {
+      *find (entries [i].mIdentifierKey) = entries [i] ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPeriodStatistics::enterMessage (const uint32_t inIdentifierKey,
+                                        const uint64_t inSOFSampleNumber) {
+  CANPeriodEntry * entry = find (inIdentifierKey) ;
+  if (entry->mIdentifierKey == EMPTY_KEY) {
+    if ((mEntryCount + 1) * 2 > mEntries.size ()) { // Load factor below 1/2
+      grow () ;
+      entry = find (inIdentifierKey) ;
+    }
+    mEntryCount += 1 ;
+    entry->mIdentifierKey = inIdentifierKey ;
+    entry->mHistogramIndex = UINT32_MAX ;
+    entry->mMessageCount = 0 ;
+    entry->mMessageCountAtLastSummary = 0 ;
+    entry->mMinimumMicroSeconds = UINT64_MAX ;
+    entry->mMaximumMicroSeconds = 0 ;
+    entry->mTotalMicroSeconds = 0 ;
+  }else{
+    const uint64_t microSeconds = (inSOFSampleNumber - entry->mLastSampleNumber) * 1000000 / mSampleRateHz ;
+    if (entry->mMinimumMicroSeconds > microSeconds) {
+      entry->mMinimumMicroSeconds = microSeconds ;
+    }
+    if (entry->mMaximumMicroSeconds < microSeconds) {
+      entry->mMaximumMicroSeconds = microSeconds ;
+    }
+    entry->mTotalMicroSeconds += microSeconds ;
+  //--- Histograms are allocated at the first period, single messages need none
+    if ((entry->mHistogramIndex == UINT32_MAX) && (mHistograms.size () < (size_t (PERIOD_MAX_HISTOGRAMS) * PERIOD_HISTOGRAM_SIZE))) {
+      entry->mHistogramIndex = uint32_t (mHistograms.size () / PERIOD_HISTOGRAM_SIZE) ;
+      mHistograms.resize (mHistograms.size () + PERIOD_HISTOGRAM_SIZE, 0) ;
+    }
+    if (entry->mHistogramIndex != UINT32_MAX) {
+      mHistograms [size_t (entry->mHistogramIndex) * PERIOD_HISTOGRAM_SIZE + periodBucket (microSeconds)] += 1 ;
+    }
+  }
+  entry->mLastSampleNumber = inSOFSampleNumber ;
+  entry->mMessageCount += 1 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANPeriodStatistics::percentileMicroSeconds (const CANPeriodEntry & inEntry,
+                                                  const uint32_t inPercent,
+                                                  uint64_t & outMicroSeconds) const {
+  const bool ok = (inEntry.mHistogramIndex != UINT32_MAX) && (inEntry.mMessageCount > 1) ;
+  if (ok) {
+    const uint32_t * histogram = & mHistograms [size_t (inEntry.mHistogramIndex) * PERIOD_HISTOGRAM_SIZE] ;
+    const uint64_t rank = (inEntry.periodCount () * inPercent + 99) / 100 ; // 1 ... count
+    uint64_t count = 0 ;
+    uint32_t bucket = 0 ;
+    while ((count + histogram [bucket]) < rank) {
+      count += histogram [bucket] ;
+      bucket += 1 ;
+    }
+    outMicroSeconds = bucketLowerBound (bucket) ;
+    if (outMicroSeconds < inEntry.mMinimumMicroSeconds) {
+      outMicroSeconds = inEntry.mMinimumMicroSeconds ;
+    }else if (outMicroSeconds > inEntry.mMaximumMicroSeconds) {
+      outMicroSeconds = inEntry.mMaximumMicroSeconds ;
+    }
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPeriodStatistics::summarize (const uint64_t inSampleNumber) {
+  mChangedKeys.clear () ;
+  for (size_t i=0 ; i<mEntries.size () ; i++) {
+    const CANPeriodEntry & entry = mEntries [i] ;
+    if ((entry.mIdentifierKey != EMPTY_KEY)
+     && (entry.mMessageCount > 1)
+     && (entry.mMessageCount != entry.mMessageCountAtLastSummary)) {
+      mChangedKeys.push_back (entry.mIdentifierKey) ;
+    }
+  }
+  std::sort (mChangedKeys.begin (), mChangedKeys.end ()) ;
+  for (size_t i=0 ; i<mChangedKeys.size () ; i++) {
+    CANPeriodEntry * entry = find (mChangedKeys [i]) ;
+    mDelegate->addPeriodStatistics (*entry, *this, inSampleNumber) ;
+    entry->mMessageCountAtLastSummary = entry->mMessageCount ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,96 @@
+#ifndef CAN_PERIOD_STATISTICS
+#define CAN_PERIOD_STATISTICS
+
+//----------------------------------------------------------------------------------------
+// Per identifier period statistics: the period is the time between the SOF of two
+// consecutive messages with the same identifier (SOF, unlike EOF, does not move with the
+// stuff bit count). Count, minimum, maximum and mean are kept for every identifier;
+// percentiles come from a log bucketed histogram (HDR style): one bucket per microsecond
+// below 128 µs, then 128 buckets per power of two (0.8 % resolution), up to about 71
+// minutes.
+// Statistics live in a flat open addressing table keyed by identifier key (see
+// CANErrorCounters::identifierKey), so that any 29-bit identifier can be entered. Does not
+// depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t PERIOD_SUB_BUCKET_BITS = 7 ;
+static const uint32_t PERIOD_SUB_BUCKET_COUNT = 1 << PERIOD_SUB_BUCKET_BITS ;
+static const uint32_t PERIOD_HISTOGRAM_SIZE = PERIOD_SUB_BUCKET_COUNT * (33 - PERIOD_SUB_BUCKET_BITS) ; // Up to 2^32 µs
+
+//--- Histograms take 13 kB each: identifiers beyond this count get no percentiles
+static const uint32_t PERIOD_MAX_HISTOGRAMS = 2048 ;
+
+//----------------------------------------------------------------------------------------
+
+class CANPeriodEntry {
+  public: uint32_t mIdentifierKey ;
+  public: uint32_t mHistogramIndex ; // In units of PERIOD_HISTOGRAM_SIZE, UINT32_MAX: none
+  public: uint64_t mLastSampleNumber ; // SOF of the last message
+  public: uint64_t mMessageCount ;
+  public: uint64_t mMessageCountAtLastSummary ;
+  public: uint64_t mMinimumMicroSeconds ;
+  public: uint64_t mMaximumMicroSeconds ;
+  public: uint64_t mTotalMicroSeconds ;
+
+//--- Periods are one less than messages
+  public: inline uint64_t periodCount (void) const { return mMessageCount - 1 ; }
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANPeriodStatistics ;
+
+class CANPeriodStatisticsDelegate {
+  public: virtual ~CANPeriodStatisticsDelegate (void) {}
+
+//--- Sent by summarize for each identifier with a new period since the last summary;
+//    inStatistics provides the percentiles
+  public: virtual void addPeriodStatistics (const CANPeriodEntry & inEntry,
+                                            const CANPeriodStatistics & inStatistics,
+                                            const uint64_t inSampleNumber) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANPeriodStatistics {
+
+  public: CANPeriodStatistics (CANPeriodStatisticsDelegate * inDelegate) ;
+
+  public: void configure (const bool inEnabled, const uint32_t inSampleRateHz) ;
+
+  public: inline bool enabled (void) const { return mEnabled ; }
+
+  public: void enterMessage (const uint32_t inIdentifierKey, const uint64_t inSOFSampleNumber) ;
+
+//--- Sends the statistics of identifiers with new periods since the previous call, in
+//    increasing identifier key order
+  public: void summarize (const uint64_t inSampleNumber) ;
+
+  public: inline uint32_t identifierCount (void) const { return mEntryCount ; }
+
+//--- Lower bound of the bucket that holds the given percentile (clamped to min ... max);
+//    false if the entry has no histogram or no period
+  public: bool percentileMicroSeconds (const CANPeriodEntry & inEntry,
+                                       const uint32_t inPercent,
+                                       uint64_t & outMicroSeconds) const ;
+
+  private: CANPeriodEntry * find (const uint32_t inIdentifierKey) ;
+  private: void grow (void) ;
+
+  private: CANPeriodStatisticsDelegate * mDelegate ;
+  private: bool mEnabled ;
+  private: uint32_t mSampleRateHz ;
+  private: std::vector <CANPeriodEntry> mEntries ; // Power of two size, linear probing
+  private: uint32_t mEntryCount ;
+  private: std::vector <uint32_t> mHistograms ; // PERIOD_HISTOGRAM_SIZE counts per histogram
+  private: std::vector <uint32_t> mChangedKeys ; // Scratch, for summarize
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_PERIOD_STATISTICS
@@ -0,0 +1,174 @@
+#include "CANPhaseErrors.h"
+
+#include <stdio.h>
+
+//----------------------------------------------------------------------------------------
+//   CANPhaseHistogram
+//----------------------------------------------------------------------------------------
+
+CANPhaseHistogram::CANPhaseHistogram (void) :
+mEdgeCount (0),
+mEdgeCountAtLastSummary (0),
+mMinimum (0),
+mMaximum (0),
+mTotal (0) {
+  clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPhaseHistogram::clear (void) {
+  mEdgeCount = 0 ;
+  mEdgeCountAtLastSummary = 0 ;
+  mMinimum = PHASE_FULL_BIT ;
+  mMaximum = -PHASE_FULL_BIT ;
+  mTotal = 0 ;
+  for (uint32_t i=0 ; i<PHASE_BIN_COUNT ; i++) {
+    mBins [i] = 0 ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPhaseHistogram::enter (const int32_t inError) {
+  mEdgeCount += 1 ;
+  mTotal += inError ;
+  if (mMinimum > inError) {
+    mMinimum = inError ;
+  }
+  if (mMaximum < inError) {
+    mMaximum = inError ;
+  }
+  int32_t bin = (inError + PHASE_FULL_BIT / 2) * int32_t (PHASE_BIN_COUNT) / PHASE_FULL_BIT ;
+  if (bin < 0) {
+    bin = 0 ;
+  }else if (bin >= int32_t (PHASE_BIN_COUNT)) {
+    bin = int32_t (PHASE_BIN_COUNT) - 1 ;
+  }
+  mBins [bin] += 1 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+int32_t CANPhaseHistogram::worst (void) const {
+  int32_t result = 0 ;
+  if (mEdgeCount > 0) {
+    result = (-mMinimum > mMaximum) ? -mMinimum : mMaximum ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+std::string CANPhaseHistogram::binText (void) const {
+  std::string result ;
+  for (uint32_t i=0 ; i<PHASE_BIN_COUNT ; i++) {
+    if (mBins [i] > 0) {
+      const double lowerPercent = -50.0 + 100.0 * i / PHASE_BIN_COUNT ;
+      char s [48] ;
+      snprintf (s, sizeof (s), "%s%.1f:%llu", result.empty () ? "" : " ", lowerPercent, (unsigned long long) mBins [i]) ;
+      result += s ;
+    }
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANPhaseErrors
+//----------------------------------------------------------------------------------------
+
+CANPhaseErrors::CANPhaseErrors (CANPhaseErrorsDelegate * inDelegate) :
+mDelegate (inDelegate),
+mMode (PHASE_ERRORS_OFF),
+mWarningError (PHASE_FULL_BIT),
+mInFrame (false),
+mHasIdentifier (false),
+mIdentifierKey (0),
+mTransmitterEndSampleNumber (UINT64_MAX),
+mFrameEdges (),
+mFrameHistogram (),
+mCaptureHistogram (),
+mWarningCount (0),
+mIdentifierHistograms () {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPhaseErrors::configure (const CANPhaseErrorMode inMode, const uint32_t inWarningPercent) {
+  mMode = inMode ;
+  mWarningError = int32_t (inWarningPercent) * PHASE_FULL_BIT / 100 ;
+  mInFrame = false ;
+  mFrameEdges.clear () ;
+  mCaptureHistogram.clear () ;
+  mWarningCount = 0 ;
+  mIdentifierHistograms.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPhaseErrors::beginFrame (void) {
+  mInFrame = true ;
+  mHasIdentifier = false ;
+  mTransmitterEndSampleNumber = UINT64_MAX ;
+  mFrameEdges.clear () ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPhaseErrors::setIdentifier (const uint32_t inIdentifierKey) {
+  mHasIdentifier = true ;
+  mIdentifierKey = inIdentifierKey ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPhaseErrors::setTransmitterEnd (const uint64_t inSampleNumber) {
+  mTransmitterEndSampleNumber = inSampleNumber ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPhaseErrors::endFrame (const uint64_t inSampleNumber) {
+  if (mInFrame) {
+    mInFrame = false ;
+    mFrameHistogram.clear () ;
+    CANPhaseHistogram * identifierHistogram = NULL ;
+    if (mHasIdentifier && (mMode >= PHASE_ERRORS_IDENTIFIERS)) {
+      identifierHistogram = & mIdentifierHistograms [mIdentifierKey] ;
+    }
+    for (size_t i=0 ; i<mFrameEdges.size () ; i++) {
+      const Edge & edge = mFrameEdges [i] ;
+      mFrameHistogram.enter (edge.mError) ;
+      mCaptureHistogram.enter (edge.mError) ;
+      if ((identifierHistogram != NULL) && (edge.mSampleNumber < mTransmitterEndSampleNumber)) {
+        identifierHistogram->enter (edge.mError) ;
+      }
+    }
+    const bool warning = mFrameHistogram.worst () >= mWarningError ;
+    if (warning) {
+      mWarningCount += 1 ;
+    }
+    if ((mFrameHistogram.mEdgeCount > 0) && (warning || (mMode == PHASE_ERRORS_FRAMES))) {
+      mDelegate->addPhaseErrorFrame (mFrameHistogram, warning, inSampleNumber) ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANPhaseErrors::summarize (const uint64_t inSampleNumber) {
+  if (mCaptureHistogram.mEdgeCount != mCaptureHistogram.mEdgeCountAtLastSummary) {
+    mDelegate->addPhaseErrorSummary (mCaptureHistogram, mWarningCount, inSampleNumber) ;
+    mCaptureHistogram.mEdgeCountAtLastSummary = mCaptureHistogram.mEdgeCount ;
+  }
+  std::map <uint32_t, CANPhaseHistogram>::iterator it ;
+  for (it = mIdentifierHistograms.begin () ; it != mIdentifierHistograms.end () ; it++) {
+    CANPhaseHistogram & histogram = it->second ;
+    if (histogram.mEdgeCount != histogram.mEdgeCountAtLastSummary) {
+      mDelegate->addPhaseErrorIdentifier (it->first, histogram, inSampleNumber) ;
+      histogram.mEdgeCountAtLastSummary = histogram.mEdgeCount ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
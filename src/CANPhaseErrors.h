@@ -0,0 +1,130 @@
+#ifndef CAN_PHASE_ERRORS
+#define CAN_PHASE_ERRORS
+
+//----------------------------------------------------------------------------------------
+// Bit timing phase errors: the analyzer measures each edge within a frame against the bit
+// grid of the decoder (bit boundaries every samplesPerBit from the previous edge), in
+// 1/10000 of the current bit time: negative is early, positive is late. Errors go to fixed
+// bin histograms per frame, per capture and per identifier: edges from SOF to the end of
+// the CRC delimiter are attributed to the transmitter of the frame, edges of the ACK slot
+// are sent by receivers. A frame with an edge at or beyond the warning threshold is
+// flagged; the decoder samples at the middle of the bit, so the margin is 50 % minus the
+// worst error. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  PHASE_ERRORS_OFF,
+  PHASE_ERRORS_CAPTURE, // Capture histogram, and flagged frames
+  PHASE_ERRORS_IDENTIFIERS, // Also per identifier histograms
+  PHASE_ERRORS_FRAMES // Also a row for every frame
+} CANPhaseErrorMode ;
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t PHASE_BIN_COUNT = 64 ; // 1.5625 % of bit time each, -50 % ... +50 %
+static const int32_t PHASE_FULL_BIT = 10000 ;
+
+//----------------------------------------------------------------------------------------
+
+class CANPhaseHistogram {
+  public: CANPhaseHistogram (void) ;
+
+  public: void clear (void) ;
+
+  public: void enter (const int32_t inError) ;
+
+  public: int32_t worst (void) const ; // Largest absolute error
+
+//--- Non empty bins, "LOWER%:COUNT" separated by spaces, for example "-3.1:2 0.0:517"
+  public: std::string binText (void) const ;
+
+  public: uint64_t mEdgeCount ;
+  public: uint64_t mEdgeCountAtLastSummary ;
+  public: int32_t mMinimum ;
+  public: int32_t mMaximum ;
+  public: int64_t mTotal ;
+  public: uint64_t mBins [PHASE_BIN_COUNT] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANPhaseErrorsDelegate {
+  public: virtual ~CANPhaseErrorsDelegate (void) {}
+
+//--- Sent at the end of each frame with PHASE_ERRORS_FRAMES, otherwise of flagged frames
+  public: virtual void addPhaseErrorFrame (const CANPhaseHistogram & inFrame,
+                                           const bool inWarning,
+                                           const uint64_t inSampleNumber) = 0 ;
+
+//--- Sent by summarize when edges have been measured since the previous summary
+  public: virtual void addPhaseErrorSummary (const CANPhaseHistogram & inCapture,
+                                             const uint64_t inWarningCount,
+                                             const uint64_t inSampleNumber) = 0 ;
+
+  public: virtual void addPhaseErrorIdentifier (const uint32_t inIdentifierKey,
+                                                const CANPhaseHistogram & inHistogram,
+                                                const uint64_t inSampleNumber) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANPhaseErrors {
+
+  public: CANPhaseErrors (CANPhaseErrorsDelegate * inDelegate) ;
+
+  public: void configure (const CANPhaseErrorMode inMode, const uint32_t inWarningPercent) ;
+
+  public: inline bool enabled (void) const { return mMode != PHASE_ERRORS_OFF ; }
+
+//--- Edges out of frames are ignored
+  public: inline void enterEdge (const uint64_t inSampleNumber,
+                                 const int64_t inErrorSampleCount,
+                                 const uint32_t inSamplesPerBit) {
+    if (mInFrame) {
+      Edge edge ;
+      edge.mSampleNumber = inSampleNumber ;
+      edge.mError = int32_t (inErrorSampleCount * PHASE_FULL_BIT / int64_t (inSamplesPerBit)) ;
+      mFrameEdges.push_back (edge) ;
+    }
+  }
+
+  public: void beginFrame (void) ;
+
+  public: void setIdentifier (const uint32_t inIdentifierKey) ;
+
+//--- Edges from inSampleNumber are not sent by the transmitter
+  public: void setTransmitterEnd (const uint64_t inSampleNumber) ;
+
+  public: void endFrame (const uint64_t inSampleNumber) ;
+
+  public: void summarize (const uint64_t inSampleNumber) ;
+
+  private: class Edge {
+    public: uint64_t mSampleNumber ;
+    public: int32_t mError ;
+  } ;
+
+  private: CANPhaseErrorsDelegate * mDelegate ;
+  private: CANPhaseErrorMode mMode ;
+  private: int32_t mWarningError ;
+  private: bool mInFrame ;
+  private: bool mHasIdentifier ;
+  private: uint32_t mIdentifierKey ;
+  private: uint64_t mTransmitterEndSampleNumber ;
+  private: std::vector <Edge> mFrameEdges ;
+  private: CANPhaseHistogram mFrameHistogram ;
+  private: CANPhaseHistogram mCaptureHistogram ;
+  private: uint64_t mWarningCount ;
+  private: std::map <uint32_t, CANPhaseHistogram> mIdentifierHistograms ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_PHASE_ERRORS
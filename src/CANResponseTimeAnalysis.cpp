@@ -0,0 +1,214 @@
+#include "CANResponseTimeAnalysis.h"
+
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+const char * responseTimeStatusName (const CANResponseTimeStatus inStatus) {
+  switch (inStatus) {
+  case RESPONSE_TIME_OK : return "OK" ;
+  case RESPONSE_TIME_AT_RISK : return "At risk" ;
+  case RESPONSE_TIME_EXCEEDED : return "Exceeded" ;
+  }
+  return "" ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool sameResult (const CANResponseTimeResult & inLeft, const CANResponseTimeResult & inRight) {
+  return (inLeft.mPriorityRank == inRight.mPriorityRank)
+    && (inLeft.mPeriodMicroSeconds == inRight.mPeriodMicroSeconds)
+    && (inLeft.mFrameMicroSeconds == inRight.mFrameMicroSeconds)
+    && (inLeft.mBlockingMicroSeconds == inRight.mBlockingMicroSeconds)
+    && (inLeft.mQueueingMicroSeconds == inRight.mQueueingMicroSeconds)
+    && (inLeft.mResponseMicroSeconds == inRight.mResponseMicroSeconds)
+    && (inLeft.mObservedMicroSeconds == inRight.mObservedMicroSeconds)
+    && (inLeft.mStatus == inRight.mStatus)
+  ;
+}
+
+//----------------------------------------------------------------------------------------
+//   CANResponseTimeAnalysis
+//----------------------------------------------------------------------------------------
+
+CANResponseTimeAnalysis::CANResponseTimeAnalysis (CANResponseTimeDelegate * inDelegate) :
+mDelegate (inDelegate),
+mEnabled (false),
+mSampleRateHz (1),
+mSamplesPerBit (1),
+mEntries (),
+mLastEntry (NULL) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANResponseTimeAnalysis::configure (const bool inEnabled,
+                                         const uint32_t inSampleRateHz,
+                                         const uint32_t inSamplesPerBit) {
+  mEnabled = inEnabled ;
+  mSampleRateHz = (inSampleRateHz > 0) ? inSampleRateHz : 1 ;
+  mSamplesPerBit = (inSamplesPerBit > 0) ? inSamplesPerBit : 1 ;
+  mEntries.clear () ;
+  mLastEntry = NULL ;
+}
+
+//----------------------------------------------------------------------------------------
+// Arbitration field bits, most significant first: base identifier (11), RTR or SRR, IDE,
+// extension (18), RTR; data frames only, so RTR is dominant.
+
+uint32_t CANResponseTimeAnalysis::priorityKey (const uint32_t inIdentifierKey) {
+  const bool extended = (inIdentifierKey & 0x80000000) != 0 ;
+  const uint32_t identifier = inIdentifierKey & 0x7FFFFFFF ;
+  uint32_t result ;
+  if (extended) {
+    result = ((identifier >> 18) << 21) | (3U << 19) | ((identifier & 0x3FFFF) << 1) ;
+  }else{
+    result = (identifier & 0x7FF) << 21 ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+uint64_t CANResponseTimeAnalysis::microSeconds (const uint64_t inSampleCount) const {
+  return inSampleCount * 1000000 / mSampleRateHz ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANResponseTimeAnalysis::enterMessage (const uint32_t inIdentifierKey,
+                                            const uint64_t inSOFSampleNumber) {
+  const uint32_t key = priorityKey (inIdentifierKey) ;
+  std::map <uint32_t, Entry>::iterator it = mEntries.find (key) ;
+  if (it == mEntries.end ()) {
+    Entry entry ;
+    entry.mIdentifierKey = inIdentifierKey ;
+    entry.mMessageCount = 0 ;
+    entry.mMinimumPeriod = UINT64_MAX ;
+    entry.mMaximumPeriod = 0 ;
+    entry.mTotalPeriod = 0 ;
+    entry.mMinimumFrame = 0 ;
+    entry.mMaximumFrame = 0 ;
+    entry.mReported = false ;
+    it = mEntries.insert (std::make_pair (key, entry)).first ;
+  }else{
+    Entry & entry = it->second ;
+    const uint64_t period = inSOFSampleNumber - entry.mLastSampleNumber ;
+    if (entry.mMinimumPeriod > period) {
+      entry.mMinimumPeriod = period ;
+    }
+    if (entry.mMaximumPeriod < period) {
+      entry.mMaximumPeriod = period ;
+    }
+    entry.mTotalPeriod += period ;
+  }
+  it->second.mLastSampleNumber = inSOFSampleNumber ;
+  it->second.mMessageCount += 1 ;
+  mLastEntry = & it->second ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANResponseTimeAnalysis::enterFrameLength (const uint64_t inFrameSampleCount) {
+  if (mLastEntry != NULL) {
+    const uint64_t frame = inFrameSampleCount + mSamplesPerBit ;
+    if ((mLastEntry->mMinimumFrame == 0) || (mLastEntry->mMinimumFrame > frame)) {
+      mLastEntry->mMinimumFrame = frame ;
+    }
+    if (mLastEntry->mMaximumFrame < frame) {
+      mLastEntry->mMaximumFrame = frame ;
+    }
+    mLastEntry = NULL ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANResponseTimeAnalysis::summarize (const uint64_t inSampleNumber) {
+//--- Identifiers with a complete frame, in priority order
+  std::vector <Entry *> entries ;
+  for (std::map <uint32_t, Entry>::iterator it = mEntries.begin () ; it != mEntries.end () ; it++) {
+    if (it->second.mMinimumFrame > 0) {
+      entries.push_back (& it->second) ;
+    }
+  }
+//--- Blocking: longest frame of each identifier and of all lower priority ones
+  std::vector <uint64_t> lowerPriorityFrame (entries.size () + 1, 0) ;
+  for (size_t i=entries.size () ; i>0 ; i--) {
+    const uint64_t frame = entries [i-1]->mMaximumFrame ;
+    lowerPriorityFrame [i-1] = (frame > lowerPriorityFrame [i]) ? frame : lowerPriorityFrame [i] ;
+  }
+//--- Mean periods, 0 for single messages
+  std::vector <uint64_t> periods (entries.size (), 0) ;
+  double utilization = 0.0 ;
+  for (size_t i=0 ; i<entries.size () ; i++) {
+    const Entry & entry = *entries [i] ;
+    if (entry.mMessageCount > 1) {
+      periods [i] = entry.mTotalPeriod / (entry.mMessageCount - 1) ;
+      if (periods [i] == 0) {
+        periods [i] = 1 ;
+      }
+      utilization += double (entry.mMaximumFrame) / double (periods [i]) ;
+    }
+  }
+//--- Response time of each periodic identifier
+  uint32_t identifierCount = 0 ;
+  uint32_t atRiskCount = 0 ;
+  uint32_t exceededCount = 0 ;
+  bool changed = false ;
+  for (size_t i=0 ; i<entries.size () ; i++) {
+    Entry & entry = *entries [i] ;
+    const uint64_t period = periods [i] ;
+    if (period > 0) {
+      const uint64_t frame = entry.mMaximumFrame ;
+      const uint64_t blocking = lowerPriorityFrame [i + 1] ;
+      const uint64_t start = (blocking > frame) ? blocking : frame ;
+      uint64_t queueing = start ;
+      bool converged = false ;
+      while (!converged && ((queueing + frame) <= period)) {
+        uint64_t next = start ;
+        for (size_t k=0 ; k<i ; k++) {
+          if (periods [k] > 0) {
+            next += ((queueing + mSamplesPerBit + periods [k] - 1) / periods [k]) * entries [k]->mMaximumFrame ;
+          }
+        }
+        converged = next == queueing ;
+        queueing = next ;
+      }
+      const uint64_t response = queueing + frame ;
+      const uint64_t lateness = entry.mMaximumPeriod - period ;
+      const uint64_t earliness = period - entry.mMinimumPeriod ;
+      const uint64_t observed = entry.mMinimumFrame + ((lateness > earliness) ? lateness : earliness) ;
+      CANResponseTimeResult result ;
+      result.mIdentifierKey = entry.mIdentifierKey ;
+      result.mPriorityRank = uint32_t (i) ;
+      result.mPeriodMicroSeconds = microSeconds (period) ;
+      result.mFrameMicroSeconds = microSeconds (frame) ;
+      result.mBlockingMicroSeconds = microSeconds (blocking) ;
+      result.mQueueingMicroSeconds = microSeconds (queueing) ;
+      result.mResponseMicroSeconds = microSeconds (response) ;
+      result.mObservedMicroSeconds = microSeconds (observed) ;
+      if (!converged) {
+        result.mStatus = RESPONSE_TIME_AT_RISK ;
+        atRiskCount += 1 ;
+      }else if (observed > response) {
+        result.mStatus = RESPONSE_TIME_EXCEEDED ;
+        exceededCount += 1 ;
+      }else{
+        result.mStatus = RESPONSE_TIME_OK ;
+      }
+      identifierCount += 1 ;
+      if (!entry.mReported || !sameResult (result, entry.mReportedResult)) {
+        mDelegate->addResponseTime (result, inSampleNumber) ;
+        entry.mReported = true ;
+        entry.mReportedResult = result ;
+        changed = true ;
+      }
+    }
+  }
+  if (changed) {
+    mDelegate->addResponseTimeSummary (identifierCount, 100.0 * utilization, atRiskCount, exceededCount, inSampleNumber) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,116 @@
+#ifndef CAN_RESPONSE_TIME_ANALYSIS
+#define CAN_RESPONSE_TIME_ANALYSIS
+
+//----------------------------------------------------------------------------------------
+// Worst-case response time analysis from observed traffic. For each identifier, the
+// traffic gives the mean period (T, also the deadline), the longest frame with its stuff
+// bits and intermission (C, from the INTERMISSION field frame length), and the priority
+// (arbitration order). Bounds follow the revised classical CAN analysis (Davis, Burns,
+// Bril, Lukkien, 2007, sufficient test), without release jitter nor error recovery:
+//   w = max (B, C) + sum over higher priority k of ceil ((w + bit time) / Tk) * Ck
+//   R = w + C, B being the longest frame of lower priority identifiers.
+// w is the queueing delay bound, R the response time bound. Iteration stops when R
+// exceeds the deadline ("At risk"). The bus does not show when a message is queued, so
+// the observed response time is a lower bound of the actual worst one, assuming periodic
+// queueing: the shortest frame plus the largest deviation of a period from the mean
+// period. An observed response time above the bound ("Exceeded") means the model does
+// not hold: the identifier is sporadic or jittered, or frames were lost to errors.
+// Identifiers with a single message only block others. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  RESPONSE_TIME_OK,
+  RESPONSE_TIME_AT_RISK, // Bound exceeds the deadline
+  RESPONSE_TIME_EXCEEDED // Observed response time exceeds the bound
+} CANResponseTimeStatus ;
+
+const char * responseTimeStatusName (const CANResponseTimeStatus inStatus) ;
+
+//----------------------------------------------------------------------------------------
+
+class CANResponseTimeResult {
+  public: uint32_t mIdentifierKey ;
+  public: uint32_t mPriorityRank ; // 0: highest priority identifier seen
+  public: uint64_t mPeriodMicroSeconds ;
+  public: uint64_t mFrameMicroSeconds ;
+  public: uint64_t mBlockingMicroSeconds ;
+  public: uint64_t mQueueingMicroSeconds ;
+  public: uint64_t mResponseMicroSeconds ;
+  public: uint64_t mObservedMicroSeconds ;
+  public: CANResponseTimeStatus mStatus ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANResponseTimeDelegate {
+  public: virtual ~CANResponseTimeDelegate (void) {}
+
+//--- Sent by summarize for each identifier whose result changed since it was last sent,
+//    in priority order, followed by a summary
+  public: virtual void addResponseTime (const CANResponseTimeResult & inResult,
+                                        const uint64_t inSampleNumber) = 0 ;
+
+  public: virtual void addResponseTimeSummary (const uint32_t inIdentifierCount,
+                                               const double inUtilizationPercent,
+                                               const uint32_t inAtRiskCount,
+                                               const uint32_t inExceededCount,
+                                               const uint64_t inSampleNumber) = 0 ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class CANResponseTimeAnalysis {
+
+  public: CANResponseTimeAnalysis (CANResponseTimeDelegate * inDelegate) ;
+
+  public: void configure (const bool inEnabled,
+                          const uint32_t inSampleRateHz,
+                          const uint32_t inSamplesPerBit) ;
+
+  public: inline bool enabled (void) const { return mEnabled ; }
+
+  public: void enterMessage (const uint32_t inIdentifierKey, const uint64_t inSOFSampleNumber) ;
+
+//--- Length of the last entered message, from the INTERMISSION field frame: SOF to last
+//    intermission bit center, so one bit is added
+  public: void enterFrameLength (const uint64_t inFrameSampleCount) ;
+
+//--- Runs the analysis over all identifiers, sends the changed results
+  public: void summarize (const uint64_t inSampleNumber) ;
+
+//--- Arbitration order: lower is higher priority. A standard identifier wins over the
+//    extended ones with the same base identifier (RTR / SRR, IDE bits)
+  public: static uint32_t priorityKey (const uint32_t inIdentifierKey) ;
+
+  private: class Entry {
+    public: uint32_t mIdentifierKey ;
+    public: uint64_t mMessageCount ;
+    public: uint64_t mLastSampleNumber ; // SOF of the last message
+    public: uint64_t mMinimumPeriod ; // In samples
+    public: uint64_t mMaximumPeriod ;
+    public: uint64_t mTotalPeriod ;
+    public: uint64_t mMinimumFrame ; // In samples, 0: no complete frame yet
+    public: uint64_t mMaximumFrame ;
+    public: bool mReported ;
+    public: CANResponseTimeResult mReportedResult ;
+  } ;
+
+  private: uint64_t microSeconds (const uint64_t inSampleCount) const ;
+
+  private: CANResponseTimeDelegate * mDelegate ;
+  private: bool mEnabled ;
+  private: uint32_t mSampleRateHz ;
+  private: uint32_t mSamplesPerBit ;
+  private: std::map <uint32_t, Entry> mEntries ; // By priority key
+  private: Entry * mLastEntry ; // Of the last entered message, NULL after its frame length
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_RESPONSE_TIME_ANALYSIS
@@ -0,0 +1,175 @@
+#include "CANSharedMemoryTap.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------------
+
+static_assert (sizeof (LiveTapHeader) == 128, "LiveTapHeader layout") ;
+static_assert (sizeof (LiveTapRecord) == 96, "LiveTapRecord layout") ;
+static_assert ((LIVE_TAP_RECORD_COUNT & (LIVE_TAP_RECORD_COUNT - 1)) == 0, "LIVE_TAP_RECORD_COUNT") ;
+
+//----------------------------------------------------------------------------------------
+
+bool validLiveTapName (const std::string & inName) {
+  const size_t first = ((inName.size () > 0) && (inName [0] == '/')) ? 1 : 0 ;
+  bool ok = (inName.size () > first) && ((inName.size () - first) <= 64) ;
+  for (size_t i=first ; ok && (i<inName.size ()) ; i++) {
+    const char c = inName [i] ;
+    ok = ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9'))
+      || (c == '_') || (c == '-') || (c == '.') ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+CANSharedMemoryTap::CANSharedMemoryTap (void) :
+mName (),
+mSize (0),
+mMapping (NULL),
+#ifdef _WIN32
+mHandle (NULL),
+#else
+mFileDescriptor (-1),
+#endif
+mHeader (NULL),
+mRecords (NULL),
+mNextSequence (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+CANSharedMemoryTap::~ CANSharedMemoryTap (void) {
+  close () ;
+}
+
+//----------------------------------------------------------------------------------------
+// The segment is kept open from one analysis to the next one with the same name, so that
+// consumers stay attached; it is not removed on close, consumers may still map it.
+
+bool CANSharedMemoryTap::open (const std::string & inName,
+                               const uint32_t inSampleRateHz,
+                               std::string & outError) {
+  const std::string name = ((inName.size () > 0) && (inName [0] == '/')) ? inName : ("/" + inName) ;
+  if (isOpen () && (name != mName)) {
+    close () ;
+  }
+  if (!isOpen ()) {
+    const size_t size = sizeof (LiveTapHeader) + size_t (LIVE_TAP_RECORD_COUNT) * sizeof (LiveTapRecord) ;
+  #ifdef _WIN32
+    const std::string mappingName = "Local\\" + name.substr (1) ;
+    HANDLE handle = CreateFileMappingA (INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                        DWORD (uint64_t (size) >> 32), DWORD (size),
+                                        mappingName.c_str ()) ;
+    if (handle == NULL) {
+      outError = "CreateFileMapping failed, error " + std::to_string (GetLastError ()) ;
+      return false ;
+    }
+    void * mapping = MapViewOfFile (handle, FILE_MAP_ALL_ACCESS, 0, 0, size) ;
+    if (mapping == NULL) {
+      outError = "MapViewOfFile failed, error " + std::to_string (GetLastError ()) ;
+      CloseHandle (handle) ;
+      return false ;
+    }
+    mHandle = handle ;
+  #else
+    const int fd = shm_open (name.c_str (), O_CREAT | O_RDWR, 0600) ;
+    if (fd < 0) {
+      outError = std::string ("shm_open: ") + strerror (errno) ;
+      return false ;
+    }
+    if (ftruncate (fd, off_t (size)) != 0) {
+      outError = std::string ("ftruncate: ") + strerror (errno) ;
+      ::close (fd) ;
+      return false ;
+    }
+    void * mapping = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) ;
+    if (mapping == MAP_FAILED) {
+      outError = std::string ("mmap: ") + strerror (errno) ;
+      ::close (fd) ;
+      return false ;
+    }
+    mFileDescriptor = fd ;
+  #endif
+    mName = name ;
+    mSize = size ;
+    mMapping = mapping ;
+    mHeader = static_cast <LiveTapHeader *> (mapping) ;
+    mRecords = reinterpret_cast <LiveTapRecord *> (static_cast <uint8_t *> (mapping) + sizeof (LiveTapHeader)) ;
+  }
+//--- Reset: invalidate records, then publish the header
+  mHeader->mWriteSequence.store (0, std::memory_order_relaxed) ;
+  for (uint32_t i=0 ; i<LIVE_TAP_RECORD_COUNT ; i++) {
+    mRecords [i].mSequence.store (0, std::memory_order_relaxed) ;
+  }
+  mHeader->mVersion = LIVE_TAP_VERSION ;
+  mHeader->mRecordSize = uint16_t (sizeof (LiveTapRecord)) ;
+  mHeader->mRecordCount = LIVE_TAP_RECORD_COUNT ;
+  mHeader->mSampleRateHz = inSampleRateHz ;
+  mHeader->mMagic = LIVE_TAP_MAGIC ;
+  mHeader->mRunCount.fetch_add (1, std::memory_order_release) ;
+  mNextSequence = 0 ;
+  return true ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANSharedMemoryTap::close (void) {
+  if (isOpen ()) {
+  #ifdef _WIN32
+    UnmapViewOfFile (mMapping) ;
+    CloseHandle (HANDLE (mHandle)) ;
+    mHandle = NULL ;
+  #else
+    munmap (mMapping, mSize) ;
+    ::close (mFileDescriptor) ;
+    mFileDescriptor = -1 ;
+  #endif
+    mName.clear () ;
+    mSize = 0 ;
+    mMapping = NULL ;
+    mHeader = NULL ;
+    mRecords = NULL ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+// The record sequence is cleared before the record is written (release fence), and set
+// after (release store): a consumer that reads the same sequence before and after its
+// copy has a consistent record.
+
+void CANSharedMemoryTap::publish (const CANDecodedMessage & inMessage) {
+  LiveTapRecord & record = mRecords [mNextSequence & (LIVE_TAP_RECORD_COUNT - 1)] ;
+  record.mSequence.store (0, std::memory_order_relaxed) ;
+  std::atomic_thread_fence (std::memory_order_release) ;
+  record.mStartSampleNumber = inMessage.mStartSampleNumber ;
+  record.mEndSampleNumber = inMessage.mEndSampleNumber ;
+  record.mIdentifier = inMessage.mIdentifier ;
+  record.mFlags = uint8_t (
+      (inMessage.mExtended ? LIVE_TAP_EXTENDED_FLAG : 0)
+    | (inMessage.mRemote ? LIVE_TAP_REMOTE_FLAG : 0)
+    | (inMessage.mFD ? LIVE_TAP_FD_FLAG : 0)
+    | (inMessage.mBRS ? LIVE_TAP_BRS_FLAG : 0)
+    | (inMessage.mESI ? LIVE_TAP_ESI_FLAG : 0)
+    | (inMessage.mAcked ? LIVE_TAP_ACKED_FLAG : 0)
+  ) ;
+  record.mDataCodeLength = inMessage.mDataCodeLength ;
+  record.mDataLength = inMessage.mDataLength ;
+  record.mReserved = 0 ;
+  memcpy (record.mData, inMessage.mData, sizeof (record.mData)) ;
+  mNextSequence += 1 ;
+  record.mSequence.store (mNextSequence, std::memory_order_release) ;
+  mHeader->mWriteSequence.store (mNextSequence, std::memory_order_release) ;
+}
+
+//----------------------------------------------------------------------------------------
@@ -0,0 +1,113 @@
+#ifndef CAN_SHARED_MEMORY_TAP
+#define CAN_SHARED_MEMORY_TAP
+
+//----------------------------------------------------------------------------------------
+// Live tap: decoded messages are published into a single producer ring buffer in a
+// named shared memory segment (POSIX shm_open, or a named file mapping on Windows), so
+// that other processes of the same machine can follow the traffic while it is decoded.
+// Does not depend on the Saleae SDK. The producer never waits for consumers: a consumer
+// that falls more than LIVE_TAP_RECORD_COUNT records behind loses the oldest ones.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameDecoder.h"
+
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t LIVE_TAP_MAGIC = 0x544E4143 ; // "CANT", little endian
+static const uint16_t LIVE_TAP_VERSION = 1 ;
+static const uint32_t LIVE_TAP_RECORD_COUNT = 65536 ; // Power of 2
+
+//----------------------------------------------------------------------------------------
+
+static const uint8_t LIVE_TAP_EXTENDED_FLAG = 0x01 ;
+static const uint8_t LIVE_TAP_REMOTE_FLAG = 0x02 ;
+static const uint8_t LIVE_TAP_FD_FLAG = 0x04 ;
+static const uint8_t LIVE_TAP_BRS_FLAG = 0x08 ;
+static const uint8_t LIVE_TAP_ESI_FLAG = 0x10 ;
+static const uint8_t LIVE_TAP_ACKED_FLAG = 0x20 ;
+
+//----------------------------------------------------------------------------------------
+// Segment layout: a 128-byte header, then LIVE_TAP_RECORD_COUNT records of 96 bytes.
+// Record n (from 0) is at index n % LIVE_TAP_RECORD_COUNT; its mSequence is n + 1 once
+// written, 0 while it is being written. mWriteSequence is the count of written records.
+//
+// Reading record n: load mSequence (acquire), stop if it is not n + 1, copy the record,
+// acquire fence, load mSequence again: the copy is valid if it is still n + 1, otherwise
+// the record has been overwritten and the consumer should resume from mWriteSequence.
+// A new analysis resets mWriteSequence to 0 and increments mRunCount.
+
+class LiveTapHeader {
+  public: uint32_t mMagic ;
+  public: uint16_t mVersion ;
+  public: uint16_t mRecordSize ;
+  public: uint32_t mRecordCount ;
+  public: uint32_t mSampleRateHz ; // Sample numbers of records are in this unit
+  public: std::atomic <uint64_t> mRunCount ;
+  public: uint8_t mReserved1 [40] ;
+  public: std::atomic <uint64_t> mWriteSequence ; // Own cache line
+  public: uint8_t mReserved2 [56] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class LiveTapRecord {
+  public: std::atomic <uint64_t> mSequence ;
+  public: uint64_t mStartSampleNumber ; // SOF
+  public: uint64_t mEndSampleNumber ; // End of EOF
+  public: uint32_t mIdentifier ;
+  public: uint8_t mFlags ; // LIVE_TAP_xxx_FLAG
+  public: uint8_t mDataCodeLength ;
+  public: uint8_t mDataLength ;
+  public: uint8_t mReserved ;
+  public: uint8_t mData [64] ;
+} ;
+
+//----------------------------------------------------------------------------------------
+// "/name" (leading slash optional), at most 64 letters, digits, '_', '-' or '.'
+
+bool validLiveTapName (const std::string & inName) ;
+
+//----------------------------------------------------------------------------------------
+
+class CANSharedMemoryTap {
+
+  public: CANSharedMemoryTap (void) ;
+
+  public: ~ CANSharedMemoryTap (void) ;
+
+//--- Creates (or reuses) the segment and resets it; on failure, outError is set
+  public: bool open (const std::string & inName,
+                     const uint32_t inSampleRateHz,
+                     std::string & outError) ;
+
+  public: void close (void) ;
+
+  public: inline bool isOpen (void) const { return mHeader != NULL ; }
+
+//--- Sent at EOF by the CAN frame decoder; wait free
+  public: void publish (const CANDecodedMessage & inMessage) ;
+
+  private: std::string mName ;
+  private: size_t mSize ;
+  private: void * mMapping ;
+#ifdef _WIN32
+  private: void * mHandle ;
+#else
+  private: int mFileDescriptor ;
+#endif
+  private: LiveTapHeader * mHeader ;
+  private: LiveTapRecord * mRecords ;
+  private: uint64_t mNextSequence ;
+
+//--- No copy
+  private: CANSharedMemoryTap (const CANSharedMemoryTap &) ;
+  private: CANSharedMemoryTap & operator = (const CANSharedMemoryTap &) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_SHARED_MEMORY_TAP
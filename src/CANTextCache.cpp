@@ -0,0 +1,82 @@
+#include "CANTextCache.h"
+
+//----------------------------------------------------------------------------------------
+// Approximate heap cost of an entry: list node, index node, strings
+
+static const size_t ENTRY_OVERHEAD = 96 ;
+
+//----------------------------------------------------------------------------------------
+
+CANTextCache::CANTextCache (const size_t inByteBudget) :
+mByteBudget (inByteBudget),
+mMutex (),
+mEntries (),
+mIndex (),
+mByteCount (0) {
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANTextCache::clear (void) {
+  std::lock_guard <std::mutex> lock (mMutex) ;
+  mEntries.clear () ;
+  mIndex.clear () ;
+  mByteCount = 0 ;
+}
+
+//----------------------------------------------------------------------------------------
+// Frame indexes are below 2^59: display base in bits 1-4, bubble flag in bit 0
+
+uint64_t CANTextCache::key (const uint64_t inFrameIndex,
+                            const uint32_t inDisplayBase,
+                            const bool inBubbleText) {
+  return (inFrameIndex << 5) | (uint64_t (inDisplayBase & 0xF) << 1) | uint64_t (inBubbleText) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool CANTextCache::find (const uint64_t inFrameIndex,
+                         const uint32_t inDisplayBase,
+                         const bool inBubbleText,
+                         std::vector <std::string> & outStrings) {
+  std::lock_guard <std::mutex> lock (mMutex) ;
+  const std::unordered_map <uint64_t, std::list <Entry>::iterator>::const_iterator it =
+    mIndex.find (key (inFrameIndex, inDisplayBase, inBubbleText)) ;
+  const bool found = it != mIndex.end () ;
+  if (found) {
+    mEntries.splice (mEntries.begin (), mEntries, it->second) ;
+    outStrings = it->second->mStrings ;
+  }
+  return found ;
+}
+
+//----------------------------------------------------------------------------------------
+
+void CANTextCache::insert (const uint64_t inFrameIndex,
+                           const uint32_t inDisplayBase,
+                           const bool inBubbleText,
+                           const std::vector <std::string> & inStrings) {
+  size_t byteCount = ENTRY_OVERHEAD ;
+  for (size_t i=0 ; i<inStrings.size () ; i++) {
+    byteCount += sizeof (std::string) + inStrings [i].capacity () ;
+  }
+  const uint64_t entryKey = key (inFrameIndex, inDisplayBase, inBubbleText) ;
+  std::lock_guard <std::mutex> lock (mMutex) ;
+  if ((byteCount <= mByteBudget) && (mIndex.find (entryKey) == mIndex.end ())) {
+  //--- Evict least recently used entries
+    while ((mByteCount + byteCount) > mByteBudget) {
+      mByteCount -= mEntries.back ().mByteCount ;
+      mIndex.erase (mEntries.back ().mKey) ;
+      mEntries.pop_back () ;
+    }
+    Entry entry ;
+    entry.mKey = entryKey ;
+    entry.mStrings = inStrings ;
+    entry.mByteCount = byteCount ;
+    mEntries.push_front (entry) ;
+    mIndex [entryKey] = mEntries.begin () ;
+    mByteCount += byteCount ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
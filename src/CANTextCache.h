@@ -0,0 +1,64 @@
+#ifndef CAN_TEXT_CACHE
+#define CAN_TEXT_CACHE
+
+//----------------------------------------------------------------------------------------
+// Rendered text cache: bubble and tabular strings of result frames, keyed by frame index,
+// display base and bubble / tabular kind. Least recently used entries are evicted when
+// the byte budget is exceeded. Result frames never change once added, so the cache is
+// only cleared when results are regenerated. Does not depend on the Saleae SDK.
+//----------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+static const size_t TEXT_CACHE_BYTE_BUDGET = 16 * 1024 * 1024 ;
+
+//----------------------------------------------------------------------------------------
+
+class CANTextCache {
+
+  public: CANTextCache (const size_t inByteBudget) ;
+
+  public: void clear (void) ;
+
+//--- Returns true and the cached strings if present; the entry becomes the most recent
+  public: bool find (const uint64_t inFrameIndex,
+                     const uint32_t inDisplayBase,
+                     const bool inBubbleText,
+                     std::vector <std::string> & outStrings) ;
+
+  public: void insert (const uint64_t inFrameIndex,
+                       const uint32_t inDisplayBase,
+                       const bool inBubbleText,
+                       const std::vector <std::string> & inStrings) ;
+
+  private: class Entry {
+    public: uint64_t mKey ;
+    public: std::vector <std::string> mStrings ;
+    public: size_t mByteCount ;
+  } ;
+
+  private: static uint64_t key (const uint64_t inFrameIndex,
+                                const uint32_t inDisplayBase,
+                                const bool inBubbleText) ;
+
+  private: const size_t mByteBudget ;
+  private: std::mutex mMutex ; // UI threads, and the analyzer thread at rerun
+  private: std::list <Entry> mEntries ; // Most recently used first
+  private: std::unordered_map <uint64_t, std::list <Entry>::iterator> mIndex ;
+  private: size_t mByteCount ;
+
+//--- No copy
+  private: CANTextCache (const CANTextCache &) ;
+  private: CANTextCache & operator = (const CANTextCache &) ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+#endif //CAN_TEXT_CACHE
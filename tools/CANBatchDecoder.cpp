@@ -0,0 +1,360 @@
+//----------------------------------------------------------------------------------------
+// Batch decoder: decodes many captures (Logic 2 digital binary exports, see
+// CANCaptureFile.h) in parallel, outside Logic 2, and prints one report that merges their
+// statistics. Each capture is decoded by its own CANHeadlessDecoder; with -o, its messages
+// are written to DIR/NAME.ccol (see CANColumnarFile.h).
+//
+// Captures are distributed to worker threads largest first, each worker with its own
+// queue; a worker whose queue is empty steals from the back of another queue, so that a
+// few long captures do not leave the other threads idle.
+//
+//   CANBatchDecoder [options] CAPTURE|DIRECTORY ...
+//     -b BITRATE       nominal bit rate, default 500000
+//     -d BITRATE       CAN FD data bit rate (enables CAN FD)
+//     -s RATE          sample rate the transition times are rounded to, default 100000000
+//     -i               inverted CAN signal
+//     -j THREADS       worker count, default: hardware threads
+//     -o DIRECTORY     write the messages of each capture to DIRECTORY/NAME.ccol
+// A directory stands for its *.bin files. Exit status is 1 if a capture failed.
+//----------------------------------------------------------------------------------------
+
+#include "CANHeadlessDecoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+  #include <windows.h>
+  #include <sys/stat.h>
+#else
+  #include <dirent.h>
+  #include <sys/stat.h>
+#endif
+
+//----------------------------------------------------------------------------------------
+
+class BatchCapture {
+  public: std::string mPath ;
+  public: uint64_t mSize ;
+  public: bool mDecoded ;
+  public: std::string mError ;
+  public: CANBatchStatistics mStatistics ;
+} ;
+
+//----------------------------------------------------------------------------------------
+//   Work stealing queues of capture indexes
+//----------------------------------------------------------------------------------------
+
+class WorkStealingQueues {
+
+  public: WorkStealingQueues (const size_t inWorkerCount) :
+  mQueues (inWorkerCount),
+  mMutexes () {
+    for (size_t i=0 ; i<inWorkerCount ; i++) {
+      mMutexes.push_back (std::unique_ptr <std::mutex> (new std::mutex ())) ;
+    }
+  }
+
+//--- Before the workers start
+  public: void push (const size_t inWorker, const size_t inTask) {
+    mQueues [inWorker].push_back (inTask) ;
+  }
+
+//--- Own queue from the front, other queues from the back; tasks never add tasks, so
+//    all queues empty means the work is done
+  public: bool pop (const size_t inWorker, size_t & outTask) {
+    bool found = false ;
+    for (size_t k=0 ; (k<mQueues.size ()) && !found ; k++) {
+      const size_t victim = (inWorker + k) % mQueues.size () ;
+      std::lock_guard <std::mutex> lock (*mMutexes [victim]) ;
+      found = !mQueues [victim].empty () ;
+      if (found && (k == 0)) {
+        outTask = mQueues [victim].front () ;
+        mQueues [victim].pop_front () ;
+      }else if (found) {
+        outTask = mQueues [victim].back () ;
+        mQueues [victim].pop_back () ;
+      }
+    }
+    return found ;
+  }
+
+  private: std::vector <std::deque <size_t> > mQueues ;
+  private: std::vector <std::unique_ptr <std::mutex> > mMutexes ;
+} ;
+
+//----------------------------------------------------------------------------------------
+//   Files
+//----------------------------------------------------------------------------------------
+
+static bool fileStatus (const std::string & inPath, bool & outDirectory, uint64_t & outSize) {
+#ifdef _WIN32
+  struct _stat64 status ;
+  const bool ok = _stat64 (inPath.c_str (), &status) == 0 ;
+  outDirectory = ok && ((status.st_mode & _S_IFDIR) != 0) ;
+#else
+  struct stat status ;
+  const bool ok = stat (inPath.c_str (), &status) == 0 ;
+  outDirectory = ok && S_ISDIR (status.st_mode) ;
+#endif
+  outSize = ok ? uint64_t (status.st_size) : 0 ;
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static void directoryCaptures (const std::string & inDirectory, std::vector <std::string> & outPaths) {
+  std::vector <std::string> names ;
+#ifdef _WIN32
+  WIN32_FIND_DATAA entry ;
+  HANDLE find = FindFirstFileA ((inDirectory + "\\*.bin").c_str (), &entry) ;
+  if (find != INVALID_HANDLE_VALUE) {
+    do{
+      names.push_back (entry.cFileName) ;
+    }while (FindNextFileA (find, &entry)) ;
+    FindClose (find) ;
+  }
+#else
+  DIR * directory = opendir (inDirectory.c_str ()) ;
+  if (directory != NULL) {
+    struct dirent * entry ;
+    while ((entry = readdir (directory)) != NULL) {
+      const std::string name = entry->d_name ;
+      if ((name.size () > 4) && (name.compare (name.size () - 4, 4, ".bin") == 0)) {
+        names.push_back (name) ;
+      }
+    }
+    closedir (directory) ;
+  }
+#endif
+  std::sort (names.begin (), names.end ()) ;
+  for (size_t i=0 ; i<names.size () ; i++) {
+    outPaths.push_back (inDirectory + "/" + names [i]) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+static std::string outputPath (const std::string & inDirectory, const std::string & inCapturePath) {
+  const size_t separator = inCapturePath.find_last_of ("/\\") ;
+  std::string name = (separator == std::string::npos) ? inCapturePath : inCapturePath.substr (separator + 1) ;
+  const size_t dot = name.rfind ('.') ;
+  if ((dot != std::string::npos) && (dot > 0)) {
+    name.resize (dot) ;
+  }
+  return inDirectory + "/" + name + ".ccol" ;
+}
+
+//----------------------------------------------------------------------------------------
+//   Decoding
+//----------------------------------------------------------------------------------------
+// Errors start with the path of the file they are about
+
+static void decodeCapture (BatchCapture & ioCapture,
+                           const CANHeadlessSettings & inSettings,
+                           const std::string & inOutputDirectory,
+                           CANHeadlessDecoder & ioDecoder) {
+  CANCaptureFile capture ;
+  CANColumnarWriter writer ;
+  const std::string output = outputPath (inOutputDirectory, ioCapture.mPath) ;
+  ioCapture.mDecoded = capture.open (ioCapture.mPath, ioCapture.mError) ;
+  if (ioCapture.mDecoded && !inOutputDirectory.empty ()) {
+    ioCapture.mDecoded = writer.open (output,
+                                      inSettings.mSampleRateHz,
+                                      0,
+                                      ioCapture.mError) ;
+  }
+  if (ioCapture.mDecoded) {
+    ioCapture.mDecoded = ioDecoder.decode (capture,
+                                           inSettings,
+                                           inOutputDirectory.empty () ? NULL : &writer,
+                                           ioCapture.mStatistics,
+                                           ioCapture.mError) ;
+    if (!ioCapture.mDecoded) {
+      ioCapture.mError = ioCapture.mPath + ": " + ioCapture.mError ;
+    }
+  }
+  if (ioCapture.mDecoded && !inOutputDirectory.empty ()) {
+    ioCapture.mDecoded = writer.close (ioCapture.mError) ;
+    if (!ioCapture.mDecoded) {
+      ioCapture.mError = output + ": " + ioCapture.mError ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+static void worker (const size_t inWorker,
+                    WorkStealingQueues & ioQueues,
+                    std::vector <BatchCapture> & ioCaptures,
+                    const CANHeadlessSettings & inSettings,
+                    const std::string & inOutputDirectory) {
+  CANHeadlessDecoder decoder ;
+  size_t task ;
+  while (ioQueues.pop (inWorker, task)) {
+    decodeCapture (ioCaptures [task], inSettings, inOutputDirectory, decoder) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+//   Report
+//----------------------------------------------------------------------------------------
+
+static void printReport (const std::vector <BatchCapture> & inCaptures) {
+  CANBatchStatistics total ;
+  size_t failedCount = 0 ;
+  printf ("%10s %10s %8s  %s\n", "Messages", "Errors", "Load %", "Capture") ;
+  for (size_t i=0 ; i<inCaptures.size () ; i++) {
+    const BatchCapture & capture = inCaptures [i] ;
+    if (capture.mDecoded) {
+      printf ("%10llu %10llu %8.2f  %s\n",
+              (unsigned long long) capture.mStatistics.mMessageCount,
+              (unsigned long long) capture.mStatistics.mErrors.total (),
+              capture.mStatistics.busLoadPercent (),
+              capture.mPath.c_str ()) ;
+      total.merge (capture.mStatistics) ;
+    }else{
+      printf ("%10s %10s %8s  %s\n", "-", "-", "-", capture.mError.c_str ()) ;
+      failedCount += 1 ;
+    }
+  }
+  printf ("\nCaptures: %zu (%zu failed), %.3f s\n", inCaptures.size (), failedCount, total.mCaptureSeconds) ;
+  printf ("Messages: %llu, data bytes: %llu, bus load: %.2f %%\n",
+          (unsigned long long) total.mMessageCount,
+          (unsigned long long) total.mDataByteCount,
+          total.busLoadPercent ()) ;
+  printf ("Errors: %llu\n", (unsigned long long) total.mErrors.total ()) ;
+  for (uint32_t i=0 ; i<CAN_ERROR_KIND_COUNT ; i++) {
+    if (total.mErrors.mKindCount [i] > 0) {
+      printf ("  %-20s %llu\n", errorKindName (CANErrorKind (i)), (unsigned long long) total.mErrors.mKindCount [i]) ;
+    }
+  }
+  for (uint32_t i=CAN_ACTIVE_ERROR_FLAG ; i<=CAN_PASSIVE_ERROR_FLAG ; i++) {
+    if (total.mErrors.mErrorFlagCount [i] > 0) {
+      printf ("  %-20s %llu\n", errorFlagName (CANErrorFlag (i)), (unsigned long long) total.mErrors.mErrorFlagCount [i]) ;
+    }
+  }
+//--- Identifiers that sent messages or had errors, by key: standard ones first
+  std::map <uint32_t, uint64_t> keys = total.mIdentifierMessageCount ;
+  std::map <uint32_t, uint64_t>::const_iterator it ;
+  for (it = total.mErrors.mIdentifierErrorCount.begin () ; it != total.mErrors.mIdentifierErrorCount.end () ; it++) {
+    keys [it->first] += 0 ;
+  }
+  printf ("\n%8s %12s %10s\n", "Idf", "Messages", "Errors") ;
+  for (it = keys.begin () ; it != keys.end () ; it++) {
+    const std::map <uint32_t, uint64_t>::const_iterator errors = total.mErrors.mIdentifierErrorCount.find (it->first) ;
+    char identifier [9] ;
+    snprintf (identifier, sizeof (identifier), ((it->first >> 31) != 0) ? "%08X" : "%03X", it->first & 0x7FFFFFFF) ;
+    printf ("%8s %12llu %10llu\n",
+            identifier,
+            (unsigned long long) it->second,
+            (unsigned long long) ((errors == total.mErrors.mIdentifierErrorCount.end ()) ? 0 : errors->second)) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+static void usage (void) {
+  fprintf (stderr, "usage: CANBatchDecoder [-b BITRATE] [-d DATA_BITRATE] [-s SAMPLE_RATE] [-i]"
+                   " [-j THREADS] [-o DIRECTORY] CAPTURE|DIRECTORY ...\n") ;
+  exit (2) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static uint32_t optionValue (const int inArgc, char * inArgv [], int & ioIndex) {
+  ioIndex += 1 ;
+  char * end = NULL ;
+  const unsigned long value = (ioIndex < inArgc) ? strtoul (inArgv [ioIndex], &end, 10) : 0 ;
+  if ((end == NULL) || (*end != '\0') || (value == 0) || (value > UINT32_MAX)) {
+    usage () ;
+  }
+  return uint32_t (value) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+int main (int argc, char * argv []) {
+  CANHeadlessSettings settings ;
+  settings.mSampleRateHz = 100 * 1000 * 1000 ;
+  settings.mBitRate = 500 * 1000 ;
+  settings.mCANFD = false ;
+  settings.mDataBitRate = 2 * 1000 * 1000 ;
+  settings.mInverted = false ;
+  size_t workerCount = std::thread::hardware_concurrency () ;
+  std::string outputDirectory ;
+  std::vector <std::string> paths ;
+  for (int i=1 ; i<argc ; i++) {
+    const std::string argument = argv [i] ;
+    if (argument == "-b") {
+      settings.mBitRate = optionValue (argc, argv, i) ;
+    }else if (argument == "-d") {
+      settings.mCANFD = true ;
+      settings.mDataBitRate = optionValue (argc, argv, i) ;
+    }else if (argument == "-s") {
+      settings.mSampleRateHz = optionValue (argc, argv, i) ;
+    }else if (argument == "-i") {
+      settings.mInverted = true ;
+    }else if (argument == "-j") {
+      workerCount = optionValue (argc, argv, i) ;
+    }else if ((argument == "-o") && ((i + 1) < argc)) {
+      i += 1 ;
+      outputDirectory = argv [i] ;
+    }else if (!argument.empty () && (argument [0] == '-')) {
+      usage () ;
+    }else{
+      bool directory = false ;
+      uint64_t size = 0 ;
+      if (fileStatus (argument, directory, size) && directory) {
+        directoryCaptures (argument, paths) ;
+      }else{
+        paths.push_back (argument) ; // Open error is reported with the capture
+      }
+    }
+  }
+  if (paths.empty ()) {
+    usage () ;
+  }
+//--- Captures, dealt largest first
+  std::vector <BatchCapture> captures (paths.size ()) ;
+  std::vector <size_t> order (paths.size ()) ;
+  for (size_t i=0 ; i<paths.size () ; i++) {
+    bool directory = false ;
+    captures [i].mPath = paths [i] ;
+    fileStatus (paths [i], directory, captures [i].mSize) ;
+    captures [i].mDecoded = false ;
+    order [i] = i ;
+  }
+  std::stable_sort (order.begin (), order.end (), [&captures] (const size_t inLeft, const size_t inRight) {
+    return captures [inLeft].mSize > captures [inRight].mSize ;
+  }) ;
+  workerCount = std::max (size_t (1), std::min (workerCount, captures.size ())) ;
+  WorkStealingQueues queues (workerCount) ;
+  for (size_t i=0 ; i<order.size () ; i++) {
+    queues.push (i % workerCount, order [i]) ;
+  }
+  std::vector <std::thread> threads ;
+  for (size_t w=0 ; w<workerCount ; w++) {
+    threads.push_back (std::thread (worker, w, std::ref (queues), std::ref (captures),
+                                    std::cref (settings), std::cref (outputDirectory))) ;
+  }
+  for (size_t w=0 ; w<workerCount ; w++) {
+    threads [w].join () ;
+  }
+//--- Report
+  printReport (captures) ;
+  bool ok = true ;
+  for (size_t i=0 ; i<captures.size () ; i++) {
+    ok = ok && captures [i].mDecoded ;
+  }
+  return ok ? 0 : 1 ;
+}
+
+//----------------------------------------------------------------------------------------
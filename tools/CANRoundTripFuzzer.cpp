@@ -0,0 +1,1325 @@
+//----------------------------------------------------------------------------------------
+// Round-trip fuzzer: random frames are built by CANFrameBitsGenerator into a CANFrameBatch,
+// some of them corrupted, and the resulting bus stream goes through a CANFrameDecoder (one
+// per worker thread), outside Logic 2. Checks, for each frame:
+//   - an intact frame is decoded once, with its identifier, format, type (CAN FD, BRS and
+//     ESI flags included), DLC, data, ACK slot and stuff bit count, its CRC is accepted,
+//     and no error is reported, whatever the frame before it (resynchronization);
+//   - the CAN FD stuff count of an intact frame is decoded, without error, and the bit time
+//     reported by the decoder switches to the data bit time at the sample point of the BRS
+//     bit, back to the nominal one at the sample point of the CRC delimiter;
+//   - a frame sent with a wrong CRC is rejected with a CRC error and an active error flag;
+//   - a frame with an inverted stuff bit is rejected with a stuff error and an active
+//     error flag;
+//   - a frame that starts at the third INTERMISSION bit of the previous one is intact;
+//   - a frame whose decoding ends within it (decode window end, endOfSamples) is reported
+//     as a truncated frame, or is intact if its message was sent (EOF bit 7 entered);
+//   - a frame with inverted bits (single bit, burst of 2 ... 8 bits) is reported, and any
+//     message decoded from it is a valid encoding of the bits it was decoded from (CAN
+//     does not detect every corruption: such messages are counted as undetected).
+// As on a bus, a frame with an inverted stuff bit (CAN FD fixed stuff bits included) or a
+// wrong CRC is cut by an active error flag where receivers start it: after the stuff bit,
+// after the ACK delimiter. A truncated frame is cut after its entered bits, and decoding
+// resumes after them. Every corrupted frame is followed by FUZZ_RECOVERY_BIT_COUNT
+// recessive bits, so that the decoder is back in bus idle for the next frame.
+//
+// Batches of FUZZ_BATCH_FRAME_COUNT frames are dealt to the workers; the random values of
+// a batch only depend on the seed and the batch index, so results do not depend on the
+// worker count. One batch out of four is entered bit by bit (enterBit), the others a
+// byte at a time (enterBits). Batches 4 ... 7 out of 8 are decoded with CAN FD enabled,
+// at random nominal and data bit times: half of their frames are CAN FD frames (BRS set
+// for half of them, ESI for a quarter, any DLC). Sample numbers follow the bit time
+// reported by the decoder after each entered bit (samplesPerBit), as in the analyzer;
+// without CAN FD, there is one sample per bit, and sample numbers are bit indexes.
+//
+// The first failing frame of a batch is minimised (preceding frames removed, burst
+// shortened, data bytes cleared, as long as it still fails) and saved as a case file,
+// that -r replays:
+//   # comment
+//   bit-by-bit
+//   can-fd NOMINAL DATA
+//   frame IDF std|ext TYPE ack|nack DLC DATA|- [single BIT | burst BIT COUNT |
+//         stuff BIT | crc MASK | early-sof | truncated COUNT]
+// can-fd enables CAN FD decoding, NOMINAL and DATA are the samples per bit of the nominal
+// and data phases. TYPE is data, remote, fd, fd-brs, fd-esi or fd-brs-esi. IDF, DATA and
+// MASK are hexadecimal; BIT is the index of the inverted bit from the SOF, COUNT the
+// number of bits entered from the SOF.
+//
+//   CANRoundTripFuzzer [options]
+//     -n FRAMES        frame count, default 10000000
+//     -s SEED          random seed, default 1
+//     -e PERCENT       corrupted frames, default 20
+//     -j THREADS       worker count, default: hardware threads
+//     -o DIRECTORY     directory of failing cases, default: current directory
+//     -r CASE ...      replay case files instead of fuzzing
+// Exit status is 1 if a frame failed.
+//----------------------------------------------------------------------------------------
+
+#include "CANFrameBitsGenerator.h"
+#include "CANFrameDecoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+
+static const uint32_t FUZZ_BATCH_FRAME_COUNT = 1024 ;
+
+//--- Any decoder state is back to bus idle after at most 13 recessive bits
+static const uint32_t FUZZ_RECOVERY_BIT_COUNT = 25 ;
+
+static const uint32_t FUZZ_ERROR_FLAG_BIT_COUNT = 6 ;
+
+static const uint32_t FUZZ_MAX_SAVED_CASES = 16 ;
+
+//----------------------------------------------------------------------------------------
+
+typedef enum {
+  CORRUPTION_NONE,
+  CORRUPTION_SINGLE, // One inverted bit
+  CORRUPTION_BURST, // 2 ... 8 consecutive inverted bits
+  CORRUPTION_STUFF, // Inverted stuff bit: a stuff error is expected
+  CORRUPTION_CRC, // Wrong CRC sent, stuffing is valid: a CRC error is expected
+  CORRUPTION_EARLY_SOF, // SOF at the third INTERMISSION bit of the previous frame: valid
+  CORRUPTION_TRUNCATED, // Decoding ends within the frame: a truncated frame error is expected
+  CORRUPTION_COUNT
+} FuzzCorruption ;
+
+//----------------------------------------------------------------------------------------
+
+static const char * corruptionName (const FuzzCorruption inCorruption) {
+  switch (inCorruption) {
+  case CORRUPTION_SINGLE : return "single" ;
+  case CORRUPTION_BURST : return "burst" ;
+  case CORRUPTION_STUFF : return "stuff" ;
+  case CORRUPTION_CRC : return "crc" ;
+  case CORRUPTION_EARLY_SOF : return "early-sof" ;
+  case CORRUPTION_TRUNCATED : return "truncated" ;
+  case CORRUPTION_NONE : case CORRUPTION_COUNT : break ;
+  }
+  return "none" ;
+}
+
+//----------------------------------------------------------------------------------------
+
+class FuzzFrame {
+  public: CANFrameDescriptor mDescriptor ; // mDataLength is the DLC (0 ... 15)
+  public: FuzzCorruption mCorruption ;
+  public: uint32_t mBitIndex ; // From SOF (single, burst, stuff), entered bit count (truncated)
+  public: uint32_t mBitCount ; // Burst
+  public: uint32_t mCRCErrorMask ; // CRC
+} ;
+
+//----------------------------------------------------------------------------------------
+
+static uint32_t sentDataByteCount (const CANFrameDescriptor & inDescriptor) {
+  uint32_t result = 0 ;
+  if (inDescriptor.mFD || (inDescriptor.mFrameType == dataFrame)) {
+    result = canDataLengthForCode (inDescriptor.mDataLength, inDescriptor.mFD) ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+// CRC 15, CAN FD CRC 17 (up to 16 data bytes) or CRC 21
+
+static uint32_t crcLength (const CANFrameDescriptor & inDescriptor) {
+  uint32_t result = 15 ;
+  if (inDescriptor.mFD) {
+    result = (sentDataByteCount (inDescriptor) > 16) ? 21 : 17 ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+// Case file frame type
+
+static const char * frameTypeName (const bool inFD,
+                                   const bool inBRS,
+                                   const bool inESI,
+                                   const bool inRemote) {
+  static const char * fdNames [4] = {"fd", "fd-esi", "fd-brs", "fd-brs-esi"} ;
+  return inFD ? fdNames [(inBRS ? 2 : 0) + (inESI ? 1 : 0)] : (inRemote ? "remote" : "data") ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static const char * frameTypeName (const CANFrameDescriptor & inDescriptor) {
+  return frameTypeName (inDescriptor.mFD,
+                        inDescriptor.mBRS,
+                        inDescriptor.mESI,
+                        inDescriptor.mFrameType == remoteFrame) ;
+}
+
+//----------------------------------------------------------------------------------------
+// How a batch is entered in the decoder
+
+class FuzzDecoding {
+  public: FuzzDecoding (void) :
+  mBitByBit (false),
+  mCANFD (false),
+  mNominalSamplesPerBit (1),
+  mDataSamplesPerBit (1) {
+  }
+
+  public: bool mBitByBit ; // enterBit, instead of enterBits
+  public: bool mCANFD ; // CAN FD frames are accepted
+  public: uint32_t mNominalSamplesPerBit ;
+  public: uint32_t mDataSamplesPerBit ; // CAN FD, data phase of frames with BRS set
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class FuzzStatistics {
+  public: FuzzStatistics (void) :
+  mFrameCount (0),
+  mBitCount (0),
+  mCorruptionCount (),
+  mUndetectedCount (0),
+  mFailedBatchCount (0) {
+  }
+
+  public: void merge (const FuzzStatistics & inStatistics) {
+    mFrameCount += inStatistics.mFrameCount ;
+    mBitCount += inStatistics.mBitCount ;
+    for (uint32_t i=0 ; i<CORRUPTION_COUNT ; i++) {
+      mCorruptionCount [i] += inStatistics.mCorruptionCount [i] ;
+    }
+    mUndetectedCount += inStatistics.mUndetectedCount ;
+    mFailedBatchCount += inStatistics.mFailedBatchCount ;
+  }
+
+  public: uint64_t mFrameCount ;
+  public: uint64_t mBitCount ;
+  public: uint64_t mCorruptionCount [CORRUPTION_COUNT] ;
+  public: uint64_t mUndetectedCount ;
+  public: uint64_t mFailedBatchCount ;
+} ;
+
+//----------------------------------------------------------------------------------------
+//   Random frames (splitmix64)
+//----------------------------------------------------------------------------------------
+
+class FuzzRandom {
+  public: FuzzRandom (const uint64_t inSeed) : mState (inSeed) {}
+
+  public: uint64_t next (void) {
+    mState += 0x9E3779B97F4A7C15ULL ;
+    uint64_t z = mState ;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL ;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL ;
+    return z ^ (z >> 31) ;
+  }
+
+//--- 0 ... inBound - 1
+  public: uint32_t below (const uint32_t inBound) {
+    return uint32_t (((next () >> 32) * inBound) >> 32) ;
+  }
+
+  private: uint64_t mState ;
+} ;
+
+//----------------------------------------------------------------------------------------
+// Indexes of the stuff bits (CAN FD fixed stuff bits included)
+
+static uint32_t stuffBitIndexes (const CANFrameBitsGenerator & inFrame,
+                                 uint32_t outIndexes [CAN_FD_FRAME_MAX_BIT_COUNT]) {
+  uint32_t count = 0 ;
+  for (uint32_t i=0 ; i<inFrame.frameLength () ; i++) {
+    if (inFrame.stuffBitAtIndex (i)) {
+      outIndexes [count] = i ;
+      count += 1 ;
+    }
+  }
+  return count ;
+}
+
+//----------------------------------------------------------------------------------------
+// One byte out of four is 00 or FF, so that long stuffed runs are frequent. If
+// inCANFD, half of the frames are CAN FD frames
+
+static void randomFrame (FuzzRandom & ioRandom,
+                         const uint32_t inCorruptionPercent,
+                         const bool inCANFD,
+                         FuzzFrame & outFrame) {
+  CANFrameDescriptor & descriptor = outFrame.mDescriptor ;
+  const bool extended = ioRandom.below (2) != 0 ;
+  descriptor.mFrameFormat = extended ? extendedFrame : standardFrame ;
+  descriptor.mIdentifier = uint32_t (ioRandom.next ()) & (extended ? 0x1FFFFFFF : 0x7FF) ;
+  descriptor.mFrameType = (ioRandom.below (10) == 0) ? remoteFrame : dataFrame ;
+  descriptor.mAckSlot = (ioRandom.below (20) == 0) ? ACK_SLOT_RECESSIVE : ACK_SLOT_DOMINANT ;
+  descriptor.mDataLength = uint8_t ((ioRandom.below (10) == 0) ? (9 + ioRandom.below (7)) : ioRandom.below (9)) ;
+  descriptor.mFD = inCANFD && (ioRandom.below (2) == 0) ;
+  descriptor.mBRS = false ;
+  descriptor.mESI = false ;
+  if (descriptor.mFD) {
+    descriptor.mFrameType = dataFrame ;
+    descriptor.mBRS = ioRandom.below (2) == 0 ;
+    descriptor.mESI = ioRandom.below (4) == 0 ;
+    descriptor.mDataLength = uint8_t (ioRandom.below (16)) ;
+  }
+  for (uint32_t i=0 ; i<sentDataByteCount (descriptor) ; i++) {
+    const uint32_t kind = ioRandom.below (8) ;
+    descriptor.mData [i] = uint8_t ((kind == 0) ? 0x00 : ((kind == 1) ? 0xFF : ioRandom.below (256))) ;
+  }
+  outFrame.mCorruption = CORRUPTION_NONE ;
+  outFrame.mBitIndex = 0 ;
+  outFrame.mBitCount = 0 ;
+  outFrame.mCRCErrorMask = 0 ;
+  if (ioRandom.below (100) < inCorruptionPercent) {
+    const CANFrameBitsGenerator bits (descriptor) ;
+    outFrame.mCorruption = FuzzCorruption (CORRUPTION_SINGLE + ioRandom.below (CORRUPTION_COUNT - 1)) ;
+    switch (outFrame.mCorruption) {
+    case CORRUPTION_STUFF : {
+      uint32_t indexes [CAN_FD_FRAME_MAX_BIT_COUNT] ;
+      const uint32_t count = stuffBitIndexes (bits, indexes) ;
+      if (count > 0) {
+        outFrame.mBitIndex = indexes [ioRandom.below (count)] ;
+      }else{
+        outFrame.mCorruption = CORRUPTION_SINGLE ;
+        outFrame.mBitIndex = ioRandom.below (bits.frameLength ()) ;
+      }
+      }break ;
+    case CORRUPTION_CRC :
+      outFrame.mCRCErrorMask = 1 + ioRandom.below ((1U << crcLength (descriptor)) - 1) ;
+      break ;
+    case CORRUPTION_EARLY_SOF :
+      break ;
+    case CORRUPTION_TRUNCATED :
+      outFrame.mBitIndex = 1 + ioRandom.below (bits.frameLength ()) ;
+      break ;
+    case CORRUPTION_BURST :
+      outFrame.mBitIndex = ioRandom.below (bits.frameLength () - 1) ;
+      outFrame.mBitCount = 2 + ioRandom.below (7) ;
+      break ;
+    default : // CORRUPTION_SINGLE
+      outFrame.mBitIndex = ioRandom.below (bits.frameLength ()) ;
+      break ;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+//   Decoding and checks
+//----------------------------------------------------------------------------------------
+
+class FuzzBubble {
+  public: uint64_t mData1 ;
+  public: uint64_t mData2 ;
+  public: uint64_t mEndSampleNumber ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class FuzzDecoderDelegate : public CANFrameDecoderDelegate {
+
+  public: void clear (void) {
+    mMessages.clear () ;
+    mCRCFields.clear () ;
+    mStuffCountFields.clear () ;
+    mErrors.clear () ;
+  }
+
+  public: virtual void addMark (const uint64_t /* inSampleNumber */, const CANDecoderMarker /* inMarker */) {
+  }
+
+  public: virtual void addBubble (const uint8_t inBubbleType,
+                                  const uint64_t inData1,
+                                  const uint64_t inData2,
+                                  const uint64_t /* inStartSampleNumber */,
+                                  const uint64_t inEndSampleNumber) {
+    FuzzBubble bubble ;
+    bubble.mData1 = inData1 ;
+    bubble.mData2 = inData2 ;
+    bubble.mEndSampleNumber = inEndSampleNumber ;
+    if (inBubbleType == CRC_FIELD_RESULT) {
+      mCRCFields.push_back (bubble) ;
+    }else if (inBubbleType == STUFF_COUNT_FIELD_RESULT) {
+      mStuffCountFields.push_back (bubble) ;
+    }else if (inBubbleType == CAN_ERROR_RESULT) {
+      mErrors.push_back (bubble) ;
+    }
+  }
+
+  public: virtual void addMessage (const CANDecodedMessage & inMessage) {
+    mMessages.push_back (inMessage) ;
+  }
+
+  public: std::vector <CANDecodedMessage> mMessages ;
+  public: std::vector <FuzzBubble> mCRCFields ;
+  public: std::vector <FuzzBubble> mStuffCountFields ; // CAN FD
+  public: std::vector <FuzzBubble> mErrors ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+static std::string errorName (const FuzzBubble & inError) {
+  return errorKindName (CANErrorKind (inError.mData1 & 0xFF)) ;
+}
+
+//----------------------------------------------------------------------------------------
+// Empty if the message carries the frame; the ACK slot is compared if inCompareAck
+
+static std::string messageMismatch (const CANDecodedMessage & inMessage,
+                                    const uint64_t inFrameStart,
+                                    const CANFrameDescriptor & inFrame,
+                                    const bool inCompareAck) {
+  char text [128] = "" ;
+  const bool extended = inFrame.mFrameFormat == extendedFrame ;
+  const bool remote = !inFrame.mFD && (inFrame.mFrameType == remoteFrame) ;
+  if (inMessage.mStartSampleNumber != inFrameStart) {
+    snprintf (text, sizeof (text), "SOF at sample %llu, decoded at sample %llu",
+              (unsigned long long) inFrameStart, (unsigned long long) inMessage.mStartSampleNumber) ;
+  }else if ((inMessage.mIdentifier != inFrame.mIdentifier) || (inMessage.mExtended != extended)) {
+    snprintf (text, sizeof (text), "identifier %X decoded as %X%s",
+              inFrame.mIdentifier, inMessage.mIdentifier, (inMessage.mExtended != extended) ? " (format)" : "") ;
+  }else if ((inMessage.mRemote != remote)
+         || (inMessage.mFD != inFrame.mFD)
+         || (inMessage.mBRS != inFrame.mBRS)
+         || (inMessage.mESI != inFrame.mESI)) {
+    snprintf (text, sizeof (text), "%s frame decoded as %s frame",
+              frameTypeName (inFrame),
+              frameTypeName (inMessage.mFD, inMessage.mBRS, inMessage.mESI, inMessage.mRemote)) ;
+  }else if (inMessage.mDataCodeLength != inFrame.mDataLength) {
+    snprintf (text, sizeof (text), "DLC %u decoded as %u", inFrame.mDataLength, inMessage.mDataCodeLength) ;
+  }else if (inMessage.mDataLength != sentDataByteCount (inFrame)) {
+    snprintf (text, sizeof (text), "%u data bytes decoded as %u", sentDataByteCount (inFrame), inMessage.mDataLength) ;
+  }else if (inCompareAck && (inMessage.mAcked != (inFrame.mAckSlot == ACK_SLOT_DOMINANT))) {
+    snprintf (text, sizeof (text), "ACK slot decoded as %s", inMessage.mAcked ? "dominant" : "recessive") ;
+  }else{
+    for (uint32_t i=0 ; (i<inMessage.mDataLength) && (text [0] == '\0') ; i++) {
+      if (inMessage.mData [i] != inFrame.mData [i]) {
+        snprintf (text, sizeof (text), "data byte %u %02X decoded as %02X", i, inFrame.mData [i], inMessage.mData [i]) ;
+      }
+    }
+  }
+  return text ;
+}
+
+//----------------------------------------------------------------------------------------
+// Destuffs inCount bits from inStart, and the stuff bit that may follow them if
+// inStuffBitAfterLastBit (not in CAN FD frames); returns the index of the next bit, and
+// the count of removed stuff bits
+
+static uint64_t destuff (const CANFrameBatch & inBatch,
+                         const uint64_t inStart,
+                         const uint32_t inCount,
+                         const bool inStuffBitAfterLastBit,
+                         std::vector <bool> & outBits,
+                         uint32_t & outStuffBitCount) {
+  outBits.clear () ;
+  outStuffBitCount = 0 ;
+  uint64_t idx = inStart ;
+  bool previousBit = true ;
+  uint32_t runLength = 0 ;
+  while (outBits.size () < inCount) {
+    const bool bit = inBatch.bitAtIndex (idx) ;
+    idx += 1 ;
+    if (runLength == 5) { // Stuff bit
+      outStuffBitCount += 1 ;
+      runLength = 1 ;
+    }else{
+      runLength = (bit == previousBit) ? (runLength + 1) : 1 ;
+      outBits.push_back (bit) ;
+    }
+    previousBit = bit ;
+  }
+  if ((runLength == 5) && inStuffBitAfterLastBit) {
+    outStuffBitCount += 1 ;
+    idx += 1 ;
+  }
+  return idx ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static uint32_t enterBitInFDCRC (const uint32_t inCRC, const bool inBit, const uint32_t inCRCLength) {
+  const bool crcNext = inBit ^ (((inCRC >> (inCRCLength - 1)) & 1) != 0) ;
+  uint32_t crc = (inCRC << 1) & ((1U << inCRCLength) - 1) ;
+  if (crcNext) {
+    crc ^= (inCRCLength == 17) ? 0x1685B : 0x102899 ;
+  }
+  return crc ;
+}
+
+//----------------------------------------------------------------------------------------
+// A message is a valid frame if the bus carries its encoding from SOF up to the last but
+// one EOF bit (a dominant last EOF bit is an overload condition), except the SRR bit of
+// extended frames, that receivers accept dominant: the CRC is then checked on the bus.
+// CAN FD: the fixed stuff bits, the stuff count (dynamic stuff bits on the bus) and the
+// CRC (stuffed bits on the bus, and stuff count) are checked on the bus.
+
+static bool validEncoding (const CANDecodedMessage & inMessage,
+                           const CANFrameBatch & inBatch,
+                           const uint64_t inStart) {
+  CANFrameDescriptor descriptor ;
+  descriptor.mIdentifier = inMessage.mIdentifier ;
+  descriptor.mFrameFormat = inMessage.mExtended ? extendedFrame : standardFrame ;
+  descriptor.mFrameType = inMessage.mRemote ? remoteFrame : dataFrame ;
+  descriptor.mAckSlot = inMessage.mAcked ? ACK_SLOT_DOMINANT : ACK_SLOT_RECESSIVE ;
+  descriptor.mDataLength = inMessage.mDataCodeLength ;
+  descriptor.mFD = inMessage.mFD ;
+  descriptor.mBRS = inMessage.mBRS ;
+  descriptor.mESI = inMessage.mESI ;
+  for (uint32_t i=0 ; i<64 ; i++) {
+    descriptor.mData [i] = inMessage.mData [i] ;
+  }
+  const CANFrameBitsGenerator bits (descriptor) ;
+  const uint32_t crcBitCount = crcLength (descriptor) ;
+//--- CAN FD: stuff count and CRC field, a fixed stuff bit every 4 bits
+  const uint32_t fdFieldLength = inMessage.mFD ? (4 + crcBitCount) : 0 ;
+  const uint32_t fixedStuffBitCount = (fdFieldLength + 3) / 4 ;
+  CANFrameBatch expected ;
+  expected.append (bits) ;
+  const uint32_t destuffedLength = bits.frameLength () - 13 - bits.stuffBitCount () - fdFieldLength ;
+  std::vector <bool> expectedBits ;
+  uint32_t stuffBitCount = 0 ;
+  destuff (expected, 0, destuffedLength, !inMessage.mFD, expectedBits, stuffBitCount) ;
+  std::vector <bool> busBits ;
+  uint64_t idx = destuff (inBatch, inStart, destuffedLength, !inMessage.mFD, busBits, stuffBitCount) ;
+  bool ok = inMessage.mStuffBitCount == (stuffBitCount + fixedStuffBitCount) ;
+  const uint32_t headerAndDataLength = inMessage.mFD ? destuffedLength : (destuffedLength - 15) ;
+  uint16_t crc = 0 ;
+  for (uint32_t i=0 ; (i<headerAndDataLength) && ok ; i++) {
+    ok = (busBits [i] == expectedBits [i]) || (inMessage.mExtended && (i == 12)) ;
+    const bool crcNext = busBits [i] ^ ((crc & 0x4000) != 0) ;
+    crc = uint16_t ((crc << 1) & 0x7FFF) ;
+    if (crcNext) {
+      crc ^= 0x4599 ;
+    }
+  }
+  if (!inMessage.mFD) {
+    for (uint32_t i=destuffedLength-15 ; (i<destuffedLength) && ok ; i++) {
+      ok = busBits [i] == (((crc >> (destuffedLength - 1 - i)) & 1) != 0) ;
+    }
+  }else{
+    uint32_t fdCRC = 1U << (crcBitCount - 1) ;
+    for (uint64_t i=inStart ; i<idx ; i++) {
+      fdCRC = enterBitInFDCRC (fdCRC, inBatch.bitAtIndex (i), crcBitCount) ;
+    }
+    uint32_t field = 0 ;
+    for (uint32_t i=0 ; (i<fdFieldLength) && ok ; i++) {
+      if ((i % 4) == 0) { // Fixed stuff bit
+        ok = inBatch.bitAtIndex (idx) != inBatch.bitAtIndex (idx - 1) ;
+        idx += 1 ;
+      }
+      const bool bit = inBatch.bitAtIndex (idx) ;
+      idx += 1 ;
+      field = (field << 1) | bit ;
+      if (i < 4) {
+        fdCRC = enterBitInFDCRC (fdCRC, bit, crcBitCount) ;
+      }
+    }
+    const uint32_t count = stuffBitCount % 8 ;
+    const uint32_t gray = count ^ (count >> 1) ;
+    const uint32_t stuffCount = (gray << 1) | ((gray ^ (gray >> 1) ^ (gray >> 2)) & 1) ;
+    ok = ok
+      && ((field >> crcBitCount) == stuffCount)
+      && ((field & ((1U << crcBitCount) - 1)) == fdCRC)
+    ;
+  }
+  for (uint32_t i=bits.frameLength ()-13 ; (i<(bits.frameLength () - 4)) && ok ; i++) {
+    ok = bits.bitAtIndex (i) == inBatch.bitAtIndex (idx) ;
+    idx += 1 ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+class FuzzRunner {
+
+  public: FuzzRunner (void) :
+  mResults (),
+  mDecoder (&mResults),
+  mBatch (),
+  mCRCs (),
+  mStuffBitCounts (),
+  mStuffCounts (),
+  mFrameLengths (),
+  mEndsOfSamples (),
+  mDataPhases (),
+  mSampleNumbers (),
+  mBitTimeErrors () {
+  }
+
+  public: inline uint64_t bitCount (void) const { return mBatch.bitLength () ; }
+
+//--- Returns false if a frame fails: outFailedFrame is the first one
+  public: bool run (const std::vector <FuzzFrame> & inFrames,
+                    const FuzzDecoding & inDecoding,
+                    uint64_t & ioUndetectedCount,
+                    size_t & outFailedFrame,
+                    std::string & outFailure) {
+    buildStream (inFrames) ;
+    decodeStream (inDecoding) ;
+    return checkFrames (inFrames, ioUndetectedCount, outFailedFrame, outFailure) ;
+  }
+
+  private: void buildStream (const std::vector <FuzzFrame> & inFrames) {
+    mBatch.clear () ;
+    mBatch.reserve (inFrames.size ()) ;
+    mCRCs.clear () ;
+    mStuffBitCounts.clear () ;
+    mStuffCounts.clear () ;
+    mFrameLengths.clear () ;
+    mEndsOfSamples.clear () ;
+    mDataPhases.clear () ;
+    for (size_t i=0 ; i<inFrames.size () ; i++) {
+      const FuzzFrame & frame = inFrames [i] ;
+      const CANFrameDescriptor & descriptor = frame.mDescriptor ;
+      const CANFrameBitsGenerator bits (descriptor, (frame.mCorruption == CORRUPTION_CRC) ? frame.mCRCErrorMask : 0) ;
+      if ((frame.mCorruption == CORRUPTION_EARLY_SOF) && (mBatch.bitLength () > 0)) {
+        mBatch.truncate (mBatch.bitLength () - 1) ;
+      }
+      const uint64_t start = mBatch.bitLength () ;
+      mBatch.append (bits) ;
+      mCRCs.push_back (bits.crc ()) ;
+      mStuffBitCounts.push_back (bits.stuffBitCount ()) ;
+      const uint32_t fixedStuffBitCount = descriptor.mFD ? ((4 + crcLength (descriptor) + 3) / 4) : 0 ;
+      mStuffCounts.push_back ((bits.stuffBitCount () - fixedStuffBitCount) % 8) ;
+      mFrameLengths.push_back (bits.frameLength ()) ;
+      const bool intact = (frame.mCorruption == CORRUPTION_NONE) || (frame.mCorruption == CORRUPTION_EARLY_SOF) ;
+      if (intact && (bits.brsIndex () > 0)) { // From the BRS bit up to the CRC delimiter
+        mDataPhases.push_back (std::make_pair (start + bits.brsIndex (), start + bits.frameLength () - 13)) ;
+      }
+      uint32_t invertedCount = 0 ;
+      if ((frame.mCorruption == CORRUPTION_SINGLE) || (frame.mCorruption == CORRUPTION_STUFF)) {
+        invertedCount = 1 ;
+      }else if (frame.mCorruption == CORRUPTION_BURST) {
+        invertedCount = frame.mBitCount ;
+      }
+      for (uint32_t k=0 ; (k<invertedCount) && ((frame.mBitIndex + k) < bits.frameLength ()) ; k++) {
+        mBatch.invertBit (start + frame.mBitIndex + k) ;
+      }
+      if (frame.mCorruption == CORRUPTION_STUFF) {
+        appendErrorFlag (start + frame.mBitIndex + 1) ;
+      }else if (frame.mCorruption == CORRUPTION_CRC) {
+        appendErrorFlag (start + bits.frameLength () - 10) ; // After ACK DEL
+      }else if (frame.mCorruption == CORRUPTION_TRUNCATED) {
+        const uint32_t count = (frame.mBitIndex < bits.frameLength ()) ? frame.mBitIndex : bits.frameLength () ;
+        mBatch.truncate (start + count) ;
+        mEndsOfSamples.push_back (start + count) ;
+      }
+      if ((frame.mCorruption != CORRUPTION_NONE) && (frame.mCorruption != CORRUPTION_EARLY_SOF)) {
+        mBatch.appendIdle (FUZZ_RECOVERY_BIT_COUNT) ;
+      }
+    }
+    mBatch.appendIdle (FUZZ_RECOVERY_BIT_COUNT) ;
+  }
+
+  private: void appendErrorFlag (const uint64_t inBitIndex) {
+    mBatch.truncate (inBitIndex) ;
+    mBatch.appendIdle (FUZZ_ERROR_FLAG_BIT_COUNT) ;
+    for (uint32_t k=0 ; k<FUZZ_ERROR_FLAG_BIT_COUNT ; k++) {
+      mBatch.invertBit (inBitIndex + k) ;
+    }
+  }
+
+//--- The sample point of a bit follows the one of the previous bit by the bit time the
+//    decoder reports once the previous bit is entered. Bytes are not entered across an end
+//    of samples
+  private: void decodeStream (const FuzzDecoding & inDecoding) {
+    mResults.clear () ;
+    mBitTimeErrors.clear () ;
+    mDecoder.setCANFD (inDecoding.mCANFD, inDecoding.mDataSamplesPerBit) ;
+    mDecoder.reset (inDecoding.mNominalSamplesPerBit, true) ;
+    const uint64_t * words = mBatch.words () ;
+    const uint64_t length = mBatch.bitLength () ;
+    mSampleNumbers.resize (size_t (length + 1)) ;
+    size_t endIdx = 0 ;
+    size_t phaseIdx = 0 ;
+    uint64_t sampleNumber = 0 ;
+    uint64_t idx = 0 ;
+    while (idx < length) {
+      uint64_t stop = length ;
+      if (endIdx < mEndsOfSamples.size ()) {
+        if (mEndsOfSamples [endIdx] == idx) {
+          mDecoder.endOfSamples (sampleNumber) ;
+          endIdx += 1 ;
+        }
+        if (endIdx < mEndsOfSamples.size ()) {
+          stop = mEndsOfSamples [endIdx] ;
+        }
+      }
+      const uint32_t shift = uint32_t (idx % 64) ;
+      uint64_t word = words [idx / 64] << shift ;
+      if ((shift > 56) && ((idx / 64 + 1) < ((length + 63) / 64))) {
+        word |= words [idx / 64 + 1] >> (64 - shift) ;
+      }
+      const uint8_t byte = uint8_t (word >> 56) ;
+      const uint32_t count = ((stop - idx) < 8) ? uint32_t (stop - idx) : 8 ;
+      const uint32_t samplesPerBit = mDecoder.samplesPerBit () ;
+      uint32_t entered = 1 ;
+      if (inDecoding.mBitByBit) {
+        mDecoder.enterBit ((byte & 0x80) != 0, sampleNumber) ;
+      }else{
+        entered = mDecoder.enterBits (byte, count, sampleNumber) ;
+      }
+    //--- The bit time may only change after the last entered bit
+      for (uint32_t i=0 ; i<entered ; i++) {
+        mSampleNumbers [size_t (idx)] = sampleNumber ;
+        const uint32_t bitTime = ((i + 1) < entered) ? samplesPerBit : mDecoder.samplesPerBit () ;
+        while ((phaseIdx < mDataPhases.size ()) && (mDataPhases [phaseIdx].second <= idx)) {
+          phaseIdx += 1 ;
+        }
+        const bool dataPhase = (phaseIdx < mDataPhases.size ()) && (mDataPhases [phaseIdx].first <= idx) ;
+        if (bitTime != (dataPhase ? inDecoding.mDataSamplesPerBit : inDecoding.mNominalSamplesPerBit)) {
+          mBitTimeErrors.push_back (idx) ;
+        }
+        sampleNumber += bitTime ;
+        idx += 1 ;
+      }
+    }
+    mSampleNumbers [size_t (length)] = sampleNumber ;
+  }
+
+//--- Index of the bit sampled at inSampleNumber, bit length if none
+  private: uint64_t bitIndexAtSample (const uint64_t inSampleNumber) const {
+    const std::vector <uint64_t>::const_iterator it = std::lower_bound (mSampleNumbers.begin (),
+                                                                        mSampleNumbers.end () - 1,
+                                                                        inSampleNumber) ;
+    return ((it != (mSampleNumbers.end () - 1)) && (*it == inSampleNumber))
+      ? uint64_t (it - mSampleNumbers.begin ())
+      : mBatch.bitLength () ;
+  }
+
+//--- Results are dealt to frames by sample number: a frame owns the results from its SOF
+//    up to the next SOF
+  private: bool checkFrames (const std::vector <FuzzFrame> & inFrames,
+                             uint64_t & ioUndetectedCount,
+                             size_t & outFailedFrame,
+                             std::string & outFailure) {
+    size_t messageIdx = 0 ;
+    size_t crcIdx = 0 ;
+    size_t stuffCountIdx = 0 ;
+    size_t errorIdx = 0 ;
+    size_t bitTimeErrorIdx = 0 ;
+    for (size_t i=0 ; (i<inFrames.size ()) && outFailure.empty () ; i++) {
+      const FuzzFrame & frame = inFrames [i] ;
+      const uint64_t startBit = mBatch.frameStartAtIndex (i) ;
+      const uint64_t endBit = ((i + 1) < inFrames.size ()) ? mBatch.frameStartAtIndex (i + 1) : mBatch.bitLength () ;
+      const uint64_t start = mSampleNumbers [size_t (startBit)] ;
+      const uint64_t end = mSampleNumbers [size_t (endBit)] ;
+      const size_t firstMessage = messageIdx ;
+      while ((messageIdx < mResults.mMessages.size ()) && (mResults.mMessages [messageIdx].mStartSampleNumber < end)) {
+        messageIdx += 1 ;
+      }
+      const size_t firstCRC = crcIdx ;
+      while ((crcIdx < mResults.mCRCFields.size ()) && (mResults.mCRCFields [crcIdx].mEndSampleNumber < end)) {
+        crcIdx += 1 ;
+      }
+      const size_t firstStuffCount = stuffCountIdx ;
+      while ((stuffCountIdx < mResults.mStuffCountFields.size ()) && (mResults.mStuffCountFields [stuffCountIdx].mEndSampleNumber < end)) {
+        stuffCountIdx += 1 ;
+      }
+      const size_t firstError = errorIdx ;
+      while ((errorIdx < mResults.mErrors.size ()) && (mResults.mErrors [errorIdx].mEndSampleNumber < end)) {
+        errorIdx += 1 ;
+      }
+      const size_t firstBitTimeError = bitTimeErrorIdx ;
+      while ((bitTimeErrorIdx < mBitTimeErrors.size ()) && (mBitTimeErrors [bitTimeErrorIdx] < endBit)) {
+        bitTimeErrorIdx += 1 ;
+      }
+      const size_t messageCount = messageIdx - firstMessage ;
+      const size_t errorCount = errorIdx - firstError ;
+      const size_t stuffCountCount = stuffCountIdx - firstStuffCount ;
+      char text [128] = "" ;
+      switch (frame.mCorruption) {
+      case CORRUPTION_NONE :
+      case CORRUPTION_EARLY_SOF :
+        if (messageCount != 1) {
+          snprintf (text, sizeof (text), "%zu messages decoded", messageCount) ;
+        }else if ((crcIdx - firstCRC) != 1) {
+          snprintf (text, sizeof (text), "%zu CRC fields decoded", crcIdx - firstCRC) ;
+        }else if ((mResults.mCRCFields [firstCRC].mData1 != mCRCs [i]) || (mResults.mCRCFields [firstCRC].mData2 != 0)) {
+          snprintf (text, sizeof (text), "CRC %04X decoded as %04X, remainder %04X",
+                    unsigned (mCRCs [i]),
+                    unsigned (mResults.mCRCFields [firstCRC].mData1),
+                    unsigned (mResults.mCRCFields [firstCRC].mData2)) ;
+        }else if (errorCount != 0) {
+          snprintf (text, sizeof (text), "unexpected %s", errorList (firstError, errorIdx).c_str ()) ;
+        }else if (mResults.mMessages [firstMessage].mStuffBitCount != mStuffBitCounts [i]) {
+          snprintf (text, sizeof (text), "%u stuff bits decoded as %u",
+                    mStuffBitCounts [i], mResults.mMessages [firstMessage].mStuffBitCount) ;
+        }else if (stuffCountCount != (frame.mDescriptor.mFD ? 1 : 0)) {
+          snprintf (text, sizeof (text), "%zu stuff count fields decoded", stuffCountCount) ;
+        }else if ((stuffCountCount == 1)
+               && ((mResults.mStuffCountFields [firstStuffCount].mData1 != mStuffCounts [i])
+                || (mResults.mStuffCountFields [firstStuffCount].mData2 != 0))) {
+          snprintf (text, sizeof (text), "stuff count %u decoded as %u%s",
+                    mStuffCounts [i],
+                    unsigned (mResults.mStuffCountFields [firstStuffCount].mData1),
+                    (mResults.mStuffCountFields [firstStuffCount].mData2 != 0) ? " (error)" : "") ;
+        }else if (bitTimeErrorIdx != firstBitTimeError) {
+          snprintf (text, sizeof (text), "wrong bit time after bit %llu",
+                    (unsigned long long) (mBitTimeErrors [firstBitTimeError] - startBit)) ;
+        }else{
+          snprintf (text, sizeof (text), "%s",
+                    messageMismatch (mResults.mMessages [firstMessage], start, frame.mDescriptor, true).c_str ()) ;
+        }
+        break ;
+      case CORRUPTION_TRUNCATED :
+        if (frame.mBitIndex >= (mFrameLengths [i] - 3)) { // Message sent at EOF bit 7
+          if (messageCount != 1) {
+            snprintf (text, sizeof (text), "%zu messages decoded from %u bits",
+                      messageCount, frame.mBitIndex) ;
+          }else if (errorCount != 0) {
+            snprintf (text, sizeof (text), "unexpected %s", errorList (firstError, errorIdx).c_str ()) ;
+          }else{
+            snprintf (text, sizeof (text), "%s",
+                      messageMismatch (mResults.mMessages [firstMessage], start, frame.mDescriptor, true).c_str ()) ;
+          }
+        }else if (messageCount != 0) {
+          snprintf (text, sizeof (text), "message decoded from %u bits", frame.mBitIndex) ;
+        }else if ((errorCount != 1) || ((mResults.mErrors [firstError].mData1 & 0xFF) != uint64_t (CAN_TRUNCATED_FRAME))) {
+          snprintf (text, sizeof (text), "%s reported, one %s expected",
+                    errorList (firstError, errorIdx).c_str (), errorKindName (CAN_TRUNCATED_FRAME)) ;
+        }else if ((mResults.mErrors [firstError].mData1 >> 8) != uint64_t (CAN_NO_ERROR_FLAG)) {
+          snprintf (text, sizeof (text), "%s flag decoded",
+                    errorFlagName (CANErrorFlag (mResults.mErrors [firstError].mData1 >> 8))) ;
+        }
+        break ;
+      case CORRUPTION_CRC :
+      case CORRUPTION_STUFF : {
+        const CANErrorKind expected = (frame.mCorruption == CORRUPTION_CRC) ? CAN_CRC_ERROR : CAN_STUFF_ERROR ;
+        if (messageCount != 0) {
+          snprintf (text, sizeof (text), "%s accepted", corruptionName (frame.mCorruption)) ;
+        }else if (errorCount != 1) {
+          snprintf (text, sizeof (text), "%s reported, one %s expected",
+                    errorList (firstError, errorIdx).c_str (), errorKindName (expected)) ;
+        }else if ((mResults.mErrors [firstError].mData1 & 0xFF) != uint64_t (expected)) {
+          snprintf (text, sizeof (text), "%s reported, %s expected",
+                    errorName (mResults.mErrors [firstError]).c_str (), errorKindName (expected)) ;
+        }else if ((mResults.mErrors [firstError].mData1 >> 8) != uint64_t (CAN_ACTIVE_ERROR_FLAG)) {
+          snprintf (text, sizeof (text), "%s flag decoded",
+                    errorFlagName (CANErrorFlag (mResults.mErrors [firstError].mData1 >> 8))) ;
+        }
+        }break ;
+      default : // Single, burst
+        for (size_t m=firstMessage ; (m<messageIdx) && (text [0] == '\0') ; m++) {
+          const CANDecodedMessage & message = mResults.mMessages [m] ;
+          if (!validEncoding (message, mBatch, bitIndexAtSample (message.mStartSampleNumber))) {
+            snprintf (text, sizeof (text), "message decoded at sample %llu is not a valid frame",
+                      (unsigned long long) message.mStartSampleNumber) ;
+          }else if (!messageMismatch (message, start, frame.mDescriptor, false).empty ()) {
+            ioUndetectedCount += 1 ;
+          }
+        }
+        if ((text [0] == '\0') && (messageCount == 0) && (errorCount == 0)) {
+          snprintf (text, sizeof (text), "%s corruption not reported", corruptionName (frame.mCorruption)) ;
+        }
+        break ;
+      }
+      if (text [0] != '\0') {
+        outFailedFrame = i ;
+        outFailure = text ;
+      }
+    }
+    return outFailure.empty () ;
+  }
+
+  private: std::string errorList (const size_t inFirst, const size_t inEnd) const {
+    std::string result = inFirst == inEnd ? "no error" : "" ;
+    for (size_t e=inFirst ; e<inEnd ; e++) {
+      char at [32] ;
+      snprintf (at, sizeof (at), " at sample %llu", (unsigned long long) mResults.mErrors [e].mEndSampleNumber) ;
+      result += ((e > inFirst) ? ", " : "") + errorName (mResults.mErrors [e]) + at ;
+    }
+    return result ;
+  }
+
+  private: FuzzDecoderDelegate mResults ;
+  private: CANFrameDecoder mDecoder ;
+  private: CANFrameBatch mBatch ;
+  private: std::vector <uint32_t> mCRCs ; // As sent
+  private: std::vector <uint32_t> mStuffBitCounts ;
+  private: std::vector <uint32_t> mStuffCounts ; // CAN FD: dynamic stuff bit count modulo 8
+  private: std::vector <uint32_t> mFrameLengths ;
+  private: std::vector <uint64_t> mEndsOfSamples ; // Of truncated frames, in bit order
+  private: std::vector <std::pair <uint64_t, uint64_t> > mDataPhases ; // Bit ranges, intact frames
+  private: std::vector <uint64_t> mSampleNumbers ; // Of each bit, and of the end of the batch
+  private: std::vector <uint64_t> mBitTimeErrors ; // Bits followed by an unexpected bit time
+} ;
+
+//----------------------------------------------------------------------------------------
+//   Case files
+//----------------------------------------------------------------------------------------
+
+static std::string frameLine (const FuzzFrame & inFrame) {
+  const CANFrameDescriptor & descriptor = inFrame.mDescriptor ;
+  std::string data ;
+  for (uint32_t i=0 ; i<sentDataByteCount (descriptor) ; i++) {
+    char byte [3] ;
+    snprintf (byte, sizeof (byte), "%02X", descriptor.mData [i]) ;
+    data += byte ;
+  }
+  char line [256] ;
+  snprintf (line, sizeof (line), "frame %X %s %s %s %u %s",
+            descriptor.mIdentifier,
+            (descriptor.mFrameFormat == extendedFrame) ? "ext" : "std",
+            frameTypeName (descriptor),
+            (descriptor.mAckSlot == ACK_SLOT_DOMINANT) ? "ack" : "nack",
+            descriptor.mDataLength,
+            data.empty () ? "-" : data.c_str ()) ;
+  std::string result = line ;
+  switch (inFrame.mCorruption) {
+  case CORRUPTION_SINGLE :
+  case CORRUPTION_STUFF :
+  case CORRUPTION_TRUNCATED :
+    snprintf (line, sizeof (line), " %s %u", corruptionName (inFrame.mCorruption), inFrame.mBitIndex) ;
+    result += line ;
+    break ;
+  case CORRUPTION_BURST :
+    snprintf (line, sizeof (line), " burst %u %u", inFrame.mBitIndex, inFrame.mBitCount) ;
+    result += line ;
+    break ;
+  case CORRUPTION_CRC :
+    snprintf (line, sizeof (line), " crc %X", inFrame.mCRCErrorMask) ;
+    result += line ;
+    break ;
+  case CORRUPTION_EARLY_SOF :
+    result += " early-sof" ;
+    break ;
+  case CORRUPTION_NONE : case CORRUPTION_COUNT :
+    break ;
+  }
+  return result ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool parseFrameLine (const std::string & inLine, FuzzFrame & outFrame) {
+  std::istringstream stream (inLine) ;
+  std::string keyword, format, type, ack, data, corruption ;
+  uint32_t identifier = 0 ;
+  uint32_t dataLength = 0 ;
+  stream >> keyword >> std::hex >> identifier >> format >> type >> ack >> std::dec >> dataLength >> data ;
+  CANFrameDescriptor & descriptor = outFrame.mDescriptor ;
+  bool ok = !stream.fail ()
+    && (keyword == "frame")
+    && ((format == "std") || (format == "ext"))
+    && ((ack == "ack") || (ack == "nack"))
+    && (dataLength <= 15)
+  ;
+  uint32_t typeIdx = 0 ;
+  while ((typeIdx < 6) && (type != frameTypeName (typeIdx >= 2, typeIdx >= 4, (typeIdx % 2) != 0, typeIdx == 1))) {
+    typeIdx += 1 ;
+  }
+  ok = ok && (typeIdx < 6) ;
+  if (ok) {
+    descriptor.mIdentifier = identifier ;
+    descriptor.mFrameFormat = (format == "ext") ? extendedFrame : standardFrame ;
+    descriptor.mFrameType = (type == "remote") ? remoteFrame : dataFrame ;
+    descriptor.mAckSlot = (ack == "ack") ? ACK_SLOT_DOMINANT : ACK_SLOT_RECESSIVE ;
+    descriptor.mDataLength = uint8_t (dataLength) ;
+    descriptor.mFD = typeIdx >= 2 ;
+    descriptor.mBRS = typeIdx >= 4 ;
+    descriptor.mESI = (typeIdx >= 2) && ((typeIdx % 2) != 0) ;
+    for (uint32_t i=0 ; i<64 ; i++) {
+      descriptor.mData [i] = 0 ;
+    }
+    const uint32_t byteCount = sentDataByteCount (descriptor) ;
+    ok = (byteCount == 0) ? (data == "-") : (data.size () == (2 * byteCount)) ;
+    for (uint32_t i=0 ; (i<byteCount) && ok ; i++) {
+      char * end = NULL ;
+      const std::string byte = data.substr (2 * i, 2) ;
+      descriptor.mData [i] = uint8_t (strtoul (byte.c_str (), &end, 16)) ;
+      ok = *end == '\0' ;
+    }
+  }
+  outFrame.mCorruption = CORRUPTION_NONE ;
+  outFrame.mBitIndex = 0 ;
+  outFrame.mBitCount = 0 ;
+  outFrame.mCRCErrorMask = 0 ;
+  if (ok && (stream >> corruption)) {
+    if ((corruption == "single") || (corruption == "stuff")) {
+      outFrame.mCorruption = (corruption == "single") ? CORRUPTION_SINGLE : CORRUPTION_STUFF ;
+      ok = !(stream >> outFrame.mBitIndex).fail () ;
+    }else if (corruption == "burst") {
+      outFrame.mCorruption = CORRUPTION_BURST ;
+      ok = !(stream >> outFrame.mBitIndex >> outFrame.mBitCount).fail () ;
+    }else if (corruption == "early-sof") {
+      outFrame.mCorruption = CORRUPTION_EARLY_SOF ;
+    }else if (corruption == "truncated") {
+      outFrame.mCorruption = CORRUPTION_TRUNCATED ;
+      ok = !(stream >> outFrame.mBitIndex).fail () && (outFrame.mBitIndex > 0) ;
+    }else if (corruption == "crc") {
+      uint32_t mask = 0 ;
+      outFrame.mCorruption = CORRUPTION_CRC ;
+      ok = !(stream >> std::hex >> mask).fail () && (mask > 0) && (mask < (1U << crcLength (descriptor))) ;
+      outFrame.mCRCErrorMask = mask ;
+    }else{
+      ok = false ;
+    }
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool readCase (const std::string & inPath,
+                      std::vector <FuzzFrame> & outFrames,
+                      FuzzDecoding & outDecoding,
+                      std::string & outError) {
+  std::ifstream file (inPath.c_str ()) ;
+  bool ok = file.is_open () ;
+  if (!ok) {
+    outError = "cannot open file" ;
+  }
+  outFrames.clear () ;
+  outDecoding = FuzzDecoding () ;
+  std::string line ;
+  uint32_t lineNumber = 0 ;
+  while (ok && std::getline (file, line)) {
+    lineNumber += 1 ;
+    if (!line.empty () && (line [line.size () - 1] == '\r')) {
+      line.resize (line.size () - 1) ;
+    }
+    if (line.empty () || (line [0] == '#')) {
+    }else if (line == "bit-by-bit") {
+      outDecoding.mBitByBit = true ;
+    }else if (line.compare (0, 7, "can-fd ") == 0) {
+      std::istringstream stream (line.substr (7)) ;
+      outDecoding.mCANFD = true ;
+      ok = !(stream >> outDecoding.mNominalSamplesPerBit >> outDecoding.mDataSamplesPerBit).fail ()
+        && (outDecoding.mNominalSamplesPerBit > 0)
+        && (outDecoding.mDataSamplesPerBit > 0)
+      ;
+      if (!ok) {
+        outError = "syntax error line " + std::to_string (lineNumber) ;
+      }
+    }else{
+      FuzzFrame frame ;
+      ok = parseFrameLine (line, frame) && (outDecoding.mCANFD || !frame.mDescriptor.mFD) ;
+      if (ok) {
+        outFrames.push_back (frame) ;
+      }else{
+        outError = "syntax error line " + std::to_string (lineNumber) ;
+      }
+    }
+  }
+  if (ok && outFrames.empty ()) {
+    outError = "no frame" ;
+    ok = false ;
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool writeCase (const std::string & inPath,
+                       const std::string & inTitle,
+                       const std::string & inFailure,
+                       const std::vector <FuzzFrame> & inFrames,
+                       const FuzzDecoding & inDecoding) {
+  std::ofstream file (inPath.c_str ()) ;
+  if (file.is_open ()) {
+    file << "# " << inTitle << "\n" ;
+    file << "# last frame: " << inFailure << "\n" ;
+    if (inDecoding.mBitByBit) {
+      file << "bit-by-bit\n" ;
+    }
+    if (inDecoding.mCANFD) {
+      file << "can-fd " << inDecoding.mNominalSamplesPerBit << " " << inDecoding.mDataSamplesPerBit << "\n" ;
+    }
+    for (size_t i=0 ; i<inFrames.size () ; i++) {
+      file << frameLine (inFrames [i]) << "\n" ;
+    }
+  }
+  return file.good () ;
+}
+
+//----------------------------------------------------------------------------------------
+//   Minimization
+//----------------------------------------------------------------------------------------
+// ioFrames ends with the failing frame; a candidate is kept if its last frame still fails
+
+static bool lastFrameFails (FuzzRunner & ioRunner,
+                            const std::vector <FuzzFrame> & inFrames,
+                            const FuzzDecoding & inDecoding,
+                            std::string & outFailure) {
+  uint64_t undetectedCount = 0 ;
+  size_t failedFrame = 0 ;
+  std::string failure ;
+  const bool fails = !ioRunner.run (inFrames, inDecoding, undetectedCount, failedFrame, failure)
+    && (failedFrame == (inFrames.size () - 1))
+  ;
+  if (fails) {
+    outFailure = failure ;
+  }
+  return fails ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static void minimize (FuzzRunner & ioRunner,
+                      std::vector <FuzzFrame> & ioFrames,
+                      const FuzzDecoding & inDecoding,
+                      std::string & ioFailure) {
+//--- Preceding frames: none, or only the previous one
+  std::vector <FuzzFrame> candidate (1, ioFrames.back ()) ;
+  if (lastFrameFails (ioRunner, candidate, inDecoding, ioFailure)) {
+    ioFrames = candidate ;
+  }else if (ioFrames.size () > 2) {
+    candidate.insert (candidate.begin (), ioFrames [ioFrames.size () - 2]) ;
+    if (lastFrameFails (ioRunner, candidate, inDecoding, ioFailure)) {
+      ioFrames = candidate ;
+    }
+  }
+//--- Shorter burst
+  candidate = ioFrames ;
+  while ((candidate.back ().mCorruption == CORRUPTION_BURST) && (candidate.back ().mBitCount > 1)) {
+    candidate.back ().mBitCount -= 1 ;
+    if (lastFrameFails (ioRunner, candidate, inDecoding, ioFailure)) {
+      ioFrames = candidate ;
+    }else{
+      candidate.back ().mBitCount = 0 ; // Stop
+    }
+  }
+//--- Cleared data bytes (a stuff bit index would no longer designate a stuff bit)
+  if (ioFrames.back ().mCorruption != CORRUPTION_STUFF) {
+    for (uint32_t i=0 ; i<sentDataByteCount (ioFrames.back ().mDescriptor) ; i++) {
+      candidate = ioFrames ;
+      if (candidate.back ().mDescriptor.mData [i] != 0) {
+        candidate.back ().mDescriptor.mData [i] = 0 ;
+        if (lastFrameFails (ioRunner, candidate, inDecoding, ioFailure)) {
+          ioFrames = candidate ;
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------
+//   Fuzzing
+//----------------------------------------------------------------------------------------
+
+class FuzzSettings {
+  public: uint64_t mFrameCount ;
+  public: uint64_t mSeed ;
+  public: uint32_t mCorruptionPercent ;
+  public: std::string mCaseDirectory ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+class FuzzShared {
+  public: FuzzShared (void) :
+  mNextBatch (0),
+  mMutex (),
+  mStatistics (),
+  mSavedCaseCount (0) {
+  }
+
+  public: std::atomic <uint64_t> mNextBatch ;
+  public: std::mutex mMutex ; // For the following properties, and stderr
+  public: FuzzStatistics mStatistics ;
+  public: uint32_t mSavedCaseCount ;
+} ;
+
+//----------------------------------------------------------------------------------------
+
+static void saveFailure (const FuzzSettings & inSettings,
+                         const uint64_t inBatch,
+                         const size_t inFailedFrame,
+                         std::vector <FuzzFrame> & ioFrames,
+                         const FuzzDecoding & inDecoding,
+                         std::string & ioFailure,
+                         FuzzRunner & ioRunner,
+                         FuzzShared & ioShared) {
+  char title [128] ;
+  snprintf (title, sizeof (title), "seed %llu, batch %llu, frame %zu",
+            (unsigned long long) inSettings.mSeed, (unsigned long long) inBatch, inFailedFrame) ;
+  ioFrames.resize (inFailedFrame + 1) ;
+  minimize (ioRunner, ioFrames, inDecoding, ioFailure) ;
+  std::lock_guard <std::mutex> lock (ioShared.mMutex) ;
+  if (ioShared.mSavedCaseCount < FUZZ_MAX_SAVED_CASES) {
+    char name [96] ;
+    snprintf (name, sizeof (name), "/fuzz-%llu-%llu-%zu.case",
+              (unsigned long long) inSettings.mSeed, (unsigned long long) inBatch, inFailedFrame) ;
+    const std::string path = inSettings.mCaseDirectory + name ;
+    if (writeCase (path, std::string ("CANRoundTripFuzzer case, ") + title, ioFailure, ioFrames, inDecoding)) {
+      fprintf (stderr, "%s: %s, saved to %s\n", title, ioFailure.c_str (), path.c_str ()) ;
+      ioShared.mSavedCaseCount += 1 ;
+    }else{
+      fprintf (stderr, "%s: %s, cannot write %s\n", title, ioFailure.c_str (), path.c_str ()) ;
+    }
+  }else{
+    fprintf (stderr, "%s: %s\n", title, ioFailure.c_str ()) ;
+  }
+}
+
+//----------------------------------------------------------------------------------------
+
+static void worker (const FuzzSettings & inSettings, FuzzShared & ioShared) {
+  const uint64_t batchCount = (inSettings.mFrameCount + FUZZ_BATCH_FRAME_COUNT - 1) / FUZZ_BATCH_FRAME_COUNT ;
+  FuzzRunner runner ;
+  FuzzStatistics statistics ;
+  std::vector <FuzzFrame> frames ;
+  uint64_t batch = ioShared.mNextBatch.fetch_add (1) ;
+  while (batch < batchCount) {
+    const uint64_t remaining = inSettings.mFrameCount - batch * FUZZ_BATCH_FRAME_COUNT ;
+    const size_t frameCount = size_t ((remaining < FUZZ_BATCH_FRAME_COUNT) ? remaining : FUZZ_BATCH_FRAME_COUNT) ;
+    FuzzRandom random ((inSettings.mSeed << 40) ^ batch) ;
+    FuzzDecoding decoding ;
+    decoding.mBitByBit = (batch % 4) == 3 ;
+    decoding.mCANFD = (batch % 8) >= 4 ;
+    if (decoding.mCANFD) { // Data bit time shorter than the nominal one
+      decoding.mNominalSamplesPerBit = 2 + random.below (15) ;
+      decoding.mDataSamplesPerBit = 1 + random.below (decoding.mNominalSamplesPerBit - 1) ;
+    }
+    frames.resize (frameCount) ;
+    for (size_t i=0 ; i<frameCount ; i++) {
+      randomFrame (random, inSettings.mCorruptionPercent, decoding.mCANFD, frames [i]) ;
+      statistics.mCorruptionCount [frames [i].mCorruption] += 1 ;
+    }
+    size_t failedFrame = 0 ;
+    std::string failure ;
+    const bool ok = runner.run (frames, decoding, statistics.mUndetectedCount, failedFrame, failure) ;
+    statistics.mFrameCount += frameCount ;
+    statistics.mBitCount += runner.bitCount () ;
+    if (!ok) {
+      statistics.mFailedBatchCount += 1 ;
+      saveFailure (inSettings, batch, failedFrame, frames, decoding, failure, runner, ioShared) ;
+    }
+    batch = ioShared.mNextBatch.fetch_add (1) ;
+  }
+  std::lock_guard <std::mutex> lock (ioShared.mMutex) ;
+  ioShared.mStatistics.merge (statistics) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool fuzz (const FuzzSettings & inSettings, const size_t inWorkerCount) {
+  FuzzShared shared ;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now () ;
+  std::vector <std::thread> threads ;
+  for (size_t w=0 ; w<inWorkerCount ; w++) {
+    threads.push_back (std::thread (worker, std::cref (inSettings), std::ref (shared))) ;
+  }
+  for (size_t w=0 ; w<inWorkerCount ; w++) {
+    threads [w].join () ;
+  }
+  const double seconds = std::chrono::duration <double> (std::chrono::steady_clock::now () - start).count () ;
+//--- Report
+  const FuzzStatistics & statistics = shared.mStatistics ;
+  printf ("Frames: %llu in %.3f s, %zu threads: %.0f frames/s, %.1f Mbit/s\n",
+          (unsigned long long) statistics.mFrameCount,
+          seconds,
+          inWorkerCount,
+          (seconds > 0.0) ? (double (statistics.mFrameCount) / seconds) : 0.0,
+          (seconds > 0.0) ? (double (statistics.mBitCount) / seconds / 1.0e6) : 0.0) ;
+  printf ("Injected:") ;
+  for (uint32_t i=CORRUPTION_SINGLE ; i<CORRUPTION_COUNT ; i++) {
+    printf (" %s %llu", corruptionName (FuzzCorruption (i)), (unsigned long long) statistics.mCorruptionCount [i]) ;
+  }
+  printf ("\nUndetected corruptions (valid frames on the bus): %llu\n", (unsigned long long) statistics.mUndetectedCount) ;
+  printf ("Failed batches: %llu\n", (unsigned long long) statistics.mFailedBatchCount) ;
+  return statistics.mFailedBatchCount == 0 ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static bool replay (const std::vector <std::string> & inPaths) {
+  FuzzRunner runner ;
+  bool ok = true ;
+  for (size_t i=0 ; i<inPaths.size () ; i++) {
+    std::vector <FuzzFrame> frames ;
+    FuzzDecoding decoding ;
+    std::string error ;
+    uint64_t undetectedCount = 0 ;
+    size_t failedFrame = 0 ;
+    if (!readCase (inPaths [i], frames, decoding, error)) {
+      printf ("%s: %s\n", inPaths [i].c_str (), error.c_str ()) ;
+      ok = false ;
+    }else if (!runner.run (frames, decoding, undetectedCount, failedFrame, error)) {
+      printf ("%s: frame %zu: %s\n", inPaths [i].c_str (), failedFrame, error.c_str ()) ;
+      ok = false ;
+    }else{
+      printf ("%s: ok\n", inPaths [i].c_str ()) ;
+    }
+  }
+  return ok ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static void usage (void) {
+  fprintf (stderr, "usage: CANRoundTripFuzzer [-n FRAMES] [-s SEED] [-e PERCENT] [-j THREADS] [-o DIRECTORY]\n"
+                   "       CANRoundTripFuzzer -r CASE ...\n") ;
+  exit (2) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+static uint64_t optionValue (const int inArgc,
+                             char * inArgv [],
+                             int & ioIndex,
+                             const uint64_t inMinimum,
+                             const uint64_t inMaximum) {
+  ioIndex += 1 ;
+  char * end = NULL ;
+  const unsigned long long value = (ioIndex < inArgc) ? strtoull (inArgv [ioIndex], &end, 10) : 0 ;
+  if ((end == NULL) || (*end != '\0') || (value < inMinimum) || (value > inMaximum)) {
+    usage () ;
+  }
+  return uint64_t (value) ;
+}
+
+//----------------------------------------------------------------------------------------
+
+int main (int argc, char * argv []) {
+  FuzzSettings settings ;
+  settings.mFrameCount = 10 * 1000 * 1000 ;
+  settings.mSeed = 1 ;
+  settings.mCorruptionPercent = 20 ;
+  settings.mCaseDirectory = "." ;
+  size_t workerCount = std::thread::hardware_concurrency () ;
+  std::vector <std::string> casePaths ;
+  bool replayCases = false ;
+  for (int i=1 ; i<argc ; i++) {
+    const std::string argument = argv [i] ;
+    if (replayCases) {
+      casePaths.push_back (argument) ;
+    }else if (argument == "-n") {
+      settings.mFrameCount = optionValue (argc, argv, i, 1, UINT64_MAX) ;
+    }else if (argument == "-s") {
+      settings.mSeed = optionValue (argc, argv, i, 0, 0xFFFFFF) ;
+    }else if (argument == "-e") {
+      settings.mCorruptionPercent = uint32_t (optionValue (argc, argv, i, 0, 100)) ;
+    }else if (argument == "-j") {
+      workerCount = size_t (optionValue (argc, argv, i, 1, 1024)) ;
+    }else if ((argument == "-o") && ((i + 1) < argc)) {
+      i += 1 ;
+      settings.mCaseDirectory = argv [i] ;
+    }else if (argument == "-r") {
+      replayCases = true ;
+    }else{
+      usage () ;
+    }
+  }
+  bool ok ;
+  if (replayCases) {
+    if (casePaths.empty ()) {
+      usage () ;
+    }
+    ok = replay (casePaths) ;
+  }else{
+    ok = fuzz (settings, (workerCount > 0) ? workerCount : 1) ;
+  }
+  return ok ? 0 : 1 ;
+}
+
+//----------------------------------------------------------------------------------------